@@ -68,6 +68,10 @@ class TekkiRecipe(ConanFile):
         self.requires("fmt/10.2.1")
         self.requires("cli11/2.4.1")
 
+        # Asset compression
+        self.requires("zstd/1.5.5")
+        self.requires("lz4/1.9.4")
+
         # Half precision
         self.requires("half/2.2.0")
 
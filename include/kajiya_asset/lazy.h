@@ -0,0 +1,210 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <type_traits>
+#include <typeindex>
+#include <unordered_map>
+
+namespace kajiya_asset {
+
+class LazyCache;
+
+// FNV-1a; used to build the content identities of lazy computations.
+class IdentityHasher {
+public:
+    IdentityHasher& Bytes(const void* data, size_t size) {
+        const auto* bytes = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < size; ++i) {
+            state_ = (state_ ^ bytes[i]) * 0x100000001b3ull;
+        }
+        return *this;
+    }
+
+    template<typename T>
+    IdentityHasher& Value(const T& value) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        return Bytes(&value, sizeof(T));
+    }
+
+    IdentityHasher& String(std::string_view str) {
+        Value(str.size());
+        return Bytes(str.data(), str.size());
+    }
+
+    uint64_t Finish() const { return state_; }
+
+private:
+    uint64_t state_ = 0xcbf29ce484222325ull;
+};
+
+/**
+ * A deferred computation of a `T`, keyed by a content identity.
+ *
+ * Two lazies with the same identity must produce equivalent results; LazyCache relies on that
+ * to share one evaluation between them.
+ */
+template<typename T>
+class Lazy {
+public:
+    using Worker = std::function<std::shared_ptr<T>(const std::shared_ptr<LazyCache>&)>;
+
+    Lazy() = default;
+    Lazy(uint64_t identity, Worker worker) : identity_(identity), worker_(std::move(worker)) {}
+
+    // Evaluates through `cache` when given one, directly otherwise.
+    std::shared_ptr<T> Eval(const std::shared_ptr<LazyCache>& cache) const;
+
+    // Runs the worker, bypassing any cache.
+    std::shared_ptr<T> Compute(const std::shared_ptr<LazyCache>& cache) const {
+        if (!worker_) {
+            return std::make_shared<T>();
+        }
+        return worker_(cache);
+    }
+
+    uint64_t Identity() const { return identity_; }
+
+private:
+    uint64_t identity_ = 0;
+    Worker worker_;
+};
+
+struct LazyCacheStats {
+    uint64_t Hits = 0;         // served from a live result
+    uint64_t InFlightJoins = 0; // waited on a computation another thread had started
+    uint64_t Misses = 0;       // computed
+    double ComputeSeconds = 0.0;
+};
+
+/**
+ * Memoises Lazy evaluations by (type, identity).
+ *
+ * Concurrent requests for the same identity share a single computation. Results are held
+ * weakly: once every caller drops its pointer the memory is released, and a later request
+ * recomputes. Exceptions propagate to every caller waiting on the failed computation, and the
+ * failure is not cached.
+ */
+class LazyCache : public std::enable_shared_from_this<LazyCache> {
+public:
+    static std::shared_ptr<LazyCache> Create() {
+        return std::make_shared<LazyCache>();
+    }
+
+    template<typename T>
+    std::shared_ptr<T> GetOrCreate(const Lazy<T>& lazy) {
+        Key key{std::type_index(typeid(T)), lazy.Identity()};
+        std::promise<std::shared_ptr<void>> promise;
+
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            Entry& entry = entries_[key];
+
+            if (auto value = entry.Value.lock()) {
+                hits_.fetch_add(1, std::memory_order_relaxed);
+                return std::static_pointer_cast<T>(value);
+            }
+
+            if (entry.InFlight.valid()) {
+                auto in_flight = entry.InFlight;
+                lock.unlock();
+                inFlightJoins_.fetch_add(1, std::memory_order_relaxed);
+                return std::static_pointer_cast<T>(in_flight.get());
+            }
+
+            misses_.fetch_add(1, std::memory_order_relaxed);
+            entry.InFlight = promise.get_future().share();
+            PruneExpiredLocked();
+        }
+
+        std::shared_ptr<T> value;
+        try {
+            auto start = std::chrono::steady_clock::now();
+            value = lazy.Compute(shared_from_this());
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            computeNanos_.fetch_add(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()),
+                                    std::memory_order_relaxed);
+        } catch (...) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                entries_[key].InFlight = {};
+            }
+            promise.set_exception(std::current_exception());
+            throw;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            Entry& entry = entries_[key];
+            entry.Value = value;
+            entry.InFlight = {};
+        }
+        promise.set_value(value);
+        return value;
+    }
+
+    LazyCacheStats GetStats() const {
+        LazyCacheStats stats;
+        stats.Hits = hits_.load(std::memory_order_relaxed);
+        stats.InFlightJoins = inFlightJoins_.load(std::memory_order_relaxed);
+        stats.Misses = misses_.load(std::memory_order_relaxed);
+        stats.ComputeSeconds = static_cast<double>(computeNanos_.load(std::memory_order_relaxed)) * 1.0e-9;
+        return stats;
+    }
+
+private:
+    struct Key {
+        std::type_index Type;
+        uint64_t Identity;
+
+        bool operator==(const Key& other) const { return Type == other.Type && Identity == other.Identity; }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const {
+            return key.Type.hash_code() ^ static_cast<size_t>(key.Identity * 0x9e3779b97f4a7c15ull);
+        }
+    };
+
+    struct Entry {
+        std::weak_ptr<void> Value;
+        std::shared_future<std::shared_ptr<void>> InFlight;
+    };
+
+    // Drops entries whose results have been released, amortised over map growth.
+    void PruneExpiredLocked() {
+        if (entries_.size() < pruneThreshold_) {
+            return;
+        }
+        std::erase_if(entries_, [](const auto& item) {
+            return !item.second.InFlight.valid() && item.second.Value.expired();
+        });
+        pruneThreshold_ = std::max<size_t>(64, entries_.size() * 2);
+    }
+
+    std::mutex mutex_;
+    std::unordered_map<Key, Entry, KeyHash> entries_;
+    size_t pruneThreshold_ = 64;
+
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> inFlightJoins_{0};
+    std::atomic<uint64_t> misses_{0};
+    std::atomic<uint64_t> computeNanos_{0};
+};
+
+template<typename T>
+std::shared_ptr<T> Lazy<T>::Eval(const std::shared_ptr<LazyCache>& cache) const {
+    if (!cache) {
+        return Compute(nullptr);
+    }
+    return cache->GetOrCreate(*this);
+}
+
+} // namespace kajiya_asset
@@ -4,72 +4,82 @@
 #include <memory>
 #include <string>
 #include <filesystem>
+#include <fstream>
+#include <functional>
 #include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
 #include "tekki/asset/GpuImage.h"
+#include "kajiya_asset/lazy.h"
 
 namespace kajiya_asset {
 
-// Forward declarations
-class LazyCache;
+using Mesh = tekki::asset::TriangleMesh;
+using InstancedScene = tekki::asset::InstancedTriangleScene;
 
-template<typename T>
-class Lazy {
-public:
-    Lazy() = default;
-
-    std::shared_ptr<T> Eval(const std::shared_ptr<LazyCache>& /*cache*/) const {
-        // Placeholder implementation
-        return std::make_shared<T>();
-    }
-
-    uint64_t Identity() const {
-        // Placeholder implementation
-        return 0;
-    }
-};
+// Bumped whenever the same inputs start baking to different output. Part of every image
+// identity and bake key, so caches from an older baker are never reused.
+constexpr uint32_t BAKE_VERSION = 5;
 
 struct LoadGltfScene {
     std::filesystem::path Path;
     float Scale;
     glm::quat Rotation;
 
-    Lazy<class Mesh> IntoLazy() const {
-        // Placeholder implementation
-        return Lazy<class Mesh>();
-    }
+    // Identity covers the load parameters and the file's size and modification time.
+    Lazy<Mesh> IntoLazy() const;
+    // Same, loading unique meshes and their instances; see tekki::asset::LoadGltfScene::RunInstanced.
+    Lazy<InstancedScene> IntoInstancedLazy() const;
 };
 
-class Mesh {
-public:
-    // Placeholder mesh class
-    std::vector<glm::vec3> vertices;
-    std::vector<glm::vec3> normals;
-    std::vector<glm::vec2> texcoords;
-    std::vector<uint32_t> indices;
+// Unique maps moved into shared atlas images while packing, and the atlas pages holding them.
+struct AtlasStats {
+    size_t Maps = 0;
+    size_t Pages = 0;
 };
 
 class PackedTriangleMesh {
 public:
+    tekki::asset::PackedTriangleMesh Packed;
     std::vector<std::shared_ptr<Lazy<tekki::asset::GpuImage::Proto>>> Maps;
+    // Estimated peak memory needed to bake the matching entry of `Maps`.
+    std::vector<uint64_t> MapBakeBytes;
+    AtlasStats Atlases;
 
-    void FlattenInto(std::ofstream& /*file*/) const {
-        // Placeholder implementation
+    void FlattenInto(std::ofstream& file) const {
+        tekki::asset::StreamFlattenSink sink(file);
+        Packed.FlattenInto(sink);
     }
 };
 
-PackedTriangleMesh PackTriangleMesh(const std::shared_ptr<Mesh>& mesh);
-
-class LazyCache : public std::enable_shared_from_this<LazyCache> {
+class PackedScene {
 public:
-    static std::shared_ptr<LazyCache> Create() {
-        return std::make_shared<LazyCache>();
-    }
+    tekki::asset::PackedScene::Proto Packed;
+    // Deduplicated across every mesh of the scene.
+    std::vector<std::shared_ptr<Lazy<tekki::asset::GpuImage::Proto>>> Maps;
+    std::vector<uint64_t> MapBakeBytes;
+    AtlasStats Atlases;
 
-    template<typename T>
-    std::shared_ptr<T> GetOrCreate(const Lazy<T>& lazy) {
-        // Placeholder implementation
-        return lazy.Eval(shared_from_this());
+    void FlattenInto(std::ofstream& file) const {
+        tekki::asset::StreamFlattenSink sink(file);
+        Packed.FlattenInto(sink);
     }
 };
 
-} // namespace kajiya_asset
\ No newline at end of file
+// Builds the GPU image for one material map. Identity covers the image content and the
+// parameters that affect the baked result, so maps sharing a texture share one bake.
+Lazy<tekki::asset::GpuImage::Proto> MakeMapImageLazy(const tekki::asset::MeshMaterialMap& map);
+
+// Packs `mesh` and resolves its material maps to image lazies, deduplicated by identity.
+// `Packed.Maps` holds the matching asset references.
+//
+// With options.AtlasMaxTextureSize set, small maps are packed into shared atlas images grouped by
+// bake parameters: placeholders always, decoded images when every material using them keeps its
+// (transformed) UVs within [0, 1], as an atlas can't repeat them. Their MapTransforms are
+// rewritten to address their texels in the atlas; placeholders get a constant transform.
+PackedTriangleMesh PackTriangleMesh(const std::shared_ptr<Mesh>& mesh, const tekki::asset::PackTriangleMeshOptions& options = {});
+
+// Packs every mesh of `scene` in parallel, resolving their maps as PackTriangleMesh does.
+PackedScene PackInstancedScene(const std::shared_ptr<InstancedScene>& scene,
+                               const tekki::asset::PackTriangleMeshOptions& options = {});
+
+} // namespace kajiya_asset
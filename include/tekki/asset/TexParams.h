@@ -18,6 +18,19 @@ enum class TexCompressionMode {
     Rg
 };
 
+// Downsampling kernel of the mip chain; both filter in linear space.
+enum class TexMipFilter {
+    Box,
+    Kaiser
+};
+
+// Speed/quality trade-off of the BC block compressors.
+enum class TexCompressionQuality {
+    Fast,
+    Normal,
+    Best
+};
+
 struct TexParams {
     // Transform parameters
     glm::vec2 scale = glm::vec2(1.0f);
@@ -30,9 +43,13 @@ struct TexParams {
     bool srgb = false;
     bool mipmaps = true;
     bool anisotropic_filtering = true;
+    TexMipFilter MipFilter = TexMipFilter::Box;
+    // Most mip levels to keep, the full-size one included; 0 keeps the whole chain.
+    uint32_t MaxMipCount = 0;
 
     // Compression and swizzling (from mesh.h)
     TexCompressionMode Compression = TexCompressionMode::None;
+    TexCompressionQuality CompressionQuality = TexCompressionQuality::Normal;
     std::optional<std::array<size_t, 4>> ChannelSwizzle;
 
     // Legacy aliases
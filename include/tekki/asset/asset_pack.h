@@ -0,0 +1,152 @@
+#pragma once
+
+#include "tekki/asset/compression.h"
+#include "tekki/asset/mesh.h"
+#include "tekki/core/mapped_file.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+namespace tekki::asset {
+
+enum class PackEntryKind : uint32_t {
+    Mesh = 1,
+    Image = 2,
+    Scene = 3 // PackedScene: unique meshes and their instances
+};
+
+// File layout: PackHeader, page-aligned entries, then the table of contents sorted by Identity.
+struct PackHeader {
+    std::array<char, 8> Magic;
+    uint32_t Version;
+    uint32_t EntryCount;
+    uint64_t TocOffset;
+    uint64_t Reserved;
+};
+static_assert(sizeof(PackHeader) == 32);
+
+struct PackEntry {
+    uint64_t Identity; // AssetRef identity, or PackNameIdentity for named assets
+    PackEntryKind Kind;
+    CompressionCodec Codec; // Stored entries are flat bytes; compressed ones are block streams
+    uint64_t Offset;
+    uint64_t StoredSize;
+    uint64_t Size; // Flattened size once decompressed
+};
+static_assert(sizeof(PackEntry) == 40);
+
+constexpr std::array<char, 8> PACK_MAGIC = {'T', 'E', 'K', 'K', 'I', 'P', 'A', 'K'};
+constexpr uint32_t PACK_VERSION = 2;
+
+// Payloads at least this large start on their own page inside stored entries.
+constexpr uint64_t PACK_PAGE_ALIGN_FROM = 64 * 1024;
+
+// Identity of an asset addressed by name rather than content, like the baked scene mesh.
+uint64_t PackNameIdentity(std::string_view name);
+
+/**
+ * Writes an asset pack.
+ *
+ * Add may be called from several threads; entries are flattened (and compressed) outside the
+ * lock and appended in arrival order. The pack is written next to `path` and only renamed into
+ * place by Finish, so an interrupted bake never leaves a truncated pack behind.
+ */
+class AssetPackWriter {
+public:
+    // `codec` is tried on every entry, block by block; entries it doesn't shrink are stored as is.
+    explicit AssetPackWriter(const std::filesystem::path& path, CompressionCodec codec = CompressionCodec::None);
+    ~AssetPackWriter();
+
+    AssetPackWriter(const AssetPackWriter&) = delete;
+    AssetPackWriter& operator=(const AssetPackWriter&) = delete;
+
+    // Returns false, writing nothing, if `identity` is already in the pack.
+    bool Add(uint64_t identity, PackEntryKind kind, FlatWriter& writer);
+    bool Add(uint64_t identity, const GpuImage::Proto& image);
+    // Copies an entry of another pack as stored, without decoding it.
+    bool AddStored(const PackEntry& entry, std::span<const uint8_t> stored);
+
+    void Finish();
+
+    uint64_t GetStoredBytes() const;
+    uint64_t GetFlatBytes() const;
+
+private:
+    void PadToPage();
+
+    std::filesystem::path path_;
+    std::filesystem::path tempPath_;
+    CompressionCodec codec_;
+    std::ofstream file_;
+    std::vector<PackEntry> entries_;
+    std::unordered_set<uint64_t> identities_; // Of entries_, for duplicate checks
+    uint64_t offset_ = 0;
+    uint64_t flatBytes_ = 0;
+    bool finished_ = false;
+    mutable std::mutex mutex_;
+};
+
+/**
+ * Read side of an asset pack: one mapping for the whole file and a binary-searched table of
+ * contents. Stored entries are read in place; compressed ones are decoded block-parallel,
+ * either into a heap buffer owned by the returned pointer or into caller memory via LoadInto.
+ */
+class AssetPack {
+public:
+    struct DecodeStats {
+        uint64_t StoredBytes = 0;
+        uint64_t DecodedBytes = 0;
+        double Seconds = 0.0; // Wall time of decoding calls; overlapping calls all count
+
+        double GigabytesPerSecond() const { return Seconds > 0.0 ? DecodedBytes / Seconds / 1.0e9 : 0.0; }
+    };
+
+    static std::shared_ptr<const AssetPack> Open(const std::filesystem::path& path);
+    static std::shared_ptr<const AssetPack> Open(std::shared_ptr<const tekki::core::MappedFile> file);
+
+    std::span<const PackEntry> GetEntries() const { return entries_; }
+    const PackEntry* Find(uint64_t identity) const;
+
+    // Bytes of an entry as stored in the file, compressed or not.
+    std::span<const uint8_t> GetStored(const PackEntry& entry) const;
+
+    // Flattened bytes of an entry; they keep the pack mapped while referenced.
+    std::shared_ptr<const uint8_t> Load(const PackEntry& entry) const;
+
+    // Decodes (or copies) an entry into `dst`, which must be exactly entry.Size bytes, such as a
+    // mapped staging buffer.
+    void LoadInto(const PackEntry& entry, std::span<uint8_t> dst) const;
+
+    // Totals over compressed entries decoded so far.
+    DecodeStats GetDecodeStats() const;
+
+    // The flat asset stored under `identity`, or null when the pack doesn't have it.
+    template<typename T>
+    std::shared_ptr<const T> Get(uint64_t identity) const {
+        const PackEntry* entry = Find(identity);
+        if (!entry) {
+            return nullptr;
+        }
+        auto bytes = Load(*entry);
+        return std::shared_ptr<const T>(bytes, reinterpret_cast<const T*>(bytes.get()));
+    }
+
+private:
+    AssetPack() = default;
+
+    std::shared_ptr<const tekki::core::MappedFile> file_;
+    std::span<const PackEntry> entries_;
+    mutable std::atomic<uint64_t> storedBytes_{0};
+    mutable std::atomic<uint64_t> decodedBytes_{0};
+    mutable std::atomic<uint64_t> decodeNanoseconds_{0};
+};
+
+} // namespace tekki::asset
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "tekki/asset/TexParams.h"
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace tekki::asset {
+
+enum class BcMode {
+    Bc5,
+    Bc7
+};
+
+constexpr size_t BC_BLOCK_BYTES = 16;
+
+// Number of 4x4 blocks covering a `width` x `height` image, partial blocks included.
+inline size_t BcBlockCount(uint32_t width, uint32_t height) {
+    return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4);
+}
+
+/**
+ * Compresses tightly packed RGBA8 pixels to BC5 (red and green) or BC7.
+ *
+ * Blocks are encoded in parallel, one task per row of blocks; partial blocks at the right and
+ * bottom edges repeat the edge pixels. BC7 uses mode 6 (one subset, RGBA) for every block and,
+ * above TexCompressionQuality::Fast, also tries mode 1 (two subsets, RGB) on opaque blocks.
+ * With `needsAlpha == false` the alpha channel is ignored and decodes as 254 or 255.
+ */
+std::vector<uint8_t> CompressBc(std::span<const uint8_t> rgba, uint32_t width, uint32_t height, BcMode mode,
+                                bool needsAlpha, TexCompressionQuality quality);
+
+// Decodes blocks written by CompressBc back to RGBA8; BC5 decodes with blue 0 and alpha 255.
+// Only the BC7 modes the compressor emits (1 and 6) are supported.
+std::vector<uint8_t> DecompressBc(std::span<const uint8_t> blocks, uint32_t width, uint32_t height, BcMode mode);
+
+} // namespace tekki::asset
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace tekki::asset {
+
+// General-purpose byte codecs for baked assets. Values are stored in asset files.
+enum class CompressionCodec : uint32_t {
+    None = 0,
+    Zstd = 1,
+    Lz4 = 2
+};
+
+const char* CompressionCodecName(CompressionCodec codec);
+
+// `level` 0 picks the codec's default; LZ4 has a single level.
+std::vector<uint8_t> CompressBytes(std::span<const uint8_t> src, CompressionCodec codec, int level = 0);
+
+// Decodes `src` into `dst`, which must be exactly the uncompressed size.
+void DecompressBytes(std::span<const uint8_t> src, CompressionCodec codec, std::span<uint8_t> dst);
+
+/**
+ * Block streams: data cut into independently compressed blocks of at most
+ * COMPRESSION_BLOCK_SIZE, so both ends run block-parallel and a reader can decode straight
+ * into its destination (e.g. a mapped upload buffer) without an intermediate copy.
+ *
+ * Layout: BlockStreamHeader, BlockCount CompressedBlocks, then the blocks. Blocks the codec
+ * doesn't shrink are stored as is.
+ */
+constexpr size_t COMPRESSION_BLOCK_SIZE = 256 * 1024;
+
+struct BlockStreamHeader {
+    uint32_t BlockCount;
+    CompressionCodec Codec;
+    uint64_t Size; // Decompressed
+};
+static_assert(sizeof(BlockStreamHeader) == 16);
+
+struct CompressedBlock {
+    uint64_t Offset;       // Into the decompressed data
+    uint64_t StoredOffset; // From the start of the stream
+    uint32_t Size;
+    uint32_t StoredSize;   // Equal to Size for blocks stored as is
+};
+static_assert(sizeof(CompressedBlock) == 24);
+
+// `sections` are (offset, size) ranges of `src`, like FlatWriter::GetSectionRanges(). Sections
+// of at least a block start a block of their own, so each large array decodes by whole
+// blocks; smaller ones share blocks with their neighbours.
+std::vector<uint8_t> CompressBlocks(std::span<const uint8_t> src, CompressionCodec codec,
+                                    std::span<const std::pair<uint64_t, uint64_t>> sections = {}, int level = 0);
+
+// Decompressed size of a block stream; throws if its header or block table is malformed.
+uint64_t BlockStreamSize(std::span<const uint8_t> stream);
+
+// Decodes a block stream into `dst`, which must be exactly BlockStreamSize(stream) bytes.
+void DecompressBlocks(std::span<const uint8_t> stream, std::span<uint8_t> dst);
+
+} // namespace tekki::asset
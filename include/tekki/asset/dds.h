@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace tekki::asset {
+
+/**
+ * DirectDraw Surface container, legacy and DX10 headers.
+ *
+ * Parsing only reads the header: every surface (one mip of one array slice) is a span into the
+ * original bytes, which stay alive through GetBacking(). Opening a file maps it, so pre-compressed
+ * textures reach the baked output without being read into or copied through the heap.
+ */
+class DdsImage {
+public:
+    static bool IsDds(std::span<const uint8_t> bytes);
+
+    // Surfaces borrow from `bytes`, which must remain valid for as long as `backing` is alive.
+    static std::shared_ptr<const DdsImage> Parse(std::span<const uint8_t> bytes, std::shared_ptr<const void> backing);
+    static std::shared_ptr<const DdsImage> Open(const std::filesystem::path& path);
+
+    VkFormat GetFormat() const { return format_; }
+    uint32_t GetWidth() const { return width_; }
+    uint32_t GetHeight() const { return height_; }
+    uint32_t GetDepth() const { return depth_; }
+    uint32_t GetMipCount() const { return mipCount_; }
+    // Array slices, counting the six faces of every cubemap.
+    uint32_t GetSliceCount() const { return sliceCount_; }
+    bool IsCubemap() const { return cubemap_; }
+
+    // Tightly packed rows (of blocks, for block-compressed formats) of every depth slice of `mip`.
+    std::span<const uint8_t> GetSurface(uint32_t mip, uint32_t slice = 0) const;
+    const std::shared_ptr<const void>& GetBacking() const { return backing_; }
+
+private:
+    DdsImage() = default;
+
+    VkFormat format_ = VK_FORMAT_UNDEFINED;
+    uint32_t width_ = 0;
+    uint32_t height_ = 0;
+    uint32_t depth_ = 1;
+    uint32_t mipCount_ = 1;
+    uint32_t sliceCount_ = 1;
+    bool cubemap_ = false;
+    std::vector<std::span<const uint8_t>> surfaces_; // slice-major, as stored in the file
+    std::shared_ptr<const void> backing_;
+};
+
+} // namespace tekki::asset
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "tekki/asset/exr.h"
+#include "tekki/asset/image.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace tekki::asset {
+
+// Cube faces are stored +X, -X, +Y, -Y, +Z, -Z, the layer order of a Vulkan cube image.
+constexpr uint32_t CUBE_FACE_COUNT = 6;
+
+// Coefficients of an order-3 (bands 0 to 2) spherical harmonics projection.
+constexpr uint32_t SH_COEFFICIENT_COUNT = 9;
+
+// Linear RGBA32F cube map; Mips[level] holds the six faces of that level one after another,
+// each MipExtent(Size, level) texels square.
+struct HdrCubemap {
+    uint32_t Size = 0;
+    std::vector<std::vector<float>> Mips;
+
+    size_t FaceFloats(uint32_t level) const;
+};
+
+// Direction through (u, v) of a face, both in [-1, 1] from its top-left corner; not normalised.
+glm::vec3 CubeFaceDirection(uint32_t face, float u, float v);
+
+// Resamples a latitude-longitude image (+Y up, u = 0.5 looking down +X) to a cube with `size`
+// texel faces and builds its box-filtered mip chain.
+HdrCubemap CubemapFromEquirect(const HdrImage& equirect, uint32_t size);
+
+struct GgxPrefilterOptions {
+    // GGX samples per output texel.
+    uint32_t SampleCount = 256;
+    // Levels of the result, the mirror-like top one included; 0 keeps the full chain.
+    uint32_t MipCount = 0;
+};
+
+/**
+ * Prefilters `radiance` (with its mip chain) for the split-sum specular approximation: level l
+ * of the result is convolved with a GGX lobe of perceptual roughness l / (levels - 1), taking
+ * view and reflection directions equal to the normal.
+ *
+ * Samples are importance sampled from a Hammersley set and read from a source mip matched to
+ * their solid angle (filtered importance sampling), so few samples stay noise free. The sample
+ * set of a level is built once and rotated per texel. Rows of every face of every level are
+ * filtered in parallel.
+ */
+HdrCubemap PrefilterGgx(const HdrCubemap& radiance, const GgxPrefilterOptions& options = {});
+
+// Order-3 spherical harmonics of the irradiance of an environment, cosine lobe convolution
+// already applied: Evaluate(n) is the irradiance E(n) on a surface facing n, so a Lambertian
+// surface reflects albedo * Evaluate(n) / pi.
+struct ShIrradiance {
+    std::array<glm::vec3, SH_COEFFICIENT_COUNT> Coefficients{};
+
+    glm::vec3 Evaluate(const glm::vec3& normal) const;
+};
+
+// Projects a cube map's radiance onto spherical harmonics, weighting texels by solid angle.
+// A level of at most 64 texels is used; bands 0 to 2 lose nothing to the box filter above it.
+ShIrradiance ProjectShIrradiance(const HdrCubemap& radiance);
+
+// RGBA16F cube image: Extent is {Size, Size, 6}, each mip the six faces in turn.
+GpuImage::Proto CreateCubeGpuImage(const HdrCubemap& cube);
+
+// The nine coefficients as a 9x1 RGBA32F image, alpha zero, for upload next to the cube.
+GpuImage::Proto CreateShGpuImage(const ShIrradiance& sh);
+
+struct EnvironmentBakeOptions {
+    uint32_t CubeSize = 256;
+    GgxPrefilterOptions Specular;
+};
+
+struct BakedEnvironment {
+    GpuImage::Proto Specular;
+    GpuImage::Proto Irradiance;
+    ShIrradiance Sh;
+};
+
+// Equirectangular environment to a GGX-prefiltered specular cube and SH irradiance.
+BakedEnvironment BakeEnvironment(const HdrImage& equirect, const EnvironmentBakeOptions& options = {});
+
+} // namespace tekki::asset
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "tekki/asset/image.h"
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace tekki::asset {
+
+// Linear RGBA32F pixels, rows top to bottom.
+struct HdrImage {
+    uint32_t Width = 0;
+    uint32_t Height = 0;
+    std::vector<float> Rgba;
+};
+
+bool IsExr(std::span<const uint8_t> bytes);
+
+/**
+ * Decodes the first part of an OpenEXR image with the OpenEXR core library, reading straight
+ * from `bytes` (typically a mapped file).
+ *
+ * Scanline and tiled images are supported; of a tiled mip or rip map only the top level is read.
+ * Chunks are decoded in parallel, each into its own rows of the result. Channels R, G, B and A
+ * are picked by name, preferring unlayered ones over "layer.R"; a lone Y channel is read as grey.
+ * Missing colour channels are zero and missing alpha is one.
+ */
+HdrImage DecodeExr(std::span<const uint8_t> bytes);
+
+// Converts floats to binary16 exactly like tekki::core::FloatToHalf (NaN payloads aside), eight
+// at a time with F16C where the CPU has it.
+void ConvertFloatsToHalves(std::span<const float> src, std::span<uint16_t> dst);
+
+// An RGBA16F (VK_FORMAT_R16G16B16A16_SFLOAT) image with the full box-filtered mip chain, or only
+// the top level when `mips` is false. Levels are filtered in float, then converted to half.
+GpuImage::Proto CreateHdrGpuImage(const HdrImage& image, bool mips = true);
+
+// DecodeExr followed by CreateHdrGpuImage.
+GpuImage::Proto LoadExrGpuImage(const ImageSource& source, bool mips = true);
+
+} // namespace tekki::asset
@@ -2,14 +2,18 @@
 
 #include <vector>
 #include <memory>
+#include <optional>
 #include <string>
 #include <filesystem>
 #include <array>
+#include <span>
 #include <glm/glm.hpp>
 #include <vulkan/vulkan.h>
 #include "tekki/core/result.h"
 #include "tekki/asset/TexParams.h"
 #include "tekki/asset/GpuImage.h"
+#include "tekki/asset/bc_compress.h"
+#include "tekki/asset/dds.h"
 
 namespace tekki::asset {
 
@@ -18,19 +22,27 @@ enum class ImageSourceType {
     Memory
 };
 
+/**
+ * Encoded image bytes: a read-only mapping of a file, or a buffer taken over from the caller.
+ *
+ * Copies share the bytes. Consumers that keep a span from GetData() past the source's lifetime
+ * hold on to GetBacking(), which owns the mapping or buffer.
+ */
 class ImageSource {
 public:
     ImageSource(const std::filesystem::path& path);
-    ImageSource(const std::vector<uint8_t>& data);
+    ImageSource(std::vector<uint8_t> data);
     
     ImageSourceType GetType() const;
     std::filesystem::path GetPath() const;
-    const std::vector<uint8_t>& GetData() const;
+    std::span<const uint8_t> GetData() const;
+    const std::shared_ptr<const void>& GetBacking() const;
 
 private:
     ImageSourceType type_;
     std::filesystem::path path_;
-    std::vector<uint8_t> data_;
+    std::span<const uint8_t> data_;
+    std::shared_ptr<const void> backing_;
 };
 
 struct RawRgba8Image {
@@ -46,16 +58,16 @@ enum class RawImageType {
 class RawImage {
 public:
     RawImage(const RawRgba8Image& rgba8Image);
-    RawImage(void* ddsData); // Placeholder for DDS data
+    RawImage(std::shared_ptr<const DdsImage> dds);
     
     RawImageType GetType() const;
     const RawRgba8Image& GetRgba8Image() const;
-    void* GetDdsData() const;
+    const std::shared_ptr<const DdsImage>& GetDds() const;
 
 private:
     RawImageType type_;
     RawRgba8Image rgba8Image_;
-    void* ddsData_;
+    std::shared_ptr<const DdsImage> dds_;
 };
 
 enum class LoadImageType {
@@ -66,17 +78,29 @@ enum class LoadImageType {
 class LoadImage {
 public:
     static LoadImage FromPath(const std::filesystem::path& path);
-    static LoadImage FromMemory(const std::vector<uint8_t>& data);
+    static LoadImage FromMemory(std::vector<uint8_t> data);
     
     LoadImageType GetType() const;
-    std::vector<uint8_t> Evaluate();
+    // Maps a lazy path on first use; immediate data is handed out as is.
+    std::shared_ptr<const ImageSource> Evaluate();
 
 private:
     LoadImageType type_;
     std::filesystem::path lazyPath_;
-    std::vector<uint8_t> immediateData_;
+    std::shared_ptr<const ImageSource> source_;
 };
 
+// Decodes an encoded image (PNG, JPEG, TGA, ...) to 8-bit RGBA. DDS files are parsed instead of
+// decoded, their surfaces borrowing the source's bytes.
+RawImage DecodeImage(const ImageSource& source);
+
+// Rough peak memory needed to decode and bake `source`, read from the image header without decoding.
+uint64_t EstimateImageBakeBytes(const ImageSource& source);
+
+// Width and height from the header of an image DecodeImage would decode to RGBA8; empty for DDS
+// files and unrecognised data.
+std::optional<glm::u32vec2> PeekImageExtent(const ImageSource& source);
+
 class CreatePlaceholderImage {
 public:
     explicit CreatePlaceholderImage(const std::array<uint8_t, 4>& values);
@@ -86,11 +110,6 @@ private:
     std::array<uint8_t, 4> values_;
 };
 
-enum class BcMode {
-    Bc5,
-    Bc7
-};
-
 class CreateGpuImage {
 public:
     CreateGpuImage(const std::shared_ptr<RawImage>& image, const tekki::asset::TexParams& params);
@@ -99,20 +118,15 @@ public:
 
 private:
     tekki::asset::GpuImage::Proto ProcessRgba8(const RawRgba8Image& src);
-    tekki::asset::GpuImage::Proto ProcessDds(void* ddsData);
+    tekki::asset::GpuImage::Proto ProcessDds(const std::shared_ptr<const DdsImage>& dds);
 
     std::vector<uint8_t> CompressMip(const std::vector<uint8_t>& mipData, uint32_t width, uint32_t height, BcMode bcMode, bool needsAlpha);
     void SwizzleChannels(std::vector<uint8_t>& mipData, const std::array<uint8_t, 4>& swizzle);
-    std::vector<uint8_t> ProcessMip(const std::vector<uint8_t>& mipData, uint32_t width, uint32_t height, bool shouldCompress, BcMode bcMode, const std::array<uint8_t, 4>& swizzle);
+    std::vector<uint8_t> ProcessMip(std::vector<uint8_t> mipData, uint32_t width, uint32_t height, bool shouldCompress, BcMode bcMode, const std::array<uint8_t, 4>& swizzle);
     uint32_t RoundUpToBlock(uint32_t value, uint32_t minImgDim);
 
     std::shared_ptr<RawImage> image_;
     tekki::asset::TexParams params_;
 };
 
-namespace dds_util {
-    uint32_t GetTextureSize(uint32_t pitch, uint32_t pitchHeight, uint32_t height, uint32_t depth);
-    uint32_t GetPitch(void* dds, uint32_t width);
-}
-
 } // namespace tekki::asset
\ No newline at end of file
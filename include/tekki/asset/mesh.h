@@ -5,7 +5,10 @@
 #include <memory>
 #include <string>
 #include <optional>
+#include <ostream>
+#include <type_traits>
 #include <array>
+#include <span>
 #include <glm/glm.hpp>
 #include <glm/gtc/quaternion.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -15,6 +18,8 @@
 
 namespace tekki::asset {
 
+class ImageSource;
+
 class MeshMaterialMap {
 public:
     enum class Type {
@@ -23,16 +28,16 @@ public:
     };
 
     struct ImageData {
-        // ImageSource Source; // TODO: Replace with actual ImageSource type
+        std::shared_ptr<const ImageSource> Source;
         TexParams Params;
     };
 
     MeshMaterialMap() = default;
     
-    static MeshMaterialMap CreateImage(/*ImageSource source,*/ TexParams params) {
+    static MeshMaterialMap CreateImage(std::shared_ptr<const ImageSource> source, TexParams params) {
         MeshMaterialMap map;
         map.Type = Type::Image;
-        // map.ImageData.Source = source;
+        map.ImageData.Source = std::move(source);
         map.ImageData.Params = params;
         return map;
     }
@@ -85,6 +90,26 @@ struct TriangleMesh {
     TriangleMesh() = default;
 };
 
+// One placement of a mesh of an instanced scene: the mesh's index and the top three rows of its
+// row-major object-to-world transform. Mirroring transforms keep the mesh's own winding, so a
+// negative determinant flips which faces are front-facing.
+#pragma pack(push, 1)
+struct SceneInstance {
+    uint32_t Mesh;
+    uint32_t Padding;
+    std::array<float, 12> Transform;
+};
+#pragma pack(pop)
+
+// A scene as unique object-space meshes and their instances, rather than one merged mesh.
+// Each mesh carries only the materials and maps it uses.
+struct InstancedTriangleScene {
+    std::vector<TriangleMesh> Meshes;
+    std::vector<SceneInstance> Instances;
+    // glTF meshes whose geometry and materials matched an earlier one, which replaced them.
+    size_t DuplicateMeshes = 0;
+};
+
 class LoadGltfScene {
 public:
     std::string Path;
@@ -94,7 +119,11 @@ public:
     LoadGltfScene(std::string path, float scale, glm::quat rotation)
         : Path(std::move(path)), Scale(scale), Rotation(rotation) {}
 
+    // Every primitive of every node, transformed into one world-space mesh.
     TriangleMesh Run();
+    // Each glTF mesh decoded once in its own space and placed by instances; meshes with equal
+    // content are merged even when the glTF lists them separately.
+    InstancedTriangleScene RunInstanced();
 };
 
 #pragma pack(push, 1)
@@ -105,6 +134,67 @@ struct PackedVertex {
 #pragma pack(pop)
 
 uint32_t PackUnitDirection11_10_11(float x, float y, float z);
+std::array<float, 3> UnpackUnitDirection11_10_11(uint32_t packed);
+
+// Compact counterpart of PackedVertex: position as 16-bit unorm within the mesh bounds,
+// normal as an 8:8 octahedral vector. See mesh_quantize.h.
+#pragma pack(push, 1)
+struct QuantizedVertex {
+    std::array<uint16_t, 3> Pos;
+    uint16_t Normal;
+};
+#pragma pack(pop)
+
+constexpr uint32_t MAX_MESHLET_VERTICES = 64;
+constexpr uint32_t MAX_MESHLET_TRIANGLES = 124;
+
+// A cluster of up to MAX_MESHLET_TRIANGLES triangles over up to MAX_MESHLET_VERTICES vertices.
+// `VertexOffset` indexes `MeshletVertices` (global vertex ids); `TriangleOffset` indexes
+// `MeshletTriangles`, three local vertex ids per triangle, padded so every meshlet starts
+// 4-byte aligned. A meshlet is backfacing from `eye` when
+// dot(normalize(ConeApex - eye), ConeAxis) >= ConeCutoff.
+#pragma pack(push, 1)
+struct Meshlet {
+    uint32_t VertexOffset;
+    uint32_t TriangleOffset;
+    uint32_t VertexCount;
+    uint32_t TriangleCount;
+    std::array<float, 3> Center;
+    float Radius;
+    std::array<float, 3> ConeApex;
+    float ConeCutoff;
+    std::array<float, 3> ConeAxis;
+    float Padding;
+};
+#pragma pack(pop)
+
+// A simplified level of detail: `IndexCount` indices at `IndexOffset` into `LodIndices`, over the
+// same vertices as the full mesh. `Error` is how far the surface may have moved, in object-space
+// units, for picking a level by its projected size. The level's material ranges start at
+// `FirstRange` and run up to the next level's; once CompactIndices has moved some of them to
+// 16-bit indices, `IndexOffset` and `IndexCount` only cover the 32-bit ones left.
+#pragma pack(push, 1)
+struct MeshLod {
+    uint32_t IndexOffset;
+    uint32_t IndexCount;
+    float Error;
+    uint32_t FirstRange;
+};
+#pragma pack(pop)
+
+// Triangles of one material: `IndexCount` indices from `FirstIndex`. Ranges with 4-byte indices
+// point into `Indices` for the full mesh and into `LodIndices` for coarser levels; ranges with
+// 2-byte indices point into `ShortIndices`, whose entries are relative to `BaseVertex`. Each
+// level's ranges are sorted by material.
+#pragma pack(push, 1)
+struct MaterialRange {
+    uint32_t MaterialId;
+    uint32_t FirstIndex;
+    uint32_t IndexCount;
+    uint32_t BaseVertex;
+    uint32_t IndexSize; // Bytes per index: 4 or 2
+};
+#pragma pack(pop)
 
 template<typename T>
 class FlatVec {
@@ -128,24 +218,107 @@ public:
     const T* end() const { return GetData() + GetLength(); }
 };
 
-class FlattenCtx {
+// Destination for FlatWriter output.
+class FlattenSink {
+public:
+    virtual ~FlattenSink() = default;
+    virtual void Write(const uint8_t* data, size_t size) = 0;
+};
+
+class VectorFlattenSink final : public FlattenSink {
 public:
-    std::optional<size_t> SectionIdx;
-    std::vector<uint8_t> Bytes;
-    std::vector<struct DeferredBlob> Deferred;
+    explicit VectorFlattenSink(std::vector<uint8_t>& bytes) : bytes_(bytes) {}
+    void Write(const uint8_t* data, size_t size) override;
 
-    FlattenCtx() = default;
+private:
+    std::vector<uint8_t>& bytes_;
+};
 
-    void AllocateSectionIndices();
-    void Finish(std::vector<uint8_t>& writer);
+class StreamFlattenSink final : public FlattenSink {
+public:
+    explicit StreamFlattenSink(std::ostream& stream) : stream_(stream) {}
+    void Write(const uint8_t* data, size_t size) override;
 
 private:
-    void AllocateSectionIndicesImpl(size_t& counter);
+    std::ostream& stream_;
 };
 
-struct DeferredBlob {
-    size_t FixupAddr;
-    FlattenCtx Nested;
+// Writes into caller-owned memory such as a file mapping sized with FlatWriter::Size().
+class SpanFlattenSink final : public FlattenSink {
+public:
+    explicit SpanFlattenSink(std::span<uint8_t> dst) : dst_(dst) {}
+    void Write(const uint8_t* data, size_t size) override;
+    size_t Written() const { return written_; }
+
+private:
+    std::span<uint8_t> dst_;
+    size_t written_ = 0;
+};
+
+/**
+ * Streaming builder for flat assets.
+ *
+ * Every FlatVec payload lives in its own section; sections are laid out breadth-first, each
+ * aligned to SECTION_ALIGNMENT. Payloads are referenced rather than copied, so only FlatVec
+ * headers and plain fields are buffered: the layout is computed up front, offsets are patched
+ * into those small buffers, and everything is written to the sink in a single pass.
+ */
+class FlatWriter {
+public:
+    using SectionId = size_t;
+    static constexpr SectionId ROOT = 0;
+    static constexpr uint64_t SECTION_ALIGNMENT = 8;
+    static constexpr uint64_t PAGE_ALIGNMENT = 4096;
+
+    FlatWriter();
+
+    // Starts every section whose payload is at least `minPayloadBytes` on a PAGE_ALIGNMENT
+    // boundary, so large arrays can be mapped or uploaded page by page; 0 turns it off.
+    void SetPageAlignedSections(uint64_t minPayloadBytes);
+
+    // Appends plain bytes to `section`.
+    void WriteInline(SectionId section, const void* data, size_t size);
+
+    template<typename T>
+    void WritePlain(SectionId section, const T& value) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        WriteInline(section, &value, sizeof(T));
+    }
+
+    // Appends a FlatVec header with `len` elements to `section` and returns the new section that
+    // holds the elements. `payload` is borrowed and must stay alive until WriteTo returns; nested
+    // vectors leave it empty and write their own headers into the returned section.
+    SectionId WriteVec(SectionId section, uint64_t len, std::span<const uint8_t> payload = {});
+
+    template<typename T>
+    SectionId WriteVec(SectionId section, std::span<const T> elems) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        return WriteVec(section, elems.size(),
+                        std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(elems.data()), elems.size_bytes()));
+    }
+
+    // Total flattened size in bytes.
+    uint64_t Size();
+    // (offset, size) of every section in file order, for codecs that cut along them.
+    std::vector<std::pair<uint64_t, uint64_t>> GetSectionRanges();
+    void WriteTo(FlattenSink& sink);
+
+private:
+    struct Section {
+        std::vector<uint8_t> Inline;
+        std::span<const uint8_t> Payload;
+        std::vector<std::pair<size_t, SectionId>> Fixups; // Offset field position in Inline -> target
+        std::vector<SectionId> Children;
+        uint64_t Addr = 0;
+    };
+
+    void Layout();
+
+    std::vector<Section> sections_;
+    std::vector<SectionId> order_;
+    uint64_t size_ = 0;
+    uint64_t pageAlignFrom_ = 0;
+    bool laidOut_ = false;
 };
 
 template<typename T>
@@ -163,8 +336,19 @@ namespace GpuImage {
         uint32_t Format; // VkFormat
         std::array<uint32_t, 3> Extent;
         std::vector<std::vector<uint8_t>> Mips;
-
-        void FlattenInto(std::vector<uint8_t>& writer);
+        // Levels borrowed from `Backing` (e.g. a mapped DDS file) rather than owned; when set they
+        // are used instead of Mips and only read when the image is flattened.
+        std::vector<std::span<const uint8_t>> MipViews;
+        std::shared_ptr<const void> Backing;
+
+        size_t GetMipCount() const { return MipViews.empty() ? Mips.size() : MipViews.size(); }
+        std::span<const uint8_t> GetMip(size_t level) const {
+            return MipViews.empty() ? std::span<const uint8_t>(Mips[level]) : MipViews[level];
+        }
+
+        void WriteFlat(FlatWriter& writer) const;
+        void FlattenInto(FlattenSink& sink) const;
+        void FlattenInto(std::vector<uint8_t>& writer) const;
     };
 
     struct Flat {
@@ -181,11 +365,39 @@ namespace PackedTriMesh {
         std::vector<std::array<float, 4>> Tangents;
         std::vector<std::array<float, 4>> Colors;
         std::vector<uint32_t> Indices;
+        // Per-vertex material, used while packing; SortTrianglesByMaterial replaces it with
+        // MaterialRanges.
         std::vector<uint32_t> MaterialIds;
         std::vector<MeshMaterial> Materials;
         std::vector<AssetRef<GpuImage::Flat>> Maps;
-        
-        void FlattenInto(std::vector<uint8_t>& writer);
+        std::vector<Meshlet> Meshlets;
+        std::vector<uint32_t> MeshletVertices;
+        std::vector<uint8_t> MeshletTriangles;
+
+        // Quantised streams, filled by QuantizeVertexStreams. When present they replace Verts,
+        // Uvs, Tangents, Colors and Indices, which are then left empty.
+        std::vector<QuantizedVertex> QuantizedVerts;
+        std::vector<uint32_t> HalfUvs;
+        std::vector<uint32_t> OctTangents;
+        std::vector<uint32_t> Rgba8Colors;
+        std::vector<uint8_t> IndexStream;
+        uint64_t IndexStreamCount = 0;
+        std::array<float, 3> PositionMin{};
+        std::array<float, 3> PositionScale{};
+
+        // Coarser levels of detail, finest first; see BuildLodChain. Indices is level 0.
+        std::vector<MeshLod> Lods;
+        std::vector<uint32_t> LodIndices;
+
+        // Level 0 ranges first, then those of each entry of Lods.
+        std::vector<MaterialRange> MaterialRanges;
+        // Indices of the 16-bit material ranges, filled by CompactIndices.
+        std::vector<uint16_t> ShortIndices;
+
+        // Writes the Flat fields into `section`, which may be an element of an outer vector.
+        void WriteFlat(FlatWriter& writer, FlatWriter::SectionId section = FlatWriter::ROOT) const;
+        void FlattenInto(FlattenSink& sink) const;
+        void FlattenInto(std::vector<uint8_t>& writer) const;
     };
 
     struct Flat {
@@ -194,15 +406,79 @@ namespace PackedTriMesh {
         FlatVec<std::array<float, 4>> Tangents;
         FlatVec<std::array<float, 4>> Colors;
         FlatVec<uint32_t> Indices;
-        FlatVec<uint32_t> MaterialIds;
         FlatVec<MeshMaterial> Materials;
         FlatVec<AssetRef<GpuImage::Flat>> Maps;
+        FlatVec<Meshlet> Meshlets;
+        FlatVec<uint32_t> MeshletVertices;
+        FlatVec<uint8_t> MeshletTriangles;
+        FlatVec<QuantizedVertex> QuantizedVerts;
+        FlatVec<uint32_t> HalfUvs;
+        FlatVec<uint32_t> OctTangents;
+        FlatVec<uint32_t> Rgba8Colors;
+        FlatVec<uint8_t> IndexStream;
+        uint64_t IndexStreamCount;
+        std::array<float, 3> PositionMin;
+        std::array<float, 3> PositionScale;
+        FlatVec<MeshLod> Lods;
+        FlatVec<uint32_t> LodIndices;
+        FlatVec<MaterialRange> MaterialRanges;
+        FlatVec<uint16_t> ShortIndices;
     };
 }
 
 using PackedTriangleMesh = PackedTriMesh::Proto;
 
-PackedTriangleMesh PackTriangleMesh(const TriangleMesh& mesh);
+// Unique meshes and their instances; see InstancedTriangleScene.
+namespace PackedScene {
+    struct Proto {
+        std::vector<PackedTriangleMesh> Meshes;
+        std::vector<SceneInstance> Instances;
+
+        void WriteFlat(FlatWriter& writer) const;
+        void FlattenInto(FlattenSink& sink) const;
+        void FlattenInto(std::vector<uint8_t>& writer) const;
+    };
+
+    struct Flat {
+        FlatVec<PackedTriMesh::Flat> Meshes;
+        FlatVec<SceneInstance> Instances;
+    };
+}
+
+struct PackTriangleMeshOptions {
+    // Merge duplicate vertices first; see WeldVertices.
+    bool WeldVertices = false;
+    // Per-component tolerance of the weld; 0 only merges bitwise-equal vertices.
+    float WeldEpsilon = 0.0f;
+    // Reorder triangles for post-transform cache locality, then renumber vertices in first-use order.
+    bool OptimizeVertexOrder = false;
+    // Split the packed index buffer into meshlets with culling bounds.
+    bool BuildMeshlets = false;
+    // Block compression effort for the material maps of the mesh.
+    TexCompressionQuality TextureQuality = TexCompressionQuality::Normal;
+    // Largest error of each simplified level of detail, relative to the mesh extent; empty
+    // builds none. See BuildLodChain.
+    std::vector<float> LodErrors;
+    // Maps at most this many texels a side share atlas images, with their MapTransforms
+    // rewritten to point into them (see kajiya_asset::PackTriangleMesh); 0 gives every map its
+    // own image.
+    uint32_t AtlasMaxTextureSize = 0;
+    // Largest atlas side, and how many texels of edge surround each map in an atlas.
+    uint32_t AtlasPageSize = 2048;
+    uint32_t AtlasBorder = 4;
+};
+
+PackedTriangleMesh PackTriangleMesh(const TriangleMesh& mesh, const PackTriangleMeshOptions& options = {});
+
+// Fills `Meshlets`, `MeshletVertices` and `MeshletTriangles` from `Indices` and `Verts`. Meshlets
+// never span two material ranges. The output only depends on the input, not on the number of
+// worker threads.
+void BuildMeshlets(PackedTriangleMesh& mesh);
+
+// Stably sorts the triangles of `Indices` by the material of their first vertex and describes
+// them with one MaterialRange per material, so each material draws as one contiguous range.
+// MaterialIds stays for later packing steps; PackTriangleMesh drops it once they are done.
+void SortTrianglesByMaterial(PackedTriangleMesh& mesh);
 
 #pragma pack(push, 1)
 struct GpuMaterial {
@@ -213,13 +489,14 @@ struct GpuMaterial {
 };
 #pragma pack(pop)
 
+// Views over a single primitive's streams; indices are relative to the start of the vertex spans.
 struct TangentCalcContext {
-    const std::vector<uint32_t>& Indices;
-    const std::vector<std::array<float, 3>>& Positions;
-    const std::vector<std::array<float, 3>>& Normals;
-    const std::vector<std::array<float, 2>>& Uvs;
-    std::vector<std::array<float, 4>>& Tangents;
-    
+    std::span<const uint32_t> Indices;
+    std::span<const std::array<float, 3>> Positions;
+    std::span<const std::array<float, 3>> Normals;
+    std::span<const std::array<float, 2>> Uvs;
+    std::span<std::array<float, 4>> Tangents;
+
     void GenerateTangents();
 };
 
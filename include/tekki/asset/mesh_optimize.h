@@ -0,0 +1,82 @@
+#pragma once
+
+#include "tekki/asset/mesh.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+namespace tekki::asset {
+
+// Post-transform cache size assumed by the optimizer and the analysis below.
+constexpr uint32_t VERTEX_CACHE_SIZE = 16;
+
+struct VertexCacheStats {
+    size_t Triangles = 0;
+    size_t ReferencedVertices = 0;
+    size_t TransformedVertices = 0;
+
+    // Average cache miss ratio: vertex shader invocations per triangle (0.5 is ideal for grids, 3 is worst).
+    float Acmr() const { return Triangles ? float(TransformedVertices) / float(Triangles) : 0.0f; }
+    // Average transform to vertex ratio: shader invocations per unique vertex (1.0 is ideal).
+    float Atvr() const { return ReferencedVertices ? float(TransformedVertices) / float(ReferencedVertices) : 0.0f; }
+};
+
+// Simulates a FIFO post-transform cache of `cache_size` entries over the index buffer.
+VertexCacheStats AnalyzeVertexCache(std::span<const uint32_t> indices, size_t vertex_count,
+                                    uint32_t cache_size = VERTEX_CACHE_SIZE);
+
+// Reorders triangles for post-transform cache locality (Tipsify, Sander et al. 2007).
+std::vector<uint32_t> OptimizeVertexCache(std::span<const uint32_t> indices, size_t vertex_count,
+                                          uint32_t cache_size = VERTEX_CACHE_SIZE);
+
+// Renumbers vertices in order of first use, rewriting `indices` in place. Returns the old -> new
+// vertex remap table; unreferenced vertices are moved to the end, keeping their relative order.
+std::vector<uint32_t> OptimizeVertexFetch(std::span<uint32_t> indices, size_t vertex_count);
+
+// Applies a remap table from OptimizeVertexFetch to one vertex stream.
+template<typename T>
+void RemapVertexStream(std::vector<T>& stream, std::span<const uint32_t> remap) {
+    if (stream.empty()) {
+        return;
+    }
+    if (stream.size() != remap.size()) {
+        throw std::runtime_error("vertex stream size does not match the remap table");
+    }
+
+    std::vector<T> remapped(stream.size());
+    for (size_t i = 0; i < stream.size(); ++i) {
+        remapped[remap[i]] = stream[i];
+    }
+    stream = std::move(remapped);
+}
+
+struct WeldStats {
+    size_t Vertices = 0;       // Before welding
+    size_t UniqueVertices = 0; // After welding
+    size_t DroppedTriangles = 0;
+};
+
+// Merges vertices whose attributes (position, normal, UV, tangent, colour and material) all
+// match, using a hash grid over positions. With `epsilon` 0 only bitwise-equal vertices merge;
+// otherwise every component may differ by up to `epsilon`. Each group keeps its first vertex,
+// in first-occurrence order, and triangles left with a repeated corner are dropped. Must run
+// before meshlets, LODs and quantisation, which index the vertex streams.
+WeldStats WeldVertices(PackedTriangleMesh& mesh, float epsilon = 0.0f);
+
+struct IndexCompactionStats {
+    size_t Ranges = 0;
+    size_t ShortRanges = 0;
+    uint64_t Bytes = 0;        // Index bytes before compaction
+    uint64_t CompactBytes = 0; // After
+};
+
+// Moves every material range whose vertices lie within 65535 consecutive ones to 16-bit indices
+// in `ShortIndices`, relative to the range's lowest vertex, and packs the 32-bit ranges left
+// together. Runs last on the packed mesh, after meshlets and LODs and before quantisation, which
+// only encodes the remaining 32-bit `Indices`.
+IndexCompactionStats CompactIndices(PackedTriangleMesh& mesh);
+
+} // namespace tekki::asset
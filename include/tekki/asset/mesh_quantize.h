@@ -0,0 +1,48 @@
+#pragma once
+
+#include "tekki/asset/mesh.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace tekki::asset {
+
+// Worst-case round-trip error of a quantised mesh, measured against the streams it was built from.
+struct QuantizationReport {
+    float MaxPositionError = 0.0f; // object-space units
+    float MaxNormalErrorDegrees = 0.0f;
+    float MaxTangentErrorDegrees = 0.0f;
+    float MaxUvError = 0.0f;
+    float MaxColorError = 0.0f;
+    size_t FullBytes = 0;
+    size_t QuantizedBytes = 0;
+};
+
+// Replaces the full-precision Verts, Uvs, Tangents, Colors and Indices of `mesh` with the compact
+// streams: 16-bit positions within the mesh bounds, 8:8 octahedral normals, 15:15 octahedral
+// tangents with a handedness bit, half UVs, RGBA8 colours and a delta + varint index stream.
+// Vertex count and order are unchanged, so meshlets and material ids stay valid.
+QuantizationReport QuantizeVertexStreams(PackedTriangleMesh& mesh);
+
+// Inverse of QuantizeVertexStreams; a no-op for meshes without quantised streams.
+void DequantizeVertexStreams(PackedTriangleMesh& mesh);
+
+uint16_t EncodeOctahedralNormal(const std::array<float, 3>& n);
+std::array<float, 3> DecodeOctahedralNormal(uint16_t packed);
+
+uint32_t EncodeOctahedralTangent(const std::array<float, 4>& t);
+std::array<float, 4> DecodeOctahedralTangent(uint32_t packed);
+
+// Each index is coded as the zigzagged difference to the previous one in LEB128 bytes, which
+// takes one or two bytes per index on a vertex cache and fetch optimised mesh.
+std::vector<uint8_t> EncodeIndexStream(std::span<const uint32_t> indices);
+void DecodeIndexStream(std::span<const uint8_t> stream, std::span<uint32_t> indices);
+
+// Bulk decode kernels; `out` must be the same length as the input.
+void DecodePositions(std::span<const QuantizedVertex> verts, const std::array<float, 3>& min,
+                     const std::array<float, 3>& scale, std::span<std::array<float, 3>> out);
+void DecodeHalfUvs(std::span<const uint32_t> uvs, std::span<std::array<float, 2>> out);
+
+} // namespace tekki::asset
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "tekki/asset/mesh.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace tekki::asset {
+
+struct SimplifyOptions {
+    // Stop once at most this many indices remain.
+    size_t TargetIndexCount = 0;
+    // Largest distance a collapse may move the surface, relative to `Extent`.
+    float TargetError = 0.01f;
+    // Size errors are relative to; 0 uses the largest side of the bounding box of the vertices used.
+    float Extent = 0.0f;
+};
+
+struct SimplifyResult {
+    std::vector<uint32_t> Indices;
+    float Error = 0.0f; // Largest error reached, relative to the extent
+};
+
+// Quadric-error edge collapse (Garland & Heckbert 1997), after meshoptimizer's meshopt_simplify.
+//
+// Vertices only collapse onto other existing vertices, so the result indexes the same vertex
+// streams. Vertices sharing a position but not attributes (UV seams, material boundaries) move
+// together along their seam or not at all, open borders only slide along themselves, and
+// vertices flagged in `locked` (one byte per vertex, or empty) never move.
+SimplifyResult SimplifyMesh(std::span<const uint32_t> indices, std::span<const std::array<float, 3>> positions,
+                            const SimplifyOptions& options, std::span<const uint8_t> locked = {});
+
+struct LodChainOptions {
+    // Largest error of each level, relative to the mesh extent; one level per entry.
+    std::vector<float> Errors;
+    // Triangles each level aims to keep of the level before it.
+    float Reduction = 0.5f;
+    // Reorder each level's triangles for the post-transform cache.
+    bool OptimizeVertexCache = false;
+};
+
+// Fills `Lods` and `LodIndices` with a chain of simplified index buffers over the mesh's own
+// vertices, each built from the level before it. Triangles are simplified per material, in
+// parallel; vertices shared between materials stay put so no cracks open between them. Levels
+// that would save under a tenth of the triangles of the previous one are skipped. When the mesh
+// has material ranges, each level keeps its materials contiguous and appends its own ranges.
+void BuildLodChain(PackedTriangleMesh& mesh, const LodChainOptions& options);
+
+} // namespace tekki::asset
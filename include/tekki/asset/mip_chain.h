@@ -0,0 +1,60 @@
+#pragma once
+
+#include "tekki/asset/TexParams.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace tekki::asset {
+
+// Extent of mip `level` along one axis: halved per level and rounded down, never below 1.
+inline uint32_t MipExtent(uint32_t size, uint32_t level) {
+    return std::max(size >> level, 1u);
+}
+
+// Number of levels in a full chain, the top level included.
+inline uint32_t MipLevelCount(uint32_t width, uint32_t height) {
+    uint32_t levels = 1;
+    while ((std::max(width, height) >> levels) > 0) {
+        ++levels;
+    }
+    return levels;
+}
+
+// Byte size of RGBA8 mip `level` of a `width` x `height` image.
+inline size_t MipByteSize(uint32_t width, uint32_t height, uint32_t level) {
+    return static_cast<size_t>(MipExtent(width, level)) * MipExtent(height, level) * 4;
+}
+
+struct MipChainOptions {
+    // With TexGamma::Srgb the colour channels are decoded before filtering and re-encoded after;
+    // alpha is always filtered as stored.
+    TexGamma Gamma = TexGamma::Srgb;
+    TexMipFilter Filter = TexMipFilter::Box;
+};
+
+/**
+ * Fills `levels` with the mips below a tightly packed RGBA8 image: `levels[i]` receives level
+ * i + 1 and must already hold MipByteSize(width, height, i + 1) bytes.
+ *
+ * Each level is filtered from the one above it with a separable kernel in linear space. Odd
+ * extents are handled by weighting source texels by their coverage (box) or by sampling the
+ * kernel at the true texel centres (Kaiser), so non-power-of-two images don't drift or lose
+ * edge rows. Rows of a level are split across threads; AVX2 is used where available.
+ */
+void GenerateMipChainInto(std::span<const uint8_t> rgba, uint32_t width, uint32_t height,
+                          std::span<std::vector<uint8_t>> levels, const MipChainOptions& options);
+
+// Allocates and fills the full chain below the top level (levels 1..MipLevelCount - 1).
+std::vector<std::vector<uint8_t>> GenerateMipChain(std::span<const uint8_t> rgba, uint32_t width, uint32_t height,
+                                                   const MipChainOptions& options);
+
+// Filters a tightly packed linear RGBA32F level into `dst` (dstWidth * dstHeight texels) with
+// the same kernels as the RGBA8 chain. Values are neither clamped nor encoded, so HDR content
+// keeps its range; the Kaiser kernel's negative lobes can ring around very bright texels.
+void DownsampleRgba32f(std::span<const float> src, uint32_t srcWidth, uint32_t srcHeight, std::span<float> dst,
+                       uint32_t dstWidth, uint32_t dstHeight, TexMipFilter filter = TexMipFilter::Box);
+
+} // namespace tekki::asset
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace tekki::asset {
+
+// Where an image landed: its page and the top-left texel of its content, borders excluded.
+struct AtlasPlacement {
+    uint32_t Page;
+    uint32_t X;
+    uint32_t Y;
+};
+
+struct AtlasLayout {
+    std::vector<glm::u32vec2> Pages; // Extent of each page
+    std::vector<AtlasPlacement> Placements; // One per packed size, in input order
+};
+
+/**
+ * Shelf-packs images of the given sizes into pages of at most `pageSize` texels square.
+ *
+ * Every image gets a cell `border` texels larger on each side, rounded up to whole 4x4 blocks
+ * so block compression never mixes two images. Images are placed tallest first, ties in input
+ * order; pages are trimmed to the cells they hold.
+ */
+AtlasLayout PackAtlas(std::span<const glm::u32vec2> sizes, uint32_t pageSize, uint32_t border);
+
+// Copies a tightly packed RGBA8 image into a page `pageWidth` texels wide at (x, y), repeating
+// its edge texels `border` deep around it so filtering near the edges clamps.
+void BlitAtlasImage(std::span<const uint8_t> rgba, glm::u32vec2 size, std::span<uint8_t> page, uint32_t pageWidth,
+                    uint32_t x, uint32_t y, uint32_t border);
+
+// Mip levels an atlas keeps: deeper ones would blend neighbours through a border under a texel.
+uint32_t AtlasMipCount(uint32_t border);
+
+// Composes a material map transform (see MeshMaterial::MapTransforms) with the mapping of the
+// unit square onto an image of `size` texels placed at (x, y) of a `pageSize` page.
+std::array<float, 6> AtlasMapTransform(const std::array<float, 6>& transform, glm::u32vec2 size, uint32_t x, uint32_t y,
+                                       glm::u32vec2 pageSize);
+
+// Bounds of `transform` applied to the box [uvMin, uvMax].
+void TransformUvBounds(const std::array<float, 6>& transform, glm::vec2 uvMin, glm::vec2 uvMax, glm::vec2& outMin,
+                       glm::vec2& outMax);
+
+} // namespace tekki::asset
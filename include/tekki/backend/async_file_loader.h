@@ -0,0 +1,163 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace tekki::backend
+{
+
+enum class FileReadPriority : uint8_t
+{
+    Prefetch = 0,
+    Normal = 1,
+    Urgent = 2
+};
+
+/**
+ * One asynchronous whole-file read, shared by the loader and whoever waits on it.
+ */
+class FileRead
+{
+public:
+    enum class State
+    {
+        Queued,
+        Reading,
+        Done,
+        Failed,
+        Cancelled
+    };
+
+    explicit FileRead(std::filesystem::path path, FileReadPriority priority);
+
+    const std::filesystem::path& Path() const { return path_; }
+    State GetState() const;
+    bool IsFinished() const;
+
+    void Wait() const;
+    bool WaitFor(std::chrono::milliseconds timeout) const;
+
+    // Wait for the read; throw std::runtime_error if it failed or was cancelled.
+    std::span<const uint8_t> Get() const;
+    // Like Get, but moves the bytes out; later calls see an empty file.
+    std::vector<uint8_t> Take();
+
+    // Drop a queued read or abandon one in flight; no effect once it has finished.
+    void Cancel();
+
+private:
+    friend class AsyncFileLoader;
+
+    bool Start();
+    bool Complete(std::vector<uint8_t> bytes);
+    void Fail(const std::string& error);
+    void ThrowIfUnusable() const;
+
+    std::filesystem::path path_;
+    FileReadPriority priority_;
+    std::pair<int, uint64_t> queueKey_{};
+
+    mutable std::mutex mutex_;
+    mutable std::condition_variable finished_;
+    State state_ = State::Queued;
+    std::vector<uint8_t> bytes_;
+    std::string error_;
+
+    // Progress of the read, touched only by the I/O thread that owns it.
+    int fd_ = -1;
+    uint64_t readBytes_ = 0;
+    std::vector<uint8_t> buffer_;
+};
+
+/**
+ * Reads whole files off the caller's thread.
+ *
+ * Reads are queued by priority and issued up to QueueDepth at a time: on Linux through one
+ * io_uring serviced by a single I/O thread, elsewhere (or when io_uring is unavailable, e.g.
+ * in a container that forbids it) by a small pool of reader threads. Callers queue everything
+ * they need up front and wait on each read as they get to it, so decoding and uploading one
+ * file overlaps with reading the next.
+ *
+ * Prefetch starts low-priority reads that a later Read of the same path picks up (raising the
+ * priority if it is still queued), so scene loading can fill the queue ahead of use.
+ */
+class AsyncFileLoader
+{
+public:
+    struct Options
+    {
+        size_t QueueDepth = 32;     // Reads in flight at once
+        size_t FallbackThreads = 4; // Reader threads without io_uring
+        bool UseIoUring = true;
+    };
+
+    struct Stats
+    {
+        uint64_t Reads = 0; // Completed successfully
+        uint64_t BytesRead = 0;
+        uint64_t PrefetchHits = 0;
+        uint64_t Cancelled = 0;
+    };
+
+    AsyncFileLoader();
+    explicit AsyncFileLoader(const Options& options);
+    // Cancels queued reads and waits for the ones in flight.
+    ~AsyncFileLoader();
+
+    AsyncFileLoader(const AsyncFileLoader&) = delete;
+    AsyncFileLoader& operator=(const AsyncFileLoader&) = delete;
+
+    std::shared_ptr<FileRead> Read(const std::filesystem::path& path, FileReadPriority priority = FileReadPriority::Normal);
+
+    // Starts reading `path` at Prefetch priority and keeps the result for the next Read of it.
+    void Prefetch(const std::filesystem::path& path);
+    // Cancels and forgets prefetches nobody has claimed, e.g. when switching scenes.
+    void DropPrefetches();
+
+    bool UsesIoUring() const { return ring_ != nullptr; }
+    Stats GetStats() const;
+
+    // Process-wide loader used by LoadFile.
+    static AsyncFileLoader& Shared();
+
+private:
+    class IoUring;
+
+    void EnqueueLocked(const std::shared_ptr<FileRead>& read);
+    void NotifyQueued();
+    // Next read to start, or null when the queue is empty (or once stopping, for `wait`).
+    std::shared_ptr<FileRead> PopNext(bool wait);
+    void ThreadLoop();
+    void ReadBlocking(FileRead& read);
+    void Finish(FileRead& read, std::vector<uint8_t> bytes);
+
+    Options options_;
+    mutable std::mutex mutex_;
+    std::condition_variable queued_;
+    std::map<std::pair<int, uint64_t>, std::shared_ptr<FileRead>> queue_;
+    std::unordered_map<std::string, std::shared_ptr<FileRead>> prefetched_;
+    uint64_t nextSequence_ = 0;
+    bool stopping_ = false;
+
+    std::unique_ptr<IoUring> ring_;
+    std::vector<std::thread> threads_;
+
+    std::atomic<uint64_t> reads_{0};
+    std::atomic<uint64_t> bytesRead_{0};
+    std::atomic<uint64_t> prefetchHits_{0};
+    std::atomic<uint64_t> cancelled_{0};
+};
+
+} // namespace tekki::backend
@@ -25,8 +25,9 @@ enum class RayTracingGeometryType {
 
 struct RayTracingGeometryPart {
     size_t IndexCount;
-    size_t IndexOffset;
+    size_t IndexOffset; // In indices from IndexBuffer
     uint32_t MaxVertex;
+    uint32_t FirstVertex = 0; // Added to every index, for 16-bit ranges of large meshes
 };
 
 struct RayTracingGeometryDesc {
@@ -35,6 +36,7 @@ struct RayTracingGeometryDesc {
     VkDeviceAddress IndexBuffer;
     VkFormat VertexFormat;
     size_t VertexStride;
+    VkIndexType IndexType = VK_INDEX_TYPE_UINT32;
     std::vector<RayTracingGeometryPart> Parts;
 };
 
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+
+namespace tekki::core {
+
+// IEEE 754 binary16 conversion, round-to-nearest-even. Overflow saturates to infinity
+// and NaN payloads are kept quiet.
+inline uint16_t FloatToHalf(float value) {
+    uint32_t bits = std::bit_cast<uint32_t>(value);
+    uint32_t sign = (bits >> 16) & 0x8000u;
+    uint32_t abs_bits = bits & 0x7fffffffu;
+
+    if (abs_bits >= 0x7f800000u) {
+        // Inf stays inf, NaN becomes a quiet NaN.
+        return static_cast<uint16_t>(sign | 0x7c00u | (abs_bits > 0x7f800000u ? 0x200u : 0u));
+    }
+    if (abs_bits >= 0x477ff000u) {
+        // Rounds to a value above the largest finite half.
+        return static_cast<uint16_t>(sign | 0x7c00u);
+    }
+    if (abs_bits < 0x38800000u) {
+        // Subnormal half: let the FPU do the rounding by adding 0.5, which aligns the
+        // mantissa so that the low bits are exactly the half's subnormal mantissa.
+        float shifted = std::bit_cast<float>(abs_bits) + 0.5f;
+        return static_cast<uint16_t>(sign | (std::bit_cast<uint32_t>(shifted) - 0x3f000000u));
+    }
+
+    uint32_t mantissa_odd = (abs_bits >> 13) & 1u;
+    abs_bits += 0xc8000fffu + mantissa_odd; // rebias exponent (-112 << 23) and round
+    return static_cast<uint16_t>(sign | (abs_bits >> 13));
+}
+
+inline float HalfToFloat(uint16_t value) {
+    // Shift exponent and mantissa into place, then rescale by 2^112 to rebias the exponent;
+    // this handles subnormals for free. Inf and NaN need their exponent forced to all ones.
+    uint32_t sign = static_cast<uint32_t>(value & 0x8000u) << 16;
+    uint32_t shifted = static_cast<uint32_t>(value & 0x7fffu) << 13;
+    float magnitude = std::bit_cast<float>(shifted) * 0x1.0p112f;
+    uint32_t result = std::bit_cast<uint32_t>(magnitude);
+    if (shifted >= (0x7c00u << 13)) {
+        result |= 0x7f800000u;
+    }
+    return std::bit_cast<float>(result | sign);
+}
+
+} // namespace tekki::core
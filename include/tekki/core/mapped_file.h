@@ -0,0 +1,198 @@
+#pragma once
+
+#include <cstddef>
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+    #ifndef WIN32_LEAN_AND_MEAN
+        #define WIN32_LEAN_AND_MEAN
+    #endif
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace tekki::core {
+
+/**
+ * Read-only mapping of a whole file.
+ *
+ * Pages are faulted in on first access and shared with the page cache, so spans into a mapping
+ * cost no heap memory and no up-front read. Always handed out through a shared_ptr: anything
+ * borrowing from Bytes() holds on to it to keep the mapping alive.
+ */
+class MappedFile {
+public:
+    // Expected access pattern, passed on to the kernel's read-ahead.
+    enum class Access {
+        Normal,
+        Sequential,
+        Random
+    };
+
+    static std::shared_ptr<const MappedFile> Open(const std::filesystem::path& path, Access access = Access::Normal) {
+        std::shared_ptr<MappedFile> file(new MappedFile());
+        file->path_ = path;
+        file->Map();
+        file->Advise(access);
+        return file;
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile() {
+#ifdef _WIN32
+        if (data_) {
+            UnmapViewOfFile(data_);
+        }
+#else
+        if (data_) {
+            munmap(const_cast<uint8_t*>(data_), size_);
+        }
+#endif
+    }
+
+    std::span<const uint8_t> Bytes() const { return {data_, size_}; }
+    size_t Size() const { return size_; }
+    const std::filesystem::path& Path() const { return path_; }
+
+    // Starts reading the whole file in ahead of use.
+    void WillNeed() const {
+#ifdef _WIN32
+        if (data_) {
+            WIN32_MEMORY_RANGE_ENTRY range{const_cast<uint8_t*>(data_), size_};
+            PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+        }
+#else
+        if (data_) {
+            madvise(const_cast<uint8_t*>(data_), size_, MADV_WILLNEED);
+        }
+#endif
+    }
+
+    // Drops the resident pages; they are read back from the file if touched again.
+    void DontNeed() const {
+#ifdef _WIN32
+        if (data_) {
+            // Unlocking pages that aren't locked trims them from the working set.
+            VirtualUnlock(const_cast<uint8_t*>(data_), size_);
+        }
+#else
+        if (data_) {
+            madvise(const_cast<uint8_t*>(data_), size_, MADV_DONTNEED);
+        }
+#endif
+    }
+
+    // Bytes of the mapping currently in physical memory, rounded to whole pages.
+    uint64_t ResidentBytes() const {
+#ifdef _WIN32
+        return size_; // Not tracked per page; reports the mapped size.
+#else
+        if (!data_) {
+            return 0;
+        }
+        const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        std::vector<unsigned char> pages((size_ + page - 1) / page);
+        if (mincore(const_cast<uint8_t*>(data_), size_, pages.data()) != 0) {
+            return 0;
+        }
+        uint64_t resident = 0;
+        for (size_t i = 0; i < pages.size(); ++i) {
+            if (pages[i] & 1) {
+                resident += std::min(page, size_ - i * page);
+            }
+        }
+        return resident;
+#endif
+    }
+
+private:
+    MappedFile() = default;
+
+    [[noreturn]] void Fail(const char* what) const {
+        throw std::runtime_error("Could not map " + path_.string() + ": " + what);
+    }
+
+    void Map() {
+#ifdef _WIN32
+        HANDLE file = CreateFileW(path_.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                  FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            Fail("file cannot be opened");
+        }
+        LARGE_INTEGER size{};
+        if (!GetFileSizeEx(file, &size)) {
+            CloseHandle(file);
+            Fail("file size cannot be read");
+        }
+        size_ = static_cast<size_t>(size.QuadPart);
+        if (size_ == 0) {
+            CloseHandle(file);
+            return;
+        }
+        HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        CloseHandle(file);
+        if (!mapping) {
+            Fail("file mapping cannot be created");
+        }
+        data_ = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        CloseHandle(mapping);
+        if (!data_) {
+            Fail("view cannot be mapped");
+        }
+#else
+        int fd = ::open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            Fail("file cannot be opened");
+        }
+        struct stat st {};
+        if (fstat(fd, &st) != 0) {
+            ::close(fd);
+            Fail("file size cannot be read");
+        }
+        size_ = static_cast<size_t>(st.st_size);
+        if (size_ == 0) {
+            ::close(fd);
+            return;
+        }
+        void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (data == MAP_FAILED) {
+            size_ = 0;
+            Fail("mmap failed");
+        }
+        data_ = static_cast<const uint8_t*>(data);
+#endif
+    }
+
+    void Advise([[maybe_unused]] Access access) {
+#ifndef _WIN32
+        if (!data_ || access == Access::Normal) {
+            return;
+        }
+        // Only a hint: failure leaves the default read-ahead in place.
+        madvise(const_cast<uint8_t*>(data_), size_, access == Access::Sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+#endif
+    }
+
+    std::filesystem::path path_;
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+} // namespace tekki::core
@@ -0,0 +1,203 @@
+#pragma once
+
+#include "tekki/core/thread_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace tekki::core {
+
+namespace detail {
+// Set on threads currently running ParallelFor items; nested calls then run inline
+// instead of spawning another set of workers per item.
+inline thread_local bool InParallelRegion = false;
+
+// State shared between a ParallelFor caller and the helper tasks it queued on a ThreadPool,
+// loop body included. Helpers may start after the caller has returned; they then find no
+// items left and exit without touching the loop body.
+//
+// A helper announces itself in Running before claiming items, and claims are acq_rel, so a
+// caller that has seen every item claimed also sees every helper still running one.
+template<typename F>
+struct PoolLoopState {
+    explicit PoolLoopState(F fn) : Fn(std::move(fn)) {}
+
+    F Fn;
+    std::atomic<size_t> Next{0};
+    std::atomic<size_t> Running{0};
+    std::atomic<bool> Failed{false};
+    std::exception_ptr Error;
+    std::mutex ErrorMutex;
+};
+
+template<typename F>
+void RunPoolLoop(PoolLoopState<F>& state, size_t count) {
+    while (!state.Failed.load(std::memory_order_relaxed)) {
+        size_t i = state.Next.fetch_add(1, std::memory_order_acq_rel);
+        if (i >= count) {
+            break;
+        }
+
+        try {
+            state.Fn(i);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(state.ErrorMutex);
+            if (!state.Error) {
+                state.Error = std::current_exception();
+            }
+            state.Failed.store(true, std::memory_order_relaxed);
+        }
+    }
+}
+} // namespace detail
+/**
+ * Run `fn(i)` for every i in [0, count) across a set of worker threads.
+ *
+ * Items are handed out dynamically through a shared counter, so uneven item
+ * costs balance out. The calling thread participates as a worker. The first
+ * exception thrown by any item is rethrown on the caller once all workers
+ * have stopped. Calls made from inside another ParallelFor run serially.
+ *
+ * Inside a ThreadPool task, the pool's idle workers are used instead of new
+ * threads: helper tasks are queued on the calling worker's deque and stolen
+ * by whoever is free, so nested parallel work doesn't oversubscribe the machine.
+ * There `fn` is moved (or copied) into state shared with the helpers, so it must be
+ * copyable when passed as an lvalue.
+ */
+template<typename F>
+void ParallelFor(size_t count, F&& fn, size_t maxThreads = 0) {
+    if (count == 0) {
+        return;
+    }
+
+    if (ThreadPool* pool = ThreadPool::Current()) {
+        size_t helper_count = std::min(maxThreads == 0 ? pool->ThreadCount() : maxThreads, count) - 1;
+        if (helper_count == 0) {
+            for (size_t i = 0; i < count; ++i) {
+                fn(i);
+            }
+            return;
+        }
+
+        auto state = std::make_shared<detail::PoolLoopState<std::decay_t<F>>>(std::forward<F>(fn));
+        for (size_t h = 0; h < helper_count; ++h) {
+            pool->Push([state, count]() {
+                state->Running.fetch_add(1, std::memory_order_relaxed);
+                detail::RunPoolLoop(*state, count);
+                state->Running.fetch_sub(1, std::memory_order_release);
+                state->Running.notify_all();
+            });
+        }
+
+        detail::RunPoolLoop(*state, count);
+
+        // Close the loop: after a failure the caller stops without claiming past the end, and
+        // this claim both stops late helpers and orders every earlier claim before the wait.
+        state->Next.exchange(count, std::memory_order_acq_rel);
+
+        // Wait for the helpers still running an item.
+        for (size_t running = state->Running.load(std::memory_order_acquire); running != 0;
+             running = state->Running.load(std::memory_order_acquire)) {
+            state->Running.wait(running, std::memory_order_acquire);
+        }
+
+        if (state->Error) {
+            std::rethrow_exception(state->Error);
+        }
+        return;
+    }
+
+    size_t thread_count = maxThreads == 0 ? HardwareConcurrency() : maxThreads;
+    thread_count = std::min(thread_count, count);
+
+    if (thread_count <= 1 || detail::InParallelRegion) {
+        for (size_t i = 0; i < count; ++i) {
+            fn(i);
+        }
+        return;
+    }
+
+    std::atomic<size_t> next{0};
+    std::atomic<bool> failed{false};
+    std::exception_ptr error;
+    std::mutex error_mutex;
+
+    auto worker = [&]() {
+        bool was_in_region = detail::InParallelRegion;
+        detail::InParallelRegion = true;
+
+        while (!failed.load(std::memory_order_relaxed)) {
+            size_t i = next.fetch_add(1, std::memory_order_relaxed);
+            if (i >= count) {
+                break;
+            }
+
+            try {
+                fn(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+                failed.store(true, std::memory_order_relaxed);
+            }
+        }
+
+        detail::InParallelRegion = was_in_region;
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(thread_count - 1);
+    for (size_t t = 1; t < thread_count; ++t) {
+        threads.emplace_back(worker);
+    }
+    worker();
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+/**
+ * Run `fn(i)` for every i in [0, count) as tasks of `pool`, at most `maxInFlight` at once
+ * (0 for one per pool thread). Call from outside the pool; it blocks until every item is done
+ * and rethrows the first exception, like ParallelFor.
+ *
+ * Unlike a pool sized to the item limit, ParallelFor calls made by the items still fan out
+ * across every thread of `pool`, so a single heavy item isn't serialised.
+ */
+template<typename F>
+void ParallelForOnPool(ThreadPool& pool, size_t count, F&& fn, size_t maxInFlight = 0) {
+    if (count == 0) {
+        return;
+    }
+
+    auto state = std::make_shared<detail::PoolLoopState<std::decay_t<F>>>(std::forward<F>(fn));
+    const size_t runner_count = std::min(maxInFlight == 0 ? pool.ThreadCount() : maxInFlight, count);
+    std::vector<std::future<void>> runners;
+    runners.reserve(runner_count);
+    for (size_t r = 0; r < runner_count; ++r) {
+        runners.push_back(pool.Submit([state, count]() { detail::RunPoolLoop(*state, count); }));
+    }
+    for (auto& runner : runners) {
+        runner.get();
+    }
+
+    if (state->Error) {
+        std::rethrow_exception(state->Error);
+    }
+}
+
+} // namespace tekki::core
@@ -0,0 +1,198 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace tekki::core {
+
+// Number of workers used by the parallel helpers; never less than one.
+inline size_t HardwareConcurrency() {
+    return std::max<size_t>(1, std::thread::hardware_concurrency());
+}
+
+/**
+ * Fixed-size work-stealing thread pool.
+ *
+ * Every worker owns a deque: it pushes and pops its own work at the back and steals from
+ * the front of the others'. Tasks submitted from outside the pool are spread round-robin.
+ *
+ * Each task can reserve an estimate of the memory it will hold while running. Submit blocks
+ * while the in-flight reservations would exceed `maxInflightBytes`, which bounds peak memory
+ * independently of the number of tasks. A single task larger than the budget still runs, alone.
+ * Submissions from inside the pool never block, so tasks can fan out without deadlocking.
+ */
+class ThreadPool {
+public:
+    // `threads == 0` uses HardwareConcurrency(); `maxInflightBytes == 0` disables the budget.
+    explicit ThreadPool(size_t threads = 0, uint64_t maxInflightBytes = 0)
+        : maxInflightBytes_(maxInflightBytes) {
+        size_t count = threads == 0 ? HardwareConcurrency() : threads;
+        for (size_t i = 0; i < count; ++i) {
+            workers_.push_back(std::make_unique<Worker>());
+        }
+        for (size_t i = 0; i < count; ++i) {
+            threads_.emplace_back([this, i]() { WorkerLoop(i); });
+        }
+    }
+
+    // Finishes every queued task before joining the workers.
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex_);
+            stopping_ = true;
+        }
+        sleepCv_.notify_all();
+        for (auto& thread : threads_) {
+            thread.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    template<typename F>
+    auto Submit(F&& fn, uint64_t reservedBytes = 0) -> std::future<std::invoke_result_t<std::decay_t<F>&>> {
+        using R = std::invoke_result_t<std::decay_t<F>&>;
+
+        AcquireBudget(reservedBytes);
+        auto task = std::make_shared<std::packaged_task<R()>>(std::forward<F>(fn));
+        auto future = task->get_future();
+        Push([this, task, reservedBytes]() {
+            (*task)();
+            ReleaseBudget(reservedBytes);
+        });
+        return future;
+    }
+
+    // Queues a fire-and-forget task that must not throw.
+    void Push(std::function<void()> task) {
+        size_t index = current_ == this ? currentIndex_ : nextQueue_.fetch_add(1, std::memory_order_relaxed) % workers_.size();
+        {
+            std::lock_guard<std::mutex> lock(workers_[index]->Mutex);
+            workers_[index]->Tasks.push_back(std::move(task));
+        }
+
+        pending_.fetch_add(1, std::memory_order_release);
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex_);
+        }
+        sleepCv_.notify_one();
+    }
+
+    size_t ThreadCount() const { return workers_.size(); }
+
+    uint64_t InflightBytes() const {
+        std::lock_guard<std::mutex> lock(budgetMutex_);
+        return inflightBytes_;
+    }
+
+    uint64_t PeakInflightBytes() const {
+        std::lock_guard<std::mutex> lock(budgetMutex_);
+        return peakInflightBytes_;
+    }
+
+    // The pool whose worker is running the calling thread, or null.
+    static ThreadPool* Current() { return current_; }
+
+private:
+    struct Worker {
+        std::mutex Mutex;
+        std::deque<std::function<void()>> Tasks;
+    };
+
+    bool TryPop(size_t self, std::function<void()>& task) {
+        {
+            auto& own = *workers_[self];
+            std::lock_guard<std::mutex> lock(own.Mutex);
+            if (!own.Tasks.empty()) {
+                task = std::move(own.Tasks.back());
+                own.Tasks.pop_back();
+                return true;
+            }
+        }
+
+        for (size_t k = 1; k < workers_.size(); ++k) {
+            auto& victim = *workers_[(self + k) % workers_.size()];
+            std::lock_guard<std::mutex> lock(victim.Mutex);
+            if (!victim.Tasks.empty()) {
+                task = std::move(victim.Tasks.front());
+                victim.Tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void WorkerLoop(size_t index) {
+        current_ = this;
+        currentIndex_ = index;
+
+        for (;;) {
+            std::function<void()> task;
+            if (TryPop(index, task)) {
+                pending_.fetch_sub(1, std::memory_order_relaxed);
+                task();
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(sleepMutex_);
+            sleepCv_.wait(lock, [this]() { return stopping_ || pending_.load(std::memory_order_acquire) > 0; });
+            if (stopping_ && pending_.load(std::memory_order_acquire) == 0) {
+                break;
+            }
+        }
+
+        current_ = nullptr;
+    }
+
+    void AcquireBudget(uint64_t bytes) {
+        std::unique_lock<std::mutex> lock(budgetMutex_);
+        if (maxInflightBytes_ != 0 && current_ != this) {
+            budgetCv_.wait(lock, [&]() { return inflightBytes_ == 0 || inflightBytes_ + bytes <= maxInflightBytes_; });
+        }
+        inflightBytes_ += bytes;
+        peakInflightBytes_ = std::max(peakInflightBytes_, inflightBytes_);
+    }
+
+    void ReleaseBudget(uint64_t bytes) {
+        if (bytes == 0) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(budgetMutex_);
+            inflightBytes_ -= bytes;
+        }
+        budgetCv_.notify_all();
+    }
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::vector<std::thread> threads_;
+    std::atomic<size_t> nextQueue_{0};
+    std::atomic<size_t> pending_{0};
+
+    std::mutex sleepMutex_;
+    std::condition_variable sleepCv_;
+    bool stopping_ = false;
+
+    const uint64_t maxInflightBytes_;
+    mutable std::mutex budgetMutex_;
+    std::condition_variable budgetCv_;
+    uint64_t inflightBytes_ = 0;
+    uint64_t peakInflightBytes_ = 0;
+
+    static inline thread_local ThreadPool* current_ = nullptr;
+    static inline thread_local size_t currentIndex_ = 0;
+};
+
+} // namespace tekki::core
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace tekki::kajiya_asset_pipe {
+
+// A file the bake read, fingerprinted by content. Size and modification time let a later bake
+// reuse the hash instead of reading the file again.
+struct BakeInput {
+    std::filesystem::path Path;
+    uint64_t Size = 0;
+    int64_t ModifiedTime = 0;
+    uint64_t Hash = 0;
+};
+
+enum class BakeOutputStatus {
+    Reused,
+    Rebuilt
+};
+
+struct BakeOutput {
+    std::filesystem::path Path;
+    uint64_t Key = 0; // Content key the output was baked under
+    BakeOutputStatus Status = BakeOutputStatus::Rebuilt;
+};
+
+/**
+ * Record of one bake: the inputs it hashed, the scene key derived from them, and every output
+ * with whether it was reused or rebuilt. Saved next to the outputs as JSON; the next bake of
+ * the same scene loads it to skip unchanged work.
+ */
+struct BakeManifest {
+    uint32_t BakeVersion = 0;
+    std::filesystem::path Scene;
+    uint64_t SceneKey = 0;
+    std::vector<BakeInput> Inputs;
+    BakeOutput Mesh;
+    std::vector<BakeOutput> Images;
+
+    // Empty if the manifest is missing, unreadable or from another bake version.
+    static std::optional<BakeManifest> Load(const std::filesystem::path& path);
+    void Save(const std::filesystem::path& path) const;
+
+    const BakeInput* FindInput(const std::filesystem::path& path) const;
+    size_t CountOutputs(BakeOutputStatus status) const;
+    bool OutputsExist() const;
+};
+
+// The glTF (or .glb) file followed by every external buffer and image it references.
+std::vector<std::filesystem::path> GltfInputFiles(const std::filesystem::path& gltf);
+
+// Hashes `paths`, taking the hash from `previous` for files whose size and time still match.
+std::vector<BakeInput> HashBakeInputs(const std::vector<std::filesystem::path>& paths, const BakeManifest* previous);
+
+} // namespace tekki::kajiya_asset_pipe
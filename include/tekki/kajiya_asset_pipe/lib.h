@@ -11,6 +11,9 @@
 #include <glm/gtc/quaternion.hpp>
 #include "tekki/core/result.h"
 #include "kajiya_asset/mesh.h"
+#include "tekki/asset/compression.h"
+#include "tekki/asset/environment.h"
+#include "tekki/kajiya_asset_pipe/bake_manifest.h"
 
 namespace tekki::kajiya_asset_pipe {
 
@@ -18,14 +21,100 @@ struct MeshAssetProcessParams {
     std::filesystem::path Path;
     std::string OutputName;
     float Scale;
+    bool OptimizeVertexOrder = false;
+    bool QuantizeVertices = false;
+    // Largest error of each simplified level of detail, relative to the mesh extent.
+    std::vector<float> LodErrors;
+    // Merge duplicate vertices, bitwise or within WeldEpsilon per component.
+    bool WeldVertices = true;
+    float WeldEpsilon = 0.0f;
+    // Bake each unique glTF mesh once, with instance transforms, into a PackedScene
+    // (cache/<OutputName>.scene) instead of one merged world-space mesh.
+    bool InstanceMeshes = false;
+    // Store material ranges that fit as 16-bit indices from a base vertex; see CompactIndices.
+    bool ShortIndices = true;
+    // Pack maps at most this many texels a side into shared atlas images; 0 disables atlases.
+    uint32_t AtlasMaxTextureSize = 0;
+    // Threads packing the scene and baking its images; 0 uses every hardware thread.
+    size_t Jobs = 0;
+    // Budget for the estimated memory of images being baked at once; 0 is unlimited.
+    uint64_t MaxInflightMb = 2048;
+    // BC7/BC5 encoder effort for the material maps.
+    tekki::asset::TexCompressionQuality TextureQuality = tekki::asset::TexCompressionQuality::Normal;
+    // Write one cache/<OutputName>.pack instead of a .mesh plus one .image per texture.
+    bool Pack = false;
+    tekki::asset::CompressionCodec PackCompression = tekki::asset::CompressionCodec::None;
+    // Reuse outputs of earlier bakes recorded in cache/<OutputName>.manifest.json.
+    bool Incremental = true;
+};
+
+// Several scenes baked as one job graph; images shared between scenes are baked once.
+struct BatchBakeParams {
+    std::vector<MeshAssetProcessParams> Scenes;
+    // Threads packing scenes and baking images, and the images' memory budget, shared by the
+    // whole batch.
+    size_t Jobs = 0;
+    uint64_t MaxInflightMb = 2048;
+    // Scenes loaded and packed at once, each fanning out over all Jobs threads; 0 uses a
+    // quarter of the hardware threads.
+    size_t SceneJobs = 0;
 };
 
 class MeshAssetProcessor {
 public:
     static void ProcessMeshAsset(const MeshAssetProcessParams& params);
+    // Bakes every scene, continuing past failed ones; throws at the end if any failed.
+    static void ProcessBatch(const BatchBakeParams& batch);
+
+    /**
+     * Reads a batch manifest: {"scenes": [{"scene": "a.gltf", "output": "a", "scale": 1.0}, ...]}.
+     * Scene paths are relative to the manifest. `output` defaults to the scene's file name stem;
+     * every other setting comes from `defaults` unless the entry overrides it with "scale",
+     * "optimize_vertex_order", "quantize", "lod_errors", "weld", "weld_epsilon",
+     * "instance_meshes", "short_indices", "atlas_max_size", "bc_quality", "pack" or
+     * "pack_compression".
+     */
+    static BatchBakeParams LoadBatch(const std::filesystem::path& path, const MeshAssetProcessParams& defaults);
 
 private:
+    struct SceneBake;
+    struct ImageJob;
+    class StageTimes;
+    class BakeLog;
+
+    static void PackScene(SceneBake& scene, const std::shared_ptr<kajiya_asset::LazyCache>& lazyCache, StageTimes& times,
+                          BakeLog& log);
+    // Bakes an image for every use that can't reuse an earlier bake; false if all could.
+    static bool BakeImage(ImageJob& job, const std::shared_ptr<kajiya_asset::LazyCache>& lazyCache);
+    static void FinishScene(SceneBake& scene, BakeLog& log);
+
     static std::string FormatHex(uint64_t value, size_t width);
+    // Content key of a whole bake: baker version, output settings and every input's hash.
+    static uint64_t BakeKey(const MeshAssetProcessParams& params, const std::vector<BakeInput>& inputs);
+    static void PrintVertexCacheStats(std::ostream& out, const char* label, const std::vector<uint32_t>& indices,
+                                      size_t vertexCount);
+};
+
+// An equirectangular EXR environment, baked for image-based lighting.
+struct EnvironmentAssetProcessParams {
+    std::filesystem::path Path;
+    std::string OutputName;
+    tekki::asset::EnvironmentBakeOptions Options;
+    // Reuse the outputs recorded in cache/<OutputName>.manifest.json while nothing changed.
+    bool Incremental = true;
+};
+
+class EnvironmentAssetProcessor {
+public:
+    /**
+     * Writes cache/<OutputName>.image, the GGX-prefiltered specular cube (see PrefilterGgx),
+     * and cache/<OutputName>.irradiance.image, its SH irradiance as a 9x1 image, so the
+     * renderer can load both instead of convolving the environment itself.
+     */
+    static void ProcessEnvironment(const EnvironmentAssetProcessParams& params);
+
+private:
+    static uint64_t BakeKey(const EnvironmentAssetProcessParams& params, const std::vector<BakeInput>& inputs);
 };
 
 } // namespace tekki::kajiya_asset_pipe
\ No newline at end of file
@@ -1,61 +1,55 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <filesystem>
-#include <fstream>
 #include <memory>
-#include <mutex>
 #include <stdexcept>
 #include <string>
-#include <unordered_map>
-#include <vector>
-#include <glm/glm.hpp>
-#include "tekki/core/result.h"
+#include "tekki/core/mapped_file.h"
 
 namespace tekki::renderer {
 
+/**
+ * Process-wide cache of memory-mapped asset files.
+ *
+ * Every file is mapped at most once while anything holds it; the mapping is released with the
+ * last handle, so untouched assets cost address space only and touched ones live in the page
+ * cache rather than in anonymous memory. Lookups are sharded by path and take a shared lock on
+ * the hit path, so concurrent readers of different (or the same) assets don't serialise.
+ */
 class AssetMmapManager {
-private:
-    static std::unordered_map<std::filesystem::path, std::vector<uint8_t>> AssetMmaps;
-    static std::mutex AssetMmapsMutex;
-
 public:
+    struct Stats {
+        size_t MappedFiles = 0;
+        uint64_t MappedBytes = 0;
+        uint64_t ResidentBytes = 0; // Pages of live mappings currently in memory
+    };
+
     /**
      * Get a memory-mapped asset from the given path
      * @param path The path to the asset file
-     * @return Pointer to the memory-mapped asset data
+     * @return Pointer to the asset at the start of the mapping; the file stays mapped while any copy is alive
      * @throws std::runtime_error if the file cannot be opened or memory-mapped
      */
     template<typename T>
-    static const T* MmappedAsset(const std::filesystem::path& path) {
-        std::lock_guard<std::mutex> lock(AssetMmapsMutex);
-        
-        auto canonicalPath = std::filesystem::canonical(path);
-        
-        auto it = AssetMmaps.find(canonicalPath);
-        if (it == AssetMmaps.end()) {
-            std::ifstream file(canonicalPath, std::ios::binary | std::ios::ate);
-            if (!file.is_open()) {
-                throw std::runtime_error("Could not mmap " + canonicalPath.string() + ": file cannot be opened");
-            }
-            
-            std::streamsize size = file.tellg();
-            file.seekg(0, std::ios::beg);
-            
-            std::vector<uint8_t> buffer(size);
-            if (!file.read(reinterpret_cast<char*>(buffer.data()), size)) {
-                throw std::runtime_error("Could not mmap " + canonicalPath.string() + ": failed to read file");
-            }
-            
-            it = AssetMmaps.emplace(canonicalPath, std::move(buffer)).first;
-        }
-        
-        const std::vector<uint8_t>& data = it->second;
-        if (data.size() < sizeof(T)) {
-            throw std::runtime_error("Memory mapped data size is smaller than expected type size");
+    static std::shared_ptr<const T> MmappedAsset(const std::filesystem::path& path) {
+        auto file = Map(path);
+        if (file->Size() < sizeof(T)) {
+            throw std::runtime_error("Memory mapped data size is smaller than expected type size: " + path.string());
         }
-        
-        return reinterpret_cast<const T*>(data.data());
+        return std::shared_ptr<const T>(file, reinterpret_cast<const T*>(file->Bytes().data()));
     }
+
+    // The shared mapping of `path`, mapping it if no one holds it yet.
+    static std::shared_ptr<const tekki::core::MappedFile> Map(const std::filesystem::path& path);
+
+    // Residency hooks: start paging a held asset in, or drop its pages. No-ops when not mapped.
+    static void Prefetch(const std::filesystem::path& path);
+    static void Evict(const std::filesystem::path& path);
+
+    // MappedBytes is a running counter; ResidentBytes walks every live mapping.
+    static Stats GetStats();
 };
 
-} // namespace tekki::renderer
\ No newline at end of file
+} // namespace tekki::renderer
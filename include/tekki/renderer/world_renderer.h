@@ -42,11 +42,13 @@ constexpr bool USE_TAA_JITTER = true;
 struct GpuMesh {
     uint32_t VertexCoreOffset;
     uint32_t VertexUvOffset;
-    uint32_t VertexMatOffset;
     uint32_t VertexAuxOffset;
     uint32_t VertexTangentOffset;
     uint32_t MatDataOffset;
     uint32_t IndexOffset;
+    uint32_t MaterialRangeOffset;
+    uint32_t MaterialRangeCount;
+    uint32_t ShortIndexOffset;
 };
 
 class MeshHandle {
@@ -121,9 +123,18 @@ struct MeshLightSet {
     std::vector<TriangleLight> Lights;
 };
 
-struct UploadedTriMesh {
+// One full-detail material range of an uploaded mesh, as an indexed draw from the vertex pool.
+struct UploadedMeshDraw {
     uint64_t IndexBufferOffset;
     uint32_t IndexCount;
+    VkIndexType IndexType;
+    uint32_t VertexOffset; // Base vertex of 16-bit ranges, 0 for 32-bit ones
+    uint32_t MaterialId;
+};
+
+struct UploadedTriMesh {
+    // Entry i matches MaterialRange i and BLAS geometry i of the mesh.
+    std::vector<UploadedMeshDraw> Draws;
 };
 
 struct DynamicExposureState {
@@ -10,11 +10,15 @@ namespace tekki::rust_shaders_shared {
 struct MeshDescriptor {
     uint32_t VertexCoreOffset; // position, normal packed in one
     uint32_t VertexUvOffset;
-    uint32_t VertexMatOffset;
     uint32_t VertexAuxOffset;
     uint32_t VertexTangentOffset;
     uint32_t MatDataOffset;
     uint32_t IndexOffset;
+    // Full-detail MaterialRange entries in material order. Entry i is BLAS geometry i, so ray
+    // hits look theirs up by geometry index; FirstIndex is into ShortIndices for 16-bit ranges.
+    uint32_t MaterialRangeOffset;
+    uint32_t MaterialRangeCount;
+    uint32_t ShortIndexOffset; // 16-bit indices of the ranges with IndexSize 2
 };
 
 struct InstanceDynamicConstants {
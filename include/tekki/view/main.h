@@ -6,6 +6,7 @@
 #include <vector>
 #include <string>
 #include <glm/glm.hpp>
+#include "tekki/backend/async_file_loader.h"
 #include "tekki/core/result.h"
 #include "kajiya_simple.h"
 #include "Opt.h"
@@ -62,6 +63,8 @@ public:
      */
     void LoadScene(const std::filesystem::path& scene_path) {
         try {
+            // Reads prefetched for the previous scene would only hold the new one's back.
+            tekki::backend::AsyncFileLoader::Shared().DropPrefetches();
             runtime_.LoadScene(persisted_, kajiya_.GetWorldRenderer(), scene_path);
         } catch (const std::exception& e) {
             throw std::runtime_error(std::string("Failed to load scene: ") + e.what());
@@ -54,6 +54,8 @@ AppState AppState::New(PersistedState persisted, const Opt& opt) {
  */
 void AppState::LoadScene(const std::filesystem::path& scene_path) {
     try {
+        // Reads prefetched for the previous scene would only hold the new one's back.
+        tekki::backend::AsyncFileLoader::Shared().DropPrefetches();
         runtime_.LoadScene(persisted_, kajiya_.GetWorldRenderer(), scene_path);
     } catch (const std::exception& e) {
         throw std::runtime_error(std::string("Failed to load scene: ") + e.what());
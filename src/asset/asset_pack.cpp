@@ -0,0 +1,256 @@
+#include "tekki/asset/asset_pack.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace tekki::asset {
+
+uint64_t PackNameIdentity(std::string_view name) {
+    // FNV-1a
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (char c : name) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+AssetPackWriter::AssetPackWriter(const std::filesystem::path& path, CompressionCodec codec)
+    : path_(path), tempPath_(path.string() + ".tmp"), codec_(codec) {
+    file_.open(tempPath_, std::ios::binary | std::ios::trunc);
+    if (!file_.is_open()) {
+        throw std::runtime_error("Failed to create asset pack " + tempPath_.string());
+    }
+
+    // Placeholder header; the real one is written once the table of contents is known.
+    PackHeader header{};
+    file_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    offset_ = sizeof(header);
+}
+
+AssetPackWriter::~AssetPackWriter() {
+    if (!finished_) {
+        file_.close();
+        std::error_code ec;
+        std::filesystem::remove(tempPath_, ec);
+    }
+}
+
+void AssetPackWriter::PadToPage() {
+    static constexpr char padding[FlatWriter::PAGE_ALIGNMENT] = {};
+    uint64_t aligned = (offset_ + FlatWriter::PAGE_ALIGNMENT - 1) & ~(FlatWriter::PAGE_ALIGNMENT - 1);
+    file_.write(padding, static_cast<std::streamsize>(aligned - offset_));
+    offset_ = aligned;
+}
+
+bool AssetPackWriter::Add(uint64_t identity, PackEntryKind kind, FlatWriter& writer) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (identities_.contains(identity)) {
+            return false;
+        }
+    }
+
+    writer.SetPageAlignedSections(PACK_PAGE_ALIGN_FROM);
+    PackEntry entry{identity, kind, CompressionCodec::None, 0, 0, writer.Size()};
+
+    // Compressed entries are built outside the lock; stored ones stream straight to the file.
+    std::vector<uint8_t> compressed;
+    if (codec_ != CompressionCodec::None) {
+        std::vector<uint8_t> flat;
+        flat.reserve(static_cast<size_t>(entry.Size));
+        VectorFlattenSink sink(flat);
+        writer.WriteTo(sink);
+        compressed = CompressBlocks(flat, codec_, writer.GetSectionRanges());
+        if (compressed.size() < flat.size()) {
+            entry.Codec = codec_;
+        } else {
+            compressed = std::move(flat);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (identities_.contains(identity)) {
+        return false;
+    }
+
+    PadToPage();
+    entry.Offset = offset_;
+    if (codec_ != CompressionCodec::None) {
+        file_.write(reinterpret_cast<const char*>(compressed.data()), static_cast<std::streamsize>(compressed.size()));
+        entry.StoredSize = compressed.size();
+    } else {
+        StreamFlattenSink sink(file_);
+        writer.WriteTo(sink);
+        entry.StoredSize = entry.Size;
+    }
+    if (!file_) {
+        throw std::runtime_error("Failed to write asset pack " + tempPath_.string());
+    }
+
+    offset_ += entry.StoredSize;
+    flatBytes_ += entry.Size;
+    entries_.push_back(entry);
+    identities_.insert(identity);
+    return true;
+}
+
+bool AssetPackWriter::Add(uint64_t identity, const GpuImage::Proto& image) {
+    FlatWriter writer;
+    image.WriteFlat(writer);
+    return Add(identity, PackEntryKind::Image, writer);
+}
+
+bool AssetPackWriter::AddStored(const PackEntry& entry, std::span<const uint8_t> stored) {
+    if (stored.size() != entry.StoredSize) {
+        throw std::runtime_error("Stored asset " + std::to_string(entry.Identity) + " has " +
+                                 std::to_string(stored.size()) + " bytes, expected " + std::to_string(entry.StoredSize));
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (identities_.contains(entry.Identity)) {
+        return false;
+    }
+
+    PadToPage();
+    PackEntry copy = entry;
+    copy.Offset = offset_;
+    file_.write(reinterpret_cast<const char*>(stored.data()), static_cast<std::streamsize>(stored.size()));
+    if (!file_) {
+        throw std::runtime_error("Failed to write asset pack " + tempPath_.string());
+    }
+
+    offset_ += copy.StoredSize;
+    flatBytes_ += copy.Size;
+    entries_.push_back(copy);
+    identities_.insert(copy.Identity);
+    return true;
+}
+
+void AssetPackWriter::Finish() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (finished_) {
+        return;
+    }
+
+    std::sort(entries_.begin(), entries_.end(),
+              [](const PackEntry& a, const PackEntry& b) { return a.Identity < b.Identity; });
+
+    PadToPage();
+    PackHeader header{PACK_MAGIC, PACK_VERSION, static_cast<uint32_t>(entries_.size()), offset_, 0};
+    file_.write(reinterpret_cast<const char*>(entries_.data()),
+                static_cast<std::streamsize>(entries_.size() * sizeof(PackEntry)));
+    file_.seekp(0);
+    file_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file_.close();
+    if (!file_) {
+        throw std::runtime_error("Failed to write asset pack " + tempPath_.string());
+    }
+
+    std::filesystem::rename(tempPath_, path_);
+    finished_ = true;
+}
+
+uint64_t AssetPackWriter::GetStoredBytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return offset_;
+}
+
+uint64_t AssetPackWriter::GetFlatBytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return flatBytes_;
+}
+
+std::shared_ptr<const AssetPack> AssetPack::Open(const std::filesystem::path& path) {
+    return Open(tekki::core::MappedFile::Open(path, tekki::core::MappedFile::Access::Random));
+}
+
+std::shared_ptr<const AssetPack> AssetPack::Open(std::shared_ptr<const tekki::core::MappedFile> file) {
+    const auto bytes = file->Bytes();
+    const std::string name = file->Path().string();
+
+    PackHeader header;
+    if (bytes.size() < sizeof(header)) {
+        throw std::runtime_error("Asset pack " + name + " is too small");
+    }
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    if (header.Magic != PACK_MAGIC) {
+        throw std::runtime_error(name + " is not an asset pack");
+    }
+    if (header.Version != PACK_VERSION) {
+        throw std::runtime_error("Asset pack " + name + " has version " + std::to_string(header.Version) +
+                                 ", expected " + std::to_string(PACK_VERSION));
+    }
+    const uint64_t toc_size = static_cast<uint64_t>(header.EntryCount) * sizeof(PackEntry);
+    if (header.TocOffset % alignof(PackEntry) != 0 || header.TocOffset > bytes.size() ||
+        toc_size > bytes.size() - header.TocOffset) {
+        throw std::runtime_error("Asset pack " + name + " has a truncated table of contents");
+    }
+
+    std::shared_ptr<AssetPack> pack(new AssetPack());
+    pack->entries_ = {reinterpret_cast<const PackEntry*>(bytes.data() + header.TocOffset), header.EntryCount};
+    for (const PackEntry& entry : pack->entries_) {
+        if (entry.Offset > header.TocOffset || entry.StoredSize > header.TocOffset - entry.Offset) {
+            throw std::runtime_error("Asset pack " + name + " has an entry past its end");
+        }
+        if (entry.Codec == CompressionCodec::None && entry.StoredSize != entry.Size) {
+            throw std::runtime_error("Asset pack " + name + " has a stored entry of the wrong size");
+        }
+    }
+    pack->file_ = std::move(file);
+    return pack;
+}
+
+const PackEntry* AssetPack::Find(uint64_t identity) const {
+    auto it = std::lower_bound(entries_.begin(), entries_.end(), identity,
+                               [](const PackEntry& entry, uint64_t id) { return entry.Identity < id; });
+    return it != entries_.end() && it->Identity == identity ? &*it : nullptr;
+}
+
+std::span<const uint8_t> AssetPack::GetStored(const PackEntry& entry) const {
+    return file_->Bytes().subspan(static_cast<size_t>(entry.Offset), static_cast<size_t>(entry.StoredSize));
+}
+
+std::shared_ptr<const uint8_t> AssetPack::Load(const PackEntry& entry) const {
+    if (entry.Codec == CompressionCodec::None) {
+        return std::shared_ptr<const uint8_t>(file_, file_->Bytes().data() + entry.Offset);
+    }
+
+    auto buffer = std::make_shared<std::vector<uint8_t>>(static_cast<size_t>(entry.Size));
+    LoadInto(entry, *buffer);
+    return std::shared_ptr<const uint8_t>(buffer, buffer->data());
+}
+
+void AssetPack::LoadInto(const PackEntry& entry, std::span<uint8_t> dst) const {
+    auto stored = GetStored(entry);
+    const auto start = std::chrono::steady_clock::now();
+    try {
+        if (entry.Codec == CompressionCodec::None) {
+            DecompressBytes(stored, entry.Codec, dst);
+            return;
+        }
+        DecompressBlocks(stored, dst);
+    } catch (const std::exception& e) {
+        throw std::runtime_error("Failed to load asset " + std::to_string(entry.Identity) + " from " +
+                                 file_->Path().string() + ": " + e.what());
+    }
+
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    storedBytes_.fetch_add(entry.StoredSize, std::memory_order_relaxed);
+    decodedBytes_.fetch_add(entry.Size, std::memory_order_relaxed);
+    decodeNanoseconds_.fetch_add(
+        static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()),
+        std::memory_order_relaxed);
+}
+
+AssetPack::DecodeStats AssetPack::GetDecodeStats() const {
+    DecodeStats stats;
+    stats.StoredBytes = storedBytes_.load(std::memory_order_relaxed);
+    stats.DecodedBytes = decodedBytes_.load(std::memory_order_relaxed);
+    stats.Seconds = static_cast<double>(decodeNanoseconds_.load(std::memory_order_relaxed)) / 1.0e9;
+    return stats;
+}
+
+} // namespace tekki::asset
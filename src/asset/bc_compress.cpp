@@ -0,0 +1,1042 @@
+#include "tekki/asset/bc_compress.h"
+#include "tekki/core/parallel.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    #define TEKKI_BC_X86 1
+    #include <immintrin.h>
+#endif
+
+namespace tekki::asset {
+
+namespace {
+
+constexpr int WEIGHTS3[8] = {0, 9, 18, 27, 37, 46, 55, 64};
+constexpr int WEIGHTS4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+// BC7 two-subset partitions: the subset of every pixel, and the anchor pixel of subset 1.
+constexpr uint8_t PARTITIONS2[64][16] = {
+    {0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1}, {0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1},
+    {0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1}, {0, 0, 0, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 1, 1, 1},
+    {0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 1, 1}, {0, 0, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 1, 1, 1, 1},
+    {0, 0, 0, 1, 0, 0, 1, 1, 0, 1, 1, 1, 1, 1, 1, 1}, {0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 1, 1, 0, 1, 1, 1},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 1, 1}, {0, 0, 1, 1, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1},
+    {0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 1, 1, 1, 1, 1, 1}, {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 1, 1},
+    {0, 0, 0, 1, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1}, {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1},
+    {0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1}, {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1},
+    {0, 0, 0, 0, 1, 0, 0, 0, 1, 1, 1, 0, 1, 1, 1, 1}, {0, 1, 1, 1, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 1, 1, 1, 0}, {0, 1, 1, 1, 0, 0, 1, 1, 0, 0, 0, 1, 0, 0, 0, 0},
+    {0, 0, 1, 1, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0}, {0, 0, 0, 0, 1, 0, 0, 0, 1, 1, 0, 0, 1, 1, 1, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 1, 1, 0, 0}, {0, 1, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 0, 1},
+    {0, 0, 1, 1, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 0}, {0, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1, 1, 0, 0},
+    {0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0}, {0, 0, 1, 1, 0, 1, 1, 0, 0, 1, 1, 0, 1, 1, 0, 0},
+    {0, 0, 0, 1, 0, 1, 1, 1, 1, 1, 1, 0, 1, 0, 0, 0}, {0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0},
+    {0, 1, 1, 1, 0, 0, 0, 1, 1, 0, 0, 0, 1, 1, 1, 0}, {0, 0, 1, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 1, 0, 0},
+    {0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1}, {0, 0, 0, 0, 1, 1, 1, 1, 0, 0, 0, 0, 1, 1, 1, 1},
+    {0, 1, 0, 1, 1, 0, 1, 0, 0, 1, 0, 1, 1, 0, 1, 0}, {0, 0, 1, 1, 0, 0, 1, 1, 1, 1, 0, 0, 1, 1, 0, 0},
+    {0, 0, 1, 1, 1, 1, 0, 0, 0, 0, 1, 1, 1, 1, 0, 0}, {0, 1, 0, 1, 0, 1, 0, 1, 1, 0, 1, 0, 1, 0, 1, 0},
+    {0, 1, 1, 0, 1, 0, 0, 1, 0, 1, 1, 0, 1, 0, 0, 1}, {0, 1, 0, 1, 1, 0, 1, 0, 1, 0, 1, 0, 0, 1, 0, 1},
+    {0, 1, 1, 1, 0, 0, 1, 1, 1, 1, 0, 0, 1, 1, 1, 0}, {0, 0, 0, 1, 0, 0, 1, 1, 1, 1, 0, 0, 1, 0, 0, 0},
+    {0, 0, 1, 1, 0, 0, 1, 0, 0, 1, 0, 0, 1, 1, 0, 0}, {0, 0, 1, 1, 1, 0, 1, 1, 1, 1, 0, 1, 1, 1, 0, 0},
+    {0, 1, 1, 0, 1, 0, 0, 1, 1, 0, 0, 1, 0, 1, 1, 0}, {0, 0, 1, 1, 1, 1, 0, 0, 1, 1, 0, 0, 0, 0, 1, 1},
+    {0, 1, 1, 0, 0, 1, 1, 0, 1, 0, 0, 1, 1, 0, 0, 1}, {0, 0, 0, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 0, 0, 0},
+    {0, 1, 0, 0, 1, 1, 1, 0, 0, 1, 0, 0, 0, 0, 0, 0}, {0, 0, 1, 0, 0, 1, 1, 1, 0, 0, 1, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 1, 0, 0, 1, 1, 1, 0, 0, 1, 0}, {0, 0, 0, 0, 0, 1, 0, 0, 1, 1, 1, 0, 0, 1, 0, 0},
+    {0, 1, 1, 0, 1, 1, 0, 0, 1, 0, 0, 1, 0, 0, 1, 1}, {0, 0, 1, 1, 0, 1, 1, 0, 1, 1, 0, 0, 1, 0, 0, 1},
+    {0, 1, 1, 0, 0, 0, 1, 1, 1, 0, 0, 1, 1, 1, 0, 0}, {0, 0, 1, 1, 1, 0, 0, 1, 1, 1, 0, 0, 0, 1, 1, 0},
+    {0, 1, 1, 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 0, 0, 1}, {0, 1, 1, 0, 0, 0, 1, 1, 0, 0, 1, 1, 1, 0, 0, 1},
+    {0, 1, 1, 1, 1, 1, 1, 0, 1, 0, 0, 0, 0, 0, 0, 1}, {0, 0, 0, 1, 1, 0, 0, 0, 1, 1, 1, 0, 0, 1, 1, 1},
+    {0, 0, 0, 0, 1, 1, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1}, {0, 0, 1, 1, 0, 0, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0},
+    {0, 0, 1, 0, 0, 0, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0}, {0, 1, 0, 0, 0, 1, 0, 0, 0, 1, 1, 1, 0, 1, 1, 1},
+};
+
+constexpr uint8_t ANCHORS2[64] = {
+    15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+    15, 2,  8,  2,  2,  8,  8,  15, 2,  8,  2,  2,  8,  8,  2,  2,
+    15, 15, 6,  8,  2,  8,  15, 15, 2,  8,  2,  2,  2,  15, 15, 6,
+    6,  2,  6,  8,  15, 15, 2,  2,  15, 15, 15, 15, 15, 2,  2,  15,
+};
+
+// Little-endian bit stream over one 16-byte block.
+class BlockWriter {
+public:
+    explicit BlockWriter(uint8_t* out) : out_(out) { std::memset(out_, 0, BC_BLOCK_BYTES); }
+
+    void Write(uint32_t value, int bits) {
+        for (int i = 0; i < bits; ++i, ++pos_) {
+            out_[pos_ >> 3] |= static_cast<uint8_t>(((value >> i) & 1u) << (pos_ & 7));
+        }
+    }
+
+private:
+    uint8_t* out_;
+    int pos_ = 0;
+};
+
+class BlockReader {
+public:
+    explicit BlockReader(const uint8_t* in) : in_(in) {}
+
+    uint32_t Read(int bits) {
+        uint32_t value = 0;
+        for (int i = 0; i < bits; ++i, ++pos_) {
+            value |= static_cast<uint32_t>((in_[pos_ >> 3] >> (pos_ & 7)) & 1u) << i;
+        }
+        return value;
+    }
+
+private:
+    const uint8_t* in_;
+    int pos_ = 0;
+};
+
+void LoadBlock(std::span<const uint8_t> rgba, uint32_t width, uint32_t height, uint32_t bx, uint32_t by, uint8_t (&px)[16][4]) {
+    for (uint32_t y = 0; y < 4; ++y) {
+        uint32_t sy = std::min(by * 4 + y, height - 1);
+        for (uint32_t x = 0; x < 4; ++x) {
+            uint32_t sx = std::min(bx * 4 + x, width - 1);
+            std::memcpy(px[y * 4 + x], &rgba[(static_cast<size_t>(sy) * width + sx) * 4], 4);
+        }
+    }
+}
+
+void StoreBlock(const uint8_t (&px)[16][4], uint32_t width, uint32_t height, uint32_t bx, uint32_t by, std::span<uint8_t> rgba) {
+    for (uint32_t y = 0; y < 4 && by * 4 + y < height; ++y) {
+        for (uint32_t x = 0; x < 4 && bx * 4 + x < width; ++x) {
+            std::memcpy(&rgba[(static_cast<size_t>(by * 4 + y) * width + bx * 4 + x) * 4], px[y * 4 + x], 4);
+        }
+    }
+}
+
+inline int Interpolate(int e0, int e1, int weight) {
+    return ((64 - weight) * e0 + weight * e1 + 32) >> 6;
+}
+
+// ---------------------------------------------------------------------------------------------
+// BC4 (one channel; BC5 is two of them)
+
+struct Bc4Fit {
+    int E0 = 0;
+    int E1 = 0;
+    uint8_t Indices[16] = {};
+    uint32_t Error = std::numeric_limits<uint32_t>::max();
+};
+
+// `e0 > e1` selects eight interpolated values, otherwise six plus explicit 0 and 255.
+void Bc4Palette(int e0, int e1, int (&palette)[8]) {
+    palette[0] = e0;
+    palette[1] = e1;
+    if (e0 > e1) {
+        for (int i = 2; i < 8; ++i) {
+            palette[i] = ((8 - i) * e0 + (i - 1) * e1 + 3) / 7;
+        }
+    } else {
+        for (int i = 2; i < 6; ++i) {
+            palette[i] = ((6 - i) * e0 + (i - 1) * e1 + 2) / 5;
+        }
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+}
+
+Bc4Fit TryBc4(const uint8_t (&values)[16], int e0, int e1) {
+    int palette[8];
+    Bc4Palette(e0, e1, palette);
+
+    Bc4Fit fit;
+    fit.E0 = e0;
+    fit.E1 = e1;
+    fit.Error = 0;
+    for (int i = 0; i < 16; ++i) {
+        int best = 0;
+        int best_err = std::numeric_limits<int>::max();
+        for (int j = 0; j < 8; ++j) {
+            int d = palette[j] - values[i];
+            if (d * d < best_err) {
+                best_err = d * d;
+                best = j;
+            }
+        }
+        fit.Indices[i] = static_cast<uint8_t>(best);
+        fit.Error += static_cast<uint32_t>(best_err);
+    }
+    return fit;
+}
+
+// Least-squares endpoints for the current eight-value indices; false when they are degenerate.
+bool RefineBc4(const uint8_t (&values)[16], const Bc4Fit& fit, int& e0, int& e1) {
+    float a = 0.0f, b = 0.0f, c = 0.0f, x = 0.0f, y = 0.0f;
+    for (int i = 0; i < 16; ++i) {
+        int index = fit.Indices[i];
+        float w = index == 0 ? 0.0f : index == 1 ? 1.0f : static_cast<float>(index - 1) / 7.0f;
+        a += (1.0f - w) * (1.0f - w);
+        b += (1.0f - w) * w;
+        c += w * w;
+        x += (1.0f - w) * values[i];
+        y += w * values[i];
+    }
+
+    float det = a * c - b * b;
+    if (std::abs(det) < 1e-6f) {
+        return false;
+    }
+    e0 = std::clamp(static_cast<int>(std::lround((c * x - b * y) / det)), 0, 255);
+    e1 = std::clamp(static_cast<int>(std::lround((a * y - b * x) / det)), 0, 255);
+    if (e0 < e1) {
+        std::swap(e0, e1);
+    }
+    return e0 != e1;
+}
+
+void EncodeBc4(const uint8_t (&values)[16], TexCompressionQuality quality, uint8_t* out) {
+    auto [lo, hi] = std::minmax_element(std::begin(values), std::end(values));
+
+    Bc4Fit best;
+    if (*lo == *hi) {
+        best.E0 = *hi;
+        best.E1 = *lo;
+        best.Error = 0;
+    } else {
+        best = TryBc4(values, *hi, *lo);
+
+        int iterations = quality == TexCompressionQuality::Fast ? 0 : quality == TexCompressionQuality::Normal ? 1 : 4;
+        for (int iter = 0; iter < iterations && best.Error > 0; ++iter) {
+            int e0 = 0, e1 = 0;
+            if (!RefineBc4(values, best, e0, e1)) {
+                break;
+            }
+            auto candidate = TryBc4(values, e0, e1);
+            if (candidate.Error >= best.Error) {
+                break;
+            }
+            best = candidate;
+        }
+
+        // Blocks that touch 0 or 255 can spend all six interpolated values on the rest.
+        if (quality == TexCompressionQuality::Best && best.Error > 0) {
+            int inner_lo = 255, inner_hi = 0;
+            for (uint8_t v : values) {
+                if (v != 0 && v != 255) {
+                    inner_lo = std::min<int>(inner_lo, v);
+                    inner_hi = std::max<int>(inner_hi, v);
+                }
+            }
+            if (inner_lo <= inner_hi) {
+                auto candidate = TryBc4(values, inner_lo, inner_hi);
+                if (candidate.Error < best.Error) {
+                    best = candidate;
+                }
+            }
+        }
+    }
+
+    out[0] = static_cast<uint8_t>(best.E0);
+    out[1] = static_cast<uint8_t>(best.E1);
+    uint64_t bits = 0;
+    for (int i = 0; i < 16; ++i) {
+        bits |= static_cast<uint64_t>(best.Indices[i]) << (3 * i);
+    }
+    for (int i = 0; i < 6; ++i) {
+        out[2 + i] = static_cast<uint8_t>(bits >> (8 * i));
+    }
+}
+
+void DecodeBc4(const uint8_t* in, uint8_t (&px)[16][4], int channel) {
+    int palette[8];
+    Bc4Palette(in[0], in[1], palette);
+    uint64_t bits = 0;
+    for (int i = 0; i < 6; ++i) {
+        bits |= static_cast<uint64_t>(in[2 + i]) << (8 * i);
+    }
+    for (int i = 0; i < 16; ++i) {
+        px[i][channel] = static_cast<uint8_t>(palette[(bits >> (3 * i)) & 7]);
+    }
+}
+
+void EncodeBc5Block(const uint8_t (&px)[16][4], TexCompressionQuality quality, uint8_t* out) {
+    uint8_t red[16], green[16];
+    for (int i = 0; i < 16; ++i) {
+        red[i] = px[i][0];
+        green[i] = px[i][1];
+    }
+    EncodeBc4(red, quality, out);
+    EncodeBc4(green, quality, out + 8);
+}
+
+// ---------------------------------------------------------------------------------------------
+// BC7 palette search
+//
+// The palette and the pixels are stored as interleaved (r, g) and (b, a) int16 pairs, so one
+// madd per pair yields the squared distance of a pixel to several palette entries at once. The
+// error is shifted left and or'ed with the entry index, which turns the closest-entry search into
+// an unsigned min whose ties resolve to the lowest index, the same as the scalar loop.
+
+struct Palette {
+    alignas(32) int16_t Rg[32] = {};
+    alignas(32) int16_t Ba[32] = {};
+    int Count = 0; // 8 or 16
+};
+
+struct PixelSet {
+    uint32_t Rg[16] = {};
+    uint32_t Ba[16] = {};
+    int Count = 0;
+};
+
+inline uint32_t PackPair(int lo, int hi) {
+    return static_cast<uint32_t>(static_cast<uint16_t>(lo)) | (static_cast<uint32_t>(static_cast<uint16_t>(hi)) << 16);
+}
+
+using FindClosestFn = uint32_t (*)(const Palette&, const PixelSet&, uint8_t*);
+
+uint32_t FindClosestScalar(const Palette& palette, const PixelSet& pixels, uint8_t* indices) {
+    uint32_t total = 0;
+    for (int i = 0; i < pixels.Count; ++i) {
+        int r = static_cast<int16_t>(pixels.Rg[i]), g = static_cast<int16_t>(pixels.Rg[i] >> 16);
+        int b = static_cast<int16_t>(pixels.Ba[i]), a = static_cast<int16_t>(pixels.Ba[i] >> 16);
+
+        uint32_t best = std::numeric_limits<uint32_t>::max();
+        int best_index = 0;
+        for (int j = 0; j < palette.Count; ++j) {
+            int dr = palette.Rg[2 * j] - r, dg = palette.Rg[2 * j + 1] - g;
+            int db = palette.Ba[2 * j] - b, da = palette.Ba[2 * j + 1] - a;
+            uint32_t err = static_cast<uint32_t>(dr * dr + dg * dg + db * db + da * da);
+            if (err < best) {
+                best = err;
+                best_index = j;
+            }
+        }
+        indices[i] = static_cast<uint8_t>(best_index);
+        total += best;
+    }
+    return total;
+}
+
+#ifdef TEKKI_BC_X86
+__attribute__((target("sse4.1"))) uint32_t FindClosestSse41(const Palette& palette, const PixelSet& pixels, uint8_t* indices) {
+    const int groups = palette.Count / 4;
+    __m128i rg[4], ba[4], lanes[4];
+    for (int g = 0; g < groups; ++g) {
+        rg[g] = _mm_load_si128(reinterpret_cast<const __m128i*>(palette.Rg + 8 * g));
+        ba[g] = _mm_load_si128(reinterpret_cast<const __m128i*>(palette.Ba + 8 * g));
+        lanes[g] = _mm_setr_epi32(4 * g, 4 * g + 1, 4 * g + 2, 4 * g + 3);
+    }
+
+    uint32_t total = 0;
+    for (int i = 0; i < pixels.Count; ++i) {
+        const __m128i prg = _mm_set1_epi32(static_cast<int>(pixels.Rg[i]));
+        const __m128i pba = _mm_set1_epi32(static_cast<int>(pixels.Ba[i]));
+
+        __m128i key = _mm_set1_epi32(-1);
+        for (int g = 0; g < groups; ++g) {
+            __m128i d = _mm_sub_epi16(rg[g], prg);
+            __m128i err = _mm_madd_epi16(d, d);
+            d = _mm_sub_epi16(ba[g], pba);
+            err = _mm_add_epi32(err, _mm_madd_epi16(d, d));
+            key = _mm_min_epu32(key, _mm_or_si128(_mm_slli_epi32(err, 4), lanes[g]));
+        }
+        key = _mm_min_epu32(key, _mm_shuffle_epi32(key, _MM_SHUFFLE(1, 0, 3, 2)));
+        key = _mm_min_epu32(key, _mm_shuffle_epi32(key, _MM_SHUFFLE(2, 3, 0, 1)));
+
+        uint32_t k = static_cast<uint32_t>(_mm_cvtsi128_si32(key));
+        indices[i] = static_cast<uint8_t>(k & 15);
+        total += k >> 4;
+    }
+    return total;
+}
+
+__attribute__((target("avx2"))) uint32_t FindClosestAvx2(const Palette& palette, const PixelSet& pixels, uint8_t* indices) {
+    const bool wide = palette.Count > 8;
+    const __m256i rg0 = _mm256_load_si256(reinterpret_cast<const __m256i*>(palette.Rg));
+    const __m256i ba0 = _mm256_load_si256(reinterpret_cast<const __m256i*>(palette.Ba));
+    const __m256i rg1 = _mm256_load_si256(reinterpret_cast<const __m256i*>(palette.Rg + 16));
+    const __m256i ba1 = _mm256_load_si256(reinterpret_cast<const __m256i*>(palette.Ba + 16));
+    const __m256i lanes0 = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i lanes1 = _mm256_setr_epi32(8, 9, 10, 11, 12, 13, 14, 15);
+
+    uint32_t total = 0;
+    for (int i = 0; i < pixels.Count; ++i) {
+        const __m256i prg = _mm256_set1_epi32(static_cast<int>(pixels.Rg[i]));
+        const __m256i pba = _mm256_set1_epi32(static_cast<int>(pixels.Ba[i]));
+
+        __m256i d = _mm256_sub_epi16(rg0, prg);
+        __m256i err = _mm256_madd_epi16(d, d);
+        d = _mm256_sub_epi16(ba0, pba);
+        err = _mm256_add_epi32(err, _mm256_madd_epi16(d, d));
+        __m256i key = _mm256_or_si256(_mm256_slli_epi32(err, 4), lanes0);
+
+        if (wide) {
+            d = _mm256_sub_epi16(rg1, prg);
+            err = _mm256_madd_epi16(d, d);
+            d = _mm256_sub_epi16(ba1, pba);
+            err = _mm256_add_epi32(err, _mm256_madd_epi16(d, d));
+            key = _mm256_min_epu32(key, _mm256_or_si256(_mm256_slli_epi32(err, 4), lanes1));
+        }
+
+        __m128i m = _mm_min_epu32(_mm256_castsi256_si128(key), _mm256_extracti128_si256(key, 1));
+        m = _mm_min_epu32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(1, 0, 3, 2)));
+        m = _mm_min_epu32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(2, 3, 0, 1)));
+
+        uint32_t k = static_cast<uint32_t>(_mm_cvtsi128_si32(m));
+        indices[i] = static_cast<uint8_t>(k & 15);
+        total += k >> 4;
+    }
+    return total;
+}
+#endif
+
+// Picks the widest kernel the CPU supports, once per process.
+FindClosestFn SelectFindClosest() {
+#ifdef TEKKI_BC_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return FindClosestAvx2;
+    }
+    if (__builtin_cpu_supports("sse4.1")) {
+        return FindClosestSse41;
+    }
+#endif
+    return FindClosestScalar;
+}
+
+// ---------------------------------------------------------------------------------------------
+// BC7 endpoint fitting
+
+struct ModeInfo {
+    int ColorBits;    // per endpoint component, excluding the p-bit
+    int IndexBits;
+    bool SharedPbit;  // one p-bit per subset instead of per endpoint
+    bool Alpha;       // alpha takes part in the fit; otherwise it is written as opaque
+};
+
+struct Endpoints {
+    float E[2][4] = {};
+};
+
+struct QuantizedEndpoints {
+    int Q[2][4] = {};
+    int P[2] = {};
+};
+
+struct SubsetFit {
+    QuantizedEndpoints Endpoints;
+    uint8_t Indices[16] = {};
+    uint32_t Error = std::numeric_limits<uint32_t>::max();
+};
+
+struct Bc7Settings {
+    bool UseMode1 = false;
+    int Mode1Partitions = 0;  // best-estimated partitions that get a full encode
+    int RefineIterations = 0; // least-squares passes, stopping early once they no longer help
+    bool SearchPbits = false; // score every p-bit combination by its palette error
+};
+
+Bc7Settings SettingsFor(TexCompressionQuality quality) {
+    switch (quality) {
+        case TexCompressionQuality::Fast:
+            return {false, 0, 0, false};
+        case TexCompressionQuality::Normal:
+            return {true, 4, 1, false};
+        case TexCompressionQuality::Best:
+            return {true, 64, 3, true};
+    }
+    return {};
+}
+
+inline int ExpandComponent(int q, int bits, int pbit) {
+    int v = (q << 1) | pbit;
+    int width = bits + 1;
+    return (v << (8 - width)) | (v >> (2 * width - 8));
+}
+
+// Nearest `bits`-bit code for every half step of an 8-bit value and p-bit, for the 6- and 7-bit
+// endpoint modes.
+struct QuantizationTable {
+    uint8_t Code[2][2][511];
+
+    QuantizationTable() {
+        for (int wide = 0; wide < 2; ++wide) {
+            const int bits = wide ? 7 : 6;
+            for (int pbit = 0; pbit < 2; ++pbit) {
+                for (int half_steps = 0; half_steps < 511; ++half_steps) {
+                    int best = 0;
+                    for (int q = 1; q < (1 << bits); ++q) {
+                        if (std::abs(2 * ExpandComponent(q, bits, pbit) - half_steps) <
+                            std::abs(2 * ExpandComponent(best, bits, pbit) - half_steps)) {
+                            best = q;
+                        }
+                    }
+                    Code[wide][pbit][half_steps] = static_cast<uint8_t>(best);
+                }
+            }
+        }
+    }
+};
+
+const QuantizationTable QUANTIZATION;
+
+inline int QuantizeComponent(float value, int bits, int pbit) {
+    return QUANTIZATION.Code[bits == 7][pbit][std::clamp(static_cast<int>(value * 2.0f + 0.5f), 0, 510)];
+}
+
+// Mean of the pixels and the direction along which they vary most.
+void PrincipalAxis(const float (*px)[4], int count, int channels, float (&mean)[4], float (&axis)[4]) {
+    std::fill(std::begin(mean), std::end(mean), 0.0f);
+    std::fill(std::begin(axis), std::end(axis), 0.0f);
+    for (int i = 0; i < count; ++i) {
+        for (int c = 0; c < channels; ++c) {
+            mean[c] += px[i][c];
+        }
+    }
+    for (int c = 0; c < channels; ++c) {
+        mean[c] /= static_cast<float>(count);
+    }
+
+    float cov[4][4] = {};
+    for (int i = 0; i < count; ++i) {
+        float d[4] = {};
+        for (int c = 0; c < channels; ++c) {
+            d[c] = px[i][c] - mean[c];
+        }
+        for (int r = 0; r < channels; ++r) {
+            for (int c = r; c < channels; ++c) {
+                cov[r][c] += d[r] * d[c];
+            }
+        }
+    }
+    float trace = 0.0f;
+    int widest = 0;
+    for (int r = 0; r < channels; ++r) {
+        for (int c = 0; c < r; ++c) {
+            cov[r][c] = cov[c][r];
+        }
+        trace += cov[r][r];
+        if (cov[r][r] > cov[widest][widest]) {
+            widest = r;
+        }
+    }
+    if (trace <= 1e-6f) {
+        axis[0] = 1.0f;
+        return;
+    }
+
+    // Power iteration from the column of the channel with the largest variance.
+    for (int c = 0; c < channels; ++c) {
+        axis[c] = cov[widest][c];
+    }
+    for (int iter = 0; iter < 8; ++iter) {
+        float next[4] = {};
+        float largest = 0.0f;
+        for (int r = 0; r < channels; ++r) {
+            for (int c = 0; c < channels; ++c) {
+                next[r] += cov[r][c] * axis[c];
+            }
+            largest = std::max(largest, std::abs(next[r]));
+        }
+        if (largest <= 0.0f) {
+            break;
+        }
+        for (int c = 0; c < channels; ++c) {
+            axis[c] = next[c] / largest;
+        }
+    }
+
+    float length = 0.0f;
+    for (int c = 0; c < channels; ++c) {
+        length += axis[c] * axis[c];
+    }
+    length = std::sqrt(length);
+    if (length <= 0.0f) {
+        axis[0] = 1.0f;
+        return;
+    }
+    for (int c = 0; c < channels; ++c) {
+        axis[c] /= length;
+    }
+}
+
+// RGB sums and products of a set of pixels: r, g, b, rr, rg, rb, gg, gb, bb.
+using Moments = std::array<float, 9>;
+
+Moments PixelMoments(const float (&p)[4]) {
+    return {p[0], p[1], p[2], p[0] * p[0], p[0] * p[1], p[0] * p[2], p[1] * p[1], p[1] * p[2], p[2] * p[2]};
+}
+
+// Squared distance of the pixels to their best-fit line: total variance minus the variance
+// along the principal axis, estimated with a few power iterations.
+float LineResidual(const Moments& m, int count) {
+    const float n = static_cast<float>(count);
+    const float mean[3] = {m[0] / n, m[1] / n, m[2] / n};
+    const float cov[3][3] = {
+        {m[3] - n * mean[0] * mean[0], m[4] - n * mean[0] * mean[1], m[5] - n * mean[0] * mean[2]},
+        {m[4] - n * mean[0] * mean[1], m[6] - n * mean[1] * mean[1], m[7] - n * mean[1] * mean[2]},
+        {m[5] - n * mean[0] * mean[2], m[7] - n * mean[1] * mean[2], m[8] - n * mean[2] * mean[2]},
+    };
+    const float trace = cov[0][0] + cov[1][1] + cov[2][2];
+    if (trace <= 1e-6f) {
+        return 0.0f;
+    }
+
+    int widest = cov[1][1] > cov[0][0] ? 1 : 0;
+    widest = cov[2][2] > cov[widest][widest] ? 2 : widest;
+    float v[3] = {cov[widest][0], cov[widest][1], cov[widest][2]};
+    float along = 0.0f;
+    for (int iter = 0; iter < 4; ++iter) {
+        float next[3];
+        for (int r = 0; r < 3; ++r) {
+            next[r] = cov[r][0] * v[0] + cov[r][1] * v[1] + cov[r][2] * v[2];
+        }
+        float length_sq = v[0] * v[0] + v[1] * v[1] + v[2] * v[2];
+        if (length_sq <= 0.0f) {
+            return 0.0f;
+        }
+        along = (v[0] * next[0] + v[1] * next[1] + v[2] * next[2]) / length_sq;
+        float scale = 1.0f / std::max({std::abs(next[0]), std::abs(next[1]), std::abs(next[2]), 1e-12f});
+        for (int r = 0; r < 3; ++r) {
+            v[r] = next[r] * scale;
+        }
+    }
+    return std::max(0.0f, trace - along);
+}
+
+Endpoints FitLine(const float (*px)[4], int count, int channels) {
+    float mean[4], axis[4];
+    PrincipalAxis(px, count, channels, mean, axis);
+
+    float t_min = std::numeric_limits<float>::max(), t_max = std::numeric_limits<float>::lowest();
+    for (int i = 0; i < count; ++i) {
+        float t = 0.0f;
+        for (int c = 0; c < channels; ++c) {
+            t += (px[i][c] - mean[c]) * axis[c];
+        }
+        t_min = std::min(t_min, t);
+        t_max = std::max(t_max, t);
+    }
+
+    Endpoints ends;
+    for (int c = 0; c < channels; ++c) {
+        ends.E[0][c] = std::clamp(mean[c] + axis[c] * t_min, 0.0f, 255.0f);
+        ends.E[1][c] = std::clamp(mean[c] + axis[c] * t_max, 0.0f, 255.0f);
+    }
+    return ends;
+}
+
+// Least-squares endpoints for fixed indices; false when every pixel uses the same weight.
+bool RefineEndpoints(const float (*px)[4], int count, int channels, const uint8_t* indices, const int* weights, Endpoints& ends) {
+    float a = 0.0f, b = 0.0f, c2 = 0.0f, x[4] = {}, y[4] = {};
+    for (int i = 0; i < count; ++i) {
+        float w = static_cast<float>(weights[indices[i]]) / 64.0f;
+        a += (1.0f - w) * (1.0f - w);
+        b += (1.0f - w) * w;
+        c2 += w * w;
+        for (int c = 0; c < channels; ++c) {
+            x[c] += (1.0f - w) * px[i][c];
+            y[c] += w * px[i][c];
+        }
+    }
+
+    float det = a * c2 - b * b;
+    if (std::abs(det) < 1e-6f) {
+        return false;
+    }
+    for (int c = 0; c < channels; ++c) {
+        ends.E[0][c] = std::clamp((c2 * x[c] - b * y[c]) / det, 0.0f, 255.0f);
+        ends.E[1][c] = std::clamp((a * y[c] - b * x[c]) / det, 0.0f, 255.0f);
+    }
+    return true;
+}
+
+class Bc7Encoder {
+public:
+    Bc7Encoder(bool needsAlpha, TexCompressionQuality quality)
+        : findClosest_(SelectFindClosestOnce()), settings_(SettingsFor(quality)), needsAlpha_(needsAlpha) {}
+
+    void EncodeBlock(const uint8_t (&src)[16][4], uint8_t* out) const {
+        float px[16][4];
+        bool opaque = true;
+        for (int i = 0; i < 16; ++i) {
+            for (int c = 0; c < 4; ++c) {
+                px[i][c] = static_cast<float>(src[i][c]);
+            }
+            if (!needsAlpha_) {
+                px[i][3] = 0.0f;
+            }
+            opaque = opaque && src[i][3] == 255;
+        }
+
+        const ModeInfo mode6{7, 4, false, needsAlpha_};
+        SubsetFit fit6 = FitSubset(px, 16, mode6);
+
+        if (settings_.UseMode1 && fit6.Error > 0 && (opaque || !needsAlpha_)) {
+            uint32_t best_error = fit6.Error;
+            int best_partition = -1;
+            SubsetFit best_fits[2];
+            if (TryMode1(px, best_error, best_partition, best_fits)) {
+                WriteMode1(best_partition, best_fits, out);
+                return;
+            }
+        }
+
+        WriteMode6(fit6, out);
+    }
+
+private:
+    static FindClosestFn SelectFindClosestOnce() {
+        static const FindClosestFn fn = SelectFindClosest();
+        return fn;
+    }
+
+    int Channels(const ModeInfo& mode) const { return mode.Alpha ? 4 : 3; }
+
+    QuantizedEndpoints Quantize(const Endpoints& ends, const ModeInfo& mode, int p0, int p1) const {
+        QuantizedEndpoints q;
+        q.P[0] = p0;
+        q.P[1] = p1;
+        for (int j = 0; j < 2; ++j) {
+            for (int c = 0; c < 3; ++c) {
+                q.Q[j][c] = QuantizeComponent(ends.E[j][c], mode.ColorBits, q.P[j]);
+            }
+            q.Q[j][3] = mode.Alpha ? QuantizeComponent(ends.E[j][3], mode.ColorBits, q.P[j]) : (1 << mode.ColorBits) - 1;
+        }
+        return q;
+    }
+
+    float QuantizationError(const Endpoints& ends, const QuantizedEndpoints& q, const ModeInfo& mode) const {
+        float err = 0.0f;
+        for (int j = 0; j < 2; ++j) {
+            for (int c = 0; c < Channels(mode); ++c) {
+                float d = static_cast<float>(ExpandComponent(q.Q[j][c], mode.ColorBits, q.P[j])) - ends.E[j][c];
+                err += d * d;
+            }
+        }
+        return err;
+    }
+
+    void BuildPalette(const QuantizedEndpoints& q, const ModeInfo& mode, Palette& palette) const {
+        const int* weights = mode.IndexBits == 3 ? WEIGHTS3 : WEIGHTS4;
+        int e[2][4] = {};
+        for (int j = 0; j < 2; ++j) {
+            for (int c = 0; c < Channels(mode); ++c) {
+                e[j][c] = ExpandComponent(q.Q[j][c], mode.ColorBits, q.P[j]);
+            }
+        }
+
+        palette.Count = 1 << mode.IndexBits;
+        for (int i = 0; i < palette.Count; ++i) {
+            palette.Rg[2 * i] = static_cast<int16_t>(Interpolate(e[0][0], e[1][0], weights[i]));
+            palette.Rg[2 * i + 1] = static_cast<int16_t>(Interpolate(e[0][1], e[1][1], weights[i]));
+            palette.Ba[2 * i] = static_cast<int16_t>(Interpolate(e[0][2], e[1][2], weights[i]));
+            palette.Ba[2 * i + 1] = static_cast<int16_t>(Interpolate(e[0][3], e[1][3], weights[i]));
+        }
+    }
+
+    SubsetFit Evaluate(const PixelSet& pixels, const Endpoints& ends, const ModeInfo& mode) const {
+        static constexpr int PBITS[4][2] = {{0, 0}, {1, 1}, {0, 1}, {1, 0}};
+        const int combos = mode.SharedPbit ? 2 : 4;
+
+        SubsetFit best;
+        Palette palette;
+        if (settings_.SearchPbits) {
+            for (int k = 0; k < combos; ++k) {
+                SubsetFit fit;
+                fit.Endpoints = Quantize(ends, mode, PBITS[k][0], PBITS[k][1]);
+                BuildPalette(fit.Endpoints, mode, palette);
+                fit.Error = findClosest_(palette, pixels, fit.Indices);
+                if (fit.Error < best.Error) {
+                    best = fit;
+                }
+            }
+            return best;
+        }
+
+        float best_quant = std::numeric_limits<float>::max();
+        for (int k = 0; k < combos; ++k) {
+            auto q = Quantize(ends, mode, PBITS[k][0], PBITS[k][1]);
+            float err = QuantizationError(ends, q, mode);
+            if (err < best_quant) {
+                best_quant = err;
+                best.Endpoints = q;
+            }
+        }
+        BuildPalette(best.Endpoints, mode, palette);
+        best.Error = findClosest_(palette, pixels, best.Indices);
+        return best;
+    }
+
+    SubsetFit FitSubset(const float (*px)[4], int count, const ModeInfo& mode) const {
+        PixelSet pixels;
+        pixels.Count = count;
+        for (int i = 0; i < count; ++i) {
+            pixels.Rg[i] = PackPair(static_cast<int>(px[i][0]), static_cast<int>(px[i][1]));
+            pixels.Ba[i] = PackPair(static_cast<int>(px[i][2]), mode.Alpha ? static_cast<int>(px[i][3]) : 0);
+        }
+
+        const int channels = Channels(mode);
+        Endpoints ends = FitLine(px, count, channels);
+        SubsetFit best = Evaluate(pixels, ends, mode);
+
+        const int* weights = mode.IndexBits == 3 ? WEIGHTS3 : WEIGHTS4;
+        for (int iter = 0; iter < settings_.RefineIterations && best.Error > 0; ++iter) {
+            if (!RefineEndpoints(px, count, channels, best.Indices, weights, ends)) {
+                break;
+            }
+            SubsetFit candidate = Evaluate(pixels, ends, mode);
+            if (candidate.Error >= best.Error) {
+                break;
+            }
+            best = candidate;
+        }
+        return best;
+    }
+
+    // Fits the most promising two-subset partitions; true if one beats `best_error`.
+    bool TryMode1(const float (&px)[16][4], uint32_t& best_error, int& best_partition, SubsetFit (&best_fits)[2]) const {
+        const ModeInfo mode1{6, 3, true, false};
+
+        float gathered[2][16][4];
+        int counts[2];
+        auto gather = [&](int partition) {
+            counts[0] = counts[1] = 0;
+            for (int i = 0; i < 16; ++i) {
+                int s = PARTITIONS2[partition][i];
+                std::memcpy(gathered[s][counts[s]++], px[i], sizeof(px[i]));
+            }
+        };
+
+        // Rank partitions by how far each subset's pixels lie from its own best-fit line. The
+        // subset moments are sums of per-pixel moments, and subset 0 is the block minus subset 1.
+        Moments pixel_moments[16];
+        Moments block_moments{};
+        for (int i = 0; i < 16; ++i) {
+            pixel_moments[i] = PixelMoments(px[i]);
+            for (int k = 0; k < 9; ++k) {
+                block_moments[k] += pixel_moments[i][k];
+            }
+        }
+
+        std::array<float, 64> estimates;
+        for (int p = 0; p < 64; ++p) {
+            Moments second{};
+            int second_count = 0;
+            for (int i = 0; i < 16; ++i) {
+                if (PARTITIONS2[p][i]) {
+                    for (int k = 0; k < 9; ++k) {
+                        second[k] += pixel_moments[i][k];
+                    }
+                    ++second_count;
+                }
+            }
+            Moments first;
+            for (int k = 0; k < 9; ++k) {
+                first[k] = block_moments[k] - second[k];
+            }
+            estimates[p] = LineResidual(first, 16 - second_count) + LineResidual(second, second_count);
+        }
+        std::array<int, 64> order;
+        std::iota(order.begin(), order.end(), 0);
+        const int candidates = std::min(settings_.Mode1Partitions, 64);
+        std::partial_sort(order.begin(), order.begin() + candidates, order.end(),
+                          [&](int a, int b) { return estimates[a] < estimates[b]; });
+
+        bool improved = false;
+        for (int k = 0; k < candidates; ++k) {
+            int p = order[k];
+            gather(p);
+            SubsetFit fits[2] = {FitSubset(gathered[0], counts[0], mode1), FitSubset(gathered[1], counts[1], mode1)};
+            uint32_t error = fits[0].Error + fits[1].Error;
+            if (error < best_error) {
+                best_error = error;
+                best_partition = p;
+                best_fits[0] = fits[0];
+                best_fits[1] = fits[1];
+                improved = true;
+            }
+        }
+        return improved;
+    }
+
+    void WriteMode6(SubsetFit fit, uint8_t* out) const {
+        // The anchor index is stored without its top bit, so it must be below 8.
+        if (fit.Indices[0] & 8) {
+            std::swap(fit.Endpoints.Q[0], fit.Endpoints.Q[1]);
+            std::swap(fit.Endpoints.P[0], fit.Endpoints.P[1]);
+            for (auto& index : fit.Indices) {
+                index = static_cast<uint8_t>(15 - index);
+            }
+        }
+
+        BlockWriter writer(out);
+        writer.Write(1u << 6, 7);
+        for (int c = 0; c < 4; ++c) {
+            writer.Write(static_cast<uint32_t>(fit.Endpoints.Q[0][c]), 7);
+            writer.Write(static_cast<uint32_t>(fit.Endpoints.Q[1][c]), 7);
+        }
+        writer.Write(static_cast<uint32_t>(fit.Endpoints.P[0]), 1);
+        writer.Write(static_cast<uint32_t>(fit.Endpoints.P[1]), 1);
+        for (int i = 0; i < 16; ++i) {
+            writer.Write(fit.Indices[i], i == 0 ? 3 : 4);
+        }
+    }
+
+    void WriteMode1(int partition, SubsetFit (&fits)[2], uint8_t* out) const {
+        // Scatter the per-subset indices back to pixel order.
+        uint8_t indices[16];
+        int cursor[2] = {0, 0};
+        for (int i = 0; i < 16; ++i) {
+            int s = PARTITIONS2[partition][i];
+            indices[i] = fits[s].Indices[cursor[s]++];
+        }
+
+        const int anchors[2] = {0, ANCHORS2[partition]};
+        for (int s = 0; s < 2; ++s) {
+            if (indices[anchors[s]] & 4) {
+                std::swap(fits[s].Endpoints.Q[0], fits[s].Endpoints.Q[1]);
+                for (int i = 0; i < 16; ++i) {
+                    if (PARTITIONS2[partition][i] == s) {
+                        indices[i] = static_cast<uint8_t>(7 - indices[i]);
+                    }
+                }
+            }
+        }
+
+        BlockWriter writer(out);
+        writer.Write(1u << 1, 2);
+        writer.Write(static_cast<uint32_t>(partition), 6);
+        for (int c = 0; c < 3; ++c) {
+            for (int s = 0; s < 2; ++s) {
+                writer.Write(static_cast<uint32_t>(fits[s].Endpoints.Q[0][c]), 6);
+                writer.Write(static_cast<uint32_t>(fits[s].Endpoints.Q[1][c]), 6);
+            }
+        }
+        writer.Write(static_cast<uint32_t>(fits[0].Endpoints.P[0]), 1);
+        writer.Write(static_cast<uint32_t>(fits[1].Endpoints.P[0]), 1);
+        for (int i = 0; i < 16; ++i) {
+            writer.Write(indices[i], i == anchors[0] || i == anchors[1] ? 2 : 3);
+        }
+    }
+
+    FindClosestFn findClosest_;
+    Bc7Settings settings_;
+    bool needsAlpha_;
+};
+
+void DecodeBc7Block(const uint8_t* in, uint8_t (&px)[16][4]) {
+    BlockReader reader(in);
+    int mode = 0;
+    while (mode < 8 && reader.Read(1) == 0) {
+        ++mode;
+    }
+
+    if (mode == 6) {
+        int q[2][4], p[2];
+        for (int c = 0; c < 4; ++c) {
+            q[0][c] = static_cast<int>(reader.Read(7));
+            q[1][c] = static_cast<int>(reader.Read(7));
+        }
+        p[0] = static_cast<int>(reader.Read(1));
+        p[1] = static_cast<int>(reader.Read(1));
+        for (int i = 0; i < 16; ++i) {
+            int weight = WEIGHTS4[reader.Read(i == 0 ? 3 : 4)];
+            for (int c = 0; c < 4; ++c) {
+                px[i][c] = static_cast<uint8_t>(Interpolate(ExpandComponent(q[0][c], 7, p[0]), ExpandComponent(q[1][c], 7, p[1]), weight));
+            }
+        }
+    } else if (mode == 1) {
+        int partition = static_cast<int>(reader.Read(6));
+        int q[4][3], p[2];
+        for (int c = 0; c < 3; ++c) {
+            for (int j = 0; j < 4; ++j) {
+                q[j][c] = static_cast<int>(reader.Read(6));
+            }
+        }
+        p[0] = static_cast<int>(reader.Read(1));
+        p[1] = static_cast<int>(reader.Read(1));
+        for (int i = 0; i < 16; ++i) {
+            int s = PARTITIONS2[partition][i];
+            int weight = WEIGHTS3[reader.Read(i == 0 || i == ANCHORS2[partition] ? 2 : 3)];
+            for (int c = 0; c < 3; ++c) {
+                px[i][c] = static_cast<uint8_t>(
+                    Interpolate(ExpandComponent(q[2 * s][c], 6, p[s]), ExpandComponent(q[2 * s + 1][c], 6, p[s]), weight));
+            }
+            px[i][3] = 255;
+        }
+    } else {
+        throw std::runtime_error("unsupported BC7 mode " + std::to_string(mode));
+    }
+}
+
+void CheckImageSize(size_t actual, size_t expected, const char* what) {
+    if (actual < expected) {
+        throw std::runtime_error(std::string(what) + ": expected " + std::to_string(expected) + " bytes, got " + std::to_string(actual));
+    }
+}
+
+} // namespace
+
+std::vector<uint8_t> CompressBc(std::span<const uint8_t> rgba, uint32_t width, uint32_t height, BcMode mode,
+                                bool needsAlpha, TexCompressionQuality quality) {
+    if (width == 0 || height == 0) {
+        return {};
+    }
+    CheckImageSize(rgba.size(), static_cast<size_t>(width) * height * 4, "CompressBc");
+
+    const uint32_t blocks_x = (width + 3) / 4;
+    const uint32_t blocks_y = (height + 3) / 4;
+    std::vector<uint8_t> out(BcBlockCount(width, height) * BC_BLOCK_BYTES);
+    const Bc7Encoder bc7(needsAlpha, quality);
+
+    tekki::core::ParallelFor(blocks_y, [&](size_t by) {
+        uint8_t px[16][4];
+        for (uint32_t bx = 0; bx < blocks_x; ++bx) {
+            LoadBlock(rgba, width, height, bx, static_cast<uint32_t>(by), px);
+            uint8_t* dst = &out[(by * blocks_x + bx) * BC_BLOCK_BYTES];
+            if (mode == BcMode::Bc5) {
+                EncodeBc5Block(px, quality, dst);
+            } else {
+                bc7.EncodeBlock(px, dst);
+            }
+        }
+    });
+
+    return out;
+}
+
+std::vector<uint8_t> DecompressBc(std::span<const uint8_t> blocks, uint32_t width, uint32_t height, BcMode mode) {
+    if (width == 0 || height == 0) {
+        return {};
+    }
+    CheckImageSize(blocks.size(), BcBlockCount(width, height) * BC_BLOCK_BYTES, "DecompressBc");
+
+    const uint32_t blocks_x = (width + 3) / 4;
+    const uint32_t blocks_y = (height + 3) / 4;
+    std::vector<uint8_t> rgba(static_cast<size_t>(width) * height * 4);
+
+    tekki::core::ParallelFor(blocks_y, [&](size_t by) {
+        uint8_t px[16][4];
+        for (uint32_t bx = 0; bx < blocks_x; ++bx) {
+            const uint8_t* src = &blocks[(by * blocks_x + bx) * BC_BLOCK_BYTES];
+            if (mode == BcMode::Bc5) {
+                DecodeBc4(src, px, 0);
+                DecodeBc4(src + 8, px, 1);
+                for (auto& p : px) {
+                    p[2] = 0;
+                    p[3] = 255;
+                }
+            } else {
+                DecodeBc7Block(src, px);
+            }
+            StoreBlock(px, width, height, bx, static_cast<uint32_t>(by), rgba);
+        }
+    });
+
+    return rgba;
+}
+
+} // namespace tekki::asset
@@ -0,0 +1,209 @@
+#include "tekki/asset/compression.h"
+#include "tekki/core/parallel.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <lz4.h>
+#include <zstd.h>
+
+namespace tekki::asset {
+
+namespace {
+
+void CheckZstd(size_t result, const char* what) {
+    if (ZSTD_isError(result)) {
+        throw std::runtime_error(std::string(what) + ": " + ZSTD_getErrorName(result));
+    }
+}
+
+// (offset, size) of every block: large sections are cut on their own, everything else in
+// plain COMPRESSION_BLOCK_SIZE steps.
+std::vector<std::pair<uint64_t, uint64_t>> BlockRanges(uint64_t size,
+                                                       std::span<const std::pair<uint64_t, uint64_t>> sections) {
+    std::vector<uint64_t> cuts{0};
+    auto cut = [&](uint64_t at) {
+        if (at > cuts.back() && at < size) {
+            cuts.push_back(at);
+        }
+    };
+    for (const auto& [offset, length] : sections) {
+        if (length >= COMPRESSION_BLOCK_SIZE) {
+            cut(offset);
+            cut(offset + length);
+        }
+    }
+    cuts.push_back(size);
+
+    std::vector<std::pair<uint64_t, uint64_t>> blocks;
+    for (size_t i = 0; i + 1 < cuts.size(); ++i) {
+        for (uint64_t at = cuts[i]; at < cuts[i + 1]; at += COMPRESSION_BLOCK_SIZE) {
+            blocks.emplace_back(at, std::min<uint64_t>(COMPRESSION_BLOCK_SIZE, cuts[i + 1] - at));
+        }
+    }
+    return blocks;
+}
+
+} // namespace
+
+const char* CompressionCodecName(CompressionCodec codec) {
+    switch (codec) {
+        case CompressionCodec::None: return "none";
+        case CompressionCodec::Zstd: return "zstd";
+        case CompressionCodec::Lz4: return "lz4";
+    }
+    return "unknown";
+}
+
+std::vector<uint8_t> CompressBytes(std::span<const uint8_t> src, CompressionCodec codec, int level) {
+    switch (codec) {
+        case CompressionCodec::None:
+            return std::vector<uint8_t>(src.begin(), src.end());
+        case CompressionCodec::Zstd: {
+            std::vector<uint8_t> dst(ZSTD_compressBound(src.size()));
+            size_t size = ZSTD_compress(dst.data(), dst.size(), src.data(), src.size(),
+                                        level == 0 ? ZSTD_CLEVEL_DEFAULT : level);
+            CheckZstd(size, "zstd compression failed");
+            dst.resize(size);
+            return dst;
+        }
+        case CompressionCodec::Lz4: {
+            if (src.size() > LZ4_MAX_INPUT_SIZE) {
+                throw std::runtime_error("lz4 input of " + std::to_string(src.size()) + " bytes is too large");
+            }
+            std::vector<uint8_t> dst(static_cast<size_t>(LZ4_compressBound(static_cast<int>(src.size()))));
+            int size = LZ4_compress_default(reinterpret_cast<const char*>(src.data()), reinterpret_cast<char*>(dst.data()),
+                                            static_cast<int>(src.size()), static_cast<int>(dst.size()));
+            if (size <= 0 && !src.empty()) {
+                throw std::runtime_error("lz4 compression failed");
+            }
+            dst.resize(static_cast<size_t>(std::max(size, 0)));
+            return dst;
+        }
+    }
+    throw std::runtime_error("Unknown compression codec " + std::to_string(static_cast<uint32_t>(codec)));
+}
+
+void DecompressBytes(std::span<const uint8_t> src, CompressionCodec codec, std::span<uint8_t> dst) {
+    switch (codec) {
+        case CompressionCodec::None:
+            if (src.size() != dst.size()) {
+                throw std::runtime_error("Stored size " + std::to_string(src.size()) + " does not match " +
+                                         std::to_string(dst.size()));
+            }
+            std::memcpy(dst.data(), src.data(), src.size());
+            return;
+        case CompressionCodec::Zstd: {
+            size_t size = ZSTD_decompress(dst.data(), dst.size(), src.data(), src.size());
+            CheckZstd(size, "zstd decompression failed");
+            if (size != dst.size()) {
+                throw std::runtime_error("zstd data decoded to " + std::to_string(size) + " bytes, expected " +
+                                         std::to_string(dst.size()));
+            }
+            return;
+        }
+        case CompressionCodec::Lz4: {
+            if (src.size() > LZ4_MAX_INPUT_SIZE || dst.size() > LZ4_MAX_INPUT_SIZE) {
+                throw std::runtime_error("lz4 block is too large");
+            }
+            int size = LZ4_decompress_safe(reinterpret_cast<const char*>(src.data()), reinterpret_cast<char*>(dst.data()),
+                                           static_cast<int>(src.size()), static_cast<int>(dst.size()));
+            if (size < 0) {
+                throw std::runtime_error("lz4 decompression failed");
+            }
+            if (static_cast<size_t>(size) != dst.size()) {
+                throw std::runtime_error("lz4 data decoded to " + std::to_string(size) + " bytes, expected " +
+                                         std::to_string(dst.size()));
+            }
+            return;
+        }
+    }
+    throw std::runtime_error("Unknown compression codec " + std::to_string(static_cast<uint32_t>(codec)));
+}
+
+std::vector<uint8_t> CompressBlocks(std::span<const uint8_t> src, CompressionCodec codec,
+                                    std::span<const std::pair<uint64_t, uint64_t>> sections, int level) {
+    const auto ranges = BlockRanges(src.size(), sections);
+
+    std::vector<std::vector<uint8_t>> compressed(ranges.size());
+    if (codec != CompressionCodec::None) {
+        tekki::core::ParallelFor(ranges.size(), [&](size_t i) {
+            auto block = src.subspan(static_cast<size_t>(ranges[i].first), static_cast<size_t>(ranges[i].second));
+            compressed[i] = CompressBytes(block, codec, level);
+        });
+    }
+
+    BlockStreamHeader header{static_cast<uint32_t>(ranges.size()), codec, src.size()};
+    std::vector<CompressedBlock> table(ranges.size());
+    uint64_t stored_offset = sizeof(header) + table.size() * sizeof(CompressedBlock);
+    for (size_t i = 0; i < ranges.size(); ++i) {
+        // Blocks the codec doesn't shrink are kept as they are.
+        const bool keep = codec != CompressionCodec::None && compressed[i].size() < ranges[i].second;
+        if (!keep) {
+            compressed[i].clear();
+        }
+        const auto stored_size = keep ? compressed[i].size() : ranges[i].second;
+        table[i] = {ranges[i].first, stored_offset, static_cast<uint32_t>(ranges[i].second),
+                    static_cast<uint32_t>(stored_size)};
+        stored_offset += stored_size;
+    }
+
+    std::vector<uint8_t> stream(static_cast<size_t>(stored_offset));
+    std::memcpy(stream.data(), &header, sizeof(header));
+    std::memcpy(stream.data() + sizeof(header), table.data(), table.size() * sizeof(CompressedBlock));
+    for (size_t i = 0; i < ranges.size(); ++i) {
+        const uint8_t* block = compressed[i].empty() ? src.data() + ranges[i].first : compressed[i].data();
+        std::memcpy(stream.data() + table[i].StoredOffset, block, table[i].StoredSize);
+    }
+    return stream;
+}
+
+uint64_t BlockStreamSize(std::span<const uint8_t> stream) {
+    BlockStreamHeader header;
+    if (stream.size() < sizeof(header)) {
+        throw std::runtime_error("Block stream is truncated");
+    }
+    std::memcpy(&header, stream.data(), sizeof(header));
+    if (header.BlockCount > (stream.size() - sizeof(header)) / sizeof(CompressedBlock)) {
+        throw std::runtime_error("Block stream has a truncated block table");
+    }
+
+    uint64_t offset = 0;
+    for (uint32_t i = 0; i < header.BlockCount; ++i) {
+        CompressedBlock block;
+        std::memcpy(&block, stream.data() + sizeof(header) + i * sizeof(CompressedBlock), sizeof(block));
+        if (block.Offset != offset || block.Size > COMPRESSION_BLOCK_SIZE || block.StoredSize > block.Size ||
+            block.StoredOffset > stream.size() || block.StoredSize > stream.size() - block.StoredOffset) {
+            throw std::runtime_error("Block stream has a malformed block " + std::to_string(i));
+        }
+        offset += block.Size;
+    }
+    if (offset != header.Size) {
+        throw std::runtime_error("Block stream blocks add up to " + std::to_string(offset) + " bytes, expected " +
+                                 std::to_string(header.Size));
+    }
+    return header.Size;
+}
+
+void DecompressBlocks(std::span<const uint8_t> stream, std::span<uint8_t> dst) {
+    const uint64_t size = BlockStreamSize(stream);
+    if (size != dst.size()) {
+        throw std::runtime_error("Block stream holds " + std::to_string(size) + " bytes, destination has " +
+                                 std::to_string(dst.size()));
+    }
+
+    BlockStreamHeader header;
+    std::memcpy(&header, stream.data(), sizeof(header));
+    tekki::core::ParallelFor(header.BlockCount, [&](size_t i) {
+        CompressedBlock block;
+        std::memcpy(&block, stream.data() + sizeof(header) + i * sizeof(CompressedBlock), sizeof(block));
+        auto stored = stream.subspan(static_cast<size_t>(block.StoredOffset), block.StoredSize);
+        auto out = dst.subspan(static_cast<size_t>(block.Offset), block.Size);
+        try {
+            DecompressBytes(stored, block.StoredSize == block.Size ? CompressionCodec::None : header.Codec, out);
+        } catch (const std::exception& e) {
+            throw std::runtime_error("Block " + std::to_string(i) + ": " + e.what());
+        }
+    });
+}
+
+} // namespace tekki::asset
@@ -0,0 +1,215 @@
+#include "tekki/asset/dds.h"
+#include "tekki/asset/mip_chain.h"
+#include "tekki/core/mapped_file.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace tekki::asset {
+
+namespace {
+
+constexpr uint32_t DDS_MAGIC = 0x20534444; // "DDS "
+constexpr size_t HEADER_SIZE = 124;
+constexpr size_t DX10_HEADER_SIZE = 20;
+
+constexpr uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+constexpr uint32_t DDPF_FOURCC = 0x4;
+constexpr uint32_t DDPF_RGB = 0x40;
+constexpr uint32_t DDPF_LUMINANCE = 0x20000;
+constexpr uint32_t DDSCAPS2_CUBEMAP = 0x200;
+constexpr uint32_t DDSCAPS2_VOLUME = 0x200000;
+constexpr uint32_t DX10_MISC_TEXTURECUBE = 0x4;
+constexpr uint32_t DX10_DIMENSION_TEXTURE3D = 4;
+
+constexpr uint32_t FourCc(const char (&code)[5]) {
+    return static_cast<uint32_t>(code[0]) | (static_cast<uint32_t>(code[1]) << 8) |
+           (static_cast<uint32_t>(code[2]) << 16) | (static_cast<uint32_t>(code[3]) << 24);
+}
+
+struct FormatInfo {
+    VkFormat Format = VK_FORMAT_UNDEFINED;
+    uint32_t BlockBytes = 0; // Per 4x4 block when BlockDim is 4, per texel otherwise
+    uint32_t BlockDim = 1;
+};
+
+FormatInfo Block(VkFormat format, uint32_t bytes) {
+    return {format, bytes, 4};
+}
+
+FormatInfo Texel(VkFormat format, uint32_t bytes) {
+    return {format, bytes, 1};
+}
+
+FormatInfo FromDxgi(uint32_t dxgi) {
+    switch (dxgi) {
+        case 2: return Texel(VK_FORMAT_R32G32B32A32_SFLOAT, 16);
+        case 10: return Texel(VK_FORMAT_R16G16B16A16_SFLOAT, 8);
+        case 24: return Texel(VK_FORMAT_A2B10G10R10_UNORM_PACK32, 4);
+        case 26: return Texel(VK_FORMAT_B10G11R11_UFLOAT_PACK32, 4);
+        case 28: return Texel(VK_FORMAT_R8G8B8A8_UNORM, 4);
+        case 29: return Texel(VK_FORMAT_R8G8B8A8_SRGB, 4);
+        case 34: return Texel(VK_FORMAT_R16G16_SFLOAT, 4);
+        case 41: return Texel(VK_FORMAT_R32_SFLOAT, 4);
+        case 49: return Texel(VK_FORMAT_R8G8_UNORM, 2);
+        case 54: return Texel(VK_FORMAT_R16_SFLOAT, 2);
+        case 61: return Texel(VK_FORMAT_R8_UNORM, 1);
+        case 71: return Block(VK_FORMAT_BC1_RGBA_UNORM_BLOCK, 8);
+        case 72: return Block(VK_FORMAT_BC1_RGBA_SRGB_BLOCK, 8);
+        case 74: return Block(VK_FORMAT_BC2_UNORM_BLOCK, 16);
+        case 75: return Block(VK_FORMAT_BC2_SRGB_BLOCK, 16);
+        case 77: return Block(VK_FORMAT_BC3_UNORM_BLOCK, 16);
+        case 78: return Block(VK_FORMAT_BC3_SRGB_BLOCK, 16);
+        case 80: return Block(VK_FORMAT_BC4_UNORM_BLOCK, 8);
+        case 81: return Block(VK_FORMAT_BC4_SNORM_BLOCK, 8);
+        case 83: return Block(VK_FORMAT_BC5_UNORM_BLOCK, 16);
+        case 84: return Block(VK_FORMAT_BC5_SNORM_BLOCK, 16);
+        case 87: return Texel(VK_FORMAT_B8G8R8A8_UNORM, 4);
+        case 91: return Texel(VK_FORMAT_B8G8R8A8_SRGB, 4);
+        case 95: return Block(VK_FORMAT_BC6H_UFLOAT_BLOCK, 16);
+        case 96: return Block(VK_FORMAT_BC6H_SFLOAT_BLOCK, 16);
+        case 98: return Block(VK_FORMAT_BC7_UNORM_BLOCK, 16);
+        case 99: return Block(VK_FORMAT_BC7_SRGB_BLOCK, 16);
+        default: throw std::runtime_error("Unsupported DXGI format " + std::to_string(dxgi));
+    }
+}
+
+// Pre-DX10 pixel formats: FourCC codes, D3DFMT numbers in the FourCC field, and the common masks.
+FormatInfo FromPixelFormat(uint32_t flags, uint32_t fourCc, uint32_t bitCount, const uint32_t (&masks)[4]) {
+    if (flags & DDPF_FOURCC) {
+        switch (fourCc) {
+            case FourCc("DXT1"): return Block(VK_FORMAT_BC1_RGBA_UNORM_BLOCK, 8);
+            case FourCc("DXT2"):
+            case FourCc("DXT3"): return Block(VK_FORMAT_BC2_UNORM_BLOCK, 16);
+            case FourCc("DXT4"):
+            case FourCc("DXT5"): return Block(VK_FORMAT_BC3_UNORM_BLOCK, 16);
+            case FourCc("ATI1"):
+            case FourCc("BC4U"): return Block(VK_FORMAT_BC4_UNORM_BLOCK, 8);
+            case FourCc("BC4S"): return Block(VK_FORMAT_BC4_SNORM_BLOCK, 8);
+            case FourCc("ATI2"):
+            case FourCc("BC5U"): return Block(VK_FORMAT_BC5_UNORM_BLOCK, 16);
+            case FourCc("BC5S"): return Block(VK_FORMAT_BC5_SNORM_BLOCK, 16);
+            case 111: return Texel(VK_FORMAT_R16_SFLOAT, 2);
+            case 112: return Texel(VK_FORMAT_R16G16_SFLOAT, 4);
+            case 113: return Texel(VK_FORMAT_R16G16B16A16_SFLOAT, 8);
+            case 114: return Texel(VK_FORMAT_R32_SFLOAT, 4);
+            case 116: return Texel(VK_FORMAT_R32G32B32A32_SFLOAT, 16);
+            default: break;
+        }
+    } else if ((flags & (DDPF_RGB | DDPF_LUMINANCE)) && bitCount == 32) {
+        if (masks[0] == 0x000000ff && masks[1] == 0x0000ff00 && masks[2] == 0x00ff0000) {
+            return Texel(VK_FORMAT_R8G8B8A8_UNORM, 4);
+        }
+        if (masks[0] == 0x00ff0000 && masks[1] == 0x0000ff00 && masks[2] == 0x000000ff) {
+            return Texel(VK_FORMAT_B8G8R8A8_UNORM, 4);
+        }
+    } else if ((flags & (DDPF_RGB | DDPF_LUMINANCE)) && bitCount == 16 && masks[0] == 0x00ff && masks[1] == 0xff00) {
+        return Texel(VK_FORMAT_R8G8_UNORM, 2);
+    } else if ((flags & (DDPF_RGB | DDPF_LUMINANCE)) && bitCount == 8 && masks[0] == 0xff) {
+        return Texel(VK_FORMAT_R8_UNORM, 1);
+    }
+    throw std::runtime_error("Unsupported DDS pixel format (flags " + std::to_string(flags) + ", FourCC " +
+                             std::to_string(fourCc) + ", " + std::to_string(bitCount) + " bpp)");
+}
+
+uint32_t ReadU32(std::span<const uint8_t> bytes, size_t offset) {
+    uint32_t value = 0;
+    std::memcpy(&value, bytes.data() + offset, sizeof(value));
+    return value;
+}
+
+} // namespace
+
+bool DdsImage::IsDds(std::span<const uint8_t> bytes) {
+    return bytes.size() >= 4 && ReadU32(bytes, 0) == DDS_MAGIC;
+}
+
+std::shared_ptr<const DdsImage> DdsImage::Parse(std::span<const uint8_t> bytes, std::shared_ptr<const void> backing) {
+    if (!IsDds(bytes) || bytes.size() < 4 + HEADER_SIZE) {
+        throw std::runtime_error("Not a DDS file");
+    }
+    if (ReadU32(bytes, 4) != HEADER_SIZE) {
+        throw std::runtime_error("Invalid DDS header size " + std::to_string(ReadU32(bytes, 4)));
+    }
+
+    const uint32_t flags = ReadU32(bytes, 8);
+    const uint32_t pf_flags = ReadU32(bytes, 80);
+    const uint32_t four_cc = ReadU32(bytes, 84);
+    const uint32_t caps2 = ReadU32(bytes, 112);
+
+    std::shared_ptr<DdsImage> image(new DdsImage());
+    image->height_ = ReadU32(bytes, 12);
+    image->width_ = ReadU32(bytes, 16);
+    image->depth_ = (caps2 & DDSCAPS2_VOLUME) ? std::max(ReadU32(bytes, 24), 1u) : 1;
+    image->mipCount_ = (flags & DDSD_MIPMAPCOUNT) ? std::max(ReadU32(bytes, 28), 1u) : 1;
+
+    size_t data_offset = 4 + HEADER_SIZE;
+    FormatInfo info;
+    if ((pf_flags & DDPF_FOURCC) && four_cc == FourCc("DX10")) {
+        if (bytes.size() < data_offset + DX10_HEADER_SIZE) {
+            throw std::runtime_error("DDS DX10 header is truncated");
+        }
+        info = FromDxgi(ReadU32(bytes, data_offset));
+        const uint32_t dimension = ReadU32(bytes, data_offset + 4);
+        image->cubemap_ = (ReadU32(bytes, data_offset + 8) & DX10_MISC_TEXTURECUBE) != 0;
+        image->sliceCount_ = std::max(ReadU32(bytes, data_offset + 12), 1u) * (image->cubemap_ ? 6 : 1);
+        image->depth_ = dimension == DX10_DIMENSION_TEXTURE3D ? std::max(ReadU32(bytes, 24), 1u) : 1;
+        data_offset += DX10_HEADER_SIZE;
+    } else {
+        const uint32_t masks[4] = {ReadU32(bytes, 92), ReadU32(bytes, 96), ReadU32(bytes, 100), ReadU32(bytes, 104)};
+        info = FromPixelFormat(pf_flags, four_cc, ReadU32(bytes, 88), masks);
+        image->cubemap_ = (caps2 & DDSCAPS2_CUBEMAP) != 0;
+        image->sliceCount_ = image->cubemap_ ? 6 : 1;
+    }
+    image->format_ = info.Format;
+
+    if (image->width_ == 0 || image->height_ == 0) {
+        throw std::runtime_error("DDS image has no pixels");
+    }
+    const uint32_t max_mips = MipLevelCount(std::max(image->width_, image->depth_), image->height_);
+    if (image->mipCount_ > max_mips) {
+        throw std::runtime_error("DDS image declares " + std::to_string(image->mipCount_) + " mips, at most " +
+                                 std::to_string(max_mips) + " fit");
+    }
+
+    // Surfaces are stored slice by slice, each with its full mip chain.
+    uint64_t offset = data_offset;
+    for (uint32_t slice = 0; slice < image->sliceCount_; ++slice) {
+        for (uint32_t mip = 0; mip < image->mipCount_; ++mip) {
+            const uint64_t blocks_x = (MipExtent(image->width_, mip) + info.BlockDim - 1) / info.BlockDim;
+            const uint64_t blocks_y = (MipExtent(image->height_, mip) + info.BlockDim - 1) / info.BlockDim;
+            const uint64_t size = blocks_x * blocks_y * MipExtent(image->depth_, mip) * info.BlockBytes;
+            if (offset + size > bytes.size()) {
+                throw std::runtime_error("DDS data is truncated: slice " + std::to_string(slice) + " mip " +
+                                         std::to_string(mip) + " ends at byte " + std::to_string(offset + size) +
+                                         " of " + std::to_string(bytes.size()));
+            }
+            image->surfaces_.push_back(bytes.subspan(static_cast<size_t>(offset), static_cast<size_t>(size)));
+            offset += size;
+        }
+    }
+
+    image->backing_ = std::move(backing);
+    return image;
+}
+
+std::shared_ptr<const DdsImage> DdsImage::Open(const std::filesystem::path& path) {
+    try {
+        auto file = tekki::core::MappedFile::Open(path);
+        return Parse(file->Bytes(), file);
+    } catch (const std::exception& e) {
+        throw std::runtime_error("Failed to open DDS " + path.string() + ": " + e.what());
+    }
+}
+
+std::span<const uint8_t> DdsImage::GetSurface(uint32_t mip, uint32_t slice) const {
+    if (mip >= mipCount_ || slice >= sliceCount_) {
+        throw std::runtime_error("DDS surface out of range: mip " + std::to_string(mip) + " of " +
+                                 std::to_string(mipCount_) + ", slice " + std::to_string(slice) + " of " +
+                                 std::to_string(sliceCount_));
+    }
+    return surfaces_[static_cast<size_t>(slice) * mipCount_ + mip];
+}
+
+} // namespace tekki::asset
@@ -0,0 +1,401 @@
+#include "tekki/asset/environment.h"
+#include "tekki/asset/mip_chain.h"
+#include "tekki/core/parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numbers>
+#include <stdexcept>
+#include <string>
+
+namespace tekki::asset {
+
+namespace {
+
+constexpr float PI = std::numbers::pi_v<float>;
+
+// Largest face size ProjectShIrradiance integrates over.
+constexpr uint32_t SH_PROJECTION_SIZE = 64;
+
+struct FaceCoord {
+    uint32_t Face;
+    float U; // [-1, 1]
+    float V;
+};
+
+// Inverse of CubeFaceDirection: the face `dir` leaves through and where.
+FaceCoord DirectionToFace(const glm::vec3& dir) {
+    const glm::vec3 a = glm::abs(dir);
+    if (a.x >= a.y && a.x >= a.z) {
+        return dir.x > 0.0f ? FaceCoord{0, -dir.z / a.x, -dir.y / a.x} : FaceCoord{1, dir.z / a.x, -dir.y / a.x};
+    }
+    if (a.y >= a.z) {
+        return dir.y > 0.0f ? FaceCoord{2, dir.x / a.y, dir.z / a.y} : FaceCoord{3, dir.x / a.y, -dir.z / a.y};
+    }
+    return dir.z > 0.0f ? FaceCoord{4, dir.x / a.z, -dir.y / a.z} : FaceCoord{5, -dir.x / a.z, -dir.y / a.z};
+}
+
+// Bilinear RGB of one face at texel coordinates (x, y), clamped to the face.
+glm::vec3 SampleFace(const float* face, uint32_t size, float x, float y) {
+    x = std::clamp(x, 0.0f, static_cast<float>(size - 1));
+    y = std::clamp(y, 0.0f, static_cast<float>(size - 1));
+    const uint32_t x0 = static_cast<uint32_t>(x);
+    const uint32_t y0 = static_cast<uint32_t>(y);
+    const uint32_t x1 = std::min(x0 + 1, size - 1);
+    const uint32_t y1 = std::min(y0 + 1, size - 1);
+    const float fx = x - static_cast<float>(x0);
+    const float fy = y - static_cast<float>(y0);
+
+    auto texel = [&](uint32_t tx, uint32_t ty) {
+        const float* p = face + (static_cast<size_t>(ty) * size + tx) * 4;
+        return glm::vec3(p[0], p[1], p[2]);
+    };
+    return glm::mix(glm::mix(texel(x0, y0), texel(x1, y0), fx), glm::mix(texel(x0, y1), texel(x1, y1), fx), fy);
+}
+
+glm::vec3 SampleCubeLevel(const HdrCubemap& cube, uint32_t level, const glm::vec3& dir) {
+    const FaceCoord coord = DirectionToFace(dir);
+    const uint32_t size = MipExtent(cube.Size, level);
+    const float* face = cube.Mips[level].data() + coord.Face * cube.FaceFloats(level);
+    return SampleFace(face, size, (coord.U + 1.0f) * 0.5f * size - 0.5f, (coord.V + 1.0f) * 0.5f * size - 0.5f);
+}
+
+// Trilinear lookup; `lod` is clamped to the chain.
+glm::vec3 SampleCubeLod(const HdrCubemap& cube, const glm::vec3& dir, float lod) {
+    const float max_lod = static_cast<float>(cube.Mips.size() - 1);
+    lod = std::clamp(lod, 0.0f, max_lod);
+    const uint32_t l0 = static_cast<uint32_t>(lod);
+    const float t = lod - static_cast<float>(l0);
+    glm::vec3 colour = SampleCubeLevel(cube, l0, dir);
+    if (t > 0.0f) {
+        colour = glm::mix(colour, SampleCubeLevel(cube, l0 + 1, dir), t);
+    }
+    return colour;
+}
+
+float RadicalInverse(uint32_t bits) {
+    bits = (bits << 16u) | (bits >> 16u);
+    bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+    bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+    bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+    bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+    return static_cast<float>(bits) * 2.3283064365386963e-10f;
+}
+
+// A light direction around +Z, the normal, with its N.L weight and the source lod to read.
+struct GgxSample {
+    glm::vec3 Direction;
+    float Weight;
+    float Lod;
+};
+
+// Importance-sampled GGX lobe with V = N = +Z. The lod makes each sample cover the solid angle
+// its pdf assigns it (Krivanek and Colbert, filtered importance sampling).
+std::vector<GgxSample> BuildGgxSamples(float roughness, uint32_t count, uint32_t source_size) {
+    const float alpha = std::max(roughness * roughness, 1.0e-4f);
+    const float alpha2 = alpha * alpha;
+    const float texel_solid_angle = 4.0f * PI / (CUBE_FACE_COUNT * static_cast<float>(source_size) * source_size);
+
+    std::vector<GgxSample> samples;
+    samples.reserve(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        const float xi1 = static_cast<float>(i) / static_cast<float>(count);
+        const float xi2 = RadicalInverse(i);
+        const float phi = 2.0f * PI * xi1;
+        const float cos_theta = std::sqrt((1.0f - xi2) / (1.0f + (alpha2 - 1.0f) * xi2));
+        const float sin_theta = std::sqrt(std::max(0.0f, 1.0f - cos_theta * cos_theta));
+        const glm::vec3 h(sin_theta * std::cos(phi), sin_theta * std::sin(phi), cos_theta);
+        const glm::vec3 l(2.0f * cos_theta * h.x, 2.0f * cos_theta * h.y, 2.0f * cos_theta * cos_theta - 1.0f);
+        if (l.z <= 0.0f) {
+            continue;
+        }
+
+        // With V = N, pdf(L) = D(H) (N.H) / (4 V.H) = D(H) / 4.
+        const float d_denom = cos_theta * cos_theta * (alpha2 - 1.0f) + 1.0f;
+        const float pdf = alpha2 / (PI * d_denom * d_denom) * 0.25f;
+        const float sample_solid_angle = 1.0f / (static_cast<float>(count) * pdf + 1.0e-6f);
+        const float lod = std::max(0.5f * std::log2(sample_solid_angle / texel_solid_angle) + 1.0f, 0.0f);
+        samples.push_back({l, l.z, lod});
+    }
+    return samples;
+}
+
+std::array<float, SH_COEFFICIENT_COUNT> ShBasis(const glm::vec3& n) {
+    return {0.282095f,
+            0.488603f * n.y,
+            0.488603f * n.z,
+            0.488603f * n.x,
+            1.092548f * n.x * n.y,
+            1.092548f * n.y * n.z,
+            0.315392f * (3.0f * n.z * n.z - 1.0f),
+            1.092548f * n.x * n.z,
+            0.546274f * (n.x * n.x - n.y * n.y)};
+}
+
+// Clamped-cosine convolution per band (Ramamoorthi and Hanrahan).
+constexpr std::array<float, SH_COEFFICIENT_COUNT> SH_COSINE_LOBE = {
+    PI, 2.0f * PI / 3.0f, 2.0f * PI / 3.0f, 2.0f * PI / 3.0f, PI / 4.0f, PI / 4.0f, PI / 4.0f, PI / 4.0f, PI / 4.0f};
+
+void CheckCube(const HdrCubemap& cube) {
+    if (cube.Size == 0 || cube.Mips.empty() || cube.Mips.size() > MipLevelCount(cube.Size, cube.Size)) {
+        throw std::runtime_error("Cube map has no levels or more than its size allows");
+    }
+    for (uint32_t level = 0; level < cube.Mips.size(); ++level) {
+        if (cube.Mips[level].size() != cube.FaceFloats(level) * CUBE_FACE_COUNT) {
+            throw std::runtime_error("Cube map level " + std::to_string(level) + " doesn't match its extent");
+        }
+    }
+}
+
+} // namespace
+
+size_t HdrCubemap::FaceFloats(uint32_t level) const {
+    const size_t extent = MipExtent(Size, level);
+    return extent * extent * 4;
+}
+
+glm::vec3 CubeFaceDirection(uint32_t face, float u, float v) {
+    switch (face) {
+    case 0: return {1.0f, -v, -u};
+    case 1: return {-1.0f, -v, u};
+    case 2: return {u, 1.0f, v};
+    case 3: return {u, -1.0f, -v};
+    case 4: return {u, -v, 1.0f};
+    default: return {-u, -v, -1.0f};
+    }
+}
+
+HdrCubemap CubemapFromEquirect(const HdrImage& equirect, uint32_t size) {
+    if (equirect.Rgba.size() != static_cast<size_t>(equirect.Width) * equirect.Height * 4 || equirect.Rgba.empty()) {
+        throw std::runtime_error("HDR image pixels don't match its extent");
+    }
+    if (size == 0) {
+        throw std::runtime_error("Cube maps need at least one texel per face");
+    }
+
+    HdrCubemap cube;
+    cube.Size = size;
+    cube.Mips.resize(MipLevelCount(size, size));
+    cube.Mips[0].resize(cube.FaceFloats(0) * CUBE_FACE_COUNT);
+
+    const float width = static_cast<float>(equirect.Width);
+    const float height = static_cast<float>(equirect.Height);
+    auto texel = [&](int64_t x, int64_t y) {
+        x = ((x % equirect.Width) + equirect.Width) % equirect.Width;
+        y = std::clamp<int64_t>(y, 0, equirect.Height - 1);
+        const float* p = &equirect.Rgba[(static_cast<size_t>(y) * equirect.Width + static_cast<size_t>(x)) * 4];
+        return glm::vec4(p[0], p[1], p[2], p[3]);
+    };
+
+    tekki::core::ParallelFor(static_cast<size_t>(CUBE_FACE_COUNT) * size, [&](size_t item) {
+        const uint32_t face = static_cast<uint32_t>(item / size);
+        const uint32_t y = static_cast<uint32_t>(item % size);
+        float* row = cube.Mips[0].data() + face * cube.FaceFloats(0) + static_cast<size_t>(y) * size * 4;
+        for (uint32_t x = 0; x < size; ++x) {
+            const float u = (static_cast<float>(x) + 0.5f) / size * 2.0f - 1.0f;
+            const float v = (static_cast<float>(y) + 0.5f) / size * 2.0f - 1.0f;
+            const glm::vec3 dir = glm::normalize(CubeFaceDirection(face, u, v));
+
+            // Longitude wraps around; latitude clamps at the poles.
+            const float sx = (0.5f + std::atan2(dir.z, dir.x) / (2.0f * PI)) * width - 0.5f;
+            const float sy = std::acos(std::clamp(dir.y, -1.0f, 1.0f)) / PI * height - 0.5f;
+            const float fx0 = std::floor(sx);
+            const float fy0 = std::floor(sy);
+            const float fx = sx - fx0;
+            const float fy = sy - fy0;
+            const int64_t x0 = static_cast<int64_t>(fx0);
+            const int64_t y0 = static_cast<int64_t>(fy0);
+            const glm::vec4 colour = glm::mix(glm::mix(texel(x0, y0), texel(x0 + 1, y0), fx),
+                                              glm::mix(texel(x0, y0 + 1), texel(x0 + 1, y0 + 1), fx), fy);
+            std::memcpy(row + x * 4, &colour, sizeof(colour));
+        }
+    });
+
+    for (uint32_t level = 1; level < cube.Mips.size(); ++level) {
+        const uint32_t src_size = MipExtent(size, level - 1);
+        const uint32_t dst_size = MipExtent(size, level);
+        cube.Mips[level].resize(cube.FaceFloats(level) * CUBE_FACE_COUNT);
+        for (uint32_t face = 0; face < CUBE_FACE_COUNT; ++face) {
+            std::span<const float> src(cube.Mips[level - 1].data() + face * cube.FaceFloats(level - 1), cube.FaceFloats(level - 1));
+            std::span<float> dst(cube.Mips[level].data() + face * cube.FaceFloats(level), cube.FaceFloats(level));
+            DownsampleRgba32f(src, src_size, src_size, dst, dst_size, dst_size);
+        }
+    }
+    return cube;
+}
+
+HdrCubemap PrefilterGgx(const HdrCubemap& radiance, const GgxPrefilterOptions& options) {
+    CheckCube(radiance);
+    if (options.SampleCount == 0) {
+        throw std::runtime_error("GGX prefiltering needs at least one sample");
+    }
+
+    const uint32_t full_count = MipLevelCount(radiance.Size, radiance.Size);
+    const uint32_t level_count = options.MipCount == 0 ? full_count : std::min(options.MipCount, full_count);
+
+    HdrCubemap result;
+    result.Size = radiance.Size;
+    result.Mips.resize(level_count);
+    result.Mips[0] = radiance.Mips[0];
+
+    // One work item per row of a face of a level; the rougher levels are smaller, so handing
+    // rows out dynamically keeps the threads even.
+    struct Row {
+        uint32_t Level;
+        uint32_t Face;
+        uint32_t Y;
+    };
+    std::vector<Row> rows;
+    std::vector<std::vector<GgxSample>> samples(level_count);
+    for (uint32_t level = 1; level < level_count; ++level) {
+        const float roughness = static_cast<float>(level) / static_cast<float>(level_count - 1);
+        samples[level] = BuildGgxSamples(roughness, options.SampleCount, radiance.Size);
+        result.Mips[level].resize(result.FaceFloats(level) * CUBE_FACE_COUNT);
+        for (uint32_t face = 0; face < CUBE_FACE_COUNT; ++face) {
+            for (uint32_t y = 0; y < MipExtent(radiance.Size, level); ++y) {
+                rows.push_back({level, face, y});
+            }
+        }
+    }
+
+    tekki::core::ParallelFor(rows.size(), [&](size_t item) {
+        const Row& work = rows[item];
+        const uint32_t size = MipExtent(result.Size, work.Level);
+        const auto& level_samples = samples[work.Level];
+        float* out = result.Mips[work.Level].data() + work.Face * result.FaceFloats(work.Level) +
+                     static_cast<size_t>(work.Y) * size * 4;
+
+        for (uint32_t x = 0; x < size; ++x) {
+            const float u = (static_cast<float>(x) + 0.5f) / size * 2.0f - 1.0f;
+            const float v = (static_cast<float>(work.Y) + 0.5f) / size * 2.0f - 1.0f;
+            const glm::vec3 n = glm::normalize(CubeFaceDirection(work.Face, u, v));
+            const glm::vec3 up = std::abs(n.z) < 0.999f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+            const glm::vec3 t = glm::normalize(glm::cross(up, n));
+            const glm::vec3 b = glm::cross(n, t);
+
+            glm::vec3 sum(0.0f);
+            float weight = 0.0f;
+            for (const auto& sample : level_samples) {
+                const glm::vec3 l = t * sample.Direction.x + b * sample.Direction.y + n * sample.Direction.z;
+                sum += SampleCubeLod(radiance, l, sample.Lod) * sample.Weight;
+                weight += sample.Weight;
+            }
+            const glm::vec3 colour = weight > 0.0f ? sum / weight : SampleCubeLevel(radiance, 0, n);
+            out[x * 4 + 0] = colour.x;
+            out[x * 4 + 1] = colour.y;
+            out[x * 4 + 2] = colour.z;
+            out[x * 4 + 3] = 1.0f;
+        }
+    });
+    return result;
+}
+
+glm::vec3 ShIrradiance::Evaluate(const glm::vec3& normal) const {
+    const auto basis = ShBasis(normal);
+    glm::vec3 irradiance(0.0f);
+    for (uint32_t i = 0; i < SH_COEFFICIENT_COUNT; ++i) {
+        irradiance += Coefficients[i] * basis[i];
+    }
+    return irradiance;
+}
+
+ShIrradiance ProjectShIrradiance(const HdrCubemap& radiance) {
+    CheckCube(radiance);
+
+    uint32_t level = 0;
+    while (level + 1 < radiance.Mips.size() && MipExtent(radiance.Size, level) > SH_PROJECTION_SIZE) {
+        ++level;
+    }
+    const uint32_t size = MipExtent(radiance.Size, level);
+
+    // Faces are projected in parallel and summed in order, so the result doesn't depend on
+    // scheduling.
+    struct FaceSum {
+        std::array<glm::dvec3, SH_COEFFICIENT_COUNT> Coefficients{};
+        double SolidAngle = 0.0;
+    };
+    std::array<FaceSum, CUBE_FACE_COUNT> faces;
+    tekki::core::ParallelFor(CUBE_FACE_COUNT, [&](size_t face) {
+        const float* texels = radiance.Mips[level].data() + face * radiance.FaceFloats(level);
+        const float texel_extent = 2.0f / static_cast<float>(size);
+        auto& sum = faces[face];
+        for (uint32_t y = 0; y < size; ++y) {
+            for (uint32_t x = 0; x < size; ++x) {
+                const float u = (static_cast<float>(x) + 0.5f) * texel_extent - 1.0f;
+                const float v = (static_cast<float>(y) + 0.5f) * texel_extent - 1.0f;
+                const glm::vec3 dir = CubeFaceDirection(static_cast<uint32_t>(face), u, v);
+                const float len2 = glm::dot(dir, dir);
+                const float solid_angle = texel_extent * texel_extent / (len2 * std::sqrt(len2));
+
+                const float* p = texels + (static_cast<size_t>(y) * size + x) * 4;
+                const glm::dvec3 colour(p[0], p[1], p[2]);
+                const auto basis = ShBasis(dir / std::sqrt(len2));
+                for (uint32_t i = 0; i < SH_COEFFICIENT_COUNT; ++i) {
+                    sum.Coefficients[i] += colour * static_cast<double>(basis[i] * solid_angle);
+                }
+                sum.SolidAngle += solid_angle;
+            }
+        }
+    });
+
+    std::array<glm::dvec3, SH_COEFFICIENT_COUNT> total{};
+    double solid_angle = 0.0;
+    for (const auto& face : faces) {
+        for (uint32_t i = 0; i < SH_COEFFICIENT_COUNT; ++i) {
+            total[i] += face.Coefficients[i];
+        }
+        solid_angle += face.SolidAngle;
+    }
+
+    // The texel solid angles only approximate the sphere; renormalising keeps constants exact.
+    const double normalise = 4.0 * std::numbers::pi / solid_angle;
+    ShIrradiance sh;
+    for (uint32_t i = 0; i < SH_COEFFICIENT_COUNT; ++i) {
+        const glm::dvec3 coefficient = total[i] * (normalise * SH_COSINE_LOBE[i]);
+        sh.Coefficients[i] = glm::vec3(coefficient.x, coefficient.y, coefficient.z);
+    }
+    return sh;
+}
+
+GpuImage::Proto CreateCubeGpuImage(const HdrCubemap& cube) {
+    CheckCube(cube);
+
+    GpuImage::Proto proto;
+    proto.Format = VK_FORMAT_R16G16B16A16_SFLOAT;
+    proto.Extent = {cube.Size, cube.Size, CUBE_FACE_COUNT};
+    for (const auto& level : cube.Mips) {
+        std::vector<uint16_t> halves(level.size());
+        ConvertFloatsToHalves(level, halves);
+        auto& bytes = proto.Mips.emplace_back(halves.size() * sizeof(uint16_t));
+        std::memcpy(bytes.data(), halves.data(), bytes.size());
+    }
+    return proto;
+}
+
+GpuImage::Proto CreateShGpuImage(const ShIrradiance& sh) {
+    std::array<float, SH_COEFFICIENT_COUNT * 4> texels{};
+    for (uint32_t i = 0; i < SH_COEFFICIENT_COUNT; ++i) {
+        texels[i * 4 + 0] = sh.Coefficients[i].x;
+        texels[i * 4 + 1] = sh.Coefficients[i].y;
+        texels[i * 4 + 2] = sh.Coefficients[i].z;
+    }
+
+    GpuImage::Proto proto;
+    proto.Format = VK_FORMAT_R32G32B32A32_SFLOAT;
+    proto.Extent = {SH_COEFFICIENT_COUNT, 1, 1};
+    auto& bytes = proto.Mips.emplace_back(sizeof(texels));
+    std::memcpy(bytes.data(), texels.data(), sizeof(texels));
+    return proto;
+}
+
+BakedEnvironment BakeEnvironment(const HdrImage& equirect, const EnvironmentBakeOptions& options) {
+    const HdrCubemap radiance = CubemapFromEquirect(equirect, options.CubeSize);
+
+    BakedEnvironment baked;
+    baked.Sh = ProjectShIrradiance(radiance);
+    baked.Specular = CreateCubeGpuImage(PrefilterGgx(radiance, options.Specular));
+    baked.Irradiance = CreateShGpuImage(baked.Sh);
+    return baked;
+}
+
+} // namespace tekki::asset
@@ -0,0 +1,362 @@
+#include "tekki/asset/exr.h"
+#include "tekki/asset/mip_chain.h"
+#include "tekki/core/half.h"
+#include "tekki/core/parallel.h"
+#include <openexr.h>
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    #define TEKKI_EXR_X86 1
+    #include <immintrin.h>
+#endif
+
+namespace tekki::asset {
+
+namespace {
+
+constexpr uint32_t EXR_MAGIC = 20000630;
+
+// Texels converted to half per task.
+constexpr size_t HALVES_PER_TASK = 1 << 16;
+
+// The core library reports details through its error handler, on the thread that hit them.
+thread_local std::string exr_error_message;
+
+void RecordError(exr_const_context_t, exr_result_t, const char* message) {
+    exr_error_message = message ? message : "";
+}
+
+void Check(exr_result_t result, const char* what) {
+    if (result != EXR_ERR_SUCCESS) {
+        std::string message = std::string(what) + ": " + exr_get_error_code_as_string(result);
+        if (!exr_error_message.empty()) {
+            message += " (" + exr_error_message + ")";
+            exr_error_message.clear();
+        }
+        throw std::runtime_error(message);
+    }
+}
+
+struct MemoryStream {
+    std::span<const uint8_t> Bytes;
+};
+
+int64_t ReadMemory(exr_const_context_t, void* user_data, void* buffer, uint64_t size, uint64_t offset,
+                   exr_stream_error_func_ptr_t) {
+    const auto& bytes = static_cast<const MemoryStream*>(user_data)->Bytes;
+    if (offset >= bytes.size()) {
+        return 0;
+    }
+    uint64_t count = std::min<uint64_t>(size, bytes.size() - offset);
+    std::memcpy(buffer, bytes.data() + offset, count);
+    return static_cast<int64_t>(count);
+}
+
+int64_t MemorySize(exr_const_context_t, void* user_data) {
+    return static_cast<int64_t>(static_cast<const MemoryStream*>(user_data)->Bytes.size());
+}
+
+class ExrContext {
+public:
+    explicit ExrContext(std::span<const uint8_t> bytes) : stream_{bytes} {
+        exr_context_initializer_t init = EXR_DEFAULT_CONTEXT_INITIALIZER;
+        init.user_data = &stream_;
+        init.read_fn = ReadMemory;
+        init.size_fn = MemorySize;
+        init.error_handler_fn = RecordError;
+        Check(exr_start_read(&context_, "<memory>", &init), "Failed to read the EXR header");
+    }
+    ~ExrContext() { exr_finish(&context_); }
+
+    ExrContext(const ExrContext&) = delete;
+    ExrContext& operator=(const ExrContext&) = delete;
+
+    exr_context_t Get() const { return context_; }
+
+private:
+    MemoryStream stream_;
+    exr_context_t context_ = nullptr;
+};
+
+// Decoding state of one chunk.
+class Decoder {
+public:
+    Decoder(exr_const_context_t context, const exr_chunk_info_t& chunk) : context_(context) {
+        Check(exr_decoding_initialize(context_, 0, &chunk, &pipeline_), "Failed to prepare an EXR chunk");
+    }
+    ~Decoder() { exr_decoding_destroy(context_, &pipeline_); }
+
+    Decoder(const Decoder&) = delete;
+    Decoder& operator=(const Decoder&) = delete;
+
+    exr_decode_pipeline_t& Pipeline() { return pipeline_; }
+
+private:
+    exr_const_context_t context_;
+    exr_decode_pipeline_t pipeline_ = EXR_DECODE_PIPELINE_INITIALIZER;
+};
+
+// RGBA slot of each channel of the part: R, G, B, A, or Y as grey into R. Unlayered names win
+// over layered ones; -1 skips the channel.
+std::vector<int> AssignChannels(const exr_coding_channel_info_t* channels, int count, bool& grey) {
+    constexpr std::array<std::string_view, 5> NAMES = {"R", "G", "B", "A", "Y"};
+    std::array<int, 5> chosen;
+    std::array<bool, 5> chosen_layered;
+    chosen.fill(-1);
+    chosen_layered.fill(false);
+
+    for (int c = 0; c < count; ++c) {
+        std::string_view name = channels[c].channel_name;
+        size_t dot = name.rfind('.');
+        bool layered = dot != std::string_view::npos;
+        std::string_view base = layered ? name.substr(dot + 1) : name;
+        for (size_t n = 0; n < NAMES.size(); ++n) {
+            if (base == NAMES[n] && (chosen[n] < 0 || (chosen_layered[n] && !layered))) {
+                chosen[n] = c;
+                chosen_layered[n] = layered;
+            }
+        }
+    }
+
+    grey = chosen[0] < 0 && chosen[1] < 0 && chosen[2] < 0 && chosen[4] >= 0;
+    if (grey) {
+        chosen[0] = chosen[4];
+    }
+
+    std::vector<int> slots(static_cast<size_t>(count), -1);
+    for (int n = 0; n < 4; ++n) {
+        if (chosen[n] >= 0) {
+            slots[static_cast<size_t>(chosen[n])] = n;
+        }
+    }
+    return slots;
+}
+
+using ConvertHalvesFn = void (*)(const float* src, uint16_t* dst, size_t count);
+
+void ConvertHalvesScalar(const float* src, uint16_t* dst, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        dst[i] = tekki::core::FloatToHalf(src[i]);
+    }
+}
+
+#ifdef TEKKI_EXR_X86
+__attribute__((target("avx2,f16c"))) void ConvertHalvesF16c(const float* src, uint16_t* dst, size_t count) {
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i lo = _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT);
+        __m128i hi = _mm256_cvtps_ph(_mm256_loadu_ps(src + i + 8), _MM_FROUND_TO_NEAREST_INT);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_set_m128i(hi, lo));
+    }
+    for (; i + 8 <= count; i += 8) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),
+                         _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT));
+    }
+    ConvertHalvesScalar(src + i, dst + i, count - i);
+}
+#endif
+
+ConvertHalvesFn SelectConvertHalves() {
+#ifdef TEKKI_EXR_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("f16c")) {
+        return ConvertHalvesF16c;
+    }
+#endif
+    return ConvertHalvesScalar;
+}
+
+ConvertHalvesFn ConvertHalves() {
+    static const ConvertHalvesFn fn = SelectConvertHalves();
+    return fn;
+}
+
+// One RGBA16F mip level, converted in parallel.
+std::vector<uint8_t> ToHalfLevel(std::span<const float> rgba) {
+    std::vector<uint8_t> level(rgba.size() * sizeof(uint16_t));
+    ConvertFloatsToHalves(rgba, std::span(reinterpret_cast<uint16_t*>(level.data()), rgba.size()));
+    return level;
+}
+
+} // namespace
+
+bool IsExr(std::span<const uint8_t> bytes) {
+    uint32_t magic = 0;
+    if (bytes.size() >= sizeof(magic)) {
+        std::memcpy(&magic, bytes.data(), sizeof(magic));
+    }
+    return magic == EXR_MAGIC;
+}
+
+HdrImage DecodeExr(std::span<const uint8_t> bytes) {
+    if (!IsExr(bytes)) {
+        throw std::runtime_error("Not an OpenEXR image");
+    }
+
+    ExrContext context(bytes);
+    exr_context_t ctx = context.Get();
+
+    exr_storage_t storage;
+    Check(exr_get_storage(ctx, 0, &storage), "Failed to read the EXR storage type");
+    if (storage != EXR_STORAGE_SCANLINE && storage != EXR_STORAGE_TILED) {
+        throw std::runtime_error("Deep EXR images are not supported");
+    }
+
+    exr_attr_box2i_t window;
+    Check(exr_get_data_window(ctx, 0, &window), "Failed to read the EXR data window");
+    const int64_t width = int64_t(window.max.x) - window.min.x + 1;
+    const int64_t height = int64_t(window.max.y) - window.min.y + 1;
+    if (width <= 0 || height <= 0 || width > UINT32_MAX || height > UINT32_MAX) {
+        throw std::runtime_error("EXR data window is empty or too large");
+    }
+
+    HdrImage image;
+    image.Width = static_cast<uint32_t>(width);
+    image.Height = static_cast<uint32_t>(height);
+    image.Rgba.resize(static_cast<size_t>(width) * static_cast<size_t>(height) * 4);
+    for (size_t i = 3; i < image.Rgba.size(); i += 4) {
+        image.Rgba[i] = 1.0f;
+    }
+
+    // Chunks of the top level, in file order.
+    int32_t chunk_count = 0;
+    int32_t rows_per_chunk = 1;
+    int32_t tiles_x = 1;
+    uint32_t tile_width = 0;
+    uint32_t tile_height = 0;
+    if (storage == EXR_STORAGE_SCANLINE) {
+        Check(exr_get_scanlines_per_chunk(ctx, 0, &rows_per_chunk), "Failed to read the EXR chunk layout");
+        chunk_count = static_cast<int32_t>((height + rows_per_chunk - 1) / rows_per_chunk);
+    } else {
+        int32_t tiles_y = 0;
+        exr_tile_level_mode_t level_mode;
+        exr_tile_round_mode_t round_mode;
+        Check(exr_get_tile_descriptor(ctx, 0, &tile_width, &tile_height, &level_mode, &round_mode),
+              "Failed to read the EXR tile layout");
+        Check(exr_get_tile_counts(ctx, 0, 0, 0, &tiles_x, &tiles_y), "Failed to read the EXR tile layout");
+        chunk_count = tiles_x * tiles_y;
+    }
+
+    bool grey = false;
+    tekki::core::ParallelFor(static_cast<size_t>(chunk_count), [&](size_t c) {
+        // Top-left pixel of the chunk, relative to the data window.
+        exr_chunk_info_t chunk;
+        int64_t x0 = 0;
+        int64_t y0 = 0;
+        if (storage == EXR_STORAGE_SCANLINE) {
+            int y = window.min.y + static_cast<int>(c) * rows_per_chunk;
+            Check(exr_read_scanline_chunk_info(ctx, 0, y, &chunk), "Failed to read an EXR chunk");
+            y0 = int64_t(chunk.start_y) - window.min.y;
+        } else {
+            int tile_x = static_cast<int>(c) % tiles_x;
+            int tile_y = static_cast<int>(c) / tiles_x;
+            Check(exr_read_tile_chunk_info(ctx, 0, tile_x, tile_y, 0, 0, &chunk), "Failed to read an EXR tile");
+            x0 = int64_t(tile_x) * tile_width;
+            y0 = int64_t(tile_y) * tile_height;
+        }
+
+        Decoder decoder(ctx, chunk);
+        exr_decode_pipeline_t& pipeline = decoder.Pipeline();
+
+        bool chunk_grey = false;
+        std::vector<int> slots = AssignChannels(pipeline.channels, pipeline.channel_count, chunk_grey);
+        if (c == 0) {
+            grey = chunk_grey;
+        }
+
+        if (x0 < 0 || y0 < 0 || x0 + chunk.width > width || y0 + chunk.height > height) {
+            throw std::runtime_error("EXR chunk lies outside the data window");
+        }
+
+        for (int i = 0; i < pipeline.channel_count; ++i) {
+            exr_coding_channel_info_t& channel = pipeline.channels[i];
+            if (slots[static_cast<size_t>(i)] < 0) {
+                channel.decode_to_ptr = nullptr;
+                continue;
+            }
+            if (channel.x_samples != 1 || channel.y_samples != 1) {
+                throw std::runtime_error("Subsampled EXR channels are not supported");
+            }
+            float* first = image.Rgba.data() + (static_cast<size_t>(y0) * image.Width + static_cast<size_t>(x0)) * 4 +
+                           slots[static_cast<size_t>(i)];
+            channel.decode_to_ptr = reinterpret_cast<uint8_t*>(first);
+            channel.user_pixel_stride = 4 * sizeof(float);
+            channel.user_line_stride = static_cast<int32_t>(image.Width * 4 * sizeof(float));
+            channel.user_bytes_per_element = sizeof(float);
+            channel.user_data_type = EXR_PIXEL_FLOAT;
+        }
+
+        Check(exr_decoding_choose_default_routines(ctx, 0, &pipeline), "Failed to set up EXR decoding");
+        Check(exr_decoding_run(ctx, 0, &pipeline), "Failed to decode an EXR chunk");
+    });
+
+    if (grey) {
+        for (size_t i = 0; i < image.Rgba.size(); i += 4) {
+            image.Rgba[i + 1] = image.Rgba[i];
+            image.Rgba[i + 2] = image.Rgba[i];
+        }
+    }
+    return image;
+}
+
+void ConvertFloatsToHalves(std::span<const float> src, std::span<uint16_t> dst) {
+    if (src.size() != dst.size()) {
+        throw std::runtime_error("ConvertFloatsToHalves: source and destination sizes differ");
+    }
+    const ConvertHalvesFn convert = ConvertHalves();
+    const size_t tasks = (src.size() + HALVES_PER_TASK - 1) / HALVES_PER_TASK;
+    tekki::core::ParallelFor(tasks, [&](size_t task) {
+        size_t first = task * HALVES_PER_TASK;
+        convert(src.data() + first, dst.data() + first, std::min(HALVES_PER_TASK, src.size() - first));
+    });
+}
+
+GpuImage::Proto CreateHdrGpuImage(const HdrImage& image, bool mips) {
+    if (image.Rgba.size() != static_cast<size_t>(image.Width) * image.Height * 4 || image.Rgba.empty()) {
+        throw std::runtime_error("HDR image pixels don't match its extent");
+    }
+
+    GpuImage::Proto proto;
+    proto.Format = VK_FORMAT_R16G16B16A16_SFLOAT;
+    proto.Extent = {image.Width, image.Height, 1};
+    proto.Mips.push_back(ToHalfLevel(image.Rgba));
+    if (!mips) {
+        return proto;
+    }
+
+    // Each level is filtered from the float level above it; only two float levels live at once.
+    const uint32_t level_count = MipLevelCount(image.Width, image.Height);
+    std::vector<float> above;
+    std::vector<float> level;
+    std::span<const float> src = image.Rgba;
+    for (uint32_t l = 1; l < level_count; ++l) {
+        uint32_t src_width = MipExtent(image.Width, l - 1);
+        uint32_t src_height = MipExtent(image.Height, l - 1);
+        uint32_t dst_width = MipExtent(image.Width, l);
+        uint32_t dst_height = MipExtent(image.Height, l);
+
+        level.resize(static_cast<size_t>(dst_width) * dst_height * 4);
+        DownsampleRgba32f(src, src_width, src_height, level, dst_width, dst_height);
+        proto.Mips.push_back(ToHalfLevel(level));
+
+        std::swap(above, level);
+        src = above;
+    }
+    return proto;
+}
+
+GpuImage::Proto LoadExrGpuImage(const ImageSource& source, bool mips) {
+    try {
+        return CreateHdrGpuImage(DecodeExr(source.GetData()), mips);
+    } catch (const std::exception& e) {
+        std::string name = source.GetType() == ImageSourceType::File ? source.GetPath().string() : "<memory>";
+        throw std::runtime_error("Failed to load EXR image " + name + ": " + e.what());
+    }
+}
+
+} // namespace tekki::asset
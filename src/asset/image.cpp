@@ -1,61 +1,40 @@
 #include "tekki/asset/image.h"
 #include <stdexcept>
 #include <algorithm>
-#include <fstream>
 #include <vector>
 #include <memory>
 #include <string>
 #include <filesystem>
+#include <limits>
 #include <glm/glm.hpp>
 #include <vulkan/vulkan.h>
 #include "tekki/core/result.h"
 #include "tekki/asset/TexParams.h"
 #include "tekki/asset/GpuImage.h"
+#include "tekki/asset/mip_chain.h"
+#include "tekki/core/mapped_file.h"
 
-// DDS file format support (simplified implementation)
-namespace ddsfile {
-    enum class DxgiFormat {
-        BC1_UNorm_sRGB,
-        BC3_UNorm,
-        BC3_UNorm_sRGB,
-        BC5_UNorm,
-        BC5_SNorm
-    };
-
-    struct Dds {
-        uint32_t width_;
-        uint32_t height_;
-        uint32_t depth_;
-        uint32_t num_mipmap_levels_;
-        DxgiFormat dxgi_format_;
-        std::vector<uint8_t> data_;
-        
-        uint32_t get_width() const { return width_; }
-        uint32_t get_height() const { return height_; }
-        uint32_t get_depth() const { return depth_; }
-        uint32_t get_num_mipmap_levels() const { return num_mipmap_levels_; }
-        DxgiFormat get_dxgi_format() const { return dxgi_format_; }
-        const std::vector<uint8_t>& get_data(uint32_t) const { return data_; }
-        uint32_t get_pitch_height() const { return 4; } // Assuming BC formats
-    };
-}
+#define STB_IMAGE_IMPLEMENTATION
+#define STBI_NO_STDIO
+#include <stb_image.h>
 
 namespace tekki::asset {
 
 // ImageSource implementation
 ImageSource::ImageSource(const std::filesystem::path& path) 
     : type_(ImageSourceType::File), path_(path) {
-    // Load file data
-    std::ifstream file(path, std::ios::binary);
-    if (!file) {
-        throw std::runtime_error("Failed to open image file: " + path.string());
-    }
-    
-    data_ = std::vector<uint8_t>(std::istreambuf_iterator<char>(file), {});
+    // Decoders stream through the bytes front to back.
+    auto file = tekki::core::MappedFile::Open(path, tekki::core::MappedFile::Access::Sequential);
+    data_ = file->Bytes();
+    backing_ = std::move(file);
 }
 
-ImageSource::ImageSource(const std::vector<uint8_t>& data)
-    : type_(ImageSourceType::Memory), data_(data) {}
+ImageSource::ImageSource(std::vector<uint8_t> data)
+    : type_(ImageSourceType::Memory) {
+    auto buffer = std::make_shared<const std::vector<uint8_t>>(std::move(data));
+    data_ = *buffer;
+    backing_ = std::move(buffer);
+}
 
 ImageSourceType ImageSource::GetType() const {
     return type_;
@@ -68,16 +47,20 @@ std::filesystem::path ImageSource::GetPath() const {
     return path_;
 }
 
-const std::vector<uint8_t>& ImageSource::GetData() const {
+std::span<const uint8_t> ImageSource::GetData() const {
     return data_;
 }
 
+const std::shared_ptr<const void>& ImageSource::GetBacking() const {
+    return backing_;
+}
+
 // RawImage implementation
 RawImage::RawImage(const RawRgba8Image& rgba8Image)
-    : type_(RawImageType::Rgba8), rgba8Image_(rgba8Image), ddsData_(nullptr) {}
+    : type_(RawImageType::Rgba8), rgba8Image_(rgba8Image) {}
 
-RawImage::RawImage(void* ddsData)
-    : type_(RawImageType::Dds), ddsData_(ddsData) {}
+RawImage::RawImage(std::shared_ptr<const DdsImage> dds)
+    : type_(RawImageType::Dds), dds_(std::move(dds)) {}
 
 RawImageType RawImage::GetType() const {
     return type_;
@@ -90,11 +73,11 @@ const RawRgba8Image& RawImage::GetRgba8Image() const {
     return rgba8Image_;
 }
 
-void* RawImage::GetDdsData() const {
+const std::shared_ptr<const DdsImage>& RawImage::GetDds() const {
     if (type_ != RawImageType::Dds) {
         throw std::runtime_error("RawImage is not DDS type");
     }
-    return ddsData_;
+    return dds_;
 }
 
 // LoadImage implementation
@@ -105,10 +88,10 @@ LoadImage LoadImage::FromPath(const std::filesystem::path& path) {
     return result;
 }
 
-LoadImage LoadImage::FromMemory(const std::vector<uint8_t>& data) {
+LoadImage LoadImage::FromMemory(std::vector<uint8_t> data) {
     LoadImage result;
     result.type_ = LoadImageType::Immediate;
-    result.immediateData_ = data;
+    result.source_ = std::make_shared<const ImageSource>(std::move(data));
     return result;
 }
 
@@ -116,30 +99,76 @@ LoadImageType LoadImage::GetType() const {
     return type_;
 }
 
-std::vector<uint8_t> LoadImage::Evaluate() {
+std::shared_ptr<const ImageSource> LoadImage::Evaluate() {
     try {
-        if (type_ == LoadImageType::Immediate) {
-            return immediateData_;
-        } else {
-            // Load from file
-            std::ifstream file(lazyPath_, std::ios::binary);
-            if (!file) {
-                throw std::runtime_error("Failed to open image file: " + lazyPath_.string());
-            }
-            
-            std::vector<uint8_t> data(std::istreambuf_iterator<char>(file), {});
-            
-            // Try to parse as DDS first
-            // For now, we'll assume it's not DDS and load as regular image
-            // In a real implementation, you'd use a proper DDS parser
-            
-            return data;
+        if (!source_) {
+            source_ = std::make_shared<const ImageSource>(lazyPath_);
         }
+        return source_;
     } catch (const std::exception& e) {
         throw std::runtime_error(std::string("Failed to evaluate image: ") + e.what());
     }
 }
 
+RawImage DecodeImage(const ImageSource& source) {
+    const auto& data = source.GetData();
+    if (DdsImage::IsDds(data)) {
+        return RawImage(DdsImage::Parse(data, source.GetBacking()));
+    }
+
+    if (data.size() > static_cast<size_t>(std::numeric_limits<int>::max())) {
+        throw std::runtime_error("Encoded image is too large");
+    }
+
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    stbi_uc* pixels = stbi_load_from_memory(data.data(), static_cast<int>(data.size()), &width, &height, &channels, 4);
+    if (!pixels) {
+        throw std::runtime_error(std::string("Failed to decode image: ") + stbi_failure_reason());
+    }
+
+    RawRgba8Image rgba8Image;
+    rgba8Image.data.assign(pixels, pixels + static_cast<size_t>(width) * height * 4);
+    rgba8Image.dimensions = glm::u32vec2(width, height);
+    stbi_image_free(pixels);
+
+    return RawImage(rgba8Image);
+}
+
+uint64_t EstimateImageBakeBytes(const ImageSource& source) {
+    const auto& data = source.GetData();
+    uint64_t encoded = data.size();
+    if (DdsImage::IsDds(data)) {
+        // Surfaces are borrowed from the source, never decoded.
+        return encoded;
+    }
+
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    if (data.size() > static_cast<size_t>(std::numeric_limits<int>::max()) ||
+        !stbi_info_from_memory(data.data(), static_cast<int>(data.size()), &width, &height, &channels)) {
+        return encoded * 4;
+    }
+
+    // Decoded RGBA8 plus a working copy and the output mip chain (4/3 of the top level).
+    uint64_t decoded = static_cast<uint64_t>(width) * static_cast<uint64_t>(height) * 4;
+    return encoded + decoded + decoded + decoded * 4 / 3;
+}
+
+std::optional<glm::u32vec2> PeekImageExtent(const ImageSource& source) {
+    const auto& data = source.GetData();
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    if (DdsImage::IsDds(data) || data.size() > static_cast<size_t>(std::numeric_limits<int>::max()) ||
+        !stbi_info_from_memory(data.data(), static_cast<int>(data.size()), &width, &height, &channels)) {
+        return std::nullopt;
+    }
+    return glm::u32vec2(width, height);
+}
+
 // CreatePlaceholderImage implementation
 CreatePlaceholderImage::CreatePlaceholderImage(const std::array<uint8_t, 4>& values)
     : values_(values) {}
@@ -166,7 +195,7 @@ tekki::asset::GpuImage::Proto CreateGpuImage::Create() {
             case RawImageType::Rgba8:
                 return ProcessRgba8(image_->GetRgba8Image());
             case RawImageType::Dds:
-                return ProcessDds(image_->GetDdsData());
+                return ProcessDds(image_->GetDds());
             default:
                 throw std::runtime_error("Unsupported image type");
         }
@@ -176,74 +205,77 @@ tekki::asset::GpuImage::Proto CreateGpuImage::Create() {
 }
 
 tekki::asset::GpuImage::Proto CreateGpuImage::ProcessRgba8(const RawRgba8Image& src) {
-    // This is a simplified implementation
-    // In a real implementation, you would:
-    // 1. Handle different gamma spaces
-    // 2. Implement BC5/BC7 compression
-    // 3. Handle mipmap generation
-    // 4. Implement channel swizzling
+    const bool should_compress = params_.Compression != TexCompressionMode::None;
+    const BcMode bc_mode = params_.Compression == TexCompressionMode::Rg ? BcMode::Bc5 : BcMode::Bc7;
 
     tekki::asset::GpuImage::Proto proto;
-
-    // Set format based on SRGB setting
-    if (params_.srgb) {
-        proto.Format = VK_FORMAT_R8G8B8A8_SRGB;
+    if (!should_compress) {
+        proto.Format = params_.srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+    } else if (bc_mode == BcMode::Bc5) {
+        proto.Format = VK_FORMAT_BC5_UNORM_BLOCK;
     } else {
-        proto.Format = VK_FORMAT_R8G8B8A8_UNORM;
+        proto.Format = params_.srgb ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK;
     }
 
-    // Set dimensions
     proto.Extent = {src.dimensions.x, src.dimensions.y, 1};
 
-    // For now, just pass through the data without processing
-    // In a real implementation, you would implement the full processing pipeline
-    proto.Mips.push_back(src.data);
+    std::array<uint8_t, 4> swizzle = {0, 1, 2, 3};
+    if (params_.ChannelSwizzle) {
+        for (size_t i = 0; i < 4; ++i) {
+            swizzle[i] = static_cast<uint8_t>((*params_.ChannelSwizzle)[i]);
+        }
+    }
+
+    // The chain is filtered from the unswizzled source into its final slots, then each level is
+    // swizzled and compressed in place.
+    const uint32_t width = src.dimensions.x;
+    const uint32_t height = src.dimensions.y;
+    uint32_t mip_count = params_.use_mips ? MipLevelCount(width, height) : 1;
+    if (params_.MaxMipCount != 0) {
+        mip_count = std::min(mip_count, params_.MaxMipCount);
+    }
+    proto.Mips.resize(mip_count);
+    for (uint32_t level = 1; level < proto.Mips.size(); ++level) {
+        proto.Mips[level].resize(MipByteSize(width, height, level));
+    }
+    GenerateMipChainInto(src.data, width, height, std::span(proto.Mips).subspan(1),
+                         MipChainOptions{params_.gamma, params_.MipFilter});
+
+    proto.Mips[0] = ProcessMip(src.data, width, height, should_compress, bc_mode, swizzle);
+    for (uint32_t level = 1; level < proto.Mips.size(); ++level) {
+        proto.Mips[level] = ProcessMip(std::move(proto.Mips[level]), MipExtent(width, level), MipExtent(height, level),
+                                       should_compress, bc_mode, swizzle);
+    }
 
     return proto;
 }
 
-tekki::asset::GpuImage::Proto CreateGpuImage::ProcessDds(void* ddsData) {
-    // This is a placeholder implementation
-    // In a real implementation, you would parse the DDS data and convert to Vulkan format
-
-    auto* dds = static_cast<ddsfile::Dds*>(ddsData);
+tekki::asset::GpuImage::Proto CreateGpuImage::ProcessDds(const std::shared_ptr<const DdsImage>& dds) {
+    // Pre-compressed surfaces are passed through as views into the DDS bytes; swizzling and
+    // compression params don't apply to them.
+    if (dds->GetSliceCount() != 1) {
+        throw std::runtime_error("DDS arrays and cubemaps are not supported for material maps (" +
+                                 std::to_string(dds->GetSliceCount()) + " slices)");
+    }
 
     tekki::asset::GpuImage::Proto proto;
+    proto.Format = dds->GetFormat();
+    proto.Extent = {dds->GetWidth(), dds->GetHeight(), dds->GetDepth()};
 
-    // Map DDS format to Vulkan format
-    switch (dds->get_dxgi_format()) {
-        case ddsfile::DxgiFormat::BC1_UNorm_sRGB:
-            proto.Format = VK_FORMAT_BC1_RGB_SRGB_BLOCK;
-            break;
-        case ddsfile::DxgiFormat::BC3_UNorm:
-            proto.Format = VK_FORMAT_BC3_UNORM_BLOCK;
-            break;
-        case ddsfile::DxgiFormat::BC3_UNorm_sRGB:
-            proto.Format = VK_FORMAT_BC3_SRGB_BLOCK;
-            break;
-        case ddsfile::DxgiFormat::BC5_UNorm:
-            proto.Format = VK_FORMAT_BC5_UNORM_BLOCK;
-            break;
-        case ddsfile::DxgiFormat::BC5_SNorm:
-            proto.Format = VK_FORMAT_BC5_SNORM_BLOCK;
-            break;
-        default:
-            throw std::runtime_error("Unsupported DDS format");
+    uint32_t mip_count = params_.use_mips ? dds->GetMipCount() : 1;
+    if (params_.MaxMipCount != 0) {
+        mip_count = std::min(mip_count, params_.MaxMipCount);
     }
-
-    proto.Extent = {dds->get_width(), dds->get_height(), dds->get_depth()};
-
-    // Extract mip data (simplified)
-    const auto& ddsDataVec = dds->get_data(0);
-    proto.Mips.push_back(ddsDataVec);
+    for (uint32_t mip = 0; mip < mip_count; ++mip) {
+        proto.MipViews.push_back(dds->GetSurface(mip));
+    }
+    proto.Backing = dds;
 
     return proto;
 }
 
-std::vector<uint8_t> CreateGpuImage::CompressMip([[maybe_unused]] const std::vector<uint8_t>& mipData, [[maybe_unused]] uint32_t width, [[maybe_unused]] uint32_t height, [[maybe_unused]] BcMode bcMode, [[maybe_unused]] bool needsAlpha) {
-    // Placeholder implementation - in real code you would use a BC compression library
-    // For now, just return the original data
-    return mipData;
+std::vector<uint8_t> CreateGpuImage::CompressMip(const std::vector<uint8_t>& mipData, uint32_t width, uint32_t height, BcMode bcMode, bool needsAlpha) {
+    return CompressBc(mipData, width, height, bcMode, needsAlpha, params_.CompressionQuality);
 }
 
 void CreateGpuImage::SwizzleChannels(std::vector<uint8_t>& mipData, const std::array<uint8_t, 4>& swizzle) {
@@ -265,17 +297,23 @@ void CreateGpuImage::SwizzleChannels(std::vector<uint8_t>& mipData, const std::a
     }
 }
 
-std::vector<uint8_t> CreateGpuImage::ProcessMip(const std::vector<uint8_t>& mipData, uint32_t width, uint32_t height, bool shouldCompress, BcMode bcMode, const std::array<uint8_t, 4>& swizzle) {
-    auto processedData = mipData;
+std::vector<uint8_t> CreateGpuImage::ProcessMip(std::vector<uint8_t> mipData, uint32_t width, uint32_t height, bool shouldCompress, BcMode bcMode, const std::array<uint8_t, 4>& swizzle) {
+    auto processedData = std::move(mipData);
     
     // Apply swizzle if needed
     if (swizzle[0] != 0 || swizzle[1] != 1 || swizzle[2] != 2 || swizzle[3] != 3) {
         SwizzleChannels(processedData, swizzle);
     }
     
-    // Compress if needed
+    // Compress if needed; BC7 only spends bits on alpha when some pixel is translucent
     if (shouldCompress) {
-        processedData = CompressMip(processedData, width, height, bcMode, false); // needsAlpha would be determined
+        bool needs_alpha = false;
+        if (bcMode == BcMode::Bc7) {
+            for (size_t i = 3; i < processedData.size() && !needs_alpha; i += 4) {
+                needs_alpha = processedData[i] != 255;
+            }
+        }
+        processedData = CompressMip(processedData, width, height, bcMode, needs_alpha);
     }
     
     return processedData;
@@ -285,28 +323,4 @@ uint32_t CreateGpuImage::RoundUpToBlock(uint32_t value, uint32_t minImgDim) {
     return ((value + minImgDim - 1) / minImgDim) * minImgDim;
 }
 
-namespace dds_util {
-    uint32_t GetTextureSize(uint32_t pitch, uint32_t pitchHeight, uint32_t height, uint32_t depth) {
-        uint32_t row_height = (height + (pitchHeight - 1)) / pitchHeight;
-        return pitch * row_height * depth;
-    }
-
-    uint32_t GetPitch(void* dds, uint32_t width) {
-        auto* ddsPtr = static_cast<ddsfile::Dds*>(dds);
-        
-        // Simplified implementation - assume BC formats (4x4 blocks)
-        // For BC formats, pitch = width * bytes_per_block / 4
-        switch (ddsPtr->get_dxgi_format()) {
-            case ddsfile::DxgiFormat::BC1_UNorm_sRGB:
-            case ddsfile::DxgiFormat::BC3_UNorm:
-            case ddsfile::DxgiFormat::BC3_UNorm_sRGB:
-            case ddsfile::DxgiFormat::BC5_UNorm:
-            case ddsfile::DxgiFormat::BC5_SNorm:
-                return (width * 16 + 3) / 4; // 16 bytes per 4x4 block
-            default:
-                return width * 4; // Assume RGBA8 as fallback
-        }
-    }
-}
-
 } // namespace tekki::asset
\ No newline at end of file
@@ -1,7 +1,12 @@
 #include "tekki/asset/mesh.h"
+#include "tekki/asset/image.h"
+#include "tekki/asset/mesh_optimize.h"
+#include "tekki/asset/mesh_simplify.h"
+#include "tekki/core/parallel.h"
 #include <glm/glm.hpp>
 #include <glm/gtc/quaternion.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
 #include <algorithm>
 #include <stdexcept>
 #include <fstream>
@@ -10,6 +15,20 @@
 #include <memory>
 #include <string>
 #include <optional>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <numeric>
+#include <unordered_map>
+
+// Images are only referenced by the loader and decoded later by the image pipeline,
+// so TinyGLTF's own stb_image decoding and external image loading are compiled out.
+#define TINYGLTF_IMPLEMENTATION
+#define TINYGLTF_NO_STB_IMAGE
+#define TINYGLTF_NO_STB_IMAGE_WRITE
+#define TINYGLTF_NO_EXTERNAL_IMAGE
+#include <tiny_gltf.h>
 
 namespace tekki::asset {
 
@@ -25,214 +44,264 @@ uint32_t PackUnitDirection11_10_11(float x, float y, float z) {
     return (packed_z << 21) | (packed_y << 11) | packed_x;
 }
 
-void FlattenCtx::AllocateSectionIndices() {
-    size_t counter = 0;
-    AllocateSectionIndicesImpl(counter);
+std::array<float, 3> UnpackUnitDirection11_10_11(uint32_t packed) {
+    float x = static_cast<float>(packed & 0x7ffu) / ((1u << 11u) - 1u);
+    float y = static_cast<float>((packed >> 11) & 0x3ffu) / ((1u << 10u) - 1u);
+    float z = static_cast<float>(packed >> 21) / ((1u << 11u) - 1u);
+
+    return {x * 2.0f - 1.0f, y * 2.0f - 1.0f, z * 2.0f - 1.0f};
 }
 
-void FlattenCtx::AllocateSectionIndicesImpl(size_t& counter) {
-    SectionIdx = counter;
-    counter++;
-    
-    for (auto& deferred : Deferred) {
-        deferred.Nested.AllocateSectionIndicesImpl(counter);
+void VectorFlattenSink::Write(const uint8_t* data, size_t size) {
+    bytes_.insert(bytes_.end(), data, data + size);
+}
+
+void StreamFlattenSink::Write(const uint8_t* data, size_t size) {
+    stream_.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+    if (!stream_) {
+        throw std::runtime_error("Failed to write flattened asset");
     }
 }
 
-void FlattenCtx::Finish(std::vector<uint8_t>& writer) {
-    AllocateSectionIndices();
-    
-    struct Section {
-        std::vector<uint8_t> Bytes;
-        std::vector<std::pair<size_t, size_t>> Fixups;
-    };
-    
-    std::vector<Section> sections;
-    std::vector<FlattenCtx> ctx_list;
-    ctx_list.push_back(std::move(*this));
-    
-    while (!ctx_list.empty()) {
-        std::vector<FlattenCtx> next_ctx_list;
-        
-        for (auto& ctx : ctx_list) {
-            Section section;
-            section.Bytes = std::move(ctx.Bytes);
-            
-            for (const auto& deferred : ctx.Deferred) {
-                section.Fixups.emplace_back(deferred.FixupAddr, deferred.Nested.SectionIdx.value());
-            }
-            
-            sections.push_back(std::move(section));
-            
-            for (auto& deferred : ctx.Deferred) {
-                next_ctx_list.push_back(std::move(deferred.Nested));
-            }
+void SpanFlattenSink::Write(const uint8_t* data, size_t size) {
+    if (size > dst_.size() - written_) {
+        throw std::runtime_error("Flattened asset does not fit the destination buffer");
+    }
+    std::memcpy(dst_.data() + written_, data, size);
+    written_ += size;
+}
+
+FlatWriter::FlatWriter() {
+    sections_.emplace_back();
+}
+
+void FlatWriter::SetPageAlignedSections(uint64_t minPayloadBytes) {
+    pageAlignFrom_ = minPayloadBytes;
+    laidOut_ = false;
+}
+
+void FlatWriter::WriteInline(SectionId section, const void* data, size_t size) {
+    auto& bytes = sections_.at(section).Inline;
+    const auto* src = static_cast<const uint8_t*>(data);
+    bytes.insert(bytes.end(), src, src + size);
+    laidOut_ = false;
+}
+
+FlatWriter::SectionId FlatWriter::WriteVec(SectionId section, uint64_t len, std::span<const uint8_t> payload) {
+    SectionId child = sections_.size();
+    sections_.emplace_back();
+    sections_[child].Payload = payload;
+
+    auto& parent = sections_.at(section);
+    size_t header_addr = parent.Inline.size();
+    parent.Inline.resize(header_addr + 16);
+    std::memcpy(parent.Inline.data() + header_addr, &len, sizeof(uint64_t));
+    parent.Fixups.emplace_back(header_addr + 8, child);
+    parent.Children.push_back(child);
+
+    laidOut_ = false;
+    return child;
+}
+
+void FlatWriter::Layout() {
+    if (laidOut_) {
+        return;
+    }
+
+    // Breadth-first, so every level of nesting is contiguous.
+    order_.clear();
+    order_.push_back(ROOT);
+    for (size_t i = 0; i < order_.size(); ++i) {
+        const auto& children = sections_[order_[i]].Children;
+        order_.insert(order_.end(), children.begin(), children.end());
+    }
+
+    uint64_t addr = 0;
+    for (SectionId id : order_) {
+        auto& section = sections_[id];
+        const bool page_aligned = pageAlignFrom_ != 0 && section.Payload.size() >= pageAlignFrom_;
+        const uint64_t alignment = page_aligned ? PAGE_ALIGNMENT : SECTION_ALIGNMENT;
+        addr = (addr + alignment - 1) & ~(alignment - 1);
+        section.Addr = addr;
+        addr += section.Inline.size() + section.Payload.size();
+    }
+    size_ = addr;
+
+    for (SectionId id : order_) {
+        auto& section = sections_[id];
+        for (const auto& [fixup_addr, target] : section.Fixups) {
+            uint64_t relative = sections_[target].Addr - (section.Addr + fixup_addr);
+            std::memcpy(section.Inline.data() + fixup_addr, &relative, sizeof(relative));
         }
-        
-        ctx_list = std::move(next_ctx_list);
     }
-    
-    size_t total_bytes = 0;
-    std::vector<size_t> section_base_addr;
-    for (const auto& section : sections) {
-        section_base_addr.push_back(total_bytes);
-        total_bytes += section.Bytes.size();
+
+    laidOut_ = true;
+}
+
+uint64_t FlatWriter::Size() {
+    Layout();
+    return size_;
+}
+
+std::vector<std::pair<uint64_t, uint64_t>> FlatWriter::GetSectionRanges() {
+    Layout();
+    std::vector<std::pair<uint64_t, uint64_t>> ranges;
+    ranges.reserve(order_.size());
+    for (SectionId id : order_) {
+        const auto& section = sections_[id];
+        ranges.emplace_back(section.Addr, section.Inline.size() + section.Payload.size());
     }
-    
-    for (size_t i = 0; i < sections.size(); ++i) {
-        auto& section = sections[i];
-        size_t section_addr = section_base_addr[i];
-        
-        for (const auto& fixup : section.Fixups) {
-            size_t fixup_addr = fixup.first;
-            size_t target_section = fixup.second;
-            uint64_t fixup_target = static_cast<uint64_t>(section_base_addr[target_section]);
-            uint64_t fixup_relative = fixup_target - (fixup_addr + section_addr);
-            
-            std::memcpy(&section.Bytes[fixup_addr], &fixup_relative, sizeof(fixup_relative));
+    return ranges;
+}
+
+void FlatWriter::WriteTo(FlattenSink& sink) {
+    Layout();
+
+    static constexpr uint8_t padding[PAGE_ALIGNMENT] = {};
+    uint64_t written = 0;
+    for (SectionId id : order_) {
+        const auto& section = sections_[id];
+        if (section.Addr > written) {
+            sink.Write(padding, static_cast<size_t>(section.Addr - written));
+        }
+        if (!section.Inline.empty()) {
+            sink.Write(section.Inline.data(), section.Inline.size());
         }
+        if (!section.Payload.empty()) {
+            sink.Write(section.Payload.data(), section.Payload.size());
+        }
+        written = section.Addr + section.Inline.size() + section.Payload.size();
     }
-    
-    for (const auto& section : sections) {
-        writer.insert(writer.end(), section.Bytes.begin(), section.Bytes.end());
+}
+
+void GpuImage::Proto::WriteFlat(FlatWriter& writer) const {
+    writer.WritePlain(FlatWriter::ROOT, Format);
+    writer.WritePlain(FlatWriter::ROOT, Extent);
+
+    auto mips = writer.WriteVec(FlatWriter::ROOT, GetMipCount());
+    for (size_t level = 0; level < GetMipCount(); ++level) {
+        writer.WriteVec<uint8_t>(mips, GetMip(level));
     }
 }
 
-void GpuImage::Proto::FlattenInto(std::vector<uint8_t>& writer) {
-    FlattenCtx output;
-    
+void GpuImage::Proto::FlattenInto(FlattenSink& sink) const {
     try {
-        // Flatten format
-        // flatten_plain_field(output.Bytes, Format);
-        
-        // Flatten extent
-        std::memcpy(output.Bytes.data() + output.Bytes.size(), Extent.data(), sizeof(Extent));
-        output.Bytes.resize(output.Bytes.size() + sizeof(Extent));
-        
-        // Flatten mips
-        size_t fixup_addr = output.Bytes.size();
-        output.Bytes.resize(output.Bytes.size() + 16); // len + offset
-        
-        FlattenCtx nested;
-        for (const auto& mip : Mips) {
-            size_t mip_fixup_addr = nested.Bytes.size();
-            nested.Bytes.resize(nested.Bytes.size() + 16);
-            
-            uint64_t mip_size = mip.size();
-            std::memcpy(nested.Bytes.data() + mip_fixup_addr, &mip_size, sizeof(uint64_t));
-            
-            FlattenCtx mip_nested;
-            mip_nested.Bytes.insert(mip_nested.Bytes.end(), mip.begin(), mip.end());
-            nested.Deferred.push_back(DeferredBlob{mip_fixup_addr + 8, std::move(mip_nested)});
-        }
-        
-        output.Deferred.push_back(DeferredBlob{fixup_addr + 8, std::move(nested)});
-        
-        output.Finish(writer);
+        FlatWriter writer;
+        WriteFlat(writer);
+        writer.WriteTo(sink);
     } catch (const std::exception& e) {
         throw std::runtime_error("Failed to flatten GpuImage: " + std::string(e.what()));
     }
 }
 
-void PackedTriMesh::Proto::FlattenInto(std::vector<uint8_t>& writer) {
-    FlattenCtx output;
-    
+void GpuImage::Proto::FlattenInto(std::vector<uint8_t>& writer) const {
+    VectorFlattenSink sink(writer);
+    FlattenInto(sink);
+}
+
+void PackedTriMesh::Proto::WriteFlat(FlatWriter& writer, FlatWriter::SectionId section) const {
+    auto root = section;
+    writer.WriteVec<PackedVertex>(root, Verts);
+    writer.WriteVec<std::array<float, 2>>(root, Uvs);
+    writer.WriteVec<std::array<float, 4>>(root, Tangents);
+    writer.WriteVec<std::array<float, 4>>(root, Colors);
+    writer.WriteVec<uint32_t>(root, Indices);
+    writer.WriteVec<MeshMaterial>(root, Materials);
+    writer.WriteVec<AssetRef<GpuImage::Flat>>(root, Maps);
+    writer.WriteVec<Meshlet>(root, Meshlets);
+    writer.WriteVec<uint32_t>(root, MeshletVertices);
+    writer.WriteVec<uint8_t>(root, MeshletTriangles);
+    writer.WriteVec<QuantizedVertex>(root, QuantizedVerts);
+    writer.WriteVec<uint32_t>(root, HalfUvs);
+    writer.WriteVec<uint32_t>(root, OctTangents);
+    writer.WriteVec<uint32_t>(root, Rgba8Colors);
+    writer.WriteVec<uint8_t>(root, IndexStream);
+    writer.WritePlain(root, IndexStreamCount);
+    writer.WritePlain(root, PositionMin);
+    writer.WritePlain(root, PositionScale);
+    writer.WriteVec<MeshLod>(root, Lods);
+    writer.WriteVec<uint32_t>(root, LodIndices);
+    writer.WriteVec<MaterialRange>(root, MaterialRanges);
+    writer.WriteVec<uint16_t>(root, ShortIndices);
+}
+
+void PackedTriMesh::Proto::FlattenInto(FlattenSink& sink) const {
     try {
-        // Flatten verts
-        size_t verts_fixup = output.Bytes.size();
-        output.Bytes.resize(output.Bytes.size() + 16);
-        
-        FlattenCtx verts_nested;
-        for (const auto& vert : Verts) {
-            std::memcpy(verts_nested.Bytes.data() + verts_nested.Bytes.size(), &vert, sizeof(PackedVertex));
-            verts_nested.Bytes.resize(verts_nested.Bytes.size() + sizeof(PackedVertex));
-        }
-        output.Deferred.push_back(DeferredBlob{verts_fixup + 8, std::move(verts_nested)});
-        
-        // Flatten uvs
-        size_t uvs_fixup = output.Bytes.size();
-        output.Bytes.resize(output.Bytes.size() + 16);
-        
-        FlattenCtx uvs_nested;
-        for (const auto& uv : Uvs) {
-            std::memcpy(uvs_nested.Bytes.data() + uvs_nested.Bytes.size(), uv.data(), sizeof(std::array<float, 2>));
-            uvs_nested.Bytes.resize(uvs_nested.Bytes.size() + sizeof(std::array<float, 2>));
-        }
-        output.Deferred.push_back(DeferredBlob{uvs_fixup + 8, std::move(uvs_nested)});
-        
-        // Flatten tangents
-        size_t tangents_fixup = output.Bytes.size();
-        output.Bytes.resize(output.Bytes.size() + 16);
-        
-        FlattenCtx tangents_nested;
-        for (const auto& tangent : Tangents) {
-            std::memcpy(tangents_nested.Bytes.data() + tangents_nested.Bytes.size(), tangent.data(), sizeof(std::array<float, 4>));
-            tangents_nested.Bytes.resize(tangents_nested.Bytes.size() + sizeof(std::array<float, 4>));
-        }
-        output.Deferred.push_back(DeferredBlob{tangents_fixup + 8, std::move(tangents_nested)});
-        
-        // Flatten colors
-        size_t colors_fixup = output.Bytes.size();
-        output.Bytes.resize(output.Bytes.size() + 16);
-        
-        FlattenCtx colors_nested;
-        for (const auto& color : Colors) {
-            std::memcpy(colors_nested.Bytes.data() + colors_nested.Bytes.size(), color.data(), sizeof(std::array<float, 4>));
-            colors_nested.Bytes.resize(colors_nested.Bytes.size() + sizeof(std::array<float, 4>));
-        }
-        output.Deferred.push_back(DeferredBlob{colors_fixup + 8, std::move(colors_nested)});
-        
-        // Flatten indices
-        size_t indices_fixup = output.Bytes.size();
-        output.Bytes.resize(output.Bytes.size() + 16);
-        
-        FlattenCtx indices_nested;
-        for (const auto& index : Indices) {
-            std::memcpy(indices_nested.Bytes.data() + indices_nested.Bytes.size(), &index, sizeof(uint32_t));
-            indices_nested.Bytes.resize(indices_nested.Bytes.size() + sizeof(uint32_t));
-        }
-        output.Deferred.push_back(DeferredBlob{indices_fixup + 8, std::move(indices_nested)});
-        
-        // Flatten material_ids
-        size_t material_ids_fixup = output.Bytes.size();
-        output.Bytes.resize(output.Bytes.size() + 16);
-        
-        FlattenCtx material_ids_nested;
-        for (const auto& material_id : MaterialIds) {
-            std::memcpy(material_ids_nested.Bytes.data() + material_ids_nested.Bytes.size(), &material_id, sizeof(uint32_t));
-            material_ids_nested.Bytes.resize(material_ids_nested.Bytes.size() + sizeof(uint32_t));
-        }
-        output.Deferred.push_back(DeferredBlob{material_ids_fixup + 8, std::move(material_ids_nested)});
-        
-        // Flatten materials
-        size_t materials_fixup = output.Bytes.size();
-        output.Bytes.resize(output.Bytes.size() + 16);
-        
-        FlattenCtx materials_nested;
-        for (const auto& material : Materials) {
-            std::memcpy(materials_nested.Bytes.data() + materials_nested.Bytes.size(), &material, sizeof(MeshMaterial));
-            materials_nested.Bytes.resize(materials_nested.Bytes.size() + sizeof(MeshMaterial));
-        }
-        output.Deferred.push_back(DeferredBlob{materials_fixup + 8, std::move(materials_nested)});
-        
-        // Flatten maps
-        size_t maps_fixup = output.Bytes.size();
-        output.Bytes.resize(output.Bytes.size() + 16);
-        
-        FlattenCtx maps_nested;
-        for (const auto& map : Maps) {
-            std::memcpy(maps_nested.Bytes.data() + maps_nested.Bytes.size(), &map, sizeof(AssetRef<GpuImage::Flat>));
-            maps_nested.Bytes.resize(maps_nested.Bytes.size() + sizeof(AssetRef<GpuImage::Flat>));
-        }
-        output.Deferred.push_back(DeferredBlob{maps_fixup + 8, std::move(maps_nested)});
-        
-        output.Finish(writer);
+        FlatWriter writer;
+        WriteFlat(writer);
+        writer.WriteTo(sink);
     } catch (const std::exception& e) {
         throw std::runtime_error("Failed to flatten PackedTriMesh: " + std::string(e.what()));
     }
 }
 
-PackedTriangleMesh PackTriangleMesh(const TriangleMesh& mesh) {
+void PackedTriMesh::Proto::FlattenInto(std::vector<uint8_t>& writer) const {
+    VectorFlattenSink sink(writer);
+    FlattenInto(sink);
+}
+
+void PackedScene::Proto::WriteFlat(FlatWriter& writer) const {
+    // Each mesh's Flat header is one element of the outer vector, its streams nested below it.
+    auto meshes = writer.WriteVec(FlatWriter::ROOT, Meshes.size());
+    for (const auto& mesh : Meshes) {
+        mesh.WriteFlat(writer, meshes);
+    }
+    writer.WriteVec<SceneInstance>(FlatWriter::ROOT, Instances);
+}
+
+void PackedScene::Proto::FlattenInto(FlattenSink& sink) const {
+    try {
+        FlatWriter writer;
+        WriteFlat(writer);
+        writer.WriteTo(sink);
+    } catch (const std::exception& e) {
+        throw std::runtime_error("Failed to flatten PackedScene: " + std::string(e.what()));
+    }
+}
+
+void PackedScene::Proto::FlattenInto(std::vector<uint8_t>& writer) const {
+    VectorFlattenSink sink(writer);
+    FlattenInto(sink);
+}
+
+void SortTrianglesByMaterial(PackedTriangleMesh& mesh) {
+    if (mesh.Indices.size() % 3 != 0) {
+        throw std::runtime_error("SortTrianglesByMaterial: index count is not a multiple of 3");
+    }
+    if (!mesh.Lods.empty() || !mesh.Meshlets.empty()) {
+        throw std::runtime_error("SortTrianglesByMaterial: LODs and meshlets must be built after sorting");
+    }
+
+    const size_t triangle_count = mesh.Indices.size() / 3;
+    std::vector<uint32_t> materials(triangle_count, 0);
+    if (!mesh.MaterialIds.empty()) {
+        for (size_t t = 0; t < triangle_count; ++t) {
+            uint32_t v = mesh.Indices[t * 3];
+            if (v >= mesh.MaterialIds.size()) {
+                throw std::runtime_error("SortTrianglesByMaterial: vertex index out of range");
+            }
+            materials[t] = mesh.MaterialIds[v];
+        }
+    }
+
+    std::vector<uint32_t> order(triangle_count);
+    std::iota(order.begin(), order.end(), 0u);
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return materials[a] < materials[b]; });
+
+    std::vector<uint32_t> sorted(mesh.Indices.size());
+    mesh.MaterialRanges.clear();
+    for (size_t i = 0; i < triangle_count; ++i) {
+        uint32_t t = order[i];
+        std::copy_n(mesh.Indices.begin() + t * 3, 3, sorted.begin() + i * 3);
+        if (mesh.MaterialRanges.empty() || mesh.MaterialRanges.back().MaterialId != materials[t]) {
+            mesh.MaterialRanges.push_back(MaterialRange{materials[t], static_cast<uint32_t>(i * 3), 0, 0, sizeof(uint32_t)});
+        }
+        mesh.MaterialRanges.back().IndexCount += 3;
+    }
+    mesh.Indices = std::move(sorted);
+}
+
+PackedTriangleMesh PackTriangleMesh(const TriangleMesh& mesh, const PackTriangleMeshOptions& options) {
     PackedTriangleMesh result;
     
     try {
@@ -255,9 +324,45 @@ PackedTriangleMesh PackTriangleMesh(const TriangleMesh& mesh) {
         result.Indices = mesh.Indices;
         result.MaterialIds = mesh.MaterialIds;
         result.Materials = mesh.Materials;
+
+        if (options.WeldVertices) {
+            WeldVertices(result, options.WeldEpsilon);
+        }
+
+        SortTrianglesByMaterial(result);
+
+        if (options.OptimizeVertexOrder) {
+            // Each material's triangles are reordered among themselves, so the ranges hold.
+            size_t vertex_count = result.Verts.size();
+            tekki::core::ParallelFor(result.MaterialRanges.size(), [&](size_t r) {
+                auto range = std::span(result.Indices).subspan(result.MaterialRanges[r].FirstIndex, result.MaterialRanges[r].IndexCount);
+                auto optimized = OptimizeVertexCache(range, vertex_count);
+                std::copy(optimized.begin(), optimized.end(), range.begin());
+            });
+
+            auto remap = OptimizeVertexFetch(result.Indices, vertex_count);
+            RemapVertexStream(result.Verts, remap);
+            RemapVertexStream(result.Uvs, remap);
+            RemapVertexStream(result.Tangents, remap);
+            RemapVertexStream(result.Colors, remap);
+            RemapVertexStream(result.MaterialIds, remap);
+        }
+
+        if (!options.LodErrors.empty()) {
+            LodChainOptions lod_options;
+            lod_options.Errors = options.LodErrors;
+            lod_options.OptimizeVertexCache = options.OptimizeVertexOrder;
+            BuildLodChain(result, lod_options);
+        }
+
+        if (options.BuildMeshlets) {
+            BuildMeshlets(result);
+        }
+
+        // Every step that needed per-vertex materials is done; the ranges replace them.
+        result.MaterialIds = {};
         
-        // Note: Maps conversion from MeshMaterialMap to AssetRef<GpuImage::Flat> would require
-        // additional image loading infrastructure not provided in the header
+        // Maps are resolved to baked image references by the asset pipeline, which owns image baking.
         
     } catch (const std::exception& e) {
         throw std::runtime_error("Failed to pack triangle mesh: " + std::string(e.what()));
@@ -266,36 +371,733 @@ PackedTriangleMesh PackTriangleMesh(const TriangleMesh& mesh) {
     return result;
 }
 
-void TangentCalcContext::GenerateTangents() {
-    try {
-        // MikkTSpace tangent generation implementation would go here
-        // This is a placeholder for the actual implementation
-        
-        for (size_t i = 0; i < Tangents.size(); ++i) {
-            Tangents[i] = {1.0f, 0.0f, 0.0f, 1.0f};
+namespace {
+
+// Strided view of a glTF accessor's backing buffer. `Data` is null for accessors without a
+// buffer view, which the spec defines as all zeros.
+struct AccessorView {
+    const uint8_t* Data = nullptr;
+    size_t Stride = 0;
+    size_t Count = 0;
+    int ComponentType = 0;
+    size_t Components = 0;
+    bool Normalized = false;
+};
+
+AccessorView ViewAccessor(const tinygltf::Model& model, int accessor_idx) {
+    const auto& accessor = model.accessors.at(accessor_idx);
+    if (accessor.sparse.isSparse) {
+        throw std::runtime_error("sparse accessors are not supported");
+    }
+
+    AccessorView view;
+    view.Count = accessor.count;
+    view.ComponentType = accessor.componentType;
+    view.Components = static_cast<size_t>(tinygltf::GetNumComponentsInType(accessor.type));
+    view.Normalized = accessor.normalized;
+
+    if (accessor.bufferView < 0) {
+        return view;
+    }
+
+    const auto& buffer_view = model.bufferViews.at(accessor.bufferView);
+    const auto& buffer = model.buffers.at(buffer_view.buffer);
+
+    size_t elem_size = static_cast<size_t>(tinygltf::GetComponentSizeInBytes(accessor.componentType)) * view.Components;
+    int stride = accessor.ByteStride(buffer_view);
+    if (stride <= 0) {
+        throw std::runtime_error("invalid accessor stride");
+    }
+    view.Stride = static_cast<size_t>(stride);
+
+    size_t start = buffer_view.byteOffset + accessor.byteOffset;
+    if (view.Count > 0 && start + view.Stride * (view.Count - 1) + elem_size > buffer.data.size()) {
+        throw std::runtime_error("accessor " + std::to_string(accessor_idx) + " exceeds its buffer");
+    }
+
+    view.Data = buffer.data.data() + start;
+    return view;
+}
+
+float ReadComponent(const uint8_t* elem, size_t c, int component_type, bool normalized) {
+    switch (component_type) {
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE: {
+            float v = static_cast<float>(elem[c]);
+            return normalized ? v / 255.0f : v;
         }
-        
-    } catch (const std::exception& e) {
-        throw std::runtime_error("Failed to generate tangents: " + std::string(e.what()));
+        case TINYGLTF_COMPONENT_TYPE_BYTE: {
+            float v = static_cast<float>(static_cast<int8_t>(elem[c]));
+            return normalized ? std::max(v / 127.0f, -1.0f) : v;
+        }
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: {
+            uint16_t raw;
+            std::memcpy(&raw, elem + c * sizeof(raw), sizeof(raw));
+            float v = static_cast<float>(raw);
+            return normalized ? v / 65535.0f : v;
+        }
+        case TINYGLTF_COMPONENT_TYPE_SHORT: {
+            int16_t raw;
+            std::memcpy(&raw, elem + c * sizeof(raw), sizeof(raw));
+            float v = static_cast<float>(raw);
+            return normalized ? std::max(v / 32767.0f, -1.0f) : v;
+        }
+        case TINYGLTF_COMPONENT_TYPE_FLOAT: {
+            float v;
+            std::memcpy(&v, elem + c * sizeof(v), sizeof(v));
+            return v;
+        }
+        default:
+            throw std::runtime_error("unsupported accessor component type " + std::to_string(component_type));
+    }
+}
+
+// Decodes `dst.size()` elements of `view` straight into `dst`, passing each through `map`.
+// Components missing from the accessor keep their `fallback` values.
+template<size_t N, typename Map>
+void DecodeAccessor(const AccessorView& view, std::span<std::array<float, N>> dst, std::array<float, N> fallback, Map&& map) {
+    if (view.Data == nullptr) {
+        std::array<float, N> zero{};
+        for (auto& v : dst) {
+            v = map(zero);
+        }
+        return;
+    }
+
+    size_t components = std::min(N, view.Components);
+    for (size_t i = 0; i < dst.size(); ++i) {
+        const uint8_t* elem = view.Data + i * view.Stride;
+        std::array<float, N> v = fallback;
+
+        if (view.ComponentType == TINYGLTF_COMPONENT_TYPE_FLOAT) {
+            std::memcpy(v.data(), elem, components * sizeof(float));
+        } else {
+            for (size_t c = 0; c < components; ++c) {
+                v[c] = ReadComponent(elem, c, view.ComponentType, view.Normalized);
+            }
+        }
+
+        dst[i] = map(v);
     }
 }
 
+void DecodeIndices(const AccessorView& view, std::span<uint32_t> dst, size_t vertex_count) {
+    if (view.Data == nullptr) {
+        // An accessor without a buffer view is zero-initialised.
+        if (!dst.empty() && vertex_count == 0) {
+            throw std::runtime_error("vertex index out of range");
+        }
+        std::fill(dst.begin(), dst.end(), 0u);
+        return;
+    }
+
+    for (size_t i = 0; i < dst.size(); ++i) {
+        const uint8_t* elem = view.Data + i * view.Stride;
+        uint32_t index = 0;
+
+        switch (view.ComponentType) {
+            case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+                index = elem[0];
+                break;
+            case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: {
+                uint16_t raw;
+                std::memcpy(&raw, elem, sizeof(raw));
+                index = raw;
+                break;
+            }
+            case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+                std::memcpy(&index, elem, sizeof(index));
+                break;
+            default:
+                throw std::runtime_error("unsupported index component type " + std::to_string(view.ComponentType));
+        }
+
+        if (index >= vertex_count) {
+            throw std::runtime_error("vertex index out of range");
+        }
+        dst[i] = index;
+    }
+}
+
+glm::mat4 NodeTransform(const tinygltf::Node& node) {
+    if (node.matrix.size() == 16) {
+        glm::dmat4 m = glm::make_mat4(node.matrix.data());
+        return glm::mat4(m);
+    }
+
+    glm::mat4 xform(1.0f);
+    if (node.translation.size() == 3) {
+        xform = glm::translate(xform, glm::vec3(node.translation[0], node.translation[1], node.translation[2]));
+    }
+    if (node.rotation.size() == 4) {
+        glm::quat rotation(static_cast<float>(node.rotation[3]), static_cast<float>(node.rotation[0]),
+                           static_cast<float>(node.rotation[1]), static_cast<float>(node.rotation[2]));
+        xform = xform * glm::mat4_cast(rotation);
+    }
+    if (node.scale.size() == 3) {
+        xform = glm::scale(xform, glm::vec3(node.scale[0], node.scale[1], node.scale[2]));
+    }
+    return xform;
+}
+
+// KHR_texture_transform as a row-major 2x2 rotation-scale followed by the offset.
+std::array<float, 6> TextureTransform(const tinygltf::ExtensionMap& extensions) {
+    std::array<float, 6> result = {1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f};
+
+    auto it = extensions.find("KHR_texture_transform");
+    if (it == extensions.end()) {
+        return result;
+    }
+    const auto& ext = it->second;
+
+    auto read_vec2 = [&](const char* key, glm::vec2 fallback) {
+        if (!ext.Has(key)) {
+            return fallback;
+        }
+        const auto& v = ext.Get(key);
+        if (!v.IsArray() || v.ArrayLen() != 2) {
+            return fallback;
+        }
+        return glm::vec2(v.Get(0).GetNumberAsDouble(), v.Get(1).GetNumberAsDouble());
+    };
+
+    glm::vec2 offset = read_vec2("offset", glm::vec2(0.0f));
+    glm::vec2 scale = read_vec2("scale", glm::vec2(1.0f));
+    float rotation = ext.Has("rotation") ? static_cast<float>(ext.Get("rotation").GetNumberAsDouble()) : 0.0f;
+
+    float c = std::cos(rotation);
+    float s = std::sin(rotation);
+    result = {scale.x * c, scale.y * s, -scale.x * s, scale.y * c, offset.x, offset.y};
+    return result;
+}
+
+bool KeepEncodedImage(tinygltf::Image* image, const int /*image_idx*/, std::string* /*err*/, std::string* /*warn*/,
+                      int /*req_width*/, int /*req_height*/, const unsigned char* bytes, int size, void* /*user_data*/) {
+    image->image.assign(bytes, bytes + size);
+    image->as_is = true;
+    return true;
+}
+
+class GltfMaterialLoader {
+public:
+    GltfMaterialLoader(const tinygltf::Model& model, std::filesystem::path base_dir)
+        : model_(model), base_dir_(std::move(base_dir)), images_(model.images.size()) {}
+
+    // Appends the material and its four maps (normal, spec, albedo, emissive) to `mesh`.
+    void Load(const tinygltf::Material* mat, TriangleMesh& mesh) {
+        uint32_t map_base = static_cast<uint32_t>(mesh.Maps.size());
+
+        MeshMaterial material{};
+        material.BaseColorMult = {1.0f, 1.0f, 1.0f, 1.0f};
+        material.Maps = {map_base + 0, map_base + 1, map_base + 2, map_base + 3};
+        material.RoughnessMult = 1.0f;
+        material.MetalnessFactor = 1.0f;
+        material.Emissive = {0.0f, 0.0f, 0.0f};
+        material.Flags = 0;
+        for (auto& xform : material.MapTransforms) {
+            xform = {1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f};
+        }
+
+        TexParams normal_params;
+        normal_params.gamma = TexGamma::Linear;
+        normal_params.srgb = false;
+        normal_params.Compression = TexCompressionMode::Rg;
+
+        TexParams spec_params;
+        spec_params.gamma = TexGamma::Linear;
+        spec_params.srgb = false;
+        spec_params.Compression = TexCompressionMode::Rg;
+        spec_params.ChannelSwizzle = std::array<size_t, 4>{1, 2, 0, 3};
+
+        TexParams albedo_params;
+        albedo_params.gamma = TexGamma::Srgb;
+        albedo_params.srgb = true;
+        albedo_params.Compression = TexCompressionMode::Rgba;
+
+        TexParams emissive_params = albedo_params;
+
+        if (mat == nullptr) {
+            mesh.Maps.push_back(MeshMaterialMap::CreatePlaceholder({127, 127, 255, 255}));
+            mesh.Maps.push_back(MeshMaterialMap::CreatePlaceholder({255, 255, 255, 255}));
+            mesh.Maps.push_back(MeshMaterialMap::CreatePlaceholder({255, 255, 255, 255}));
+            mesh.Maps.push_back(MeshMaterialMap::CreatePlaceholder({0, 0, 0, 255}));
+            mesh.Materials.push_back(material);
+            return;
+        }
+
+        const auto& pbr = mat->pbrMetallicRoughness;
+        for (size_t i = 0; i < 4 && i < pbr.baseColorFactor.size(); ++i) {
+            material.BaseColorMult[i] = static_cast<float>(pbr.baseColorFactor[i]);
+        }
+        material.RoughnessMult = static_cast<float>(pbr.roughnessFactor);
+        material.MetalnessFactor = static_cast<float>(pbr.metallicFactor);
+        for (size_t i = 0; i < 3 && i < mat->emissiveFactor.size(); ++i) {
+            material.Emissive[i] = static_cast<float>(mat->emissiveFactor[i]);
+        }
+
+        mesh.Maps.push_back(MakeMap(mat->normalTexture.index, normal_params, {127, 127, 255, 255}));
+        mesh.Maps.push_back(MakeMap(pbr.metallicRoughnessTexture.index, spec_params, {255, 255, 255, 255}));
+        mesh.Maps.push_back(MakeMap(pbr.baseColorTexture.index, albedo_params, {255, 255, 255, 255}));
+        mesh.Maps.push_back(MakeMap(mat->emissiveTexture.index, emissive_params, {255, 255, 255, 255}));
+
+        material.MapTransforms[0] = TextureTransform(mat->normalTexture.extensions);
+        material.MapTransforms[1] = TextureTransform(pbr.metallicRoughnessTexture.extensions);
+        material.MapTransforms[2] = TextureTransform(pbr.baseColorTexture.extensions);
+        material.MapTransforms[3] = TextureTransform(mat->emissiveTexture.extensions);
+
+        mesh.Materials.push_back(material);
+    }
+
+private:
+    MeshMaterialMap MakeMap(int texture_idx, TexParams params, std::array<uint8_t, 4> placeholder) {
+        if (texture_idx < 0 || static_cast<size_t>(texture_idx) >= model_.textures.size()) {
+            return MeshMaterialMap::CreatePlaceholder(placeholder);
+        }
+
+        int image_idx = model_.textures[texture_idx].source;
+        if (image_idx < 0 || static_cast<size_t>(image_idx) >= model_.images.size()) {
+            return MeshMaterialMap::CreatePlaceholder(placeholder);
+        }
+
+        return MeshMaterialMap::CreateImage(GetImageSource(static_cast<size_t>(image_idx)), params);
+    }
+
+    // One source per glTF image, shared by every map that references it.
+    std::shared_ptr<const ImageSource> GetImageSource(size_t image_idx) {
+        auto& source = images_[image_idx];
+        if (!source) {
+            const auto& image = model_.images[image_idx];
+            if (!image.image.empty()) {
+                source = std::make_shared<ImageSource>(std::vector<uint8_t>(image.image.begin(), image.image.end()));
+            } else {
+                source = std::make_shared<ImageSource>(base_dir_ / image.uri);
+            }
+        }
+        return source;
+    }
+
+    const tinygltf::Model& model_;
+    std::filesystem::path base_dir_;
+    std::vector<std::shared_ptr<const ImageSource>> images_;
+};
+
+// One triangle primitive of one node instance, with its destination ranges in the output mesh.
+struct PrimitiveJob {
+    const tinygltf::Primitive* Prim;
+    glm::mat4 Xform;
+    uint32_t MaterialId;
+    size_t VertexBase;
+    size_t VertexCount;
+    size_t IndexBase;
+    size_t IndexCount;
+};
+
+void DecodePrimitive(const tinygltf::Model& model, const PrimitiveJob& job, TriangleMesh& mesh) {
+    const auto& attributes = job.Prim->attributes;
+    auto attribute = [&](const char* name) {
+        auto it = attributes.find(name);
+        return it == attributes.end() ? -1 : it->second;
+    };
+    // Every attribute is decoded for all of the primitive's vertices, so a shorter one would
+    // read past its buffer.
+    auto view_attribute = [&](int accessor_idx, const char* name) {
+        AccessorView view = ViewAccessor(model, accessor_idx);
+        if (view.Count < job.VertexCount) {
+            throw std::runtime_error(std::string(name) + " accessor has " + std::to_string(view.Count) +
+                                     " elements for " + std::to_string(job.VertexCount) + " vertices");
+        }
+        return view;
+    };
+
+    bool flip_winding_order = glm::determinant(job.Xform) < 0.0f;
+    glm::mat3 normal_xform = glm::transpose(glm::inverse(glm::mat3(job.Xform)));
+    glm::mat3 tangent_xform = glm::mat3(job.Xform);
+
+    auto positions = std::span(mesh.Positions).subspan(job.VertexBase, job.VertexCount);
+    auto normals = std::span(mesh.Normals).subspan(job.VertexBase, job.VertexCount);
+    auto tangents = std::span(mesh.Tangents).subspan(job.VertexBase, job.VertexCount);
+    auto uvs = std::span(mesh.Uvs).subspan(job.VertexBase, job.VertexCount);
+    auto colors = std::span(mesh.Colors).subspan(job.VertexBase, job.VertexCount);
+    auto material_ids = std::span(mesh.MaterialIds).subspan(job.VertexBase, job.VertexCount);
+    auto indices = std::span(mesh.Indices).subspan(job.IndexBase, job.IndexCount);
+
+    DecodeAccessor<3>(view_attribute(attribute("POSITION"), "POSITION"), positions, {0.0f, 0.0f, 0.0f},
+                      [&](const std::array<float, 3>& v) {
+                          glm::vec3 p = glm::vec3(job.Xform * glm::vec4(v[0], v[1], v[2], 1.0f));
+                          return std::array<float, 3>{p.x, p.y, p.z};
+                      });
+
+    DecodeAccessor<3>(view_attribute(attribute("NORMAL"), "NORMAL"), normals, {0.0f, 0.0f, 1.0f},
+                      [&](const std::array<float, 3>& v) {
+                          glm::vec3 n = normal_xform * glm::vec3(v[0], v[1], v[2]);
+                          float len = glm::length(n);
+                          n = len > 0.0f ? n / len : glm::vec3(0.0f, 0.0f, 1.0f);
+                          return std::array<float, 3>{n.x, n.y, n.z};
+                      });
+
+    int uv_accessor = attribute("TEXCOORD_0");
+    if (uv_accessor >= 0) {
+        DecodeAccessor<2>(view_attribute(uv_accessor, "TEXCOORD_0"), uvs, {0.0f, 0.0f},
+                          [](const std::array<float, 2>& v) { return v; });
+    } else {
+        std::fill(uvs.begin(), uvs.end(), std::array<float, 2>{0.0f, 0.0f});
+    }
+
+    int color_accessor = attribute("COLOR_0");
+    if (color_accessor >= 0) {
+        DecodeAccessor<4>(view_attribute(color_accessor, "COLOR_0"), colors, {1.0f, 1.0f, 1.0f, 1.0f},
+                          [](const std::array<float, 4>& v) { return v; });
+    } else {
+        std::fill(colors.begin(), colors.end(), std::array<float, 4>{1.0f, 1.0f, 1.0f, 1.0f});
+    }
+
+    std::fill(material_ids.begin(), material_ids.end(), job.MaterialId);
+
+    if (job.Prim->indices >= 0) {
+        DecodeIndices(ViewAccessor(model, job.Prim->indices), indices, job.VertexCount);
+    } else {
+        std::iota(indices.begin(), indices.end(), 0u);
+    }
+
+    if (flip_winding_order) {
+        for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+            std::swap(indices[i], indices[i + 2]);
+        }
+    }
+
+    int tangent_accessor = attribute("TANGENT");
+    if (tangent_accessor >= 0) {
+        float handedness = flip_winding_order ? -1.0f : 1.0f;
+        DecodeAccessor<4>(view_attribute(tangent_accessor, "TANGENT"), tangents, {1.0f, 0.0f, 0.0f, 1.0f},
+                          [&](const std::array<float, 4>& v) {
+                              glm::vec3 t = tangent_xform * glm::vec3(v[0], v[1], v[2]);
+                              float len = glm::length(t);
+                              t = len > 0.0f ? t / len : glm::vec3(1.0f, 0.0f, 0.0f);
+                              return std::array<float, 4>{t.x, t.y, t.z, v[3] * handedness};
+                          });
+    } else if (uv_accessor >= 0) {
+        // Generated in world space, after the winding fixup, so no handedness correction is needed.
+        TangentCalcContext ctx{indices, positions, normals, uvs, tangents};
+        ctx.GenerateTangents();
+    } else {
+        std::fill(tangents.begin(), tangents.end(), std::array<float, 4>{1.0f, 0.0f, 0.0f, 1.0f});
+    }
+
+    uint32_t base_vertex = static_cast<uint32_t>(job.VertexBase);
+    for (auto& index : indices) {
+        index += base_vertex;
+    }
+}
+
+// Primitive jobs of one output mesh and the stream sizes they add up to.
+struct MeshJobs {
+    std::vector<PrimitiveJob> Jobs;
+    size_t VertexCount = 0;
+    size_t IndexCount = 0;
+};
+
+// Appends a job for every triangle primitive of glTF mesh `mesh_idx` placed by `xform`.
+// Primitives without a valid material get index `model.materials.size()`, the default material.
+void AppendMeshJobs(const tinygltf::Model& model, int mesh_idx, const glm::mat4& xform, MeshJobs& out,
+                    bool& needs_default_material) {
+    for (const auto& prim : model.meshes.at(mesh_idx).primitives) {
+        if (prim.mode != -1 && prim.mode != TINYGLTF_MODE_TRIANGLES) {
+            continue;
+        }
+
+        auto position = prim.attributes.find("POSITION");
+        if (position == prim.attributes.end() || prim.attributes.find("NORMAL") == prim.attributes.end()) {
+            continue;
+        }
+
+        size_t prim_vertex_count = model.accessors.at(position->second).count;
+        size_t prim_index_count = prim.indices >= 0 ? model.accessors.at(prim.indices).count : prim_vertex_count;
+        prim_index_count -= prim_index_count % 3;
+
+        uint32_t material_id = static_cast<uint32_t>(model.materials.size());
+        if (prim.material >= 0 && static_cast<size_t>(prim.material) < model.materials.size()) {
+            material_id = static_cast<uint32_t>(prim.material);
+        } else {
+            needs_default_material = true;
+        }
+
+        out.Jobs.push_back(PrimitiveJob{&prim, xform, material_id, out.VertexCount, prim_vertex_count, out.IndexCount, prim_index_count});
+        out.VertexCount += prim_vertex_count;
+        out.IndexCount += prim_index_count;
+    }
+}
+
+tinygltf::Model LoadGltfModel(const std::string& path) {
+    tinygltf::TinyGLTF loader;
+    loader.SetImageLoader(KeepEncodedImage, nullptr);
+
+    tinygltf::Model model;
+    std::string err;
+    std::string warn;
+
+    bool loaded = std::filesystem::path(path).extension() == ".glb"
+        ? loader.LoadBinaryFromFile(&model, &err, &warn, path)
+        : loader.LoadASCIIFromFile(&model, &err, &warn, path);
+    if (!loaded) {
+        throw std::runtime_error(err.empty() ? "unknown glTF parse error" : err);
+    }
+    if (model.scenes.empty()) {
+        throw std::runtime_error("no scenes found");
+    }
+    return model;
+}
+
+// Calls `fn(mesh_idx, xform)` for every node of the default scene that has a mesh.
+template<typename F>
+void VisitMeshNodes(const tinygltf::Model& model, const glm::mat4& root_xform, F&& fn) {
+    const auto& scene = model.scenes[model.defaultScene >= 0 ? model.defaultScene : 0];
+
+    auto visit = [&](auto& self, int node_idx, const glm::mat4& parent_xform) -> void {
+        const auto& node = model.nodes.at(node_idx);
+        glm::mat4 xform = parent_xform * NodeTransform(node);
+
+        if (node.mesh >= 0) {
+            fn(node.mesh, xform);
+        }
+        for (int child : node.children) {
+            self(self, child, xform);
+        }
+    };
+
+    for (int node_idx : scene.nodes) {
+        visit(visit, node_idx, root_xform);
+    }
+}
+
+void ResizeStreams(TriangleMesh& mesh, size_t vertex_count, size_t index_count) {
+    if (vertex_count > std::numeric_limits<uint32_t>::max()) {
+        throw std::runtime_error("mesh exceeds 2^32 vertices");
+    }
+
+    mesh.Positions.resize(vertex_count);
+    mesh.Normals.resize(vertex_count);
+    mesh.Colors.resize(vertex_count);
+    mesh.Uvs.resize(vertex_count);
+    mesh.Tangents.resize(vertex_count);
+    mesh.MaterialIds.resize(vertex_count);
+    mesh.Indices.resize(index_count);
+}
+
+// Decodes every job into its mesh in parallel, each into its own disjoint range.
+void DecodePrimitives(const tinygltf::Model& model, const std::vector<std::pair<const PrimitiveJob*, TriangleMesh*>>& work) {
+    // Largest primitives first, so a single huge one doesn't end up last on a busy pool.
+    std::vector<size_t> order(work.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        const auto& ja = *work[a].first;
+        const auto& jb = *work[b].first;
+        return ja.VertexCount + ja.IndexCount > jb.VertexCount + jb.IndexCount;
+    });
+
+    tekki::core::ParallelFor(order.size(), [&](size_t i) {
+        DecodePrimitive(model, *work[order[i]].first, *work[order[i]].second);
+    });
+}
+
+// Gives `mesh` its own copy of the materials it uses out of `library`, renumbered in order of
+// first use, with their maps; `jobs` are rewritten to the local material indices.
+void LocalizeMaterials(const TriangleMesh& library, std::vector<PrimitiveJob>& jobs, TriangleMesh& mesh) {
+    std::unordered_map<uint32_t, uint32_t> local_ids;
+    for (auto& job : jobs) {
+        auto [it, inserted] = local_ids.emplace(job.MaterialId, static_cast<uint32_t>(mesh.Materials.size()));
+        if (inserted) {
+            MeshMaterial material = library.Materials.at(job.MaterialId);
+            for (auto& map : material.Maps) {
+                mesh.Maps.push_back(library.Maps.at(map));
+                map = static_cast<uint32_t>(mesh.Maps.size() - 1);
+            }
+            mesh.Materials.push_back(material);
+        }
+        job.MaterialId = it->second;
+    }
+}
+
+template<typename T>
+void HashStream(uint64_t& hash, const std::vector<T>& stream) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    hash = (hash ^ stream.size()) * 0x100000001b3ull;
+    const auto* bytes = reinterpret_cast<const uint8_t*>(stream.data());
+    for (size_t i = 0; i < stream.size() * sizeof(T); ++i) {
+        hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+    }
+}
+
+template<typename T>
+bool SameStream(const std::vector<T>& a, const std::vector<T>& b) {
+    return a.size() == b.size() && (a.empty() || std::memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0);
+}
+
+uint64_t HashMeshContent(const TriangleMesh& mesh) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    HashStream(hash, mesh.Positions);
+    HashStream(hash, mesh.Normals);
+    HashStream(hash, mesh.Colors);
+    HashStream(hash, mesh.Uvs);
+    HashStream(hash, mesh.Tangents);
+    HashStream(hash, mesh.MaterialIds);
+    HashStream(hash, mesh.Indices);
+    HashStream(hash, mesh.Materials);
+    return hash;
+}
+
+// Bitwise-equal streams and materials, and maps of the same images or placeholder values.
+bool SameMeshContent(const TriangleMesh& a, const TriangleMesh& b) {
+    if (!SameStream(a.Positions, b.Positions) || !SameStream(a.Normals, b.Normals) || !SameStream(a.Colors, b.Colors) ||
+        !SameStream(a.Uvs, b.Uvs) || !SameStream(a.Tangents, b.Tangents) || !SameStream(a.MaterialIds, b.MaterialIds) ||
+        !SameStream(a.Indices, b.Indices) || !SameStream(a.Materials, b.Materials) || a.Maps.size() != b.Maps.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.Maps.size(); ++i) {
+        const auto& ma = a.Maps[i];
+        const auto& mb = b.Maps[i];
+        if (ma.GetType() != mb.GetType()) {
+            return false;
+        }
+        // Map params only depend on the map's slot in its material, which the materials pin down.
+        bool same = ma.GetType() == MeshMaterialMap::Type::Image
+            ? ma.GetImageData().Source == mb.GetImageData().Source
+            : ma.GetPlaceholderValues() == mb.GetPlaceholderValues();
+        if (!same) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
 TriangleMesh LoadGltfScene::Run() {
     TriangleMesh result;
-    
+
     try {
-        // GLTF loading implementation would go here
-        // This is a placeholder for the actual implementation
-        
-        // For now, return an empty mesh since we don't have the GLTF loading infrastructure
-        // In a real implementation, this would load the GLTF file, parse nodes, materials,
-        // and populate the TriangleMesh structure
-        
+        tinygltf::Model model = LoadGltfModel(Path);
+
+        // Materials are shared by every primitive that references them; index `materials.size()`
+        // is the default material for primitives without one.
+        GltfMaterialLoader material_loader(model, std::filesystem::path(Path).parent_path());
+        for (const auto& mat : model.materials) {
+            material_loader.Load(&mat, result);
+        }
+        bool needs_default_material = false;
+
+        // Walk the node tree serially to size every output stream; the accessors themselves are
+        // decoded afterwards in parallel, each primitive into its own disjoint range.
+        MeshJobs jobs;
+        glm::mat4 root_xform = glm::mat4_cast(Rotation) * glm::scale(glm::mat4(1.0f), glm::vec3(Scale));
+        VisitMeshNodes(model, root_xform, [&](int mesh_idx, const glm::mat4& xform) {
+            AppendMeshJobs(model, mesh_idx, xform, jobs, needs_default_material);
+        });
+
+        if (needs_default_material) {
+            material_loader.Load(nullptr, result);
+        }
+
+        ResizeStreams(result, jobs.VertexCount, jobs.IndexCount);
+
+        std::vector<std::pair<const PrimitiveJob*, TriangleMesh*>> work;
+        for (const auto& job : jobs.Jobs) {
+            work.emplace_back(&job, &result);
+        }
+        DecodePrimitives(model, work);
+
     } catch (const std::exception& e) {
         throw std::runtime_error("Failed to load GLTF scene from " + Path + ": " + std::string(e.what()));
     }
-    
+
+    return result;
+}
+
+InstancedTriangleScene LoadGltfScene::RunInstanced() {
+    InstancedTriangleScene result;
+
+    try {
+        tinygltf::Model model = LoadGltfModel(Path);
+
+        TriangleMesh library;
+        GltfMaterialLoader material_loader(model, std::filesystem::path(Path).parent_path());
+        for (const auto& mat : model.materials) {
+            material_loader.Load(&mat, library);
+        }
+        bool needs_default_material = false;
+
+        // Each glTF mesh is decoded once, untransformed; the root scale and rotation go into the
+        // instance transforms along with the node hierarchy.
+        constexpr uint32_t NO_MESH = std::numeric_limits<uint32_t>::max();
+        std::vector<uint32_t> mesh_slots(model.meshes.size(), NO_MESH);
+        std::vector<MeshJobs> mesh_jobs;
+        std::vector<std::pair<uint32_t, glm::mat4>> placements;
+
+        glm::mat4 root_xform = glm::mat4_cast(Rotation) * glm::scale(glm::mat4(1.0f), glm::vec3(Scale));
+        VisitMeshNodes(model, root_xform, [&](int mesh_idx, const glm::mat4& xform) {
+            uint32_t& slot = mesh_slots.at(mesh_idx);
+            if (slot == NO_MESH) {
+                MeshJobs jobs;
+                AppendMeshJobs(model, mesh_idx, glm::mat4(1.0f), jobs, needs_default_material);
+                if (jobs.Jobs.empty()) {
+                    return; // No triangles to place
+                }
+                slot = static_cast<uint32_t>(mesh_jobs.size());
+                mesh_jobs.push_back(std::move(jobs));
+            }
+            placements.emplace_back(slot, xform);
+        });
+
+        if (needs_default_material) {
+            material_loader.Load(nullptr, library);
+        }
+
+        std::vector<TriangleMesh> meshes(mesh_jobs.size());
+        std::vector<std::pair<const PrimitiveJob*, TriangleMesh*>> work;
+        for (size_t m = 0; m < meshes.size(); ++m) {
+            LocalizeMaterials(library, mesh_jobs[m].Jobs, meshes[m]);
+            ResizeStreams(meshes[m], mesh_jobs[m].VertexCount, mesh_jobs[m].IndexCount);
+            for (const auto& job : mesh_jobs[m].Jobs) {
+                work.emplace_back(&job, &meshes[m]);
+            }
+        }
+        DecodePrimitives(model, work);
+
+        // DCC exports often repeat geometry as separate glTF meshes; keep the first of each.
+        std::vector<uint64_t> hashes(meshes.size());
+        tekki::core::ParallelFor(meshes.size(), [&](size_t m) { hashes[m] = HashMeshContent(meshes[m]); });
+
+        std::vector<uint32_t> unique_index(meshes.size());
+        std::unordered_map<uint64_t, std::vector<uint32_t>> by_hash;
+        for (uint32_t m = 0; m < meshes.size(); ++m) {
+            auto& candidates = by_hash[hashes[m]];
+            auto same = std::find_if(candidates.begin(), candidates.end(), [&](uint32_t c) {
+                return SameMeshContent(result.Meshes[c], meshes[m]);
+            });
+            if (same != candidates.end()) {
+                unique_index[m] = *same;
+                result.DuplicateMeshes++;
+                continue;
+            }
+            unique_index[m] = static_cast<uint32_t>(result.Meshes.size());
+            candidates.push_back(unique_index[m]);
+            result.Meshes.push_back(std::move(meshes[m]));
+        }
+
+        result.Instances.reserve(placements.size());
+        for (const auto& [slot, xform] : placements) {
+            SceneInstance instance{unique_index[slot], 0, {}};
+            for (int row = 0; row < 3; ++row) {
+                for (int col = 0; col < 4; ++col) {
+                    instance.Transform[row * 4 + col] = xform[col][row];
+                }
+            }
+            result.Instances.push_back(instance);
+        }
+
+    } catch (const std::exception& e) {
+        throw std::runtime_error("Failed to load GLTF scene from " + Path + ": " + std::string(e.what()));
+    }
+
     return result;
 }
 
-} // namespace tekki::asset
\ No newline at end of file
+} // namespace tekki::asset
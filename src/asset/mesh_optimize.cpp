@@ -0,0 +1,482 @@
+#include "tekki/asset/mesh_optimize.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace tekki::asset {
+
+namespace {
+
+// Empty streams are absent and match everywhere.
+template<typename T>
+bool SameElement(const std::vector<T>& stream, uint32_t a, uint32_t b) {
+    return stream.empty() || std::memcmp(&stream[a], &stream[b], sizeof(T)) == 0;
+}
+
+template<size_t N>
+bool NearElement(const std::vector<std::array<float, N>>& stream, uint32_t a, uint32_t b, float epsilon) {
+    if (stream.empty()) {
+        return true;
+    }
+    for (size_t c = 0; c < N; ++c) {
+        if (!(std::abs(stream[a][c] - stream[b][c]) <= epsilon)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// FNV-1a over the element's bytes.
+template<typename T>
+void HashElement(uint64_t& hash, const std::vector<T>& stream, uint32_t v) {
+    if (stream.empty()) {
+        return;
+    }
+    const auto* bytes = reinterpret_cast<const uint8_t*>(&stream[v]);
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+    }
+}
+
+// Keeps the elements of the vertices that head their weld group, in order.
+template<typename T>
+void KeepGroupHeads(std::vector<T>& stream, std::span<const uint32_t> group, size_t unique_count) {
+    if (stream.empty()) {
+        return;
+    }
+    std::vector<T> kept;
+    kept.reserve(unique_count);
+    for (size_t v = 0; v < stream.size(); ++v) {
+        if (group[v] == v) {
+            kept.push_back(stream[v]);
+        }
+    }
+    stream = std::move(kept);
+}
+
+} // namespace
+
+VertexCacheStats AnalyzeVertexCache(std::span<const uint32_t> indices, size_t vertex_count, uint32_t cache_size) {
+    VertexCacheStats stats;
+    stats.Triangles = indices.size() / 3;
+
+    // FIFO simulated with insertion timestamps: a vertex is resident if fewer than `cache_size`
+    // misses have happened since it was inserted.
+    std::vector<uint64_t> inserted_at(vertex_count, 0);
+    std::vector<bool> referenced(vertex_count, false);
+    uint64_t misses = 0;
+
+    for (uint32_t v : indices) {
+        if (v >= vertex_count) {
+            throw std::runtime_error("AnalyzeVertexCache: vertex index out of range");
+        }
+
+        if (!referenced[v]) {
+            referenced[v] = true;
+            stats.ReferencedVertices++;
+        }
+
+        if (inserted_at[v] == 0 || misses - inserted_at[v] >= cache_size) {
+            misses++;
+            inserted_at[v] = misses;
+        }
+    }
+
+    stats.TransformedVertices = static_cast<size_t>(misses);
+    return stats;
+}
+
+std::vector<uint32_t> OptimizeVertexCache(std::span<const uint32_t> indices, size_t vertex_count, uint32_t cache_size) {
+    size_t triangle_count = indices.size() / 3;
+    std::vector<uint32_t> result;
+    result.reserve(triangle_count * 3);
+
+    if (triangle_count == 0) {
+        return result;
+    }
+    if (vertex_count > std::numeric_limits<int64_t>::max() || triangle_count > std::numeric_limits<uint32_t>::max()) {
+        throw std::runtime_error("OptimizeVertexCache: mesh too large");
+    }
+
+    // Per-vertex state only needs to cover the vertices the indices span, which keeps calls on
+    // one material's slice of a large mesh cheap. Shifting preserves the order, so the result
+    // is the same.
+    auto used = indices.first(triangle_count * 3);
+    auto [lowest, highest] = std::minmax_element(used.begin(), used.end());
+    if (*highest >= vertex_count) {
+        throw std::runtime_error("OptimizeVertexCache: vertex index out of range");
+    }
+    if (*lowest > 0 || *highest + 1 < vertex_count) {
+        uint32_t base = *lowest;
+        std::vector<uint32_t> local(used.begin(), used.end());
+        for (uint32_t& index : local) {
+            index -= base;
+        }
+        result = OptimizeVertexCache(local, *highest - base + 1, cache_size);
+        for (uint32_t& index : result) {
+            index += base;
+        }
+        return result;
+    }
+
+    // Vertex -> triangle adjacency, and the number of not yet emitted triangles per vertex.
+    std::vector<uint32_t> live(vertex_count, 0);
+    for (size_t i = 0; i < triangle_count * 3; ++i) {
+        if (indices[i] >= vertex_count) {
+            throw std::runtime_error("OptimizeVertexCache: vertex index out of range");
+        }
+        live[indices[i]]++;
+    }
+
+    std::vector<size_t> adjacency_offsets(vertex_count + 1, 0);
+    for (size_t v = 0; v < vertex_count; ++v) {
+        adjacency_offsets[v + 1] = adjacency_offsets[v] + live[v];
+    }
+
+    std::vector<uint32_t> adjacency(triangle_count * 3);
+    {
+        std::vector<size_t> cursor(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+        for (size_t i = 0; i < triangle_count * 3; ++i) {
+            adjacency[cursor[indices[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+    }
+
+    std::vector<uint64_t> cache_time(vertex_count, 0);
+    std::vector<bool> emitted(triangle_count, false);
+    std::vector<uint32_t> dead_end;
+    std::vector<uint32_t> candidates;
+
+    uint64_t time = cache_size + 1;
+    size_t scan_cursor = 0;
+    int64_t fanning = 0;
+
+    auto skip_dead_end = [&]() -> int64_t {
+        while (!dead_end.empty()) {
+            uint32_t v = dead_end.back();
+            dead_end.pop_back();
+            if (live[v] > 0) {
+                return v;
+            }
+        }
+        for (; scan_cursor < vertex_count; ++scan_cursor) {
+            if (live[scan_cursor] > 0) {
+                return static_cast<int64_t>(scan_cursor);
+            }
+        }
+        return -1;
+    };
+
+    while (fanning >= 0) {
+        candidates.clear();
+
+        size_t f = static_cast<size_t>(fanning);
+        for (size_t a = adjacency_offsets[f]; a < adjacency_offsets[f + 1]; ++a) {
+            uint32_t tri = adjacency[a];
+            if (emitted[tri]) {
+                continue;
+            }
+
+            for (size_t c = 0; c < 3; ++c) {
+                uint32_t v = indices[tri * 3 + c];
+                result.push_back(v);
+                dead_end.push_back(v);
+                candidates.push_back(v);
+                live[v]--;
+                if (time - cache_time[v] > cache_size) {
+                    cache_time[v] = time++;
+                }
+            }
+            emitted[tri] = true;
+        }
+
+        // Next fanning vertex: the candidate that stays in cache longest while it still has
+        // triangles left, otherwise fall back to the dead-end stack or a linear scan.
+        int64_t best = -1;
+        int64_t best_priority = -1;
+        for (uint32_t v : candidates) {
+            if (live[v] == 0) {
+                continue;
+            }
+            int64_t priority = 0;
+            if (time - cache_time[v] + 2 * uint64_t(live[v]) <= cache_size) {
+                priority = static_cast<int64_t>(time - cache_time[v]);
+            }
+            if (priority > best_priority) {
+                best_priority = priority;
+                best = v;
+            }
+        }
+
+        fanning = best >= 0 ? best : skip_dead_end();
+    }
+
+    return result;
+}
+
+std::vector<uint32_t> OptimizeVertexFetch(std::span<uint32_t> indices, size_t vertex_count) {
+    constexpr uint32_t UNASSIGNED = std::numeric_limits<uint32_t>::max();
+    if (vertex_count >= UNASSIGNED) {
+        throw std::runtime_error("OptimizeVertexFetch: too many vertices");
+    }
+
+    std::vector<uint32_t> remap(vertex_count, UNASSIGNED);
+    uint32_t next = 0;
+
+    for (uint32_t& index : indices) {
+        if (index >= vertex_count) {
+            throw std::runtime_error("OptimizeVertexFetch: vertex index out of range");
+        }
+        if (remap[index] == UNASSIGNED) {
+            remap[index] = next++;
+        }
+        index = remap[index];
+    }
+
+    for (auto& target : remap) {
+        if (target == UNASSIGNED) {
+            target = next++;
+        }
+    }
+
+    return remap;
+}
+
+WeldStats WeldVertices(PackedTriangleMesh& mesh, float epsilon) {
+    constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+    const size_t vertex_count = mesh.Verts.size();
+
+    if (!(epsilon >= 0.0f)) {
+        throw std::runtime_error("WeldVertices: epsilon must not be negative");
+    }
+    if (vertex_count >= NONE) {
+        throw std::runtime_error("WeldVertices: too many vertices");
+    }
+    if (mesh.Indices.size() % 3 != 0) {
+        throw std::runtime_error("WeldVertices: index count is not a multiple of 3");
+    }
+    auto check_stream = [&](size_t size, const char* name) {
+        if (size != 0 && size != vertex_count) {
+            throw std::runtime_error(std::string("WeldVertices: ") + name + " stream does not match the vertex count");
+        }
+    };
+    check_stream(mesh.Uvs.size(), "UV");
+    check_stream(mesh.Tangents.size(), "tangent");
+    check_stream(mesh.Colors.size(), "color");
+    check_stream(mesh.MaterialIds.size(), "material");
+    if (!mesh.Meshlets.empty() || !mesh.Lods.empty() || !mesh.QuantizedVerts.empty()) {
+        throw std::runtime_error("WeldVertices: meshlets, LODs and quantised streams must be built after welding");
+    }
+
+    WeldStats stats;
+    stats.Vertices = vertex_count;
+
+    // First vertex of the group each vertex welds into; always at or before the vertex itself.
+    std::vector<uint32_t> group(vertex_count);
+
+    if (epsilon == 0.0f) {
+        // Exact matches: open-addressed table of group heads keyed by a hash of every attribute.
+        auto same = [&](uint32_t a, uint32_t b) {
+            return SameElement(mesh.Verts, a, b) && SameElement(mesh.Uvs, a, b) && SameElement(mesh.Tangents, a, b) &&
+                   SameElement(mesh.Colors, a, b) && SameElement(mesh.MaterialIds, a, b);
+        };
+
+        size_t capacity = 1;
+        while (capacity < vertex_count * 2) {
+            capacity *= 2;
+        }
+        const size_t mask = capacity - 1;
+        std::vector<uint32_t> table(capacity, NONE);
+
+        for (uint32_t v = 0; v < vertex_count; ++v) {
+            uint64_t hash = 0xcbf29ce484222325ull;
+            HashElement(hash, mesh.Verts, v);
+            HashElement(hash, mesh.Uvs, v);
+            HashElement(hash, mesh.Tangents, v);
+            HashElement(hash, mesh.Colors, v);
+            HashElement(hash, mesh.MaterialIds, v);
+
+            // Triangular probing visits every slot of a power-of-two table.
+            for (size_t slot = hash & mask, step = 1;; slot = (slot + step++) & mask) {
+                if (table[slot] == NONE) {
+                    table[slot] = v;
+                    group[v] = v;
+                    break;
+                }
+                if (same(table[slot], v)) {
+                    group[v] = table[slot];
+                    break;
+                }
+            }
+        }
+    } else {
+        // Near matches: group heads bucketed in a grid of `epsilon` cells, so any vertex within
+        // `epsilon` of a head lies in the head's cell or one of its 26 neighbours.
+        auto near = [&](uint32_t a, uint32_t b) {
+            const auto& va = mesh.Verts[a];
+            const auto& vb = mesh.Verts[b];
+            auto na = UnpackUnitDirection11_10_11(va.Normal);
+            auto nb = UnpackUnitDirection11_10_11(vb.Normal);
+            for (size_t c = 0; c < 3; ++c) {
+                if (!(std::abs(va.Pos[c] - vb.Pos[c]) <= epsilon) || !(std::abs(na[c] - nb[c]) <= epsilon)) {
+                    return false;
+                }
+            }
+            return NearElement(mesh.Uvs, a, b, epsilon) && NearElement(mesh.Tangents, a, b, epsilon) &&
+                   NearElement(mesh.Colors, a, b, epsilon) && SameElement(mesh.MaterialIds, a, b);
+        };
+
+        using Cell = std::array<int64_t, 3>;
+        struct CellHash {
+            size_t operator()(const Cell& cell) const {
+                return static_cast<size_t>((cell[0] * 73856093) ^ (cell[1] * 19349663) ^ (cell[2] * 83492791));
+            }
+        };
+        std::unordered_map<Cell, std::vector<uint32_t>, CellHash> grid;
+
+        for (uint32_t v = 0; v < vertex_count; ++v) {
+            const auto& pos = mesh.Verts[v].Pos;
+            group[v] = v;
+            if (!std::isfinite(pos[0]) || !std::isfinite(pos[1]) || !std::isfinite(pos[2])) {
+                continue; // Never near anything
+            }
+
+            Cell cell;
+            for (size_t c = 0; c < 3; ++c) {
+                cell[c] = static_cast<int64_t>(std::clamp(std::floor(double(pos[c]) / epsilon), -4.0e18, 4.0e18));
+            }
+
+            uint32_t head = NONE;
+            for (int64_t dz = -1; dz <= 1 && head == NONE; ++dz) {
+                for (int64_t dy = -1; dy <= 1 && head == NONE; ++dy) {
+                    for (int64_t dx = -1; dx <= 1 && head == NONE; ++dx) {
+                        auto it = grid.find(Cell{cell[0] + dx, cell[1] + dy, cell[2] + dz});
+                        if (it == grid.end()) {
+                            continue;
+                        }
+                        for (uint32_t candidate : it->second) {
+                            if (near(candidate, v)) {
+                                head = candidate;
+                                break;
+                            }
+                        }
+                    }
+                }
+            }
+
+            if (head == NONE) {
+                grid[cell].push_back(v);
+            } else {
+                group[v] = head;
+            }
+        }
+    }
+
+    std::vector<uint32_t> remap(vertex_count);
+    uint32_t unique_count = 0;
+    for (uint32_t v = 0; v < vertex_count; ++v) {
+        remap[v] = group[v] == v ? unique_count++ : remap[group[v]];
+    }
+    stats.UniqueVertices = unique_count;
+
+    size_t kept = 0;
+    for (size_t i = 0; i < mesh.Indices.size(); i += 3) {
+        std::array<uint32_t, 3> tri;
+        for (size_t k = 0; k < 3; ++k) {
+            if (mesh.Indices[i + k] >= vertex_count) {
+                throw std::runtime_error("WeldVertices: vertex index out of range");
+            }
+            tri[k] = remap[mesh.Indices[i + k]];
+        }
+        if (tri[0] == tri[1] || tri[1] == tri[2] || tri[0] == tri[2]) {
+            stats.DroppedTriangles++;
+            continue;
+        }
+        std::copy(tri.begin(), tri.end(), mesh.Indices.begin() + kept);
+        kept += 3;
+    }
+    mesh.Indices.resize(kept);
+
+    KeepGroupHeads(mesh.Verts, group, unique_count);
+    KeepGroupHeads(mesh.Uvs, group, unique_count);
+    KeepGroupHeads(mesh.Tangents, group, unique_count);
+    KeepGroupHeads(mesh.Colors, group, unique_count);
+    KeepGroupHeads(mesh.MaterialIds, group, unique_count);
+
+    return stats;
+}
+
+IndexCompactionStats CompactIndices(PackedTriangleMesh& mesh) {
+    if (!mesh.IndexStream.empty()) {
+        throw std::runtime_error("CompactIndices: indices are already quantised");
+    }
+
+    IndexCompactionStats stats;
+    stats.Ranges = mesh.MaterialRanges.size();
+    stats.Bytes = (mesh.Indices.size() + mesh.LodIndices.size()) * sizeof(uint32_t) + mesh.ShortIndices.size() * sizeof(uint16_t);
+
+    // 0xffff stays free, as it restarts strips when primitive restart is on.
+    constexpr uint32_t MAX_SHORT_INDEX = std::numeric_limits<uint16_t>::max() - 1;
+
+    std::vector<uint32_t> indices;
+    std::vector<uint32_t> lod_indices;
+    for (size_t level = 0; level <= mesh.Lods.size(); ++level) {
+        const std::vector<uint32_t>& source = level == 0 ? mesh.Indices : mesh.LodIndices;
+        std::vector<uint32_t>& wide = level == 0 ? indices : lod_indices;
+        size_t first_range = level == 0 ? 0 : mesh.Lods[level - 1].FirstRange;
+        size_t end_range = level < mesh.Lods.size() ? mesh.Lods[level].FirstRange : mesh.MaterialRanges.size();
+        if (first_range > end_range || end_range > mesh.MaterialRanges.size()) {
+            throw std::runtime_error("CompactIndices: LOD material ranges out of order");
+        }
+        size_t level_start = wide.size();
+
+        for (size_t r = first_range; r < end_range; ++r) {
+            MaterialRange& range = mesh.MaterialRanges[r];
+            if (range.IndexSize != sizeof(uint32_t)) {
+                stats.ShortRanges++;
+                continue; // Compacted by an earlier call
+            }
+            if (size_t(range.FirstIndex) + range.IndexCount > source.size()) {
+                throw std::runtime_error("CompactIndices: material range out of bounds");
+            }
+
+            auto range_indices = std::span(source).subspan(range.FirstIndex, range.IndexCount);
+            if (range_indices.empty()) {
+                range.FirstIndex = static_cast<uint32_t>(wide.size());
+                continue;
+            }
+            auto [lowest, highest] = std::minmax_element(range_indices.begin(), range_indices.end());
+            if (*highest - *lowest <= MAX_SHORT_INDEX) {
+                range.BaseVertex = *lowest;
+                range.FirstIndex = static_cast<uint32_t>(mesh.ShortIndices.size());
+                range.IndexSize = sizeof(uint16_t);
+                for (uint32_t index : range_indices) {
+                    mesh.ShortIndices.push_back(static_cast<uint16_t>(index - *lowest));
+                }
+                stats.ShortRanges++;
+            } else {
+                range.FirstIndex = static_cast<uint32_t>(wide.size());
+                wide.insert(wide.end(), range_indices.begin(), range_indices.end());
+            }
+        }
+
+        if (level > 0) {
+            mesh.Lods[level - 1].IndexOffset = static_cast<uint32_t>(level_start);
+            mesh.Lods[level - 1].IndexCount = static_cast<uint32_t>(wide.size() - level_start);
+        }
+    }
+    if (mesh.ShortIndices.size() > std::numeric_limits<uint32_t>::max()) {
+        throw std::runtime_error("CompactIndices: too many 16-bit indices");
+    }
+
+    mesh.Indices = std::move(indices);
+    mesh.LodIndices = std::move(lod_indices);
+    stats.CompactBytes = (mesh.Indices.size() + mesh.LodIndices.size()) * sizeof(uint32_t) + mesh.ShortIndices.size() * sizeof(uint16_t);
+    return stats;
+}
+
+} // namespace tekki::asset
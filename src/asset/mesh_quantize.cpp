@@ -0,0 +1,445 @@
+#include "tekki/asset/mesh_quantize.h"
+#include "tekki/core/half.h"
+#include "tekki/core/parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define TEKKI_MESH_QUANTIZE_SSE2 1
+    #include <emmintrin.h>
+#endif
+
+namespace tekki::asset {
+
+namespace {
+
+constexpr size_t VERTICES_PER_TASK = 1 << 16;
+constexpr float POSITION_STEPS = 65535.0f;
+constexpr float NORMAL_STEPS = 127.0f;
+constexpr float TANGENT_STEPS = 32767.0f;
+
+inline float SignNotZero(float v) {
+    return v >= 0.0f ? 1.0f : -1.0f;
+}
+
+// Projects a direction onto the octahedron and unfolds the lower hemisphere; both results in [-1, 1].
+std::array<float, 2> OctahedralWrap(float x, float y, float z) {
+    float l1 = std::abs(x) + std::abs(y) + std::abs(z);
+    if (l1 <= std::numeric_limits<float>::min()) {
+        return {0.0f, 0.0f};
+    }
+
+    float u = x / l1;
+    float v = y / l1;
+    if (z < 0.0f) {
+        float wrapped_u = (1.0f - std::abs(v)) * SignNotZero(u);
+        float wrapped_v = (1.0f - std::abs(u)) * SignNotZero(v);
+        u = wrapped_u;
+        v = wrapped_v;
+    }
+    return {u, v};
+}
+
+std::array<float, 3> OctahedralUnwrap(float u, float v) {
+    float z = 1.0f - std::abs(u) - std::abs(v);
+    if (z < 0.0f) {
+        float unwrapped_u = (1.0f - std::abs(v)) * SignNotZero(u);
+        float unwrapped_v = (1.0f - std::abs(u)) * SignNotZero(v);
+        u = unwrapped_u;
+        v = unwrapped_v;
+    }
+
+    float inv_len = 1.0f / std::sqrt(u * u + v * v + z * z);
+    return {u * inv_len, v * inv_len, z * inv_len};
+}
+
+inline uint16_t PackSnorm8x2(int u, int v) {
+    return static_cast<uint16_t>(static_cast<uint8_t>(static_cast<int8_t>(u)) |
+                                 (static_cast<uint8_t>(static_cast<int8_t>(v)) << 8));
+}
+
+float AngleDegrees(const float* a, const float* b) {
+    double dot = 0.0, len_a = 0.0, len_b = 0.0;
+    for (int c = 0; c < 3; ++c) {
+        dot += double(a[c]) * b[c];
+        len_a += double(a[c]) * a[c];
+        len_b += double(b[c]) * b[c];
+    }
+    if (len_a == 0.0 || len_b == 0.0) {
+        return 0.0f;
+    }
+
+    double cos_angle = std::clamp(dot / std::sqrt(len_a * len_b), -1.0, 1.0);
+    return static_cast<float>(std::acos(cos_angle) * (180.0 / 3.14159265358979323846));
+}
+
+inline uint32_t PackRgba8(const std::array<float, 4>& color) {
+    uint32_t packed = 0;
+    for (int c = 0; c < 4; ++c) {
+        float unorm = std::clamp(color[c], 0.0f, 1.0f) * 255.0f + 0.5f;
+        packed |= static_cast<uint32_t>(unorm) << (c * 8);
+    }
+    return packed;
+}
+
+inline std::array<float, 4> UnpackRgba8(uint32_t packed) {
+    std::array<float, 4> color;
+    for (int c = 0; c < 4; ++c) {
+        color[c] = static_cast<float>((packed >> (c * 8)) & 0xffu) * (1.0f / 255.0f);
+    }
+    return color;
+}
+
+inline uint32_t PackHalf2(const std::array<float, 2>& uv) {
+    return static_cast<uint32_t>(tekki::core::FloatToHalf(uv[0])) |
+           (static_cast<uint32_t>(tekki::core::FloatToHalf(uv[1])) << 16);
+}
+
+void CheckStreamSize(size_t size, size_t vertex_count, const char* name) {
+    if (size != 0 && size != vertex_count) {
+        throw std::runtime_error(std::string(name) + " stream does not match the vertex count");
+    }
+}
+
+} // namespace
+
+uint16_t EncodeOctahedralNormal(const std::array<float, 3>& n) {
+    auto [u, v] = OctahedralWrap(n[0], n[1], n[2]);
+    float len = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+    if (len <= std::numeric_limits<float>::min()) {
+        return PackSnorm8x2(0, 0);
+    }
+
+    // With only 8 bits per component, rounding each one independently is noticeably worse than
+    // picking the best of the four neighbouring grid points (Cigolle et al. 2014).
+    float base_u = std::floor(u * NORMAL_STEPS);
+    float base_v = std::floor(v * NORMAL_STEPS);
+    uint16_t best = 0;
+    float best_dot = -2.0f;
+    for (int du = 0; du < 2; ++du) {
+        for (int dv = 0; dv < 2; ++dv) {
+            int qu = static_cast<int>(std::clamp(base_u + du, -NORMAL_STEPS, NORMAL_STEPS));
+            int qv = static_cast<int>(std::clamp(base_v + dv, -NORMAL_STEPS, NORMAL_STEPS));
+            uint16_t packed = PackSnorm8x2(qu, qv);
+
+            auto decoded = DecodeOctahedralNormal(packed);
+            float dot = (decoded[0] * n[0] + decoded[1] * n[1] + decoded[2] * n[2]) / len;
+            if (dot > best_dot) {
+                best_dot = dot;
+                best = packed;
+            }
+        }
+    }
+    return best;
+}
+
+std::array<float, 3> DecodeOctahedralNormal(uint16_t packed) {
+    float u = static_cast<float>(static_cast<int8_t>(packed & 0xffu)) / NORMAL_STEPS;
+    float v = static_cast<float>(static_cast<int8_t>(packed >> 8)) / NORMAL_STEPS;
+    return OctahedralUnwrap(u, v);
+}
+
+uint32_t EncodeOctahedralTangent(const std::array<float, 4>& t) {
+    auto [u, v] = OctahedralWrap(t[0], t[1], t[2]);
+    if (u == 0.0f && v == 0.0f && t[2] <= 0.0f) {
+        // Missing tangent; any unit vector will do.
+        u = 1.0f;
+    }
+
+    uint32_t qu = static_cast<uint32_t>((std::clamp(u, -1.0f, 1.0f) * 0.5f + 0.5f) * TANGENT_STEPS + 0.5f);
+    uint32_t qv = static_cast<uint32_t>((std::clamp(v, -1.0f, 1.0f) * 0.5f + 0.5f) * TANGENT_STEPS + 0.5f);
+    uint32_t handedness = t[3] < 0.0f ? 1u : 0u;
+    return qu | (qv << 15) | (handedness << 31);
+}
+
+std::array<float, 4> DecodeOctahedralTangent(uint32_t packed) {
+    float u = static_cast<float>(packed & 0x7fffu) * (2.0f / TANGENT_STEPS) - 1.0f;
+    float v = static_cast<float>((packed >> 15) & 0x7fffu) * (2.0f / TANGENT_STEPS) - 1.0f;
+    auto t = OctahedralUnwrap(u, v);
+    return {t[0], t[1], t[2], (packed >> 31) ? -1.0f : 1.0f};
+}
+
+std::vector<uint8_t> EncodeIndexStream(std::span<const uint32_t> indices) {
+    std::vector<uint8_t> stream;
+    stream.reserve(indices.size() * 2);
+
+    uint32_t prev = 0;
+    for (uint32_t index : indices) {
+        int32_t delta = static_cast<int32_t>(index - prev);
+        uint32_t zigzag = (static_cast<uint32_t>(delta) << 1) ^ static_cast<uint32_t>(delta >> 31);
+        while (zigzag >= 0x80u) {
+            stream.push_back(static_cast<uint8_t>(zigzag | 0x80u));
+            zigzag >>= 7;
+        }
+        stream.push_back(static_cast<uint8_t>(zigzag));
+        prev = index;
+    }
+
+    return stream;
+}
+
+void DecodeIndexStream(std::span<const uint8_t> stream, std::span<uint32_t> indices) {
+    const uint8_t* pos = stream.data();
+    const uint8_t* end = pos + stream.size();
+    uint32_t prev = 0;
+
+    for (uint32_t& index : indices) {
+        if (pos == end) {
+            throw std::runtime_error("index stream is truncated");
+        }
+
+        uint32_t zigzag = *pos++;
+        if (zigzag >= 0x80u) {
+            zigzag &= 0x7fu;
+            for (uint32_t shift = 7;; shift += 7) {
+                if (pos == end || shift > 28) {
+                    throw std::runtime_error("index stream is truncated or malformed");
+                }
+                uint32_t byte = *pos++;
+                zigzag |= (byte & 0x7fu) << shift;
+                if (byte < 0x80u) {
+                    break;
+                }
+            }
+        }
+
+        prev += (zigzag >> 1) ^ (0u - (zigzag & 1u));
+        index = prev;
+    }
+
+    if (pos != end) {
+        throw std::runtime_error("index stream has trailing bytes");
+    }
+}
+
+void DecodePositions(std::span<const QuantizedVertex> verts, const std::array<float, 3>& min,
+                     const std::array<float, 3>& scale, std::span<std::array<float, 3>> out) {
+    size_t i = 0;
+
+#ifdef TEKKI_MESH_QUANTIZE_SSE2
+    // One vertex per iteration: widen the three u16 lanes (and the normal, which is discarded)
+    // to floats and apply the bounds. The 16-byte store spills into the next element, which is
+    // rewritten on the following iteration, so the last vertex goes through the scalar path.
+    const __m128 min_v = _mm_setr_ps(min[0], min[1], min[2], 0.0f);
+    const __m128 scale_v = _mm_setr_ps(scale[0], scale[1], scale[2], 0.0f);
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 1 < verts.size(); ++i) {
+        __m128i q = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(&verts[i]));
+        __m128 p = _mm_cvtepi32_ps(_mm_unpacklo_epi16(q, zero));
+        _mm_storeu_ps(out[i].data(), _mm_add_ps(_mm_mul_ps(p, scale_v), min_v));
+    }
+#endif
+
+    for (; i < verts.size(); ++i) {
+        for (int c = 0; c < 3; ++c) {
+            out[i][c] = static_cast<float>(verts[i].Pos[c]) * scale[c] + min[c];
+        }
+    }
+}
+
+void DecodeHalfUvs(std::span<const uint32_t> uvs, std::span<std::array<float, 2>> out) {
+    for (size_t i = 0; i < uvs.size(); ++i) {
+        out[i] = {tekki::core::HalfToFloat(static_cast<uint16_t>(uvs[i])),
+                  tekki::core::HalfToFloat(static_cast<uint16_t>(uvs[i] >> 16))};
+    }
+}
+
+QuantizationReport QuantizeVertexStreams(PackedTriangleMesh& mesh) {
+    QuantizationReport report;
+
+    try {
+        if (mesh.Verts.empty() && !mesh.QuantizedVerts.empty()) {
+            throw std::runtime_error("mesh is already quantised");
+        }
+
+        const size_t vertex_count = mesh.Verts.size();
+        CheckStreamSize(mesh.Uvs.size(), vertex_count, "UV");
+        CheckStreamSize(mesh.Tangents.size(), vertex_count, "tangent");
+        CheckStreamSize(mesh.Colors.size(), vertex_count, "color");
+
+        std::array<float, 3> min_pos{};
+        std::array<float, 3> max_pos{};
+        if (vertex_count > 0) {
+            min_pos = mesh.Verts[0].Pos;
+            max_pos = mesh.Verts[0].Pos;
+        }
+        for (const auto& vert : mesh.Verts) {
+            for (int c = 0; c < 3; ++c) {
+                min_pos[c] = std::min(min_pos[c], vert.Pos[c]);
+                max_pos[c] = std::max(max_pos[c], vert.Pos[c]);
+            }
+        }
+
+        std::array<float, 3> scale{};
+        for (int c = 0; c < 3; ++c) {
+            scale[c] = (max_pos[c] - min_pos[c]) / POSITION_STEPS;
+        }
+
+        mesh.QuantizedVerts.resize(vertex_count);
+        mesh.HalfUvs.resize(mesh.Uvs.size());
+        mesh.OctTangents.resize(mesh.Tangents.size());
+        mesh.Rgba8Colors.resize(mesh.Colors.size());
+
+        // Encode and immediately decode each chunk, so the report reflects what a loader gets back.
+        size_t chunk_count = (vertex_count + VERTICES_PER_TASK - 1) / VERTICES_PER_TASK;
+        std::vector<QuantizationReport> chunk_reports(chunk_count);
+
+        tekki::core::ParallelFor(chunk_count, [&](size_t chunk) {
+            size_t first = chunk * VERTICES_PER_TASK;
+            size_t count = std::min(VERTICES_PER_TASK, vertex_count - first);
+            QuantizationReport& chunk_report = chunk_reports[chunk];
+
+            for (size_t i = first; i < first + count; ++i) {
+                const PackedVertex& vert = mesh.Verts[i];
+                QuantizedVertex& quantized = mesh.QuantizedVerts[i];
+                for (int c = 0; c < 3; ++c) {
+                    float q = scale[c] > 0.0f ? (vert.Pos[c] - min_pos[c]) / scale[c] : 0.0f;
+                    quantized.Pos[c] = static_cast<uint16_t>(std::clamp(q + 0.5f, 0.0f, POSITION_STEPS));
+                }
+
+                auto normal = UnpackUnitDirection11_10_11(vert.Normal);
+                quantized.Normal = EncodeOctahedralNormal(normal);
+                auto decoded_normal = DecodeOctahedralNormal(quantized.Normal);
+                chunk_report.MaxNormalErrorDegrees = std::max(chunk_report.MaxNormalErrorDegrees,
+                                                              AngleDegrees(normal.data(), decoded_normal.data()));
+            }
+
+            std::vector<std::array<float, 3>> positions(count);
+            DecodePositions(std::span(mesh.QuantizedVerts).subspan(first, count), min_pos, scale, positions);
+            for (size_t i = 0; i < count; ++i) {
+                const auto& p = mesh.Verts[first + i].Pos;
+                float dx = positions[i][0] - p[0], dy = positions[i][1] - p[1], dz = positions[i][2] - p[2];
+                chunk_report.MaxPositionError = std::max(chunk_report.MaxPositionError, std::sqrt(dx * dx + dy * dy + dz * dz));
+            }
+
+            if (!mesh.Uvs.empty()) {
+                std::vector<std::array<float, 2>> uvs(count);
+                for (size_t i = first; i < first + count; ++i) {
+                    mesh.HalfUvs[i] = PackHalf2(mesh.Uvs[i]);
+                }
+                DecodeHalfUvs(std::span(mesh.HalfUvs).subspan(first, count), uvs);
+                for (size_t i = 0; i < count; ++i) {
+                    for (int c = 0; c < 2; ++c) {
+                        chunk_report.MaxUvError = std::max(chunk_report.MaxUvError, std::abs(uvs[i][c] - mesh.Uvs[first + i][c]));
+                    }
+                }
+            }
+
+            if (!mesh.Tangents.empty()) {
+                for (size_t i = first; i < first + count; ++i) {
+                    const auto& tangent = mesh.Tangents[i];
+                    mesh.OctTangents[i] = EncodeOctahedralTangent(tangent);
+                    auto decoded = DecodeOctahedralTangent(mesh.OctTangents[i]);
+                    float error = (decoded[3] < 0.0f) != (tangent[3] < 0.0f) ? 180.0f : AngleDegrees(tangent.data(), decoded.data());
+                    chunk_report.MaxTangentErrorDegrees = std::max(chunk_report.MaxTangentErrorDegrees, error);
+                }
+            }
+
+            if (!mesh.Colors.empty()) {
+                for (size_t i = first; i < first + count; ++i) {
+                    mesh.Rgba8Colors[i] = PackRgba8(mesh.Colors[i]);
+                    auto decoded = UnpackRgba8(mesh.Rgba8Colors[i]);
+                    for (int c = 0; c < 4; ++c) {
+                        chunk_report.MaxColorError = std::max(chunk_report.MaxColorError, std::abs(decoded[c] - mesh.Colors[i][c]));
+                    }
+                }
+            }
+        });
+
+        for (const auto& chunk_report : chunk_reports) {
+            report.MaxPositionError = std::max(report.MaxPositionError, chunk_report.MaxPositionError);
+            report.MaxNormalErrorDegrees = std::max(report.MaxNormalErrorDegrees, chunk_report.MaxNormalErrorDegrees);
+            report.MaxTangentErrorDegrees = std::max(report.MaxTangentErrorDegrees, chunk_report.MaxTangentErrorDegrees);
+            report.MaxUvError = std::max(report.MaxUvError, chunk_report.MaxUvError);
+            report.MaxColorError = std::max(report.MaxColorError, chunk_report.MaxColorError);
+        }
+
+        mesh.IndexStream = EncodeIndexStream(mesh.Indices);
+        mesh.IndexStreamCount = mesh.Indices.size();
+        mesh.PositionMin = min_pos;
+        mesh.PositionScale = scale;
+
+        report.FullBytes = mesh.Verts.size() * sizeof(PackedVertex) + mesh.Uvs.size() * sizeof(mesh.Uvs[0]) +
+                           mesh.Tangents.size() * sizeof(mesh.Tangents[0]) + mesh.Colors.size() * sizeof(mesh.Colors[0]) +
+                           mesh.Indices.size() * sizeof(uint32_t);
+        report.QuantizedBytes = mesh.QuantizedVerts.size() * sizeof(QuantizedVertex) + mesh.HalfUvs.size() * sizeof(uint32_t) +
+                                mesh.OctTangents.size() * sizeof(uint32_t) + mesh.Rgba8Colors.size() * sizeof(uint32_t) +
+                                mesh.IndexStream.size();
+
+        mesh.Verts = {};
+        mesh.Uvs = {};
+        mesh.Tangents = {};
+        mesh.Colors = {};
+        mesh.Indices = {};
+
+    } catch (const std::exception& e) {
+        throw std::runtime_error("Failed to quantize vertex streams: " + std::string(e.what()));
+    }
+
+    return report;
+}
+
+void DequantizeVertexStreams(PackedTriangleMesh& mesh) {
+    if (mesh.QuantizedVerts.empty() && mesh.IndexStream.empty()) {
+        return;
+    }
+
+    try {
+        const size_t vertex_count = mesh.QuantizedVerts.size();
+        CheckStreamSize(mesh.HalfUvs.size(), vertex_count, "UV");
+        CheckStreamSize(mesh.OctTangents.size(), vertex_count, "tangent");
+        CheckStreamSize(mesh.Rgba8Colors.size(), vertex_count, "color");
+
+        mesh.Verts.resize(vertex_count);
+        mesh.Uvs.resize(mesh.HalfUvs.size());
+        mesh.Tangents.resize(mesh.OctTangents.size());
+        mesh.Colors.resize(mesh.Rgba8Colors.size());
+
+        size_t chunk_count = (vertex_count + VERTICES_PER_TASK - 1) / VERTICES_PER_TASK;
+        tekki::core::ParallelFor(chunk_count, [&](size_t chunk) {
+            size_t first = chunk * VERTICES_PER_TASK;
+            size_t count = std::min(VERTICES_PER_TASK, vertex_count - first);
+
+            std::vector<std::array<float, 3>> positions(count);
+            DecodePositions(std::span(mesh.QuantizedVerts).subspan(first, count), mesh.PositionMin, mesh.PositionScale, positions);
+            for (size_t i = 0; i < count; ++i) {
+                auto n = DecodeOctahedralNormal(mesh.QuantizedVerts[first + i].Normal);
+                mesh.Verts[first + i] = PackedVertex{positions[i], PackUnitDirection11_10_11(n[0], n[1], n[2])};
+            }
+
+            if (!mesh.HalfUvs.empty()) {
+                DecodeHalfUvs(std::span(mesh.HalfUvs).subspan(first, count), std::span(mesh.Uvs).subspan(first, count));
+            }
+            if (!mesh.OctTangents.empty()) {
+                for (size_t i = first; i < first + count; ++i) {
+                    mesh.Tangents[i] = DecodeOctahedralTangent(mesh.OctTangents[i]);
+                }
+            }
+            if (!mesh.Rgba8Colors.empty()) {
+                for (size_t i = first; i < first + count; ++i) {
+                    mesh.Colors[i] = UnpackRgba8(mesh.Rgba8Colors[i]);
+                }
+            }
+        });
+
+        mesh.Indices.resize(mesh.IndexStreamCount);
+        DecodeIndexStream(mesh.IndexStream, mesh.Indices);
+
+        mesh.QuantizedVerts = {};
+        mesh.HalfUvs = {};
+        mesh.OctTangents = {};
+        mesh.Rgba8Colors = {};
+        mesh.IndexStream = {};
+        mesh.IndexStreamCount = 0;
+        mesh.PositionMin = {};
+        mesh.PositionScale = {};
+
+    } catch (const std::exception& e) {
+        throw std::runtime_error("Failed to dequantize vertex streams: " + std::string(e.what()));
+    }
+}
+
+} // namespace tekki::asset
@@ -0,0 +1,657 @@
+#include "tekki/asset/mesh_simplify.h"
+#include "tekki/asset/mesh_optimize.h"
+#include "tekki/core/parallel.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Edge collapses are picked in passes: every candidate edge is scored by the quadric error of
+// moving one endpoint onto the other, then the cheapest collapses are applied greedily, each
+// vertex taking part in at most one per pass. Positions never change, so quadrics only need
+// evaluating at existing vertices and every attribute stream stays valid as is.
+
+namespace tekki::asset {
+
+namespace {
+
+using Vec3 = std::array<float, 3>;
+
+constexpr uint32_t NONE = ~0u;
+constexpr uint32_t MULTIPLE = ~1u;
+
+// Weight of the planes that hold borders and seams in place, relative to the surface planes.
+constexpr float EDGE_WEIGHT = 10.0f;
+
+inline Vec3 Sub(const Vec3& a, const Vec3& b) {
+    return {a[0] - b[0], a[1] - b[1], a[2] - b[2]};
+}
+
+inline float Dot(const Vec3& a, const Vec3& b) {
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+inline Vec3 Cross(const Vec3& a, const Vec3& b) {
+    return {a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0]};
+}
+
+inline float Normalize(Vec3& v) {
+    float length = std::sqrt(Dot(v, v));
+    if (length > 0.0f) {
+        v = {v[0] / length, v[1] / length, v[2] / length};
+    }
+    return length;
+}
+
+// Sum of weighted squared distances to a set of planes; Error is their weighted mean.
+struct Quadric {
+    double A00 = 0, A11 = 0, A22 = 0, A10 = 0, A20 = 0, A21 = 0;
+    double B0 = 0, B1 = 0, B2 = 0, C = 0, W = 0;
+
+    // Plane dot(n, p) + d = 0 with unit `n`.
+    void AddPlane(const Vec3& n, float d, float weight) {
+        A00 += weight * n[0] * n[0];
+        A11 += weight * n[1] * n[1];
+        A22 += weight * n[2] * n[2];
+        A10 += weight * n[1] * n[0];
+        A20 += weight * n[2] * n[0];
+        A21 += weight * n[2] * n[1];
+        B0 += weight * n[0] * d;
+        B1 += weight * n[1] * d;
+        B2 += weight * n[2] * d;
+        C += weight * d * d;
+        W += weight;
+    }
+
+    void Add(const Quadric& q) {
+        A00 += q.A00, A11 += q.A11, A22 += q.A22, A10 += q.A10, A20 += q.A20, A21 += q.A21;
+        B0 += q.B0, B1 += q.B1, B2 += q.B2, C += q.C, W += q.W;
+    }
+
+    double Error(const Vec3& p) const {
+        double x = p[0], y = p[1], z = p[2];
+        double r = A00 * x * x + A11 * y * y + A22 * z * z + 2.0 * (A10 * x * y + A20 * x * z + A21 * y * z) +
+                   2.0 * (B0 * x + B1 * y + B2 * z) + C;
+        return W > 0.0 ? std::abs(r) / W : 0.0;
+    }
+};
+
+enum class VertexKind : uint8_t {
+    Manifold, // Interior vertex with a single set of attributes
+    Border,   // On an open edge
+    Seam,     // Two attribute sets along a seam that continues on both sides
+    Locked
+};
+
+struct PositionKey {
+    std::array<uint32_t, 3> Bits;
+    bool operator==(const PositionKey& other) const { return Bits == other.Bits; }
+};
+
+struct PositionKeyHash {
+    size_t operator()(const PositionKey& key) const {
+        uint64_t h = 0xcbf29ce484222325ull;
+        for (uint32_t bits : key.Bits) {
+            h = (h ^ bits) * 0x100000001b3ull;
+        }
+        return static_cast<size_t>(h ^ (h >> 29));
+    }
+};
+
+PositionKey KeyOf(const Vec3& p) {
+    PositionKey key;
+    for (int c = 0; c < 3; ++c) {
+        float v = p[c] == 0.0f ? 0.0f : p[c]; // -0 and +0 are the same position
+        std::memcpy(&key.Bits[c], &v, sizeof(float));
+    }
+    return key;
+}
+
+// Vertices with identical positions: `Remap` points at the first of them, `Wedge` links them in a ring.
+void BuildPositionClasses(std::span<const Vec3> positions, std::vector<uint32_t>& remap, std::vector<uint32_t>& wedge) {
+    size_t count = positions.size();
+    remap.resize(count);
+    wedge.resize(count);
+
+    std::unordered_map<PositionKey, uint32_t, PositionKeyHash> first;
+    first.reserve(count);
+    for (uint32_t v = 0; v < count; ++v) {
+        auto [it, inserted] = first.emplace(KeyOf(positions[v]), v);
+        remap[v] = it->second;
+        wedge[v] = v;
+        if (!inserted) {
+            // Insert after the ring's first vertex.
+            uint32_t r = it->second;
+            wedge[v] = wedge[r];
+            wedge[r] = v;
+        }
+    }
+}
+
+// Directed edges by source vertex, for reverse-edge lookups.
+struct EdgeAdjacency {
+    std::vector<uint32_t> Offsets;
+    std::vector<uint32_t> Targets;
+
+    void Build(std::span<const uint32_t> indices, size_t vertex_count) {
+        Offsets.assign(vertex_count + 1, 0);
+        for (uint32_t v : indices) {
+            ++Offsets[v + 1];
+        }
+        for (size_t v = 0; v < vertex_count; ++v) {
+            Offsets[v + 1] += Offsets[v];
+        }
+        Targets.resize(indices.size());
+        std::vector<uint32_t> fill(Offsets.begin(), Offsets.end() - 1);
+        for (size_t i = 0; i < indices.size(); i += 3) {
+            for (int e = 0; e < 3; ++e) {
+                Targets[fill[indices[i + e]]++] = indices[i + (e + 1) % 3];
+            }
+        }
+    }
+
+    bool HasEdge(uint32_t a, uint32_t b) const {
+        return std::find(Targets.begin() + Offsets[a], Targets.begin() + Offsets[a + 1], b) != Targets.begin() + Offsets[a + 1];
+    }
+};
+
+// Triangles around each position class.
+struct TriangleAdjacency {
+    std::vector<uint32_t> Offsets;
+    std::vector<uint32_t> Triangles;
+
+    void Build(std::span<const uint32_t> indices, std::span<const uint32_t> remap) {
+        Offsets.assign(remap.size() + 1, 0);
+        for (uint32_t v : indices) {
+            ++Offsets[remap[v] + 1];
+        }
+        for (size_t v = 0; v < remap.size(); ++v) {
+            Offsets[v + 1] += Offsets[v];
+        }
+        Triangles.resize(indices.size());
+        std::vector<uint32_t> fill(Offsets.begin(), Offsets.end() - 1);
+        for (size_t i = 0; i < indices.size(); ++i) {
+            Triangles[fill[remap[indices[i]]]++] = static_cast<uint32_t>(i / 3);
+        }
+    }
+};
+
+void RecordOpenEdge(uint32_t& slot, uint32_t vertex) {
+    slot = slot == NONE ? vertex : MULTIPLE;
+}
+
+// Follows a border or seam loop past a vertex that collapsed onto its neighbour.
+void RemapEdgeLoops(std::vector<uint32_t>& loop, std::span<const uint32_t> collapse_remap) {
+    for (size_t i = 0; i < loop.size(); ++i) {
+        if (loop[i] >= MULTIPLE) {
+            continue;
+        }
+        uint32_t target = collapse_remap[loop[i]];
+        loop[i] = target == i ? loop[loop[i]] : target;
+    }
+}
+
+struct Collapse {
+    uint32_t From;
+    uint32_t To;
+    double Error;
+};
+
+class Simplifier {
+public:
+    Simplifier(std::span<const Vec3> positions, std::span<const uint8_t> locked)
+        : positions_(positions), count_(positions.size()) {
+        BuildPositionClasses(positions_, remap_, wedge_);
+        kind_.assign(count_, VertexKind::Manifold);
+        loop_.assign(count_, NONE);
+        loopback_.assign(count_, NONE);
+        for (size_t v = 0; v < locked.size(); ++v) {
+            if (locked[v]) {
+                kind_[remap_[v]] = VertexKind::Locked;
+            }
+        }
+    }
+
+    float Run(std::vector<uint32_t>& indices, size_t target_index_count, double max_error) {
+        Classify(indices);
+        BuildQuadrics(indices);
+
+        double reached = 0.0;
+        std::vector<Collapse> candidates;
+        std::vector<uint32_t> collapse_remap(count_);
+        std::vector<uint8_t> collapse_locked(count_);
+
+        while (indices.size() > target_index_count) {
+            triangles_.Build(indices, remap_);
+            PickCollapses(indices, candidates);
+            if (candidates.empty()) {
+                break;
+            }
+            std::sort(candidates.begin(), candidates.end(), [](const Collapse& a, const Collapse& b) {
+                return a.Error < b.Error || (a.Error == b.Error && a.From < b.From);
+            });
+
+            for (uint32_t v = 0; v < count_; ++v) {
+                collapse_remap[v] = v;
+            }
+            std::fill(collapse_locked.begin(), collapse_locked.end(), 0);
+
+            // Each collapse removes about two triangles; stop a little past the target.
+            size_t triangles_to_remove = (indices.size() - target_index_count) / 3;
+            size_t removed = 0;
+            size_t collapses = 0;
+            for (const auto& c : candidates) {
+                if (c.Error > max_error || removed >= triangles_to_remove) {
+                    break;
+                }
+                uint32_t r0 = remap_[c.From];
+                uint32_t r1 = remap_[c.To];
+                if (collapse_locked[r0] || collapse_locked[r1]) {
+                    continue;
+                }
+
+                // The other side of a seam moves along its own, mirrored edge.
+                uint32_t sibling = wedge_[c.From];
+                uint32_t sibling_to = NONE;
+                if (kind_[c.From] == VertexKind::Seam) {
+                    sibling_to = loop_[c.From] == c.To ? loopback_[sibling] : loop_[sibling];
+                    if (sibling_to >= MULTIPLE || remap_[sibling_to] != r1) {
+                        continue;
+                    }
+                }
+                if (HasTriangleFlips(indices, collapse_remap, c)) {
+                    continue;
+                }
+
+                quadrics_[r1].Add(quadrics_[r0]);
+                collapse_remap[c.From] = c.To;
+                if (sibling_to != NONE) {
+                    collapse_remap[sibling] = sibling_to;
+                }
+                collapse_locked[r0] = 1;
+                collapse_locked[r1] = 1;
+                removed += kind_[c.From] == VertexKind::Border ? 1 : 2;
+                reached = std::max(reached, c.Error);
+                ++collapses;
+            }
+            if (collapses == 0) {
+                break;
+            }
+
+            RemapEdgeLoops(loop_, collapse_remap);
+            RemapEdgeLoops(loopback_, collapse_remap);
+
+            size_t write = 0;
+            for (size_t i = 0; i < indices.size(); i += 3) {
+                uint32_t a = collapse_remap[indices[i]];
+                uint32_t b = collapse_remap[indices[i + 1]];
+                uint32_t d = collapse_remap[indices[i + 2]];
+                if (remap_[a] == remap_[b] || remap_[b] == remap_[d] || remap_[a] == remap_[d]) {
+                    continue;
+                }
+                indices[write++] = a;
+                indices[write++] = b;
+                indices[write++] = d;
+            }
+            indices.resize(write);
+        }
+
+        return static_cast<float>(std::sqrt(reached));
+    }
+
+private:
+    void Classify(std::span<const uint32_t> indices) {
+        EdgeAdjacency edges;
+        edges.Build(indices, count_);
+
+        std::vector<uint32_t> open_out(count_, NONE);
+        std::vector<uint32_t> open_in(count_, NONE);
+        for (size_t i = 0; i < indices.size(); i += 3) {
+            for (int e = 0; e < 3; ++e) {
+                uint32_t a = indices[i + e];
+                uint32_t b = indices[i + (e + 1) % 3];
+                if (!edges.HasEdge(b, a)) {
+                    RecordOpenEdge(open_out[a], b);
+                    RecordOpenEdge(open_in[b], a);
+                }
+            }
+        }
+
+        auto single = [](uint32_t v) { return v < MULTIPLE; };
+        for (uint32_t v = 0; v < count_; ++v) {
+            if (remap_[v] != v) {
+                continue;
+            }
+
+            VertexKind kind = VertexKind::Locked;
+            uint32_t w = wedge_[v];
+            if (kind_[v] == VertexKind::Locked) {
+                kind = VertexKind::Locked;
+            } else if (w == v) {
+                if (open_out[v] == NONE && open_in[v] == NONE) {
+                    kind = VertexKind::Manifold;
+                } else if (single(open_out[v]) && single(open_in[v])) {
+                    kind = VertexKind::Border;
+                }
+            } else if (wedge_[w] == v) {
+                // Two attribute sets whose open edges mirror each other are a seam; anything else
+                // (a seam that also ends on a border, three or more sets) stays put.
+                if (single(open_out[v]) && single(open_in[v]) && single(open_out[w]) && single(open_in[w]) &&
+                    remap_[open_out[v]] == remap_[open_in[w]] && remap_[open_in[v]] == remap_[open_out[w]]) {
+                    kind = VertexKind::Seam;
+                }
+            }
+
+            uint32_t u = v;
+            do {
+                kind_[u] = kind;
+                if (kind == VertexKind::Border || kind == VertexKind::Seam) {
+                    loop_[u] = open_out[u];
+                    loopback_[u] = open_in[u];
+                }
+                u = wedge_[u];
+            } while (u != v);
+        }
+    }
+
+    void BuildQuadrics(std::span<const uint32_t> indices) {
+        quadrics_.assign(count_, Quadric{});
+        for (size_t i = 0; i < indices.size(); i += 3) {
+            const Vec3& p0 = positions_[indices[i]];
+            const Vec3& p1 = positions_[indices[i + 1]];
+            const Vec3& p2 = positions_[indices[i + 2]];
+            Vec3 normal = Cross(Sub(p1, p0), Sub(p2, p0));
+            float area = Normalize(normal);
+            float d = -Dot(normal, p0);
+            for (int c = 0; c < 3; ++c) {
+                quadrics_[remap_[indices[i + c]]].AddPlane(normal, d, area);
+            }
+
+            // Open edges get a plane through the edge, perpendicular to the triangle, so sliding
+            // a border or seam vertex costs what it moves the outline.
+            for (int e = 0; e < 3; ++e) {
+                uint32_t a = indices[i + e];
+                uint32_t b = indices[i + (e + 1) % 3];
+                if ((kind_[a] != VertexKind::Border && kind_[a] != VertexKind::Seam) || loop_[a] != b) {
+                    continue;
+                }
+                Vec3 edge = Sub(positions_[b], positions_[a]);
+                float length_sq = Dot(edge, edge);
+                Vec3 plane = Cross(edge, normal);
+                Normalize(plane);
+                float plane_d = -Dot(plane, positions_[a]);
+                quadrics_[remap_[a]].AddPlane(plane, plane_d, length_sq * EDGE_WEIGHT);
+                quadrics_[remap_[b]].AddPlane(plane, plane_d, length_sq * EDGE_WEIGHT);
+            }
+        }
+    }
+
+    bool CanCollapse(uint32_t from, uint32_t to) const {
+        switch (kind_[from]) {
+        case VertexKind::Manifold:
+            return true;
+        case VertexKind::Border:
+        case VertexKind::Seam:
+            return kind_[to] == kind_[from] && (loop_[from] == to || loopback_[from] == to);
+        case VertexKind::Locked:
+            return false;
+        }
+        return false;
+    }
+
+    void PickCollapses(std::span<const uint32_t> indices, std::vector<Collapse>& candidates) const {
+        candidates.clear();
+        for (size_t i = 0; i < indices.size(); i += 3) {
+            for (int e = 0; e < 3; ++e) {
+                uint32_t a = indices[i + e];
+                uint32_t b = indices[i + (e + 1) % 3];
+                // Interior edges show up once per side; keep one of them.
+                if (remap_[a] > remap_[b] && kind_[a] != VertexKind::Border && kind_[a] != VertexKind::Seam &&
+                    kind_[b] != VertexKind::Border && kind_[b] != VertexKind::Seam) {
+                    continue;
+                }
+
+                for (auto [from, to] : {std::pair{a, b}, std::pair{b, a}}) {
+                    if (CanCollapse(from, to)) {
+                        candidates.push_back({from, to, quadrics_[remap_[from]].Error(positions_[to])});
+                    }
+                }
+            }
+        }
+
+        // Duplicates from both sides of border and seam edges cost the same; drop them.
+        std::sort(candidates.begin(), candidates.end(), [&](const Collapse& x, const Collapse& y) {
+            return remap_[x.From] != remap_[y.From] ? remap_[x.From] < remap_[y.From] : remap_[x.To] < remap_[y.To];
+        });
+        candidates.erase(std::unique(candidates.begin(), candidates.end(),
+                                     [&](const Collapse& x, const Collapse& y) {
+                                         return remap_[x.From] == remap_[y.From] && remap_[x.To] == remap_[y.To];
+                                     }),
+                         candidates.end());
+    }
+
+    // True if moving `c.From` onto `c.To` would turn any surviving triangle around it over.
+    bool HasTriangleFlips(std::span<const uint32_t> indices, std::span<const uint32_t> collapse_remap, const Collapse& c) const {
+        uint32_t r0 = remap_[c.From];
+        uint32_t r1 = remap_[c.To];
+        const Vec3& target = positions_[c.To];
+
+        for (uint32_t k = triangles_.Offsets[r0]; k < triangles_.Offsets[r0 + 1]; ++k) {
+            uint32_t t = triangles_.Triangles[k];
+            std::array<uint32_t, 3> corners = {collapse_remap[indices[t * 3]], collapse_remap[indices[t * 3 + 1]],
+                                               collapse_remap[indices[t * 3 + 2]]};
+            int moved = -1;
+            bool collapses_away = false;
+            for (int j = 0; j < 3; ++j) {
+                uint32_t r = remap_[corners[j]];
+                moved = r == r0 ? j : moved;
+                collapses_away |= r == r1;
+            }
+            if (collapses_away || moved < 0) {
+                continue;
+            }
+
+            const Vec3& a = positions_[corners[(moved + 1) % 3]];
+            const Vec3& b = positions_[corners[(moved + 2) % 3]];
+            Vec3 before = Cross(Sub(a, positions_[corners[moved]]), Sub(b, positions_[corners[moved]]));
+            Vec3 after = Cross(Sub(a, target), Sub(b, target));
+            if (Dot(before, after) <= 0.0f) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::span<const Vec3> positions_;
+    uint32_t count_;
+    std::vector<uint32_t> remap_;
+    std::vector<uint32_t> wedge_;
+    std::vector<VertexKind> kind_;
+    std::vector<uint32_t> loop_;
+    std::vector<uint32_t> loopback_;
+    std::vector<Quadric> quadrics_;
+    TriangleAdjacency triangles_;
+};
+
+} // namespace
+
+SimplifyResult SimplifyMesh(std::span<const uint32_t> indices, std::span<const std::array<float, 3>> positions,
+                            const SimplifyOptions& options, std::span<const uint8_t> locked) {
+    if (indices.size() % 3 != 0) {
+        throw std::runtime_error("SimplifyMesh: index count is not a multiple of 3");
+    }
+    if (!locked.empty() && locked.size() != positions.size()) {
+        throw std::runtime_error("SimplifyMesh: locked flags do not match the vertex count");
+    }
+
+    SimplifyResult result;
+    if (indices.size() <= options.TargetIndexCount) {
+        result.Indices.assign(indices.begin(), indices.end());
+        return result;
+    }
+
+    // Work on the used vertices only, scaled to the extent, so the cost does not depend on the
+    // size of the shared vertex buffer and errors come out relative.
+    std::vector<uint32_t> used(indices.begin(), indices.end());
+    std::sort(used.begin(), used.end());
+    used.erase(std::unique(used.begin(), used.end()), used.end());
+    if (used.back() >= positions.size()) {
+        throw std::runtime_error("SimplifyMesh: index " + std::to_string(used.back()) + " is out of range");
+    }
+
+    Vec3 min_pos = positions[used[0]];
+    Vec3 max_pos = positions[used[0]];
+    for (uint32_t v : used) {
+        for (int c = 0; c < 3; ++c) {
+            min_pos[c] = std::min(min_pos[c], positions[v][c]);
+            max_pos[c] = std::max(max_pos[c], positions[v][c]);
+        }
+    }
+    float extent = options.Extent > 0.0f
+        ? options.Extent
+        : std::max({max_pos[0] - min_pos[0], max_pos[1] - min_pos[1], max_pos[2] - min_pos[2]});
+    float scale = extent > 0.0f ? 1.0f / extent : 1.0f;
+
+    std::vector<Vec3> local_positions(used.size());
+    std::vector<uint8_t> local_locked(locked.empty() ? 0 : used.size());
+    for (size_t i = 0; i < used.size(); ++i) {
+        const Vec3& p = positions[used[i]];
+        local_positions[i] = {(p[0] - min_pos[0]) * scale, (p[1] - min_pos[1]) * scale, (p[2] - min_pos[2]) * scale};
+        if (!locked.empty()) {
+            local_locked[i] = locked[used[i]];
+        }
+    }
+
+    std::vector<uint32_t> local_indices(indices.size());
+    for (size_t i = 0; i < indices.size(); ++i) {
+        local_indices[i] = static_cast<uint32_t>(std::lower_bound(used.begin(), used.end(), indices[i]) - used.begin());
+    }
+
+    Simplifier simplifier(local_positions, local_locked);
+    double max_error = static_cast<double>(options.TargetError) * options.TargetError;
+    result.Error = simplifier.Run(local_indices, options.TargetIndexCount, max_error);
+
+    result.Indices.resize(local_indices.size());
+    for (size_t i = 0; i < local_indices.size(); ++i) {
+        result.Indices[i] = used[local_indices[i]];
+    }
+    return result;
+}
+
+void BuildLodChain(PackedTriangleMesh& mesh, const LodChainOptions& options) {
+    if (!mesh.Lods.empty()) {
+        mesh.MaterialRanges.resize(std::min<size_t>(mesh.MaterialRanges.size(), mesh.Lods[0].FirstRange));
+    }
+    mesh.Lods.clear();
+    mesh.LodIndices.clear();
+    if (options.Errors.empty() || mesh.Indices.empty()) {
+        return;
+    }
+
+    std::vector<Vec3> positions(mesh.Verts.size());
+    Vec3 min_pos = mesh.Verts[0].Pos;
+    Vec3 max_pos = mesh.Verts[0].Pos;
+    for (size_t v = 0; v < mesh.Verts.size(); ++v) {
+        positions[v] = mesh.Verts[v].Pos;
+        for (int c = 0; c < 3; ++c) {
+            min_pos[c] = std::min(min_pos[c], positions[v][c]);
+            max_pos[c] = std::max(max_pos[c], positions[v][c]);
+        }
+    }
+    const float extent = std::max({max_pos[0] - min_pos[0], max_pos[1] - min_pos[1], max_pos[2] - min_pos[2]});
+
+    // Triangles are grouped by the material of their first corner, in order of first use.
+    std::vector<std::vector<uint32_t>> groups;
+    std::vector<uint32_t> group_materials;
+    {
+        std::unordered_map<uint32_t, size_t> group_of_material;
+        for (size_t i = 0; i < mesh.Indices.size(); i += 3) {
+            uint32_t material = mesh.MaterialIds.empty() ? 0 : mesh.MaterialIds[mesh.Indices[i]];
+            auto [it, inserted] = group_of_material.emplace(material, groups.size());
+            if (inserted) {
+                groups.emplace_back();
+                group_materials.push_back(material);
+            }
+            groups[it->second].insert(groups[it->second].end(), mesh.Indices.begin() + i, mesh.Indices.begin() + i + 3);
+        }
+    }
+
+    // A position used by several groups is on a material boundary; it stays put in every group.
+    std::vector<uint8_t> locked(positions.size(), 0);
+    if (groups.size() > 1) {
+        std::unordered_map<PositionKey, uint32_t, PositionKeyHash> group_at;
+        for (uint32_t g = 0; g < groups.size(); ++g) {
+            for (uint32_t v : groups[g]) {
+                auto [it, inserted] = group_at.emplace(KeyOf(positions[v]), g);
+                if (!inserted && it->second != g) {
+                    it->second = MULTIPLE;
+                }
+            }
+        }
+        for (size_t v = 0; v < positions.size(); ++v) {
+            auto it = group_at.find(KeyOf(positions[v]));
+            locked[v] = it != group_at.end() && it->second == MULTIPLE;
+        }
+    }
+
+    size_t previous_count = mesh.Indices.size();
+    float previous_error = 0.0f;
+    std::vector<SimplifyResult> level(groups.size());
+    for (float error : options.Errors) {
+        tekki::core::ParallelFor(groups.size(), [&](size_t g) {
+            SimplifyOptions simplify;
+            simplify.TargetIndexCount = static_cast<size_t>(groups[g].size() / 3 * options.Reduction) * 3;
+            simplify.TargetError = error;
+            simplify.Extent = extent;
+            level[g] = SimplifyMesh(groups[g], positions, simplify, locked);
+        });
+
+        size_t count = 0;
+        float level_error = previous_error;
+        for (const auto& result : level) {
+            count += result.Indices.size();
+            level_error = std::max(level_error, result.Error * extent);
+        }
+        if (count == 0 || count > previous_count * 9 / 10) {
+            continue;
+        }
+
+        // Groups stay contiguous (and are cache-optimized on their own) so each keeps one range.
+        if (options.OptimizeVertexCache) {
+            tekki::core::ParallelFor(groups.size(), [&](size_t g) {
+                level[g].Indices = OptimizeVertexCache(level[g].Indices, mesh.Verts.size());
+            });
+        }
+
+        MeshLod lod{};
+        lod.IndexOffset = static_cast<uint32_t>(mesh.LodIndices.size());
+        lod.IndexCount = static_cast<uint32_t>(count);
+        lod.Error = level_error;
+        lod.FirstRange = static_cast<uint32_t>(mesh.MaterialRanges.size());
+        mesh.Lods.push_back(lod);
+
+        std::vector<size_t> order(groups.size());
+        std::iota(order.begin(), order.end(), size_t(0));
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return group_materials[a] < group_materials[b]; });
+        for (size_t g : order) {
+            if (!level[g].Indices.empty() && !mesh.MaterialRanges.empty()) {
+                mesh.MaterialRanges.push_back(MaterialRange{group_materials[g], static_cast<uint32_t>(mesh.LodIndices.size()),
+                                                            static_cast<uint32_t>(level[g].Indices.size()), 0,
+                                                            sizeof(uint32_t)});
+            }
+            mesh.LodIndices.insert(mesh.LodIndices.end(), level[g].Indices.begin(), level[g].Indices.end());
+            groups[g] = std::move(level[g].Indices);
+        }
+
+        previous_count = count;
+        previous_error = level_error;
+    }
+}
+
+} // namespace tekki::asset
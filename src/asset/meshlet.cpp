@@ -0,0 +1,267 @@
+#include "tekki/asset/mesh.h"
+#include "tekki/core/parallel.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Meshlets are built greedily in index buffer order, so they work best on an index buffer that
+// has been through OptimizeVertexCache. The index buffer is cut into fixed chunks that are
+// processed in parallel and concatenated in order; meshlets never span chunks, which keeps the
+// output identical regardless of how many threads ran.
+
+namespace tekki::asset {
+
+namespace {
+
+constexpr size_t TRIANGLES_PER_CHUNK = 1 << 14;
+
+using Vec3 = std::array<float, 3>;
+
+inline Vec3 Sub(const Vec3& a, const Vec3& b) {
+    return {a[0] - b[0], a[1] - b[1], a[2] - b[2]};
+}
+
+inline float Dot(const Vec3& a, const Vec3& b) {
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+inline Vec3 Cross(const Vec3& a, const Vec3& b) {
+    return {a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0]};
+}
+
+struct MeshletChunk {
+    std::vector<Meshlet> Meshlets;
+    std::vector<uint32_t> Vertices;
+    std::vector<uint8_t> Triangles;
+};
+
+// Bounding sphere (around the AABB center) and normal cone, after meshoptimizer's
+// meshopt_computeMeshletBounds.
+void ComputeMeshletBounds(Meshlet& meshlet, const MeshletChunk& chunk, std::span<const PackedVertex> verts) {
+    auto position = [&](uint32_t local) -> const Vec3& {
+        return verts[chunk.Vertices[meshlet.VertexOffset + local]].Pos;
+    };
+
+    Vec3 min_pos = position(0);
+    Vec3 max_pos = position(0);
+    for (uint32_t i = 1; i < meshlet.VertexCount; ++i) {
+        const Vec3& p = position(i);
+        for (int c = 0; c < 3; ++c) {
+            min_pos[c] = std::min(min_pos[c], p[c]);
+            max_pos[c] = std::max(max_pos[c], p[c]);
+        }
+    }
+
+    Vec3 center = {(min_pos[0] + max_pos[0]) * 0.5f, (min_pos[1] + max_pos[1]) * 0.5f, (min_pos[2] + max_pos[2]) * 0.5f};
+    float radius_sq = 0.0f;
+    for (uint32_t i = 0; i < meshlet.VertexCount; ++i) {
+        Vec3 d = Sub(position(i), center);
+        radius_sq = std::max(radius_sq, Dot(d, d));
+    }
+
+    meshlet.Center = center;
+    meshlet.Radius = std::sqrt(radius_sq);
+    meshlet.Padding = 0.0f;
+
+    // Unit face normals; degenerate triangles don't constrain the cone.
+    std::array<Vec3, MAX_MESHLET_TRIANGLES> normals;
+    std::array<Vec3, MAX_MESHLET_TRIANGLES> corners;
+    uint32_t normal_count = 0;
+    Vec3 axis = {0.0f, 0.0f, 0.0f};
+
+    const uint8_t* tris = chunk.Triangles.data() + meshlet.TriangleOffset;
+    for (uint32_t t = 0; t < meshlet.TriangleCount; ++t) {
+        const Vec3& p0 = position(tris[t * 3 + 0]);
+        const Vec3& p1 = position(tris[t * 3 + 1]);
+        const Vec3& p2 = position(tris[t * 3 + 2]);
+
+        Vec3 n = Cross(Sub(p1, p0), Sub(p2, p0));
+        float len = std::sqrt(Dot(n, n));
+        if (len <= std::numeric_limits<float>::min()) {
+            continue;
+        }
+        n = {n[0] / len, n[1] / len, n[2] / len};
+
+        normals[normal_count] = n;
+        corners[normal_count] = p0;
+        normal_count++;
+        axis = {axis[0] + n[0], axis[1] + n[1], axis[2] + n[2]};
+    }
+
+    float axis_len = std::sqrt(Dot(axis, axis));
+    float min_dot = 1.0f;
+    if (axis_len > 0.0f) {
+        axis = {axis[0] / axis_len, axis[1] / axis_len, axis[2] / axis_len};
+        for (uint32_t i = 0; i < normal_count; ++i) {
+            min_dot = std::min(min_dot, Dot(axis, normals[i]));
+        }
+    }
+
+    // Cones wider than ~84 degrees would almost never cull anything; store one that never does.
+    if (normal_count == 0 || axis_len == 0.0f || min_dot <= 0.1f) {
+        meshlet.ConeApex = center;
+        meshlet.ConeAxis = {0.0f, 0.0f, 0.0f};
+        meshlet.ConeCutoff = 1.0f;
+        return;
+    }
+
+    // Move the apex back along the axis until every triangle plane is in front of it.
+    float max_t = 0.0f;
+    for (uint32_t i = 0; i < normal_count; ++i) {
+        float dc = Dot(Sub(center, corners[i]), normals[i]);
+        float dn = Dot(axis, normals[i]);
+        max_t = std::max(max_t, dc / dn);
+    }
+
+    meshlet.ConeApex = {center[0] - axis[0] * max_t, center[1] - axis[1] * max_t, center[2] - axis[2] * max_t};
+    meshlet.ConeAxis = axis;
+    meshlet.ConeCutoff = std::sqrt(1.0f - min_dot * min_dot);
+}
+
+void BuildMeshletChunk(std::span<const uint32_t> indices, std::span<const PackedVertex> verts, MeshletChunk& chunk) {
+    std::array<uint32_t, MAX_MESHLET_VERTICES> local_verts;
+    uint32_t vertex_count = 0;
+    uint32_t triangle_count = 0;
+
+    auto flush = [&]() {
+        if (triangle_count == 0) {
+            return;
+        }
+
+        Meshlet meshlet{};
+        meshlet.VertexOffset = static_cast<uint32_t>(chunk.Vertices.size());
+        meshlet.TriangleOffset = static_cast<uint32_t>(chunk.Triangles.size() - triangle_count * 3);
+        meshlet.VertexCount = vertex_count;
+        meshlet.TriangleCount = triangle_count;
+
+        chunk.Vertices.insert(chunk.Vertices.end(), local_verts.begin(), local_verts.begin() + vertex_count);
+        while (chunk.Triangles.size() % 4 != 0) {
+            chunk.Triangles.push_back(0);
+        }
+
+        ComputeMeshletBounds(meshlet, chunk, verts);
+        chunk.Meshlets.push_back(meshlet);
+
+        vertex_count = 0;
+        triangle_count = 0;
+    };
+
+    auto find_local = [&](uint32_t v) -> uint32_t {
+        for (uint32_t i = 0; i < vertex_count; ++i) {
+            if (local_verts[i] == v) {
+                return i;
+            }
+        }
+        return MAX_MESHLET_VERTICES;
+    };
+
+    for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+        const uint32_t tri[3] = {indices[t], indices[t + 1], indices[t + 2]};
+
+        uint32_t new_verts = 0;
+        for (int c = 0; c < 3; ++c) {
+            bool seen_in_tri = (c > 0 && tri[c] == tri[0]) || (c > 1 && tri[c] == tri[1]);
+            if (!seen_in_tri && find_local(tri[c]) == MAX_MESHLET_VERTICES) {
+                new_verts++;
+            }
+        }
+
+        if (vertex_count + new_verts > MAX_MESHLET_VERTICES || triangle_count + 1 > MAX_MESHLET_TRIANGLES) {
+            flush();
+        }
+
+        for (int c = 0; c < 3; ++c) {
+            uint32_t local = find_local(tri[c]);
+            if (local == MAX_MESHLET_VERTICES) {
+                local = vertex_count;
+                local_verts[vertex_count++] = tri[c];
+            }
+            chunk.Triangles.push_back(static_cast<uint8_t>(local));
+        }
+        triangle_count++;
+    }
+
+    flush();
+}
+
+} // namespace
+
+void BuildMeshlets(PackedTriangleMesh& mesh) {
+    try {
+        mesh.Meshlets.clear();
+        mesh.MeshletVertices.clear();
+        mesh.MeshletTriangles.clear();
+
+        for (uint32_t index : mesh.Indices) {
+            if (index >= mesh.Verts.size()) {
+                throw std::runtime_error("vertex index out of range");
+            }
+        }
+
+        // Chunks (first triangle, triangle count) split at material range boundaries, so no
+        // meshlet mixes two materials.
+        std::vector<std::pair<size_t, size_t>> spans;
+        auto add_spans = [&](size_t first, size_t count) {
+            for (size_t offset = 0; offset < count; offset += TRIANGLES_PER_CHUNK) {
+                spans.emplace_back(first + offset, std::min(TRIANGLES_PER_CHUNK, count - offset));
+            }
+        };
+        size_t level0_ranges = mesh.Lods.empty() ? mesh.MaterialRanges.size() : mesh.Lods[0].FirstRange;
+        if (level0_ranges == 0) {
+            add_spans(0, mesh.Indices.size() / 3);
+        }
+        for (size_t r = 0; r < level0_ranges; ++r) {
+            const MaterialRange& range = mesh.MaterialRanges[r];
+            if (range.FirstIndex % 3 != 0 || range.IndexCount % 3 != 0 ||
+                size_t(range.FirstIndex) + range.IndexCount > mesh.Indices.size()) {
+                throw std::runtime_error("material range out of bounds");
+            }
+            add_spans(range.FirstIndex / 3, range.IndexCount / 3);
+        }
+
+        std::vector<MeshletChunk> chunks(spans.size());
+        tekki::core::ParallelFor(spans.size(), [&](size_t c) {
+            auto [first, count] = spans[c];
+            BuildMeshletChunk(std::span<const uint32_t>(mesh.Indices).subspan(first * 3, count * 3), mesh.Verts, chunks[c]);
+        });
+
+        size_t meshlet_count = 0;
+        size_t vertex_count = 0;
+        size_t triangle_bytes = 0;
+        for (const auto& chunk : chunks) {
+            meshlet_count += chunk.Meshlets.size();
+            vertex_count += chunk.Vertices.size();
+            triangle_bytes += chunk.Triangles.size();
+        }
+        if (vertex_count > std::numeric_limits<uint32_t>::max() || triangle_bytes > std::numeric_limits<uint32_t>::max()) {
+            throw std::runtime_error("meshlet data exceeds 32-bit offsets");
+        }
+
+        mesh.Meshlets.reserve(meshlet_count);
+        mesh.MeshletVertices.reserve(vertex_count);
+        mesh.MeshletTriangles.reserve(triangle_bytes);
+
+        for (const auto& chunk : chunks) {
+            uint32_t vertex_base = static_cast<uint32_t>(mesh.MeshletVertices.size());
+            uint32_t triangle_base = static_cast<uint32_t>(mesh.MeshletTriangles.size());
+
+            for (Meshlet meshlet : chunk.Meshlets) {
+                meshlet.VertexOffset += vertex_base;
+                meshlet.TriangleOffset += triangle_base;
+                mesh.Meshlets.push_back(meshlet);
+            }
+            mesh.MeshletVertices.insert(mesh.MeshletVertices.end(), chunk.Vertices.begin(), chunk.Vertices.end());
+            mesh.MeshletTriangles.insert(mesh.MeshletTriangles.end(), chunk.Triangles.begin(), chunk.Triangles.end());
+        }
+
+    } catch (const std::exception& e) {
+        throw std::runtime_error("Failed to build meshlets: " + std::string(e.what()));
+    }
+}
+
+} // namespace tekki::asset
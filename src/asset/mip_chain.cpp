@@ -0,0 +1,326 @@
+#include "tekki/asset/mip_chain.h"
+#include "tekki/core/parallel.h"
+#include <array>
+#include <cmath>
+#include <numbers>
+#include <stdexcept>
+#include <string>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    #define TEKKI_MIP_X86 1
+    #include <immintrin.h>
+#endif
+
+namespace tekki::asset {
+
+namespace {
+
+constexpr size_t ROWS_PER_TASK = 8;
+
+// Kaiser-windowed sinc: radius in destination texels and window shape, as in most offline
+// texture tools.
+constexpr double KAISER_RADIUS = 3.0;
+constexpr double KAISER_ALPHA = 4.0;
+
+// Linear values are re-encoded to sRGB through a table this fine; the steepest part of the
+// curve (12.92 near black) then moves less than a quarter of a byte per step.
+constexpr size_t SRGB_ENCODE_STEPS = 16384;
+
+// Offset of the linear half of ColourTables::Decode.
+constexpr int32_t LINEAR_DECODE = 256;
+
+double SrgbToLinear(double v) {
+    return v <= 0.04045 ? v / 12.92 : std::pow((v + 0.055) / 1.055, 2.4);
+}
+
+double LinearToSrgb(double v) {
+    return v <= 0.0031308 ? v * 12.92 : 1.055 * std::pow(v, 1.0 / 2.4) - 0.055;
+}
+
+struct ColourTables {
+    // [0, 256): sRGB byte to linear, [256, 512): byte / 255.
+    std::array<float, 512> Decode;
+    std::array<uint8_t, SRGB_ENCODE_STEPS + 1> SrgbEncode;
+
+    ColourTables() {
+        for (int i = 0; i < 256; ++i) {
+            Decode[i] = static_cast<float>(SrgbToLinear(i / 255.0));
+            Decode[LINEAR_DECODE + i] = static_cast<float>(i / 255.0);
+        }
+        for (size_t i = 0; i <= SRGB_ENCODE_STEPS; ++i) {
+            double srgb = LinearToSrgb(static_cast<double>(i) / SRGB_ENCODE_STEPS);
+            SrgbEncode[i] = static_cast<uint8_t>(std::lround(std::clamp(srgb, 0.0, 1.0) * 255.0));
+        }
+    }
+};
+
+const ColourTables& Tables() {
+    static const ColourTables tables;
+    return tables;
+}
+
+// Separable weights along one axis: destination texel i reads Count[i] contiguous source
+// texels starting at First[i], weighted by Weights[i * Stride ..].
+struct AxisFilter {
+    std::vector<uint32_t> First;
+    std::vector<uint32_t> Count;
+    std::vector<float> Weights;
+    uint32_t Stride = 0;
+};
+
+double BesselI0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 32; ++k) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+        if (term < sum * 1e-12) {
+            break;
+        }
+    }
+    return sum;
+}
+
+double KaiserSinc(double t) {
+    double u = t / KAISER_RADIUS;
+    if (std::abs(u) >= 1.0) {
+        return 0.0;
+    }
+    double sinc = t == 0.0 ? 1.0 : std::sin(std::numbers::pi * t) / (std::numbers::pi * t);
+    return sinc * BesselI0(KAISER_ALPHA * std::sqrt(1.0 - u * u)) / BesselI0(KAISER_ALPHA);
+}
+
+AxisFilter BuildAxisFilter(uint32_t srcSize, uint32_t dstSize, TexMipFilter filter) {
+    const double scale = static_cast<double>(srcSize) / dstSize;
+    const int64_t last = static_cast<int64_t>(srcSize) - 1;
+
+    std::vector<std::vector<double>> taps(dstSize);
+    AxisFilter axis;
+    axis.First.resize(dstSize);
+    axis.Count.resize(dstSize);
+
+    for (uint32_t x = 0; x < dstSize; ++x) {
+        int64_t lo = 0;
+        int64_t hi = 0;
+        std::vector<double> raw;
+        if (filter == TexMipFilter::Box) {
+            // Every source texel contributes the length of its overlap with the footprint.
+            double begin = x * scale;
+            double end = (x + 1) * scale;
+            lo = static_cast<int64_t>(std::floor(begin));
+            hi = static_cast<int64_t>(std::ceil(end)) - 1;
+            for (int64_t i = lo; i <= hi; ++i) {
+                raw.push_back(std::min(end, i + 1.0) - std::max(begin, static_cast<double>(i)));
+            }
+        } else {
+            double centre = (x + 0.5) * scale;
+            double support = KAISER_RADIUS * scale;
+            lo = static_cast<int64_t>(std::floor(centre - support));
+            hi = static_cast<int64_t>(std::ceil(centre + support));
+            for (int64_t i = lo; i <= hi; ++i) {
+                raw.push_back(KaiserSinc((i + 0.5 - centre) / scale));
+            }
+        }
+
+        // Taps past the edges fold onto the edge texel, which keeps the range contiguous.
+        int64_t first = std::clamp<int64_t>(lo, 0, last);
+        std::vector<double>& merged = taps[x];
+        merged.assign(static_cast<size_t>(std::clamp<int64_t>(hi, 0, last) - first + 1), 0.0);
+        for (int64_t i = lo; i <= hi; ++i) {
+            merged[static_cast<size_t>(std::clamp<int64_t>(i, 0, last) - first)] += raw[static_cast<size_t>(i - lo)];
+        }
+
+        axis.First[x] = static_cast<uint32_t>(first);
+        axis.Count[x] = static_cast<uint32_t>(merged.size());
+        axis.Stride = std::max(axis.Stride, axis.Count[x]);
+    }
+
+    axis.Weights.assign(static_cast<size_t>(dstSize) * axis.Stride, 0.0f);
+    for (uint32_t x = 0; x < dstSize; ++x) {
+        double sum = 0.0;
+        for (double w : taps[x]) {
+            sum += w;
+        }
+        for (size_t j = 0; j < taps[x].size(); ++j) {
+            axis.Weights[x * axis.Stride + j] = static_cast<float>(taps[x][j] / sum);
+        }
+    }
+    return axis;
+}
+
+// row[i] += decode[bytes[i] + offsets[i % 4]] * weight, for `count` bytes (a multiple of 4).
+using AccumulateRowFn = void (*)(const uint8_t* bytes, size_t count, const float* decode,
+                                 const int32_t* offsets, float weight, float* row);
+
+void AccumulateRowScalar(const uint8_t* bytes, size_t count, const float* decode, const int32_t* offsets,
+                         float weight, float* row) {
+    for (size_t i = 0; i < count; i += 4) {
+        for (size_t c = 0; c < 4; ++c) {
+            row[i + c] += decode[bytes[i + c] + offsets[c]] * weight;
+        }
+    }
+}
+
+#ifdef TEKKI_MIP_X86
+__attribute__((target("avx2,fma"))) void AccumulateRowAvx2(const uint8_t* bytes, size_t count, const float* decode,
+                                                           const int32_t* offsets, float weight, float* row) {
+    const __m256i offs = _mm256_setr_epi32(offsets[0], offsets[1], offsets[2], offsets[3], offsets[0], offsets[1],
+                                           offsets[2], offsets[3]);
+    const __m256 w = _mm256_set1_ps(weight);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i packed = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(bytes + i));
+        __m256i index = _mm256_add_epi32(_mm256_cvtepu8_epi32(packed), offs);
+        __m256 linear = _mm256_i32gather_ps(decode, index, 4);
+        _mm256_storeu_ps(row + i, _mm256_fmadd_ps(linear, w, _mm256_loadu_ps(row + i)));
+    }
+    AccumulateRowScalar(bytes + i, count - i, decode, offsets, weight, row + i);
+}
+#endif
+
+AccumulateRowFn SelectAccumulateRow() {
+#ifdef TEKKI_MIP_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return AccumulateRowAvx2;
+    }
+#endif
+    return AccumulateRowScalar;
+}
+
+AccumulateRowFn AccumulateRow() {
+    static const AccumulateRowFn fn = SelectAccumulateRow();
+    return fn;
+}
+
+uint8_t EncodeLinear(float v) {
+    return static_cast<uint8_t>(std::clamp(v, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+uint8_t EncodeSrgb(const ColourTables& tables, float v) {
+    return tables.SrgbEncode[static_cast<size_t>(std::clamp(v, 0.0f, 1.0f) * SRGB_ENCODE_STEPS + 0.5f)];
+}
+
+void DownsampleLevel(std::span<const uint8_t> src, uint32_t srcWidth, uint32_t srcHeight, std::span<uint8_t> dst,
+                     uint32_t dstWidth, uint32_t dstHeight, const MipChainOptions& options) {
+    const ColourTables& tables = Tables();
+    const AccumulateRowFn accumulate = AccumulateRow();
+    const AxisFilter horizontal = BuildAxisFilter(srcWidth, dstWidth, options.Filter);
+    const AxisFilter vertical = BuildAxisFilter(srcHeight, dstHeight, options.Filter);
+
+    const bool srgb = options.Gamma == TexGamma::Srgb;
+    const int32_t colour_offset = srgb ? 0 : LINEAR_DECODE;
+    const std::array<int32_t, 4> offsets = {colour_offset, colour_offset, colour_offset, LINEAR_DECODE};
+    const size_t src_pitch = static_cast<size_t>(srcWidth) * 4;
+    const size_t dst_pitch = static_cast<size_t>(dstWidth) * 4;
+
+    const size_t tasks = (dstHeight + ROWS_PER_TASK - 1) / ROWS_PER_TASK;
+    tekki::core::ParallelFor(tasks, [&](size_t task) {
+        std::vector<float> row(src_pitch);
+        const size_t y_end = std::min<size_t>((task + 1) * ROWS_PER_TASK, dstHeight);
+        for (size_t y = task * ROWS_PER_TASK; y < y_end; ++y) {
+            // Vertical pass: decode and blend the contributing source rows into one float row.
+            std::fill(row.begin(), row.end(), 0.0f);
+            const float* vweights = &vertical.Weights[y * vertical.Stride];
+            for (uint32_t j = 0; j < vertical.Count[y]; ++j) {
+                const uint8_t* src_row = src.data() + (vertical.First[y] + j) * src_pitch;
+                accumulate(src_row, src_pitch, tables.Decode.data(), offsets.data(), vweights[j], row.data());
+            }
+
+            // Horizontal pass straight into the destination level.
+            uint8_t* out = dst.data() + y * dst_pitch;
+            for (uint32_t x = 0; x < dstWidth; ++x) {
+                float acc[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+                const float* hweights = &horizontal.Weights[static_cast<size_t>(x) * horizontal.Stride];
+                const float* texel = row.data() + static_cast<size_t>(horizontal.First[x]) * 4;
+                for (uint32_t j = 0; j < horizontal.Count[x]; ++j, texel += 4) {
+                    for (int c = 0; c < 4; ++c) {
+                        acc[c] += texel[c] * hweights[j];
+                    }
+                }
+                for (int c = 0; c < 3; ++c) {
+                    out[x * 4 + c] = srgb ? EncodeSrgb(tables, acc[c]) : EncodeLinear(acc[c]);
+                }
+                out[x * 4 + 3] = EncodeLinear(acc[3]);
+            }
+        }
+    });
+}
+
+} // namespace
+
+void GenerateMipChainInto(std::span<const uint8_t> rgba, uint32_t width, uint32_t height,
+                          std::span<std::vector<uint8_t>> levels, const MipChainOptions& options) {
+    if (rgba.size() != static_cast<size_t>(width) * height * 4) {
+        throw std::runtime_error("Mip chain source is " + std::to_string(rgba.size()) + " bytes, expected " +
+                                 std::to_string(static_cast<size_t>(width) * height * 4));
+    }
+
+    std::span<const uint8_t> src = rgba;
+    for (size_t i = 0; i < levels.size(); ++i) {
+        const uint32_t level = static_cast<uint32_t>(i + 1);
+        if (levels[i].size() != MipByteSize(width, height, level)) {
+            throw std::runtime_error("Mip level " + std::to_string(level) + " storage is " +
+                                     std::to_string(levels[i].size()) + " bytes, expected " +
+                                     std::to_string(MipByteSize(width, height, level)));
+        }
+
+        DownsampleLevel(src, MipExtent(width, level - 1), MipExtent(height, level - 1), levels[i],
+                        MipExtent(width, level), MipExtent(height, level), options);
+        src = levels[i];
+    }
+}
+
+std::vector<std::vector<uint8_t>> GenerateMipChain(std::span<const uint8_t> rgba, uint32_t width, uint32_t height,
+                                                   const MipChainOptions& options) {
+    std::vector<std::vector<uint8_t>> levels(MipLevelCount(width, height) - 1);
+    for (size_t i = 0; i < levels.size(); ++i) {
+        levels[i].resize(MipByteSize(width, height, static_cast<uint32_t>(i + 1)));
+    }
+    GenerateMipChainInto(rgba, width, height, levels, options);
+    return levels;
+}
+
+void DownsampleRgba32f(std::span<const float> src, uint32_t srcWidth, uint32_t srcHeight, std::span<float> dst,
+                       uint32_t dstWidth, uint32_t dstHeight, TexMipFilter filter) {
+    if (src.size() != static_cast<size_t>(srcWidth) * srcHeight * 4 ||
+        dst.size() != static_cast<size_t>(dstWidth) * dstHeight * 4) {
+        throw std::runtime_error("RGBA32F level sizes don't match their extents");
+    }
+
+    const AxisFilter horizontal = BuildAxisFilter(srcWidth, dstWidth, filter);
+    const AxisFilter vertical = BuildAxisFilter(srcHeight, dstHeight, filter);
+    const size_t src_pitch = static_cast<size_t>(srcWidth) * 4;
+    const size_t dst_pitch = static_cast<size_t>(dstWidth) * 4;
+
+    const size_t tasks = (dstHeight + ROWS_PER_TASK - 1) / ROWS_PER_TASK;
+    tekki::core::ParallelFor(tasks, [&](size_t task) {
+        std::vector<float> row(src_pitch);
+        const size_t y_end = std::min<size_t>((task + 1) * ROWS_PER_TASK, dstHeight);
+        for (size_t y = task * ROWS_PER_TASK; y < y_end; ++y) {
+            std::fill(row.begin(), row.end(), 0.0f);
+            const float* vweights = &vertical.Weights[y * vertical.Stride];
+            for (uint32_t j = 0; j < vertical.Count[y]; ++j) {
+                const float* src_row = src.data() + (vertical.First[y] + j) * src_pitch;
+                for (size_t i = 0; i < src_pitch; ++i) {
+                    row[i] += src_row[i] * vweights[j];
+                }
+            }
+
+            float* out = dst.data() + y * dst_pitch;
+            for (uint32_t x = 0; x < dstWidth; ++x) {
+                float acc[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+                const float* hweights = &horizontal.Weights[static_cast<size_t>(x) * horizontal.Stride];
+                const float* texel = row.data() + static_cast<size_t>(horizontal.First[x]) * 4;
+                for (uint32_t j = 0; j < horizontal.Count[x]; ++j, texel += 4) {
+                    for (int c = 0; c < 4; ++c) {
+                        acc[c] += texel[c] * hweights[j];
+                    }
+                }
+                std::copy_n(acc, 4, out + x * 4);
+            }
+        }
+    });
+}
+
+} // namespace tekki::asset
@@ -0,0 +1,323 @@
+#include "tekki/asset/mesh.h"
+#include "tekki/core/parallel.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define TEKKI_TANGENT_CALC_SSE2 1
+    #include <emmintrin.h>
+#endif
+
+// MikkTSpace-style tangent generation (after Morten Mikkelsen's reference mikktspace.c).
+//
+// Per triangle, the unit dP/ds and dP/dt directions are computed from the position and UV
+// deltas. Every vertex then gathers the triangles around it, projects their directions onto
+// its normal, and sums them weighted by the corner angle. The handedness follows from the
+// summed dP/dt. Unlike the reference, vertices are never split where the tangent frames of
+// adjacent triangles disagree, because the caller's vertex streams have a fixed size.
+//
+// The work runs in three parallel passes over independent ranges (face bases, the
+// vertex-to-corner adjacency, and the per-vertex gather). The corners of each vertex are
+// summed in sorted order, so the output does not depend on thread scheduling.
+
+namespace tekki::asset {
+
+namespace {
+
+constexpr size_t TRIANGLES_PER_TASK = 1 << 16;
+constexpr size_t VERTICES_PER_TASK = 1 << 15;
+
+// Unit dP/ds and dP/dt of one triangle; zero where the UV mapping is degenerate.
+struct FaceBasis {
+    std::array<float, 3> Os;
+    std::array<float, 3> Ot;
+};
+
+using Vec3 = std::array<float, 3>;
+
+inline Vec3 Sub(const Vec3& a, const Vec3& b) {
+    return {a[0] - b[0], a[1] - b[1], a[2] - b[2]};
+}
+
+inline float Dot(const Vec3& a, const Vec3& b) {
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+inline Vec3 Cross(const Vec3& a, const Vec3& b) {
+    return {a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0]};
+}
+
+// Removes the component along `n` and normalizes; returns false for (near) zero results.
+inline bool ProjectAndNormalize(Vec3& v, const Vec3& n) {
+    float d = Dot(n, v);
+    v = {v[0] - d * n[0], v[1] - d * n[1], v[2] - d * n[2]};
+    float len_sq = Dot(v, v);
+    if (len_sq <= std::numeric_limits<float>::min()) {
+        return false;
+    }
+    float inv_len = 1.0f / std::sqrt(len_sq);
+    v = {v[0] * inv_len, v[1] * inv_len, v[2] * inv_len};
+    return true;
+}
+
+FaceBasis ComputeFaceBasis(const TangentCalcContext& ctx, size_t tri) {
+    const Vec3& p0 = ctx.Positions[ctx.Indices[tri * 3 + 0]];
+    const Vec3& p1 = ctx.Positions[ctx.Indices[tri * 3 + 1]];
+    const Vec3& p2 = ctx.Positions[ctx.Indices[tri * 3 + 2]];
+    const auto& t0 = ctx.Uvs[ctx.Indices[tri * 3 + 0]];
+    const auto& t1 = ctx.Uvs[ctx.Indices[tri * 3 + 1]];
+    const auto& t2 = ctx.Uvs[ctx.Indices[tri * 3 + 2]];
+
+    Vec3 d1 = Sub(p1, p0);
+    Vec3 d2 = Sub(p2, p0);
+    float t21x = t1[0] - t0[0];
+    float t21y = t1[1] - t0[1];
+    float t31x = t2[0] - t0[0];
+    float t31y = t2[1] - t0[1];
+
+    FaceBasis basis{};
+
+    float signed_area = t21x * t31y - t21y * t31x;
+    if (signed_area == 0.0f) {
+        return basis;
+    }
+    float sign = signed_area > 0.0f ? 1.0f : -1.0f;
+
+    for (int i = 0; i < 3; ++i) {
+        basis.Os[i] = t31y * d1[i] - t21y * d2[i];
+        basis.Ot[i] = -t31x * d1[i] + t21x * d2[i];
+    }
+
+    float len_os = std::sqrt(Dot(basis.Os, basis.Os));
+    float len_ot = std::sqrt(Dot(basis.Ot, basis.Ot));
+    float scale_os = len_os > 0.0f ? sign / len_os : 0.0f;
+    float scale_ot = len_ot > 0.0f ? sign / len_ot : 0.0f;
+    for (int i = 0; i < 3; ++i) {
+        basis.Os[i] *= scale_os;
+        basis.Ot[i] *= scale_ot;
+    }
+
+    return basis;
+}
+
+#ifdef TEKKI_TANGENT_CALC_SSE2
+
+// Computes four face bases at once, lane i holding triangle `first + i`. Matches
+// ComputeFaceBasis lane for lane.
+void ComputeFaceBasis4(const TangentCalcContext& ctx, size_t first, FaceBasis* out) {
+    alignas(16) float p[3][3][4];
+    alignas(16) float t[3][2][4];
+
+    for (int lane = 0; lane < 4; ++lane) {
+        for (int corner = 0; corner < 3; ++corner) {
+            uint32_t idx = ctx.Indices[(first + lane) * 3 + corner];
+            const Vec3& pos = ctx.Positions[idx];
+            const auto& uv = ctx.Uvs[idx];
+            p[corner][0][lane] = pos[0];
+            p[corner][1][lane] = pos[1];
+            p[corner][2][lane] = pos[2];
+            t[corner][0][lane] = uv[0];
+            t[corner][1][lane] = uv[1];
+        }
+    }
+
+    __m128 t21x = _mm_sub_ps(_mm_load_ps(t[1][0]), _mm_load_ps(t[0][0]));
+    __m128 t21y = _mm_sub_ps(_mm_load_ps(t[1][1]), _mm_load_ps(t[0][1]));
+    __m128 t31x = _mm_sub_ps(_mm_load_ps(t[2][0]), _mm_load_ps(t[0][0]));
+    __m128 t31y = _mm_sub_ps(_mm_load_ps(t[2][1]), _mm_load_ps(t[0][1]));
+
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+
+    __m128 signed_area = _mm_sub_ps(_mm_mul_ps(t21x, t31y), _mm_mul_ps(t21y, t31x));
+    __m128 valid = _mm_cmpneq_ps(signed_area, zero);
+    __m128 sign = _mm_or_ps(_mm_and_ps(_mm_cmplt_ps(signed_area, zero), _mm_set1_ps(-0.0f)), one);
+
+    __m128 os[3];
+    __m128 ot[3];
+    for (int i = 0; i < 3; ++i) {
+        __m128 p0 = _mm_load_ps(p[0][i]);
+        __m128 d1 = _mm_sub_ps(_mm_load_ps(p[1][i]), p0);
+        __m128 d2 = _mm_sub_ps(_mm_load_ps(p[2][i]), p0);
+        os[i] = _mm_sub_ps(_mm_mul_ps(t31y, d1), _mm_mul_ps(t21y, d2));
+        ot[i] = _mm_sub_ps(_mm_mul_ps(t21x, d2), _mm_mul_ps(t31x, d1));
+    }
+
+    auto unit_scale = [&](const __m128* v) {
+        __m128 len = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(v[0], v[0]), _mm_mul_ps(v[1], v[1])),
+                                            _mm_mul_ps(v[2], v[2])));
+        __m128 nonzero = _mm_and_ps(_mm_cmpgt_ps(len, zero), valid);
+        __m128 safe_len = _mm_or_ps(_mm_and_ps(nonzero, len), _mm_andnot_ps(nonzero, one));
+        return _mm_and_ps(_mm_div_ps(sign, safe_len), nonzero);
+    };
+
+    __m128 scale_os = unit_scale(os);
+    __m128 scale_ot = unit_scale(ot);
+
+    alignas(16) float result[6][4];
+    for (int i = 0; i < 3; ++i) {
+        _mm_store_ps(result[i], _mm_mul_ps(os[i], scale_os));
+        _mm_store_ps(result[3 + i], _mm_mul_ps(ot[i], scale_ot));
+    }
+
+    for (int lane = 0; lane < 4; ++lane) {
+        out[lane].Os = {result[0][lane], result[1][lane], result[2][lane]};
+        out[lane].Ot = {result[3][lane], result[4][lane], result[5][lane]};
+    }
+}
+
+#endif
+
+void ComputeFaceBases(const TangentCalcContext& ctx, size_t first, size_t count, FaceBasis* out) {
+    size_t tri = first;
+    size_t end = first + count;
+
+#ifdef TEKKI_TANGENT_CALC_SSE2
+    for (; tri + 4 <= end; tri += 4) {
+        ComputeFaceBasis4(ctx, tri, out + (tri - first));
+    }
+#endif
+
+    for (; tri < end; ++tri) {
+        out[tri - first] = ComputeFaceBasis(ctx, tri);
+    }
+}
+
+// Any unit vector perpendicular to `n`, for vertices with no usable UV gradient.
+Vec3 ArbitraryTangent(const Vec3& n) {
+    Vec3 axis = std::abs(n[0]) < 0.9f ? Vec3{1.0f, 0.0f, 0.0f} : Vec3{0.0f, 1.0f, 0.0f};
+    Vec3 t = axis;
+    if (!ProjectAndNormalize(t, n)) {
+        return axis;
+    }
+    return t;
+}
+
+} // namespace
+
+void TangentCalcContext::GenerateTangents() {
+    try {
+        size_t vertex_count = Tangents.size();
+        if (Positions.size() != vertex_count || Normals.size() != vertex_count || Uvs.size() != vertex_count) {
+            throw std::runtime_error("vertex stream sizes differ");
+        }
+        if (vertex_count == 0) {
+            return;
+        }
+
+        size_t triangle_count = Indices.size() / 3;
+        if (triangle_count * 3 > std::numeric_limits<uint32_t>::max()) {
+            throw std::runtime_error("too many triangles");
+        }
+
+        for (uint32_t index : Indices) {
+            if (index >= vertex_count) {
+                throw std::runtime_error("vertex index out of range");
+            }
+        }
+
+        size_t triangle_tasks = (triangle_count + TRIANGLES_PER_TASK - 1) / TRIANGLES_PER_TASK;
+        size_t corner_count = triangle_count * 3;
+
+        // Pass 1: per-face bases.
+        std::vector<FaceBasis> bases(triangle_count);
+        tekki::core::ParallelFor(triangle_tasks, [&](size_t task) {
+            size_t first = task * TRIANGLES_PER_TASK;
+            size_t count = std::min(TRIANGLES_PER_TASK, triangle_count - first);
+            ComputeFaceBases(*this, first, count, bases.data() + first);
+        });
+
+        // Pass 2: vertex -> corner adjacency (CSR), filled with relaxed atomics.
+        std::vector<uint32_t> corner_offsets(vertex_count + 1, 0);
+        tekki::core::ParallelFor(triangle_tasks, [&](size_t task) {
+            size_t first = task * TRIANGLES_PER_TASK * 3;
+            size_t last = std::min(first + TRIANGLES_PER_TASK * 3, corner_count);
+            for (size_t c = first; c < last; ++c) {
+                std::atomic_ref<uint32_t>(corner_offsets[Indices[c] + 1]).fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+
+        for (size_t v = 0; v < vertex_count; ++v) {
+            corner_offsets[v + 1] += corner_offsets[v];
+        }
+
+        std::vector<uint32_t> corner_cursor(corner_offsets.begin(), corner_offsets.end() - 1);
+        std::vector<uint32_t> vertex_corners(corner_count);
+        tekki::core::ParallelFor(triangle_tasks, [&](size_t task) {
+            size_t first = task * TRIANGLES_PER_TASK * 3;
+            size_t last = std::min(first + TRIANGLES_PER_TASK * 3, corner_count);
+            for (size_t c = first; c < last; ++c) {
+                uint32_t slot = std::atomic_ref<uint32_t>(corner_cursor[Indices[c]]).fetch_add(1, std::memory_order_relaxed);
+                vertex_corners[slot] = static_cast<uint32_t>(c);
+            }
+        });
+
+        // Pass 3: angle-weighted gather per vertex.
+        size_t vertex_tasks = (vertex_count + VERTICES_PER_TASK - 1) / VERTICES_PER_TASK;
+        tekki::core::ParallelFor(vertex_tasks, [&](size_t task) {
+            size_t first = task * VERTICES_PER_TASK;
+            size_t last = std::min(first + VERTICES_PER_TASK, vertex_count);
+
+            for (size_t v = first; v < last; ++v) {
+                const Vec3& n = Normals[v];
+                const Vec3& p = Positions[v];
+
+                auto corners_begin = vertex_corners.begin() + corner_offsets[v];
+                auto corners_end = vertex_corners.begin() + corner_offsets[v + 1];
+                std::sort(corners_begin, corners_end);
+
+                Vec3 sum_os = {0.0f, 0.0f, 0.0f};
+                Vec3 sum_ot = {0.0f, 0.0f, 0.0f};
+
+                for (auto it = corners_begin; it != corners_end; ++it) {
+                    size_t tri = *it / 3;
+                    size_t corner = *it % 3;
+                    const FaceBasis& basis = bases[tri];
+
+                    Vec3 os = basis.Os;
+                    Vec3 ot = basis.Ot;
+                    bool has_os = ProjectAndNormalize(os, n);
+                    bool has_ot = ProjectAndNormalize(ot, n);
+                    if (!has_os && !has_ot) {
+                        continue;
+                    }
+
+                    Vec3 e_prev = Sub(Positions[Indices[tri * 3 + (corner + 2) % 3]], p);
+                    Vec3 e_next = Sub(Positions[Indices[tri * 3 + (corner + 1) % 3]], p);
+                    if (!ProjectAndNormalize(e_prev, n) || !ProjectAndNormalize(e_next, n)) {
+                        continue;
+                    }
+                    float angle = std::acos(std::clamp(Dot(e_prev, e_next), -1.0f, 1.0f));
+
+                    for (int i = 0; i < 3; ++i) {
+                        if (has_os) {
+                            sum_os[i] += angle * os[i];
+                        }
+                        if (has_ot) {
+                            sum_ot[i] += angle * ot[i];
+                        }
+                    }
+                }
+
+                Vec3 t = sum_os;
+                if (!ProjectAndNormalize(t, n)) {
+                    t = ArbitraryTangent(n);
+                }
+
+                float handedness = Dot(Cross(n, t), sum_ot) < 0.0f ? -1.0f : 1.0f;
+                Tangents[v] = {t[0], t[1], t[2], handedness};
+            }
+        });
+
+    } catch (const std::exception& e) {
+        throw std::runtime_error("Failed to generate tangents: " + std::string(e.what()));
+    }
+}
+
+} // namespace tekki::asset
@@ -0,0 +1,120 @@
+#include "tekki/asset/texture_atlas.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+
+namespace tekki::asset {
+
+namespace {
+
+uint32_t AlignToBlock(uint32_t value) {
+    return (value + 3) & ~3u;
+}
+
+} // namespace
+
+AtlasLayout PackAtlas(std::span<const glm::u32vec2> sizes, uint32_t pageSize, uint32_t border) {
+    AtlasLayout layout;
+    layout.Placements.resize(sizes.size());
+
+    std::vector<size_t> order(sizes.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        if (sizes[a].y != sizes[b].y) {
+            return sizes[a].y > sizes[b].y;
+        }
+        return sizes[a].x > sizes[b].x;
+    });
+
+    // Cursor of the current page: the open shelf starts at shelf_y and is shelf_height tall.
+    uint32_t cursor_x = 0;
+    uint32_t shelf_y = 0;
+    uint32_t shelf_height = 0;
+    for (size_t index : order) {
+        const uint32_t cell_width = AlignToBlock(sizes[index].x + 2 * border);
+        const uint32_t cell_height = AlignToBlock(sizes[index].y + 2 * border);
+        if (sizes[index].x == 0 || sizes[index].y == 0 || cell_width > pageSize || cell_height > pageSize) {
+            throw std::runtime_error("A " + std::to_string(sizes[index].x) + "x" + std::to_string(sizes[index].y) +
+                                     " image doesn't fit a " + std::to_string(pageSize) + " texel atlas page");
+        }
+
+        if (!layout.Pages.empty() && cursor_x + cell_width > pageSize) {
+            shelf_y += shelf_height;
+            cursor_x = 0;
+            shelf_height = 0;
+        }
+        if (layout.Pages.empty() || shelf_y + cell_height > pageSize) {
+            layout.Pages.emplace_back(0, 0);
+            cursor_x = 0;
+            shelf_y = 0;
+            shelf_height = 0;
+        }
+
+        auto& page = layout.Pages.back();
+        layout.Placements[index] = {static_cast<uint32_t>(layout.Pages.size() - 1), cursor_x + border, shelf_y + border};
+        cursor_x += cell_width;
+        shelf_height = std::max(shelf_height, cell_height);
+        page.x = std::max(page.x, cursor_x);
+        page.y = std::max(page.y, shelf_y + shelf_height);
+    }
+    return layout;
+}
+
+void BlitAtlasImage(std::span<const uint8_t> rgba, glm::u32vec2 size, std::span<uint8_t> page, uint32_t pageWidth,
+                    uint32_t x, uint32_t y, uint32_t border) {
+    if (rgba.size() != static_cast<size_t>(size.x) * size.y * 4) {
+        throw std::runtime_error("Atlas image pixels don't match its extent");
+    }
+    const size_t page_height = page.size() / 4 / pageWidth;
+    if (x < border || y < border || x + size.x + border > pageWidth || y + size.y + border > page_height) {
+        throw std::runtime_error("Atlas image and its border don't fit the page");
+    }
+
+    for (uint32_t row = 0; row < size.y + 2 * border; ++row) {
+        const uint32_t src_row = std::min(row > border ? row - border : 0, size.y - 1);
+        const uint8_t* src = rgba.data() + static_cast<size_t>(src_row) * size.x * 4;
+        uint8_t* dst = page.data() + ((static_cast<size_t>(y) + row - border) * pageWidth + x - border) * 4;
+        for (uint32_t i = 0; i < border; ++i) {
+            std::memcpy(dst + i * 4, src, 4);
+            std::memcpy(dst + (border + size.x + i) * 4, src + (size.x - 1) * 4, 4);
+        }
+        std::memcpy(dst + border * 4, src, static_cast<size_t>(size.x) * 4);
+    }
+}
+
+uint32_t AtlasMipCount(uint32_t border) {
+    uint32_t levels = 1;
+    while ((border >> levels) > 0) {
+        ++levels;
+    }
+    return levels;
+}
+
+std::array<float, 6> AtlasMapTransform(const std::array<float, 6>& transform, glm::u32vec2 size, uint32_t x, uint32_t y,
+                                       glm::u32vec2 pageSize) {
+    // Rows of the 2x2 part are (m0, m1) and (m2, m3); see MeshMaterial::TransformUv.
+    const float sx = static_cast<float>(size.x) / static_cast<float>(pageSize.x);
+    const float sy = static_cast<float>(size.y) / static_cast<float>(pageSize.y);
+    const float ox = static_cast<float>(x) / static_cast<float>(pageSize.x);
+    const float oy = static_cast<float>(y) / static_cast<float>(pageSize.y);
+    return {transform[0] * sx, transform[1] * sx, transform[2] * sy, transform[3] * sy,
+            transform[4] * sx + ox, transform[5] * sy + oy};
+}
+
+void TransformUvBounds(const std::array<float, 6>& transform, glm::vec2 uvMin, glm::vec2 uvMax, glm::vec2& outMin,
+                       glm::vec2& outMax) {
+    outMin = glm::vec2(std::numeric_limits<float>::max());
+    outMax = glm::vec2(std::numeric_limits<float>::lowest());
+    for (int corner = 0; corner < 4; ++corner) {
+        const glm::vec2 uv((corner & 1) ? uvMax.x : uvMin.x, (corner & 2) ? uvMax.y : uvMin.y);
+        const glm::vec2 mapped(transform[0] * uv.x + transform[1] * uv.y + transform[4],
+                               transform[2] * uv.x + transform[3] * uv.y + transform[5]);
+        outMin = glm::min(outMin, mapped);
+        outMax = glm::max(outMax, mapped);
+    }
+}
+
+} // namespace tekki::asset
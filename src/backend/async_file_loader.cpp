@@ -0,0 +1,601 @@
+#include "tekki/backend/async_file_loader.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <system_error>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+    #define TEKKI_HAS_IO_URING 1
+    #include <fcntl.h>
+    #include <linux/io_uring.h>
+    #include <sys/eventfd.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <sys/syscall.h>
+    #include <sys/uio.h>
+    #include <unistd.h>
+#endif
+
+namespace tekki::backend {
+
+namespace {
+
+// Large files are read in pieces so cancellation and other reads get a look in between.
+constexpr uint64_t READ_CHUNK_BYTES = 8 * 1024 * 1024;
+
+std::string QueueKeyOf(const std::filesystem::path& path) {
+    return path.lexically_normal().string();
+}
+
+} // namespace
+
+FileRead::FileRead(std::filesystem::path path, FileReadPriority priority)
+    : path_(std::move(path)), priority_(priority) {}
+
+FileRead::State FileRead::GetState() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return state_;
+}
+
+bool FileRead::IsFinished() const {
+    State state = GetState();
+    return state != State::Queued && state != State::Reading;
+}
+
+void FileRead::Wait() const {
+    std::unique_lock<std::mutex> lock(mutex_);
+    finished_.wait(lock, [this]() { return state_ != State::Queued && state_ != State::Reading; });
+}
+
+bool FileRead::WaitFor(std::chrono::milliseconds timeout) const {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return finished_.wait_for(lock, timeout,
+                              [this]() { return state_ != State::Queued && state_ != State::Reading; });
+}
+
+std::span<const uint8_t> FileRead::Get() const {
+    Wait();
+    std::lock_guard<std::mutex> lock(mutex_);
+    ThrowIfUnusable();
+    return bytes_;
+}
+
+std::vector<uint8_t> FileRead::Take() {
+    Wait();
+    std::lock_guard<std::mutex> lock(mutex_);
+    ThrowIfUnusable();
+    return std::move(bytes_);
+}
+
+void FileRead::Cancel() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (state_ == State::Queued || state_ == State::Reading) {
+        state_ = State::Cancelled;
+        finished_.notify_all();
+    }
+}
+
+bool FileRead::Start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (state_ != State::Queued) {
+        return false;
+    }
+    state_ = State::Reading;
+    return true;
+}
+
+bool FileRead::Complete(std::vector<uint8_t> bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (state_ != State::Reading) {
+        return false;
+    }
+    bytes_ = std::move(bytes);
+    state_ = State::Done;
+    finished_.notify_all();
+    return true;
+}
+
+void FileRead::Fail(const std::string& error) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (state_ == State::Reading) {
+        error_ = error;
+        state_ = State::Failed;
+        finished_.notify_all();
+    }
+}
+
+void FileRead::ThrowIfUnusable() const {
+    if (state_ == State::Failed) {
+        throw std::runtime_error(error_);
+    }
+    if (state_ == State::Cancelled) {
+        throw std::runtime_error("AsyncFileLoader: read of " + path_.string() + " was cancelled");
+    }
+}
+
+#ifdef TEKKI_HAS_IO_URING
+
+/**
+ * A single io_uring driven by one I/O thread. Every read in flight occupies a slot and has
+ * exactly one readv outstanding; the eventfd read is always armed so queueing a read (or
+ * shutting down) wakes the thread out of io_uring_enter.
+ */
+class AsyncFileLoader::IoUring {
+public:
+    static std::unique_ptr<IoUring> Create(AsyncFileLoader& loader, size_t depth) {
+        std::unique_ptr<IoUring> ring(new IoUring(loader, depth));
+        if (!ring->Setup()) {
+            return nullptr;
+        }
+        ring->thread_ = std::thread([raw = ring.get()]() { raw->Run(); });
+        return ring;
+    }
+
+    ~IoUring() {
+        stop_.store(true, std::memory_order_release);
+        Wake();
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+        if (sqes_) {
+            munmap(sqes_, sqesSize_);
+        }
+        if (cqRing_ && cqRing_ != sqRing_) {
+            munmap(cqRing_, cqRingSize_);
+        }
+        if (sqRing_) {
+            munmap(sqRing_, sqRingSize_);
+        }
+        if (ringFd_ >= 0) {
+            ::close(ringFd_);
+        }
+        if (eventFd_ >= 0) {
+            ::close(eventFd_);
+        }
+    }
+
+    void Wake() {
+        uint64_t one = 1;
+        [[maybe_unused]] auto written = ::write(eventFd_, &one, sizeof(one));
+    }
+
+private:
+    static constexpr uint64_t WAKE_TAG = 0;
+
+    IoUring(AsyncFileLoader& loader, size_t depth)
+        : loader_(loader), slots_(depth), iovecs_(depth) {}
+
+    bool Setup() {
+        io_uring_params params{};
+        ringFd_ = static_cast<int>(syscall(__NR_io_uring_setup, static_cast<unsigned>(slots_.size() + 1), &params));
+        if (ringFd_ < 0) {
+            return false;
+        }
+        eventFd_ = eventfd(0, EFD_CLOEXEC);
+        if (eventFd_ < 0) {
+            return false;
+        }
+
+        sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        const bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single_mmap) {
+            sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+        }
+
+        sqRing_ = Map(sqRingSize_, IORING_OFF_SQ_RING);
+        cqRing_ = single_mmap ? sqRing_ : Map(cqRingSize_, IORING_OFF_CQ_RING);
+        sqesSize_ = params.sq_entries * sizeof(io_uring_sqe);
+        sqes_ = static_cast<io_uring_sqe*>(Map(sqesSize_, IORING_OFF_SQES));
+        if (!sqRing_ || !cqRing_ || !sqes_) {
+            return false;
+        }
+
+        auto* sq = static_cast<uint8_t*>(sqRing_);
+        sqHead_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        sqTail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sqMask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sqArray_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+
+        auto* cq = static_cast<uint8_t*>(cqRing_);
+        cqHead_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cqTail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cqMask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+        for (size_t slot = slots_.size(); slot-- > 0;) {
+            freeSlots_.push_back(slot);
+        }
+        return true;
+    }
+
+    void* Map(size_t size, off_t offset) {
+        void* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd_, offset);
+        return ptr == MAP_FAILED ? nullptr : ptr;
+    }
+
+    void Push(uint8_t opcode, int fd, const iovec* iov, uint64_t offset, uint64_t userData) {
+        const unsigned tail = *sqTail_;
+        const unsigned index = tail & sqMask_;
+        io_uring_sqe& sqe = sqes_[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = opcode;
+        sqe.fd = fd;
+        sqe.addr = reinterpret_cast<uint64_t>(iov);
+        sqe.len = 1;
+        sqe.off = offset;
+        sqe.user_data = userData;
+        sqArray_[index] = index;
+        __atomic_store_n(sqTail_, tail + 1, __ATOMIC_RELEASE);
+    }
+
+    void ArmWake() {
+        wakeIovec_ = {&wakeValue_, sizeof(wakeValue_)};
+        Push(IORING_OP_READV, eventFd_, &wakeIovec_, 0, WAKE_TAG);
+    }
+
+    void SubmitRead(size_t slot) {
+        FileRead& read = *slots_[slot];
+        const uint64_t remaining = read.buffer_.size() - read.readBytes_;
+        iovecs_[slot] = {read.buffer_.data() + read.readBytes_, static_cast<size_t>(std::min(remaining, READ_CHUNK_BYTES))};
+        Push(IORING_OP_READV, read.fd_, &iovecs_[slot], read.readBytes_, slot + 1);
+    }
+
+    // Opens the file and sizes its buffer; false when the read already finished (empty file, or
+    // an error it was failed with).
+    bool Open(FileRead& read) {
+        read.fd_ = ::open(read.path_.c_str(), O_RDONLY | O_CLOEXEC);
+        if (read.fd_ < 0) {
+            read.Fail("AsyncFileLoader: failed to open file: " + read.path_.string() + " (" +
+                      std::system_category().message(errno) + ")");
+            return false;
+        }
+        struct stat st {};
+        if (fstat(read.fd_, &st) != 0) {
+            read.Fail("AsyncFileLoader: failed to stat file: " + read.path_.string());
+            Close(read);
+            return false;
+        }
+        try {
+            read.buffer_.resize(static_cast<size_t>(st.st_size));
+        } catch (const std::exception& e) {
+            read.Fail("AsyncFileLoader: failed to allocate " + std::to_string(st.st_size) + " bytes for " +
+                      read.path_.string() + ": " + e.what());
+            Close(read);
+            return false;
+        }
+        if (read.buffer_.empty()) {
+            Close(read);
+            loader_.Finish(read, {});
+            return false;
+        }
+        return true;
+    }
+
+    void Close(FileRead& read) {
+        if (read.fd_ >= 0) {
+            ::close(read.fd_);
+            read.fd_ = -1;
+        }
+    }
+
+    void Complete(size_t slot, int result) {
+        FileRead& read = *slots_[slot];
+        if (result == -EINTR || result == -EAGAIN) {
+            SubmitRead(slot);
+            return;
+        }
+
+        bool more = false;
+        if (result < 0) {
+            read.Fail("AsyncFileLoader: failed to read file: " + read.path_.string() + " (" +
+                      std::system_category().message(-result) + ")");
+        } else if (result == 0) {
+            read.Fail("AsyncFileLoader: file shrank while reading: " + read.path_.string());
+        } else {
+            read.readBytes_ += static_cast<uint64_t>(result);
+            more = read.readBytes_ < read.buffer_.size();
+        }
+
+        const FileRead::State state = read.GetState();
+        if (more && state == FileRead::State::Reading) {
+            SubmitRead(slot);
+            return;
+        }
+
+        Close(read);
+        if (state == FileRead::State::Reading) {
+            loader_.Finish(read, std::move(read.buffer_));
+        } else {
+            if (state == FileRead::State::Cancelled) {
+                loader_.cancelled_.fetch_add(1, std::memory_order_relaxed);
+            }
+            read.buffer_ = {};
+        }
+        slots_[slot].reset();
+        freeSlots_.push_back(slot);
+    }
+
+    void Run() {
+        ArmWake();
+        for (;;) {
+            while (!freeSlots_.empty()) {
+                auto read = loader_.PopNext(false);
+                if (!read) {
+                    break;
+                }
+                if (!Open(*read)) {
+                    continue;
+                }
+                const size_t slot = freeSlots_.back();
+                freeSlots_.pop_back();
+                slots_[slot] = std::move(read);
+                SubmitRead(slot);
+            }
+
+            if (stop_.load(std::memory_order_acquire) && freeSlots_.size() == slots_.size()) {
+                return;
+            }
+
+            const unsigned to_submit = *sqTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+            if (syscall(__NR_io_uring_enter, ringFd_, to_submit, 1u, IORING_ENTER_GETEVENTS, nullptr, 0) < 0) {
+                if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+                    continue;
+                }
+                Degrade(std::system_category().message(errno));
+                return;
+            }
+
+            unsigned head = *cqHead_;
+            const unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+            for (; head != tail; ++head) {
+                const io_uring_cqe& cqe = cqes_[head & cqMask_];
+                if (cqe.user_data == WAKE_TAG) {
+                    if (!stop_.load(std::memory_order_acquire)) {
+                        ArmWake();
+                    }
+                } else {
+                    Complete(static_cast<size_t>(cqe.user_data - 1), cqe.res);
+                }
+            }
+            __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+        }
+    }
+
+    // The ring stopped working: fail what is in flight and keep serving the queue with
+    // blocking reads on this thread.
+    void Degrade(const std::string& error) {
+        for (auto& read : slots_) {
+            if (read) {
+                read->Fail("AsyncFileLoader: io_uring failed while reading " + read->path_.string() + ": " + error);
+                Close(*read);
+                read.reset();
+            }
+        }
+        while (auto read = loader_.PopNext(true)) {
+            loader_.ReadBlocking(*read);
+        }
+    }
+
+    AsyncFileLoader& loader_;
+    std::vector<std::shared_ptr<FileRead>> slots_;
+    std::vector<iovec> iovecs_;
+    std::vector<size_t> freeSlots_;
+    std::thread thread_;
+    std::atomic<bool> stop_{false};
+
+    int ringFd_ = -1;
+    int eventFd_ = -1;
+    uint64_t wakeValue_ = 0;
+    iovec wakeIovec_{};
+
+    void* sqRing_ = nullptr;
+    void* cqRing_ = nullptr;
+    size_t sqRingSize_ = 0;
+    size_t cqRingSize_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    size_t sqesSize_ = 0;
+    unsigned* sqHead_ = nullptr;
+    unsigned* sqTail_ = nullptr;
+    unsigned* sqArray_ = nullptr;
+    unsigned sqMask_ = 0;
+    unsigned* cqHead_ = nullptr;
+    unsigned* cqTail_ = nullptr;
+    unsigned cqMask_ = 0;
+    io_uring_cqe* cqes_ = nullptr;
+};
+
+#else
+
+class AsyncFileLoader::IoUring {
+public:
+    static std::unique_ptr<IoUring> Create(AsyncFileLoader&, size_t) { return nullptr; }
+    void Wake() {}
+};
+
+#endif
+
+AsyncFileLoader::AsyncFileLoader() : AsyncFileLoader(Options{}) {}
+
+AsyncFileLoader::AsyncFileLoader(const Options& options) : options_(options) {
+    options_.QueueDepth = std::max<size_t>(options_.QueueDepth, 1);
+    if (options_.UseIoUring) {
+        ring_ = IoUring::Create(*this, options_.QueueDepth);
+    }
+    if (!ring_) {
+        const size_t count = std::clamp<size_t>(options_.FallbackThreads, 1, options_.QueueDepth);
+        for (size_t i = 0; i < count; ++i) {
+            threads_.emplace_back([this]() { ThreadLoop(); });
+        }
+    }
+}
+
+AsyncFileLoader::~AsyncFileLoader() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+        for (auto& [key, read] : queue_) {
+            read->Cancel();
+            cancelled_.fetch_add(1, std::memory_order_relaxed);
+        }
+        queue_.clear();
+        prefetched_.clear();
+    }
+    queued_.notify_all();
+
+    ring_.reset();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+std::shared_ptr<FileRead> AsyncFileLoader::Read(const std::filesystem::path& path, FileReadPriority priority) {
+    std::shared_ptr<FileRead> read;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto prefetched = prefetched_.find(QueueKeyOf(path));
+        if (prefetched != prefetched_.end()) {
+            read = std::move(prefetched->second);
+            prefetched_.erase(prefetched);
+
+            if (read->GetState() != FileRead::State::Cancelled) {
+                prefetchHits_.fetch_add(1, std::memory_order_relaxed);
+                auto queued = queue_.find(read->queueKey_);
+                if (priority > read->priority_ && queued != queue_.end() && queued->second == read) {
+                    queue_.erase(queued);
+                    read->priority_ = priority;
+                    EnqueueLocked(read);
+                }
+                return read;
+            }
+        }
+
+        read = std::make_shared<FileRead>(path, priority);
+        EnqueueLocked(read);
+    }
+    NotifyQueued();
+    return read;
+}
+
+void AsyncFileLoader::Prefetch(const std::filesystem::path& path) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto& slot = prefetched_[QueueKeyOf(path)];
+        if (slot && slot->GetState() != FileRead::State::Cancelled) {
+            return;
+        }
+        slot = std::make_shared<FileRead>(path, FileReadPriority::Prefetch);
+        EnqueueLocked(slot);
+    }
+    NotifyQueued();
+}
+
+void AsyncFileLoader::DropPrefetches() {
+    std::unordered_map<std::string, std::shared_ptr<FileRead>> dropped;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        dropped.swap(prefetched_);
+    }
+    for (auto& [key, read] : dropped) {
+        read->Cancel();
+    }
+}
+
+AsyncFileLoader::Stats AsyncFileLoader::GetStats() const {
+    Stats stats;
+    stats.Reads = reads_.load(std::memory_order_relaxed);
+    stats.BytesRead = bytesRead_.load(std::memory_order_relaxed);
+    stats.PrefetchHits = prefetchHits_.load(std::memory_order_relaxed);
+    stats.Cancelled = cancelled_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+AsyncFileLoader& AsyncFileLoader::Shared() {
+    static AsyncFileLoader loader;
+    return loader;
+}
+
+void AsyncFileLoader::EnqueueLocked(const std::shared_ptr<FileRead>& read) {
+    // Highest priority first, then first come first served.
+    read->queueKey_ = {-static_cast<int>(read->priority_), nextSequence_++};
+    queue_.emplace(read->queueKey_, read);
+}
+
+void AsyncFileLoader::NotifyQueued() {
+    queued_.notify_one();
+    if (ring_) {
+        ring_->Wake();
+    }
+}
+
+std::shared_ptr<FileRead> AsyncFileLoader::PopNext(bool wait) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        while (!queue_.empty()) {
+            auto read = std::move(queue_.begin()->second);
+            queue_.erase(queue_.begin());
+            if (read->Start()) {
+                return read;
+            }
+            cancelled_.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (!wait || stopping_) {
+            return nullptr;
+        }
+        queued_.wait(lock);
+    }
+}
+
+void AsyncFileLoader::ThreadLoop() {
+    while (auto read = PopNext(true)) {
+        ReadBlocking(*read);
+    }
+}
+
+void AsyncFileLoader::ReadBlocking(FileRead& read) {
+    std::ifstream file(read.path_, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        read.Fail("AsyncFileLoader: failed to open file: " + read.path_.string());
+        return;
+    }
+
+    const std::streamsize size = file.tellg();
+    file.seekg(0, std::ios::beg);
+    std::vector<uint8_t> bytes;
+    try {
+        bytes.resize(static_cast<size_t>(size));
+    } catch (const std::exception& e) {
+        read.Fail("AsyncFileLoader: failed to allocate " + std::to_string(size) + " bytes for " +
+                  read.path_.string() + ": " + e.what());
+        return;
+    }
+
+    for (uint64_t offset = 0; offset < bytes.size();) {
+        if (read.GetState() == FileRead::State::Cancelled) {
+            cancelled_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        const auto chunk = static_cast<std::streamsize>(std::min<uint64_t>(bytes.size() - offset, READ_CHUNK_BYTES));
+        if (!file.read(reinterpret_cast<char*>(bytes.data() + offset), chunk)) {
+            read.Fail("AsyncFileLoader: failed to read file: " + read.path_.string());
+            return;
+        }
+        offset += static_cast<uint64_t>(chunk);
+    }
+    Finish(read, std::move(bytes));
+}
+
+void AsyncFileLoader::Finish(FileRead& read, std::vector<uint8_t> bytes) {
+    const uint64_t size = bytes.size();
+    if (read.Complete(std::move(bytes))) {
+        reads_.fetch_add(1, std::memory_order_relaxed);
+        bytesRead_.fetch_add(size, std::memory_order_relaxed);
+    } else {
+        cancelled_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+} // namespace tekki::backend
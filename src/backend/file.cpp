@@ -1,4 +1,5 @@
 #include "tekki/backend/file.h"
+#include "tekki/backend/async_file_loader.h"
 
 #include <filesystem>
 #include <fstream>
@@ -38,21 +39,9 @@ std::vector<uint8_t> LoadFile::Run() {
         // Invalidation trigger would be called here
     });
     
-    // Read file content
-    std::ifstream file(path_, std::ios::binary | std::ios::ate);
-    if (!file.is_open()) {
-        throw std::runtime_error("LoadFile: failed to open file: " + path_.string());
-    }
-    
-    std::streamsize size = file.tellg();
-    file.seekg(0, std::ios::beg);
-    
-    std::vector<uint8_t> buffer(size);
-    if (!file.read(reinterpret_cast<char*>(buffer.data()), size)) {
-        throw std::runtime_error("LoadFile: failed to read file: " + path_.string());
-    }
-    
-    return buffer;
+    // Reads go through the shared loader, so a prefetched file is picked up rather than read again.
+    // This is the blocking entry point: loads overlap only where callers Prefetch ahead of it.
+    return AsyncFileLoader::Shared().Read(path_, FileReadPriority::Urgent)->Take();
 }
 
 std::string LoadFile::DebugDescription() const {
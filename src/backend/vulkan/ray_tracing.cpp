@@ -53,7 +53,7 @@ std::shared_ptr<RayTracingAcceleration> Device::CreateRayTracingBottomAccelerati
             trianglesData.maxVertex = part.MaxVertex;
             trianglesData.vertexFormat = geometryDesc.VertexFormat;
             trianglesData.indexData.deviceAddress = geometryDesc.IndexBuffer;
-            trianglesData.indexType = VK_INDEX_TYPE_UINT32; // TODO
+            trianglesData.indexType = geometryDesc.IndexType;
 
             VkAccelerationStructureGeometryKHR geometry{};
             geometry.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR;
@@ -68,8 +68,13 @@ std::shared_ptr<RayTracingAcceleration> Device::CreateRayTracingBottomAccelerati
         buildRangeInfos.reserve(desc.Geometries.size());
 
         for (const auto& geometryDesc : desc.Geometries) {
+            const auto& part = geometryDesc.Parts[0];
+            size_t indexSize = geometryDesc.IndexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+
             VkAccelerationStructureBuildRangeInfoKHR rangeInfo{};
-            rangeInfo.primitiveCount = static_cast<uint32_t>(geometryDesc.Parts[0].IndexCount / 3);
+            rangeInfo.primitiveCount = static_cast<uint32_t>(part.IndexCount / 3);
+            rangeInfo.primitiveOffset = static_cast<uint32_t>(part.IndexOffset * indexSize);
+            rangeInfo.firstVertex = part.FirstVertex;
             buildRangeInfos.push_back(rangeInfo);
         }
 
@@ -1,12 +1,371 @@
 #include "kajiya_asset/mesh.h"
+#include "tekki/asset/image.h"
+#include "tekki/asset/texture_atlas.h"
+#include "tekki/core/parallel.h"
+#include <limits>
+#include <optional>
 #include <stdexcept>
+#include <system_error>
+#include <unordered_map>
 
 namespace kajiya_asset {
 
-// Stub implementation of PackTriangleMesh
-PackedTriangleMesh PackTriangleMesh(const std::shared_ptr<Mesh>& mesh) {
-    // TODO: Implement mesh packing
-    // This is a placeholder stub to satisfy the linker
+namespace {
+
+using tekki::asset::GpuImage::Proto;
+
+void HashTexParams(IdentityHasher& hasher, const tekki::asset::TexParams& params) {
+    // UV transforms are applied by the material, not baked into the image.
+    hasher.Value(params.gamma)
+        .Value(params.use_mips)
+        .Value(params.srgb)
+        .Value(params.mipmaps)
+        .Value(params.Compression)
+        .Value(params.ChannelSwizzle.has_value());
+    if (params.use_mips) {
+        hasher.Value(params.MipFilter);
+    }
+    if (params.MaxMipCount != 0) {
+        hasher.Value(params.MaxMipCount);
+    }
+    if (params.Compression != tekki::asset::TexCompressionMode::None) {
+        hasher.Value(params.CompressionQuality);
+    }
+    if (params.ChannelSwizzle) {
+        hasher.Value(*params.ChannelSwizzle);
+    }
+}
+
+// Parameters a map's image is baked with.
+tekki::asset::TexParams MapTexParams(const tekki::asset::MeshMaterialMap& map, tekki::asset::TexCompressionQuality quality) {
+    tekki::asset::TexParams params;
+    if (map.GetType() == tekki::asset::MeshMaterialMap::Type::Placeholder) {
+        params.gamma = tekki::asset::TexGamma::Linear;
+        params.use_mips = false;
+        return params;
+    }
+    params = map.GetImageData().Params;
+    params.CompressionQuality = quality;
+    return params;
+}
+
+Lazy<Proto> MakeMapImageLazy(const tekki::asset::MeshMaterialMap& map, uint64_t content_identity,
+                             tekki::asset::TexCompressionQuality quality) {
+    using tekki::asset::MeshMaterialMap;
+
+    const auto params = MapTexParams(map, quality);
+    if (map.GetType() == MeshMaterialMap::Type::Placeholder) {
+        auto values = map.GetPlaceholderValues();
+
+        IdentityHasher hasher;
+        hasher.String("placeholder").Value(BAKE_VERSION).Value(values);
+        HashTexParams(hasher, params);
+
+        return Lazy<Proto>(hasher.Finish(), [values, params](const std::shared_ptr<LazyCache>&) {
+            auto raw = std::make_shared<tekki::asset::RawImage>(tekki::asset::CreatePlaceholderImage(values).Create());
+            return std::make_shared<Proto>(tekki::asset::CreateGpuImage(raw, params).Create());
+        });
+    }
+
+    const auto& image = map.GetImageData();
+    if (!image.Source) {
+        throw std::runtime_error("material map has no image source");
+    }
+
+    IdentityHasher hasher;
+    hasher.String("image").Value(BAKE_VERSION).Value(content_identity);
+    HashTexParams(hasher, params);
+
+    return Lazy<Proto>(hasher.Finish(), [source = image.Source, params](const std::shared_ptr<LazyCache>&) {
+        auto raw = std::make_shared<tekki::asset::RawImage>(tekki::asset::DecodeImage(*source));
+        return std::make_shared<Proto>(tekki::asset::CreateGpuImage(raw, params).Create());
+    });
+}
+
+uint64_t ImageContentIdentity(const tekki::asset::ImageSource& source) {
+    const auto& data = source.GetData();
+    return IdentityHasher().Bytes(data.data(), data.size()).Finish();
+}
+
+// Bounds of the UVs of each material's vertices; materials without vertices stay empty.
+std::vector<std::pair<glm::vec2, glm::vec2>> MaterialUvBounds(const Mesh& mesh) {
+    std::vector<std::pair<glm::vec2, glm::vec2>> bounds(
+        mesh.Materials.size(), {glm::vec2(std::numeric_limits<float>::max()), glm::vec2(std::numeric_limits<float>::lowest())});
+    for (size_t v = 0; v < mesh.MaterialIds.size(); ++v) {
+        if (mesh.MaterialIds[v] >= bounds.size()) {
+            continue;
+        }
+        const glm::vec2 uv = v < mesh.Uvs.size() ? glm::vec2(mesh.Uvs[v][0], mesh.Uvs[v][1]) : glm::vec2(0.0f);
+        auto& [lo, hi] = bounds[mesh.MaterialIds[v]];
+        lo = glm::min(lo, uv);
+        hi = glm::max(hi, uv);
+    }
+    return bounds;
+}
+
+// Resolves material maps to image lazies, one per identity across every mesh resolved through
+// it, then moves small ones into atlases once every mesh has been seen.
+class MapResolver {
+public:
+    explicit MapResolver(const tekki::asset::PackTriangleMeshOptions& options) : options_(options) {}
+
+    // Fills `packed.Maps` with the references matching `mesh.Maps`; atlased ones are only
+    // redirected by Finish.
+    void Resolve(const Mesh& mesh, tekki::asset::PackedTriangleMesh& packed) {
+        using tekki::asset::MeshMaterialMap;
+
+        // Texture-space UV bounds of every material slot reading each map.
+        std::vector<std::vector<MapUse>> uses(mesh.Maps.size());
+        const auto uv_bounds = MaterialUvBounds(mesh);
+        for (size_t m = 0; m < packed.Materials.size(); ++m) {
+            for (uint32_t slot = 0; slot < packed.Materials[m].Maps.size(); ++slot) {
+                const uint32_t map_index = packed.Materials[m].Maps[slot];
+                if (map_index >= uses.size()) {
+                    continue;
+                }
+                bool in_unit_square = true;
+                const auto& [lo, hi] = uv_bounds[m];
+                if (lo.x <= hi.x) {
+                    glm::vec2 mapped_lo;
+                    glm::vec2 mapped_hi;
+                    tekki::asset::TransformUvBounds(packed.Materials[m].MapTransforms[slot], lo, hi, mapped_lo, mapped_hi);
+                    in_unit_square = mapped_lo.x >= -ATLAS_UV_SLACK && mapped_lo.y >= -ATLAS_UV_SLACK &&
+                                     mapped_hi.x <= 1.0f + ATLAS_UV_SLACK && mapped_hi.y <= 1.0f + ATLAS_UV_SLACK;
+                }
+                uses[map_index].push_back({&packed, static_cast<uint32_t>(m), slot, in_unit_square});
+            }
+        }
+
+        packed.Maps.reserve(mesh.Maps.size());
+        for (size_t i = 0; i < mesh.Maps.size(); ++i) {
+            const auto& map = mesh.Maps[i];
+            const bool is_image = map.GetType() == MeshMaterialMap::Type::Image && map.GetImageData().Source;
+            uint64_t content_identity = 0;
+            if (is_image) {
+                // Sources are shared between maps that use the same glTF image, so hash each one once.
+                const auto* source = map.GetImageData().Source.get();
+                auto it = contentIdentities_.find(source);
+                if (it == contentIdentities_.end()) {
+                    it = contentIdentities_.emplace(source, ImageContentIdentity(*source)).first;
+                }
+                content_identity = it->second;
+            }
+
+            auto lazy = MakeMapImageLazy(map, content_identity, options_.TextureQuality);
+            uint64_t identity = lazy.Identity();
+            auto [it, inserted] = uniqueIndices_.emplace(identity, unique_.size());
+            if (inserted) {
+                UniqueMap unique;
+                unique.Image = std::make_shared<Lazy<Proto>>(std::move(lazy));
+                unique.BakeBytes = is_image ? tekki::asset::EstimateImageBakeBytes(*map.GetImageData().Source) : 64;
+                unique.Map = map;
+                if (options_.AtlasMaxTextureSize != 0) {
+                    auto extent = is_image ? tekki::asset::PeekImageExtent(*map.GetImageData().Source)
+                                           : std::optional<glm::u32vec2>(glm::u32vec2(1, 1));
+                    unique.Atlas = extent && extent->x <= options_.AtlasMaxTextureSize &&
+                                   extent->y <= options_.AtlasMaxTextureSize;
+                    unique.Extent = extent.value_or(glm::u32vec2(0));
+                }
+                unique.Placeholder = !is_image;
+                unique_.push_back(std::move(unique));
+            }
+
+            auto& unique = unique_[it->second];
+            for (const auto& use : uses[i]) {
+                // A placeholder reads one texel whatever the UVs; an image the atlas can't repeat.
+                unique.Atlas &= unique.Placeholder || use.InUnitSquare;
+                unique.Uses.push_back(use);
+            }
+            unique.Refs.emplace_back(&packed, packed.Maps.size());
+            packed.Maps.push_back(tekki::asset::AssetRef<tekki::asset::GpuImage::Flat>{identity});
+        }
+    }
+
+    // Fills Maps and MapBakeBytes: every map that stays on its own in order of first use, then
+    // the atlas pages.
+    void Finish() {
+        std::vector<std::vector<size_t>> groups;
+        std::unordered_map<uint64_t, size_t> group_indices;
+        for (size_t u = 0; u < unique_.size(); ++u) {
+            if (!unique_[u].Atlas) {
+                Maps.push_back(unique_[u].Image);
+                MapBakeBytes.push_back(unique_[u].BakeBytes);
+                continue;
+            }
+            IdentityHasher hasher;
+            HashTexParams(hasher, MapTexParams(unique_[u].Map, options_.TextureQuality));
+            auto [it, inserted] = group_indices.emplace(hasher.Finish(), groups.size());
+            if (inserted) {
+                groups.emplace_back();
+            }
+            groups[it->second].push_back(u);
+        }
+
+        for (const auto& group : groups) {
+            std::vector<glm::u32vec2> sizes;
+            for (size_t u : group) {
+                sizes.push_back(unique_[u].Extent);
+            }
+            const auto layout = tekki::asset::PackAtlas(sizes, options_.AtlasPageSize, options_.AtlasBorder);
+            for (uint32_t page = 0; page < layout.Pages.size(); ++page) {
+                std::vector<AtlasMember> members;
+                for (size_t i = 0; i < group.size(); ++i) {
+                    if (layout.Placements[i].Page == page) {
+                        members.push_back({unique_[group[i]].Map, unique_[group[i]].Extent, layout.Placements[i].X,
+                                           layout.Placements[i].Y, unique_[group[i]].Image->Identity(),
+                                           unique_[group[i]].BakeBytes});
+                    }
+                }
+                AddAtlasPage(members, layout.Pages[page]);
+
+                const uint64_t identity = Maps.back()->Identity();
+                const glm::u32vec2 page_size = layout.Pages[page];
+                for (size_t i = 0; i < group.size(); ++i) {
+                    if (layout.Placements[i].Page != page) {
+                        continue;
+                    }
+                    const auto& unique = unique_[group[i]];
+                    const auto& placement = layout.Placements[i];
+                    for (const auto& [packed, index] : unique.Refs) {
+                        packed->Maps[index] = tekki::asset::AssetRef<tekki::asset::GpuImage::Flat>{identity};
+                    }
+                    for (const auto& use : unique.Uses) {
+                        auto& transform = use.Packed->Materials[use.Material].MapTransforms[use.Slot];
+                        if (unique.Placeholder) {
+                            // Every UV reads the placeholder's texel centre.
+                            transform = {0.0f, 0.0f, 0.0f, 0.0f, (placement.X + 0.5f) / page_size.x,
+                                         (placement.Y + 0.5f) / page_size.y};
+                        } else {
+                            transform = tekki::asset::AtlasMapTransform(transform, unique.Extent, placement.X,
+                                                                        placement.Y, page_size);
+                        }
+                    }
+                }
+            }
+            Atlases.Maps += group.size();
+            Atlases.Pages += layout.Pages.size();
+        }
+    }
+
+    std::vector<std::shared_ptr<Lazy<Proto>>> Maps;
+    std::vector<uint64_t> MapBakeBytes;
+    AtlasStats Atlases;
+
+private:
+    // UVs this far outside [0, 1] still land in the border.
+    static constexpr float ATLAS_UV_SLACK = 1.0e-3f;
+
+    struct MapUse {
+        tekki::asset::PackedTriangleMesh* Packed;
+        uint32_t Material;
+        uint32_t Slot;
+        bool InUnitSquare;
+    };
+
+    struct UniqueMap {
+        std::shared_ptr<Lazy<Proto>> Image;
+        uint64_t BakeBytes = 0;
+        tekki::asset::MeshMaterialMap Map;
+        bool Placeholder = false;
+        bool Atlas = false;
+        glm::u32vec2 Extent{0, 0};
+        std::vector<MapUse> Uses;
+        std::vector<std::pair<tekki::asset::PackedTriangleMesh*, size_t>> Refs; // Entries of Packed.Maps
+    };
+
+    struct AtlasMember {
+        tekki::asset::MeshMaterialMap Map;
+        glm::u32vec2 Extent;
+        uint32_t X;
+        uint32_t Y;
+        uint64_t Identity;
+        uint64_t BakeBytes;
+    };
+
+    // Appends the lazy baking one atlas page: members are decoded, bordered and placed into an
+    // RGBA8 page that is then baked like any map with the group's parameters, generating only
+    // the mips its borders protect.
+    void AddAtlasPage(const std::vector<AtlasMember>& members, glm::u32vec2 page_size) {
+        const uint32_t border = options_.AtlasBorder;
+        auto params = MapTexParams(members.front().Map, options_.TextureQuality);
+        params.MaxMipCount = tekki::asset::AtlasMipCount(border);
+
+        IdentityHasher hasher;
+        hasher.String("atlas").Value(BAKE_VERSION).Value(page_size.x).Value(page_size.y).Value(border);
+        HashTexParams(hasher, params);
+        uint64_t bake_bytes = static_cast<uint64_t>(page_size.x) * page_size.y * 4 * 3;
+        for (const auto& member : members) {
+            hasher.Value(member.Identity).Value(member.X).Value(member.Y);
+            bake_bytes += member.BakeBytes;
+        }
+
+        Maps.push_back(std::make_shared<Lazy<Proto>>(hasher.Finish(), [members, page_size, params, border](const std::shared_ptr<LazyCache>&) {
+            tekki::asset::RawRgba8Image page;
+            page.dimensions = page_size;
+            page.data.assign(static_cast<size_t>(page_size.x) * page_size.y * 4, 0);
+            for (const auto& member : members) {
+                std::vector<uint8_t> rgba;
+                if (member.Map.GetType() == tekki::asset::MeshMaterialMap::Type::Placeholder) {
+                    auto values = member.Map.GetPlaceholderValues();
+                    rgba.assign(values.begin(), values.end());
+                } else {
+                    auto raw = tekki::asset::DecodeImage(*member.Map.GetImageData().Source);
+                    if (raw.GetType() != tekki::asset::RawImageType::Rgba8 ||
+                        raw.GetRgba8Image().dimensions != member.Extent) {
+                        throw std::runtime_error("atlas image doesn't decode to the extent in its header");
+                    }
+                    rgba = raw.GetRgba8Image().data;
+                }
+                tekki::asset::BlitAtlasImage(rgba, member.Extent, page.data, page_size.x, member.X, member.Y, border);
+            }
+
+            return std::make_shared<Proto>(
+                tekki::asset::CreateGpuImage(std::make_shared<tekki::asset::RawImage>(std::move(page)), params).Create());
+        }));
+        MapBakeBytes.push_back(bake_bytes);
+    }
+
+    tekki::asset::PackTriangleMeshOptions options_;
+    std::unordered_map<const tekki::asset::ImageSource*, uint64_t> contentIdentities_;
+    std::unordered_map<uint64_t, size_t> uniqueIndices_;
+    std::vector<UniqueMap> unique_;
+};
+
+} // namespace
+
+Lazy<Mesh> LoadGltfScene::IntoLazy() const {
+    IdentityHasher hasher;
+    hasher.String("gltf").String(Path.generic_string()).Value(Scale).Value(Rotation.x).Value(Rotation.y).Value(Rotation.z).Value(Rotation.w);
+
+    std::error_code ec;
+    auto size = std::filesystem::file_size(Path, ec);
+    hasher.Value(ec ? uint64_t(0) : static_cast<uint64_t>(size));
+    auto mtime = std::filesystem::last_write_time(Path, ec);
+    hasher.Value(ec ? int64_t(0) : static_cast<int64_t>(mtime.time_since_epoch().count()));
+
+    return Lazy<Mesh>(hasher.Finish(), [path = Path, scale = Scale, rotation = Rotation](const std::shared_ptr<LazyCache>&) {
+        return std::make_shared<Mesh>(tekki::asset::LoadGltfScene(path.string(), scale, rotation).Run());
+    });
+}
+
+Lazy<InstancedScene> LoadGltfScene::IntoInstancedLazy() const {
+    IdentityHasher hasher;
+    hasher.String("gltf-instanced").Value(IntoLazy().Identity());
+
+    return Lazy<InstancedScene>(hasher.Finish(), [path = Path, scale = Scale, rotation = Rotation](const std::shared_ptr<LazyCache>&) {
+        return std::make_shared<InstancedScene>(tekki::asset::LoadGltfScene(path.string(), scale, rotation).RunInstanced());
+    });
+}
+
+Lazy<Proto> MakeMapImageLazy(const tekki::asset::MeshMaterialMap& map) {
+    uint64_t content_identity = 0;
+    if (map.GetType() == tekki::asset::MeshMaterialMap::Type::Image && map.GetImageData().Source) {
+        content_identity = ImageContentIdentity(*map.GetImageData().Source);
+    }
+    return MakeMapImageLazy(map, content_identity, map.GetImageData().Params.CompressionQuality);
+}
+
+PackedTriangleMesh PackTriangleMesh(const std::shared_ptr<Mesh>& mesh, const tekki::asset::PackTriangleMeshOptions& options) {
     // Original Rust: kajiya/crates/lib/kajiya-asset/src/mesh.rs
 
     if (!mesh) {
@@ -14,8 +373,39 @@ PackedTriangleMesh PackTriangleMesh(const std::shared_ptr<Mesh>& mesh) {
     }
 
     PackedTriangleMesh result;
-    // Convert mesh data to packed format
-    // For now, return empty packed mesh
+    result.Packed = tekki::asset::PackTriangleMesh(*mesh, options);
+
+    MapResolver resolver(options);
+    resolver.Resolve(*mesh, result.Packed);
+    resolver.Finish();
+    result.Maps = std::move(resolver.Maps);
+    result.MapBakeBytes = std::move(resolver.MapBakeBytes);
+    result.Atlases = resolver.Atlases;
+
+    return result;
+}
+
+PackedScene PackInstancedScene(const std::shared_ptr<InstancedScene>& scene, const tekki::asset::PackTriangleMeshOptions& options) {
+    if (!scene) {
+        throw std::runtime_error("PackInstancedScene: scene is null");
+    }
+
+    PackedScene result;
+    result.Packed.Meshes.resize(scene->Meshes.size());
+    result.Packed.Instances = scene->Instances;
+    tekki::core::ParallelFor(scene->Meshes.size(), [&](size_t m) {
+        result.Packed.Meshes[m] = tekki::asset::PackTriangleMesh(scene->Meshes[m], options);
+    });
+
+    MapResolver resolver(options);
+    for (size_t m = 0; m < scene->Meshes.size(); ++m) {
+        resolver.Resolve(scene->Meshes[m], result.Packed.Meshes[m]);
+    }
+    resolver.Finish();
+    result.Maps = std::move(resolver.Maps);
+    result.MapBakeBytes = std::move(resolver.MapBakeBytes);
+    result.Atlases = resolver.Atlases;
+
     return result;
 }
 
@@ -0,0 +1,239 @@
+#include "tekki/kajiya_asset_pipe/bake_manifest.h"
+#include "kajiya_asset/lazy.h"
+#include "kajiya_asset/mesh.h"
+#include "tekki/core/mapped_file.h"
+#include "tekki/core/parallel.h"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+
+namespace tekki::kajiya_asset_pipe {
+
+namespace {
+
+using nlohmann::json;
+
+std::string ToHex(uint64_t value) {
+    std::ostringstream ss;
+    ss << std::hex << std::setw(16) << std::setfill('0') << value;
+    return ss.str();
+}
+
+uint64_t FromHex(const std::string& text) {
+    return std::stoull(text, nullptr, 16);
+}
+
+const char* StatusName(BakeOutputStatus status) {
+    return status == BakeOutputStatus::Reused ? "reused" : "rebuilt";
+}
+
+json OutputToJson(const BakeOutput& output) {
+    return {{"path", output.Path.generic_string()}, {"key", ToHex(output.Key)}, {"status", StatusName(output.Status)}};
+}
+
+BakeOutput OutputFromJson(const json& value) {
+    BakeOutput output;
+    output.Path = value.at("path").get<std::string>();
+    output.Key = FromHex(value.at("key").get<std::string>());
+    output.Status = value.at("status").get<std::string>() == "reused" ? BakeOutputStatus::Reused : BakeOutputStatus::Rebuilt;
+    return output;
+}
+
+// glTF URIs are percent-encoded.
+std::string DecodeUri(const std::string& uri) {
+    std::string decoded;
+    decoded.reserve(uri.size());
+    for (size_t i = 0; i < uri.size(); ++i) {
+        if (uri[i] == '%' && i + 2 < uri.size() && std::isxdigit(static_cast<unsigned char>(uri[i + 1])) &&
+            std::isxdigit(static_cast<unsigned char>(uri[i + 2]))) {
+            decoded.push_back(static_cast<char>(std::stoi(uri.substr(i + 1, 2), nullptr, 16)));
+            i += 2;
+        } else {
+            decoded.push_back(uri[i]);
+        }
+    }
+    return decoded;
+}
+
+json ReadGltfJson(const std::filesystem::path& path) {
+    auto file = tekki::core::MappedFile::Open(path);
+    auto bytes = file->Bytes();
+
+    // Binary glTF: 12-byte header, then a JSON chunk (length, type, data).
+    constexpr uint32_t GLB_MAGIC = 0x46546C67;
+    constexpr uint32_t JSON_CHUNK = 0x4E4F534A;
+    uint32_t magic = 0;
+    if (bytes.size() >= sizeof(magic)) {
+        std::memcpy(&magic, bytes.data(), sizeof(magic));
+    }
+    if (magic == GLB_MAGIC) {
+        std::array<uint32_t, 2> chunk{};
+        if (bytes.size() < 12 + sizeof(chunk)) {
+            throw std::runtime_error("truncated binary glTF");
+        }
+        std::memcpy(chunk.data(), bytes.data() + 12, sizeof(chunk));
+        if (chunk[1] != JSON_CHUNK || chunk[0] > bytes.size() - 12 - sizeof(chunk)) {
+            throw std::runtime_error("binary glTF has no JSON chunk");
+        }
+        bytes = bytes.subspan(12 + sizeof(chunk), chunk[0]);
+    }
+    return json::parse(bytes.begin(), bytes.end());
+}
+
+} // namespace
+
+std::optional<BakeManifest> BakeManifest::Load(const std::filesystem::path& path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        return std::nullopt;
+    }
+
+    try {
+        json root = json::parse(file);
+        BakeManifest manifest;
+        manifest.BakeVersion = root.at("bake_version").get<uint32_t>();
+        if (manifest.BakeVersion != kajiya_asset::BAKE_VERSION) {
+            return std::nullopt;
+        }
+        manifest.Scene = root.at("scene").get<std::string>();
+        manifest.SceneKey = FromHex(root.at("scene_key").get<std::string>());
+        for (const auto& input : root.at("inputs")) {
+            manifest.Inputs.push_back(BakeInput{input.at("path").get<std::string>(), input.at("size").get<uint64_t>(),
+                                                input.at("mtime").get<int64_t>(),
+                                                FromHex(input.at("hash").get<std::string>())});
+        }
+        manifest.Mesh = OutputFromJson(root.at("mesh"));
+        for (const auto& image : root.at("images")) {
+            manifest.Images.push_back(OutputFromJson(image));
+        }
+        return manifest;
+    } catch (const std::exception&) {
+        // A damaged manifest only costs a full rebake.
+        return std::nullopt;
+    }
+}
+
+void BakeManifest::Save(const std::filesystem::path& path) const {
+    json root;
+    root["bake_version"] = BakeVersion;
+    root["scene"] = Scene.generic_string();
+    root["scene_key"] = ToHex(SceneKey);
+    root["reused"] = CountOutputs(BakeOutputStatus::Reused);
+    root["rebuilt"] = CountOutputs(BakeOutputStatus::Rebuilt);
+
+    json inputs = json::array();
+    for (const auto& input : Inputs) {
+        inputs.push_back({{"path", input.Path.generic_string()}, {"size", input.Size}, {"mtime", input.ModifiedTime},
+                          {"hash", ToHex(input.Hash)}});
+    }
+    root["inputs"] = std::move(inputs);
+    root["mesh"] = OutputToJson(Mesh);
+
+    json images = json::array();
+    for (const auto& image : Images) {
+        images.push_back(OutputToJson(image));
+    }
+    root["images"] = std::move(images);
+
+    auto temp_path = path;
+    temp_path += ".tmp";
+    {
+        std::ofstream file(temp_path);
+        if (!file.is_open()) {
+            throw std::runtime_error("Failed to create bake manifest " + temp_path.string());
+        }
+        file << root.dump(2) << std::endl;
+        if (!file) {
+            throw std::runtime_error("Failed to write bake manifest " + temp_path.string());
+        }
+    }
+    std::filesystem::rename(temp_path, path);
+}
+
+const BakeInput* BakeManifest::FindInput(const std::filesystem::path& path) const {
+    auto it = std::find_if(Inputs.begin(), Inputs.end(), [&](const BakeInput& input) { return input.Path == path; });
+    return it == Inputs.end() ? nullptr : &*it;
+}
+
+size_t BakeManifest::CountOutputs(BakeOutputStatus status) const {
+    size_t count = Mesh.Path.empty() || Mesh.Status != status ? 0 : 1;
+    for (const auto& image : Images) {
+        count += image.Status == status ? 1 : 0;
+    }
+    return count;
+}
+
+bool BakeManifest::OutputsExist() const {
+    std::error_code ec;
+    if (Mesh.Path.empty() || !std::filesystem::exists(Mesh.Path, ec)) {
+        return false;
+    }
+    return std::all_of(Images.begin(), Images.end(),
+                       [&](const BakeOutput& image) { return std::filesystem::exists(image.Path, ec); });
+}
+
+std::vector<std::filesystem::path> GltfInputFiles(const std::filesystem::path& gltf) {
+    std::vector<std::filesystem::path> files{gltf};
+    json root;
+    try {
+        root = ReadGltfJson(gltf);
+    } catch (const std::exception& e) {
+        throw std::runtime_error("Failed to read glTF " + gltf.string() + ": " + e.what());
+    }
+
+    const auto base = gltf.parent_path();
+    for (const char* kind : {"buffers", "images"}) {
+        if (!root.contains(kind)) {
+            continue;
+        }
+        for (const auto& item : root[kind]) {
+            if (!item.contains("uri")) {
+                continue; // Stored in a GLB chunk or a buffer view
+            }
+            auto uri = item["uri"].get<std::string>();
+            if (uri.rfind("data:", 0) == 0 || uri.find("://") != std::string::npos) {
+                continue; // Embedded, so already covered by the glTF's own hash
+            }
+            auto path = (base / std::filesystem::path(DecodeUri(uri))).lexically_normal();
+            if (std::find(files.begin(), files.end(), path) == files.end()) {
+                files.push_back(std::move(path));
+            }
+        }
+    }
+    return files;
+}
+
+std::vector<BakeInput> HashBakeInputs(const std::vector<std::filesystem::path>& paths, const BakeManifest* previous) {
+    std::vector<BakeInput> inputs(paths.size());
+    tekki::core::ParallelFor(paths.size(), [&](size_t i) {
+        BakeInput& input = inputs[i];
+        input.Path = paths[i];
+
+        std::error_code ec;
+        input.Size = static_cast<uint64_t>(std::filesystem::file_size(input.Path, ec));
+        if (ec) {
+            throw std::runtime_error("Bake input " + input.Path.string() + " is missing: " + ec.message());
+        }
+        input.ModifiedTime = static_cast<int64_t>(std::filesystem::last_write_time(input.Path, ec).time_since_epoch().count());
+
+        const BakeInput* known = previous ? previous->FindInput(input.Path) : nullptr;
+        if (known && known->Size == input.Size && known->ModifiedTime == input.ModifiedTime) {
+            input.Hash = known->Hash;
+            return;
+        }
+
+        auto file = tekki::core::MappedFile::Open(input.Path, tekki::core::MappedFile::Access::Sequential);
+        auto bytes = file->Bytes();
+        input.Hash = kajiya_asset::IdentityHasher().Value(input.Size).Bytes(bytes.data(), bytes.size()).Finish();
+    });
+    return inputs;
+}
+
+} // namespace tekki::kajiya_asset_pipe
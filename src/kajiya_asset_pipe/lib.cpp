@@ -1,10 +1,23 @@
 #include "tekki/kajiya_asset_pipe/lib.h"
+#include "tekki/kajiya_asset_pipe/bake_manifest.h"
 #include "tekki/asset/GpuImage.h"
+#include "tekki/asset/asset_pack.h"
+#include "tekki/asset/exr.h"
+#include "tekki/asset/mesh_optimize.h"
+#include "tekki/asset/mesh_quantize.h"
+#include "tekki/core/parallel.h"
+#include "tekki/core/thread_pool.h"
+#include <nlohmann/json.hpp>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <unordered_map>
 #include <vector>
 #include <memory>
 #include <string>
 #include <filesystem>
-#include <unordered_set>
 #include <future>
 #include <fstream>
 #include <iostream>
@@ -13,84 +26,725 @@
 #include <glm/gtc/quaternion.hpp>
 #include <thread>
 #include <algorithm>
+#include <optional>
+#include <unordered_set>
 
 namespace tekki::kajiya_asset_pipe {
 
+namespace {
+
+using Proto = tekki::asset::GpuImage::Proto;
+
+// Writes `path` through a temporary file, so an interrupted bake never leaves a truncated
+// output that a later incremental bake would take for a finished one.
+template<typename F>
+void WriteOutputFile(const std::filesystem::path& path, F&& write) {
+    auto tempPath = path;
+    tempPath += ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary);
+        if (!file.is_open()) {
+            throw std::runtime_error("Failed to create " + tempPath.string());
+        }
+        write(file);
+        if (!file) {
+            throw std::runtime_error("Failed to write " + tempPath.string());
+        }
+    }
+    std::filesystem::rename(tempPath, path);
+}
+
+enum BakeStage : size_t {
+    StageHash,
+    StageLoad,
+    StagePack,
+    StageImages,
+    StageFinish,
+    StageCount
+};
+
+constexpr const char* BAKE_STAGE_NAMES[StageCount] = {"hash", "load", "pack", "images", "finish"};
+
+// Bytes of the full-precision vertex streams per vertex.
+uint64_t VertexStride(const tekki::asset::PackedTriangleMesh& mesh) {
+    uint64_t stride = sizeof(tekki::asset::PackedVertex);
+    stride += mesh.Uvs.empty() ? 0 : sizeof(mesh.Uvs[0]);
+    stride += mesh.Tangents.empty() ? 0 : sizeof(mesh.Tangents[0]);
+    stride += mesh.Colors.empty() ? 0 : sizeof(mesh.Colors[0]);
+    stride += mesh.MaterialIds.empty() ? 0 : sizeof(mesh.MaterialIds[0]);
+    return stride;
+}
+
+// Vertex and index buffer bytes of a packed mesh, before quantisation.
+uint64_t GeometryBytes(const tekki::asset::PackedTriangleMesh& mesh) {
+    return mesh.Verts.size() * VertexStride(mesh) + (mesh.Indices.size() + mesh.LodIndices.size()) * sizeof(uint32_t) +
+           mesh.ShortIndices.size() * sizeof(uint16_t);
+}
+
+} // namespace
+
+// Time spent in each stage, summed over every thread that ran it.
+class MeshAssetProcessor::StageTimes {
+public:
+    class Scope {
+    public:
+        Scope(StageTimes& times, BakeStage stage)
+            : times_(times), stage_(stage), start_(std::chrono::steady_clock::now()) {}
+        ~Scope() {
+            auto elapsed = std::chrono::steady_clock::now() - start_;
+            times_.nanos_[stage_].fetch_add(
+                static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()),
+                std::memory_order_relaxed);
+        }
+
+    private:
+        StageTimes& times_;
+        BakeStage stage_;
+        std::chrono::steady_clock::time_point start_;
+    };
+
+    double Seconds(BakeStage stage) const {
+        return static_cast<double>(nanos_[stage].load(std::memory_order_relaxed)) * 1.0e-9;
+    }
+
+private:
+    std::atomic<uint64_t> nanos_[StageCount] = {};
+};
+
+// State of one scene, carried from packing through the image stage to finishing.
+struct MeshAssetProcessor::SceneBake {
+    const MeshAssetProcessParams* Params = nullptr;
+    std::filesystem::path MeshPath;
+    std::filesystem::path ManifestPath;
+    std::optional<BakeManifest> Previous;
+    BakeManifest Manifest;
+    bool UpToDate = false;
+
+    std::unique_ptr<tekki::asset::AssetPackWriter> Pack;
+    std::shared_ptr<const tekki::asset::AssetPack> PreviousPack;
+    std::unordered_set<uint64_t> PreviousImageKeys;
+
+    // Matching entries of Manifest.Images.
+    std::vector<std::shared_ptr<kajiya_asset::Lazy<Proto>>> Maps;
+    std::vector<uint64_t> MapBakeBytes;
+
+    std::exception_ptr Error;
+    std::mutex ErrorMutex;
+
+    void Fail(std::exception_ptr error) {
+        std::lock_guard<std::mutex> lock(ErrorMutex);
+        if (!Error) {
+            Error = error;
+        }
+    }
+};
+
+// One image of the batch, baked once for every scene output that uses it.
+struct MeshAssetProcessor::ImageJob {
+    std::shared_ptr<kajiya_asset::Lazy<Proto>> Map;
+    uint64_t BakeBytes = 0;
+    std::vector<std::pair<SceneBake*, size_t>> Uses; // Scene and index into its Manifest.Images
+};
+
+// Bake output lines, prefixed by the scene's output name when several scenes interleave.
+class MeshAssetProcessor::BakeLog {
+public:
+    explicit BakeLog(bool prefix) : prefix_(prefix) {}
+
+    template<typename F>
+    void Write(const SceneBake* scene, F&& write) {
+        std::ostringstream line;
+        if (prefix_ && scene) {
+            line << "[" << scene->Params->OutputName << "] ";
+        }
+        write(line);
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::cout << line.str() << std::endl;
+    }
+
+private:
+    bool prefix_;
+    std::mutex mutex_;
+};
+
 void MeshAssetProcessor::ProcessMeshAsset(const MeshAssetProcessParams& params) {
+    BatchBakeParams batch;
+    batch.Scenes = {params};
+    batch.Jobs = params.Jobs;
+    batch.MaxInflightMb = params.MaxInflightMb;
+    ProcessBatch(batch);
+}
+
+void MeshAssetProcessor::ProcessBatch(const BatchBakeParams& batch) {
     auto lazyCache = kajiya_asset::LazyCache::Create();
+    StageTimes times;
+    BakeLog log(batch.Scenes.size() > 1);
+    const auto batchStart = std::chrono::steady_clock::now();
 
     std::filesystem::create_directories("cache");
 
+    std::vector<std::unique_ptr<SceneBake>> scenes;
+    std::unordered_set<std::string> outputNames;
+    for (const auto& params : batch.Scenes) {
+        if (!outputNames.insert(params.OutputName).second) {
+            throw std::runtime_error("Two scenes of the batch are both baked to " + params.OutputName);
+        }
+        auto scene = std::make_unique<SceneBake>();
+        scene->Params = &params;
+        scene->MeshPath = "cache/" + params.OutputName + (params.Pack ? ".pack" : params.InstanceMeshes ? ".scene" : ".mesh");
+        scene->ManifestPath = "cache/" + params.OutputName + ".manifest.json";
+        scenes.push_back(std::move(scene));
+    }
+
+    // One pool serves the whole batch. Each bake reserves its estimated footprint, so the pool
+    // only keeps as many images in flight as the memory budget allows.
+    tekki::core::ThreadPool pool(batch.Jobs, batch.MaxInflightMb * 1024 * 1024);
+
+    // Scenes load and pack concurrently, a limited number at once; their own parallel stages
+    // fan out over the whole pool. Images wait until every scene is packed, so each texture
+    // is baked once no matter how many scenes share it; meshes are written out as soon as
+    // they are packed, leaving only the image handles in memory.
     {
-        std::cout << "Loading " << params.Path << "..." << std::endl;
+        size_t sceneJobs = batch.SceneJobs != 0 ? batch.SceneJobs : std::max<size_t>(1, tekki::core::HardwareConcurrency() / 4);
+        tekki::core::ParallelForOnPool(pool, scenes.size(), [&](size_t i) {
+            try {
+                PackScene(*scenes[i], lazyCache, times, log);
+            } catch (...) {
+                scenes[i]->Fail(std::current_exception());
+            }
+        }, sceneJobs);
+    }
+
+    std::vector<ImageJob> imageJobs;
+    size_t imageUses = 0;
+    {
+        std::unordered_map<uint64_t, size_t> jobIndices;
+        for (auto& scene : scenes) {
+            if (scene->Error || scene->UpToDate) {
+                continue;
+            }
+            for (size_t i = 0; i < scene->Maps.size(); ++i) {
+                auto [it, inserted] = jobIndices.emplace(scene->Maps[i]->Identity(), imageJobs.size());
+                if (inserted) {
+                    imageJobs.push_back({scene->Maps[i], scene->MapBakeBytes[i], {}});
+                }
+                imageJobs[it->second].Uses.emplace_back(scene.get(), i);
+                ++imageUses;
+            }
+        }
+    }
+
+    std::atomic<size_t> imagesBaked{0};
+    if (!imageJobs.empty()) {
+        log.Write(nullptr, [&](std::ostream& out) {
+            out << "Processing " << imageJobs.size() << " images";
+            if (imageUses != imageJobs.size()) {
+                out << " (" << imageUses << " uses across scenes)";
+            }
+            out << " on " << pool.ThreadCount() << " threads...";
+        });
+
+        std::vector<std::future<void>> imageTasks;
+        imageTasks.reserve(imageJobs.size());
+        for (auto& job : imageJobs) {
+            imageTasks.push_back(pool.Submit([&job, &lazyCache, &times, &imagesBaked]() {
+                StageTimes::Scope scope(times, StageImages);
+                try {
+                    if (BakeImage(job, lazyCache)) {
+                        imagesBaked.fetch_add(1, std::memory_order_relaxed);
+                    }
+                } catch (const std::exception& e) {
+                    auto error = std::make_exception_ptr(std::runtime_error(std::string("Failed to process image: ") + e.what()));
+                    for (auto& [scene, index] : job.Uses) {
+                        scene->Fail(error);
+                    }
+                }
+            }, job.BakeBytes));
+        }
+        for (auto& task : imageTasks) {
+            task.get();
+        }
+
+        log.Write(nullptr, [&](std::ostream& out) {
+            out << "Peak in-flight image memory: " << pool.PeakInflightBytes() / (1024 * 1024) << " MiB";
+        });
+    }
 
-        auto loadScene = kajiya_asset::LoadGltfScene{
-            .Path = params.Path,
-            .Scale = params.Scale,
-            .Rotation = glm::quat{1.0f, 0.0f, 0.0f, 0.0f} // Quat::IDENTITY
-        };
+    size_t failed = 0;
+    for (auto& scene : scenes) {
+        if (!scene->Error && !scene->UpToDate) {
+            StageTimes::Scope scope(times, StageFinish);
+            try {
+                FinishScene(*scene, log);
+            } catch (...) {
+                scene->Fail(std::current_exception());
+            }
+        }
+        if (scene->Error) {
+            ++failed;
+            // A failed scene's pack writer is abandoned, leaving its previous pack in place.
+            scene->Pack.reset();
+            try {
+                std::rethrow_exception(scene->Error);
+            } catch (const std::exception& e) {
+                log.Write(scene.get(), [&](std::ostream& out) { out << "Failed to bake " << scene->Params->Path << ": " << e.what(); });
+            }
+        }
+    }
 
-        auto mesh = loadScene.IntoLazy();
-        auto evaluatedMesh = std::async(std::launch::async, [&]() {
-            return mesh.Eval(lazyCache);
-        }).get();
+    auto cacheStats = lazyCache->GetStats();
+    log.Write(nullptr, [&](std::ostream& out) {
+        out << "Lazy cache: " << cacheStats.Misses << " computed, " << cacheStats.Hits << " hits, "
+            << cacheStats.InFlightJoins << " joined in flight, " << std::fixed << std::setprecision(2)
+            << cacheStats.ComputeSeconds << " s of compute";
+    });
 
-        std::cout << "Packing the mesh..." << std::endl;
-        auto packedMesh = kajiya_asset::PackTriangleMesh(evaluatedMesh);
+    if (scenes.size() > 1) {
+        const double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - batchStart).count();
+        log.Write(nullptr, [&](std::ostream& out) {
+            out << "Batch: " << scenes.size() - failed << " of " << scenes.size() << " scenes baked, " << imagesBaked.load()
+                << " images baked for " << imageUses << " uses, " << std::fixed << std::setprecision(2) << wall << " s";
+        });
+        log.Write(nullptr, [&](std::ostream& out) {
+            out << "Stage times (summed over threads):" << std::fixed << std::setprecision(2);
+            for (size_t stage = 0; stage < StageCount; ++stage) {
+                out << " " << BAKE_STAGE_NAMES[stage] << " " << times.Seconds(static_cast<BakeStage>(stage)) << " s"
+                    << (stage + 1 < StageCount ? "," : "");
+            }
+        });
+    }
 
-        std::ofstream meshFile("cache/" + params.OutputName + ".mesh", std::ios::binary);
-        if (!meshFile.is_open()) {
-            throw std::runtime_error("Failed to create mesh file");
+    if (failed != 0) {
+        if (scenes.size() == 1) {
+            std::rethrow_exception(scenes.front()->Error);
         }
-        packedMesh.FlattenInto(meshFile);
+        throw std::runtime_error(std::to_string(failed) + " of " + std::to_string(scenes.size()) + " scenes failed to bake");
+    }
+
+    log.Write(nullptr, [](std::ostream& out) { out << "Done."; });
+}
+
+void MeshAssetProcessor::PackScene(SceneBake& scene, const std::shared_ptr<kajiya_asset::LazyCache>& lazyCache,
+                                   StageTimes& times, BakeLog& log) {
+    const auto& params = *scene.Params;
+    auto& manifest = scene.Manifest;
 
-        auto uniqueImages = std::vector<std::shared_ptr<kajiya_asset::Lazy<tekki::asset::GpuImage::Proto>>>();
-        auto imageSet = std::unordered_set<std::shared_ptr<kajiya_asset::Lazy<tekki::asset::GpuImage::Proto>>>();
-        
-        for (const auto& map : packedMesh.Maps) {
-            imageSet.insert(map);
+    // Inputs are hashed up front (reusing hashes of files whose size and time are unchanged).
+    // If they and the settings give the previous bake's key and its outputs are all still
+    // there, nothing needs loading at all.
+    {
+        StageTimes::Scope scope(times, StageHash);
+        if (params.Incremental) {
+            scene.Previous = BakeManifest::Load(scene.ManifestPath);
         }
-        
-        uniqueImages.assign(imageSet.begin(), imageSet.end());
 
-        std::vector<std::future<void>> imageTasks;
-        imageTasks.reserve(uniqueImages.size());
+        manifest.BakeVersion = kajiya_asset::BAKE_VERSION;
+        manifest.Scene = params.Path;
+        manifest.Inputs = HashBakeInputs(GltfInputFiles(params.Path), scene.Previous ? &*scene.Previous : nullptr);
+        manifest.SceneKey = BakeKey(params, manifest.Inputs);
+    }
+    const auto& previous = scene.Previous;
+    const bool sameScene = previous && previous->SceneKey == manifest.SceneKey;
 
-        for (const auto& img : uniqueImages) {
-            imageTasks.push_back(std::async(std::launch::async, [img, &lazyCache]() {
-                try {
-                    auto loaded = img->Eval(lazyCache);
-                    auto imgDst = std::filesystem::path("cache/" + FormatHex(img->Identity(), 8) + ".image");
-
-                    std::ofstream imageFile(imgDst, std::ios::binary);
-                    if (!imageFile.is_open()) {
-                        if (std::filesystem::exists(imgDst)) {
-                            std::cout << "Could not create " << imgDst << "; ignoring" << std::endl;
-                            return;
-                        } else {
-                            throw std::runtime_error("Failed to create image file");
-                        }
-                    }
+    if (sameScene && previous->OutputsExist()) {
+        manifest.Mesh = previous->Mesh;
+        manifest.Mesh.Status = BakeOutputStatus::Reused;
+        manifest.Images = previous->Images;
+        for (auto& image : manifest.Images) {
+            image.Status = BakeOutputStatus::Reused;
+        }
+        manifest.Save(scene.ManifestPath);
+        scene.UpToDate = true;
+        log.Write(&scene, [&](std::ostream& out) {
+            out << "Up to date: reused " << manifest.CountOutputs(BakeOutputStatus::Reused) << " outputs ("
+                << scene.ManifestPath.string() << ")";
+        });
+        return;
+    }
 
-                    std::vector<uint8_t> imageData;
-                    loaded->FlattenInto(imageData);
-                    imageFile.write(reinterpret_cast<const char*>(imageData.data()), imageData.size());
-                } catch (const std::exception& e) {
-                    throw std::runtime_error(std::string("Failed to process image: ") + e.what());
+    log.Write(&scene, [&](std::ostream& out) { out << "Loading " << params.Path << "..."; });
+
+    auto loadScene = kajiya_asset::LoadGltfScene{
+        .Path = params.Path,
+        .Scale = params.Scale,
+        .Rotation = glm::quat{1.0f, 0.0f, 0.0f, 0.0f} // Quat::IDENTITY
+    };
+    std::shared_ptr<kajiya_asset::Mesh> evaluatedMesh;
+    std::shared_ptr<kajiya_asset::InstancedScene> evaluatedScene;
+    {
+        StageTimes::Scope scope(times, StageLoad);
+        if (params.InstanceMeshes) {
+            evaluatedScene = loadScene.IntoInstancedLazy().Eval(lazyCache);
+        } else {
+            evaluatedMesh = loadScene.IntoLazy().Eval(lazyCache);
+        }
+    }
+
+    StageTimes::Scope scope(times, StagePack);
+    tekki::asset::PackTriangleMeshOptions packOptions;
+    packOptions.WeldVertices = params.WeldVertices;
+    packOptions.WeldEpsilon = params.WeldEpsilon;
+    packOptions.OptimizeVertexOrder = params.OptimizeVertexOrder;
+    packOptions.BuildMeshlets = true;
+    packOptions.TextureQuality = params.TextureQuality;
+    packOptions.LodErrors = params.LodErrors;
+    packOptions.AtlasMaxTextureSize = params.AtlasMaxTextureSize;
+
+    // Either one merged mesh or the unique meshes of an instanced scene; the steps below apply
+    // to each of them alike.
+    kajiya_asset::PackedTriangleMesh packedMesh;
+    kajiya_asset::PackedScene packedScene;
+    std::vector<tekki::asset::PackedTriangleMesh*> meshes;
+    std::vector<size_t> sourceVertices;
+    size_t sourceIndices = 0;
+
+    if (params.InstanceMeshes) {
+        log.Write(&scene, [&](std::ostream& out) { out << "Packing " << evaluatedScene->Meshes.size() << " unique meshes..."; });
+        for (const auto& mesh : evaluatedScene->Meshes) {
+            sourceVertices.push_back(mesh.Positions.size());
+            sourceIndices += mesh.Indices.size();
+        }
+        packedScene = kajiya_asset::PackInstancedScene(evaluatedScene, packOptions);
+        for (auto& mesh : packedScene.Packed.Meshes) {
+            meshes.push_back(&mesh);
+        }
+
+        // Flattening would have copied each mesh once per instance.
+        uint64_t uniqueBytes = 0;
+        uint64_t instancedBytes = 0;
+        for (const auto& mesh : packedScene.Packed.Meshes) {
+            uniqueBytes += GeometryBytes(mesh);
+        }
+        for (const auto& instance : packedScene.Packed.Instances) {
+            instancedBytes += GeometryBytes(packedScene.Packed.Meshes[instance.Mesh]);
+        }
+        log.Write(&scene, [&](std::ostream& out) {
+            out << "Instancing: " << packedScene.Packed.Instances.size() << " instances of " << packedScene.Packed.Meshes.size()
+                << " unique meshes (" << evaluatedScene->DuplicateMeshes << " duplicate glTF meshes merged), "
+                << instancedBytes - uniqueBytes << " bytes saved over flattening";
+        });
+    } else {
+        log.Write(&scene, [](std::ostream& out) { out << "Packing the mesh..."; });
+        sourceVertices.push_back(evaluatedMesh->Positions.size());
+        sourceIndices = evaluatedMesh->Indices.size();
+        packedMesh = kajiya_asset::PackTriangleMesh(evaluatedMesh, packOptions);
+        meshes.push_back(&packedMesh.Packed);
+
+        log.Write(&scene, [&](std::ostream& out) {
+            PrintVertexCacheStats(out, "Vertex cache (source)", evaluatedMesh->Indices, evaluatedMesh->Positions.size());
+        });
+        if (params.OptimizeVertexOrder) {
+            log.Write(&scene, [&](std::ostream& out) {
+                PrintVertexCacheStats(out, "Vertex cache (optimized)", packedMesh.Packed.Indices, packedMesh.Packed.Verts.size());
+            });
+        }
+        if (!packedMesh.Packed.Lods.empty()) {
+            log.Write(&scene, [&](std::ostream& out) {
+                out << "LODs: " << packedMesh.Packed.Indices.size() / 3 << " triangles";
+                for (const auto& lod : packedMesh.Packed.Lods) {
+                    out << ", " << lod.IndexCount / 3 << " (error " << lod.Error << ")";
                 }
-            }));
+            });
         }
+    }
+    evaluatedMesh.reset();
+    evaluatedScene.reset();
+
+    if (params.AtlasMaxTextureSize != 0) {
+        const auto& atlases = params.InstanceMeshes ? packedScene.Atlases : packedMesh.Atlases;
+        log.Write(&scene, [&](std::ostream& out) {
+            out << "Atlases: " << atlases.Maps << " maps of at most " << params.AtlasMaxTextureSize << " texels in "
+                << atlases.Pages << " pages (" << atlases.Maps - atlases.Pages << " fewer images)";
+        });
+    }
 
-        if (!imageTasks.empty()) {
-            std::cout << "Processing " << imageTasks.size() << " images..." << std::endl;
+    size_t totalSourceVertices = 0;
+    size_t packedVertices = 0;
+    size_t packedIndices = 0;
+    size_t meshlets = 0;
+    size_t materialRanges = 0;
+    uint64_t weldSavedBytes = 0;
+    for (size_t m = 0; m < meshes.size(); ++m) {
+        totalSourceVertices += sourceVertices[m];
+        packedVertices += meshes[m]->Verts.size();
+        packedIndices += meshes[m]->Indices.size();
+        meshlets += meshes[m]->Meshlets.size();
+        materialRanges += meshes[m]->MaterialRanges.size();
+        weldSavedBytes += (sourceVertices[m] - meshes[m]->Verts.size()) * VertexStride(*meshes[m]);
+    }
+    log.Write(&scene, [&](std::ostream& out) { out << "Meshlets: " << meshlets; });
+    log.Write(&scene, [&](std::ostream& out) {
+        out << "Material ranges: " << materialRanges << " (" << packedVertices * sizeof(uint32_t)
+            << " bytes of per-vertex material ids removed)";
+    });
+    if (params.WeldVertices) {
+        log.Write(&scene, [&](std::ostream& out) {
+            out << "Welded vertices: " << totalSourceVertices << " -> " << packedVertices << " (" << weldSavedBytes
+                << " bytes saved, " << (sourceIndices - packedIndices) / 3 << " degenerate triangles dropped)";
+        });
+    }
 
-            for (auto& task : imageTasks) {
-                task.get();
+    if (params.ShortIndices) {
+        tekki::asset::IndexCompactionStats compaction;
+        for (auto* mesh : meshes) {
+            auto meshStats = tekki::asset::CompactIndices(*mesh);
+            compaction.Ranges += meshStats.Ranges;
+            compaction.ShortRanges += meshStats.ShortRanges;
+            compaction.Bytes += meshStats.Bytes;
+            compaction.CompactBytes += meshStats.CompactBytes;
+        }
+        log.Write(&scene, [&](std::ostream& out) {
+            out << "16-bit indices: " << compaction.ShortRanges << " of " << compaction.Ranges << " ranges, "
+                << compaction.Bytes << " -> " << compaction.CompactBytes << " index bytes ("
+                << compaction.Bytes - compaction.CompactBytes << " saved)";
+        });
+    }
+
+    if (params.QuantizeVertices) {
+        tekki::asset::QuantizationReport report;
+        for (auto* mesh : meshes) {
+            auto meshReport = tekki::asset::QuantizeVertexStreams(*mesh);
+            report.FullBytes += meshReport.FullBytes;
+            report.QuantizedBytes += meshReport.QuantizedBytes;
+            report.MaxPositionError = std::max(report.MaxPositionError, meshReport.MaxPositionError);
+            report.MaxNormalErrorDegrees = std::max(report.MaxNormalErrorDegrees, meshReport.MaxNormalErrorDegrees);
+            report.MaxTangentErrorDegrees = std::max(report.MaxTangentErrorDegrees, meshReport.MaxTangentErrorDegrees);
+            report.MaxUvError = std::max(report.MaxUvError, meshReport.MaxUvError);
+            report.MaxColorError = std::max(report.MaxColorError, meshReport.MaxColorError);
+        }
+        log.Write(&scene, [&](std::ostream& out) {
+            out << "Quantized vertex streams: " << report.FullBytes << " -> " << report.QuantizedBytes << " bytes";
+        });
+        log.Write(&scene, [&](std::ostream& out) {
+            out << "Max round-trip error: position " << report.MaxPositionError
+                << ", normal " << report.MaxNormalErrorDegrees << " deg"
+                << ", tangent " << report.MaxTangentErrorDegrees << " deg"
+                << ", uv " << report.MaxUvError
+                << ", color " << report.MaxColorError;
+        });
+    }
+
+    // A pack holds the mesh and every image in one file; otherwise each gets its own.
+    // The mesh is keyed by the whole scene; images by their own content identity.
+    auto flattenMesh = [&](std::ofstream& meshFile) {
+        if (params.InstanceMeshes) {
+            packedScene.FlattenInto(meshFile);
+        } else {
+            packedMesh.FlattenInto(meshFile);
+        }
+    };
+    manifest.Mesh = {scene.MeshPath, manifest.SceneKey, BakeOutputStatus::Rebuilt};
+    if (params.Pack) {
+        if (previous && std::filesystem::exists(scene.MeshPath)) {
+            try {
+                scene.PreviousPack = tekki::asset::AssetPack::Open(scene.MeshPath);
+            } catch (const std::exception& e) {
+                log.Write(&scene, [&](std::ostream& out) { out << "Not reusing " << scene.MeshPath.string() << ": " << e.what(); });
             }
         }
+        scene.Pack = std::make_unique<tekki::asset::AssetPackWriter>(scene.MeshPath, params.PackCompression);
+        tekki::asset::FlatWriter meshWriter;
+        if (params.InstanceMeshes) {
+            packedScene.Packed.WriteFlat(meshWriter);
+        } else {
+            packedMesh.Packed.WriteFlat(meshWriter);
+        }
+        scene.Pack->Add(tekki::asset::PackNameIdentity(params.OutputName),
+                        params.InstanceMeshes ? tekki::asset::PackEntryKind::Scene : tekki::asset::PackEntryKind::Mesh, meshWriter);
+    } else if (sameScene && std::filesystem::exists(scene.MeshPath)) {
+        manifest.Mesh.Status = BakeOutputStatus::Reused;
+    } else {
+        WriteOutputFile(scene.MeshPath, flattenMesh);
+    }
+
+    auto& maps = params.InstanceMeshes ? packedScene.Maps : packedMesh.Maps;
+    auto& mapBakeBytes = params.InstanceMeshes ? packedScene.MapBakeBytes : packedMesh.MapBakeBytes;
 
-        std::cout << "Done." << std::endl;
+    if (previous) {
+        for (const auto& image : previous->Images) {
+            scene.PreviousImageKeys.insert(image.Key);
+        }
     }
+
+    // Pack entries also depend on the pack's codec, so their keys fold it in.
+    manifest.Images.resize(maps.size());
+    for (size_t i = 0; i < maps.size(); ++i) {
+        uint64_t identity = maps[i]->Identity();
+        auto& output = manifest.Images[i];
+        if (params.Pack) {
+            output.Key = kajiya_asset::IdentityHasher().Value(identity).Value(params.PackCompression).Finish();
+            output.Path = scene.MeshPath;
+        } else {
+            output.Key = identity;
+            output.Path = "cache/" + FormatHex(identity, 16) + ".image";
+        }
+    }
+    scene.Maps = std::move(maps);
+    scene.MapBakeBytes = std::move(mapBakeBytes);
+}
+
+bool MeshAssetProcessor::BakeImage(ImageJob& job, const std::shared_ptr<kajiya_asset::LazyCache>& lazyCache) {
+    const uint64_t identity = job.Map->Identity();
+
+    // Loose uses all share one content-addressed file, so an existing one is this exact bake.
+    std::filesystem::path loosePath;
+    bool writeLoose = false;
+    std::vector<std::pair<SceneBake*, size_t>> packUses;
+    for (auto& [scene, index] : job.Uses) {
+        auto& output = scene->Manifest.Images[index];
+        if (!scene->Pack) {
+            loosePath = output.Path;
+            writeLoose |= !scene->Params->Incremental || !std::filesystem::exists(output.Path);
+            continue;
+        }
+        if (scene->PreviousPack && scene->PreviousImageKeys.count(output.Key) != 0) {
+            if (const auto* entry = scene->PreviousPack->Find(identity)) {
+                scene->Pack->AddStored(*entry, scene->PreviousPack->GetStored(*entry));
+                output.Status = BakeOutputStatus::Reused;
+                continue;
+            }
+        }
+        packUses.emplace_back(scene, index);
+    }
+
+    for (auto& [scene, index] : job.Uses) {
+        if (!scene->Pack) {
+            scene->Manifest.Images[index].Status = writeLoose ? BakeOutputStatus::Rebuilt : BakeOutputStatus::Reused;
+        }
+    }
+    if (!writeLoose && packUses.empty()) {
+        return false;
+    }
+
+    auto loaded = job.Map->Eval(lazyCache);
+    for (auto& [scene, index] : packUses) {
+        scene->Pack->Add(identity, *loaded);
+    }
+    if (writeLoose) {
+        WriteOutputFile(loosePath, [&](std::ofstream& imageFile) {
+            tekki::asset::StreamFlattenSink sink(imageFile);
+            loaded->FlattenInto(sink);
+        });
+    }
+    return true;
+}
+
+void MeshAssetProcessor::FinishScene(SceneBake& scene, BakeLog& log) {
+    const auto& params = *scene.Params;
+    if (scene.Pack) {
+        // Release the old pack before the new one replaces it.
+        scene.PreviousPack.reset();
+        scene.Pack->Finish();
+        const double ratio = static_cast<double>(scene.Pack->GetFlatBytes()) / std::max<uint64_t>(scene.Pack->GetStoredBytes(), 1);
+        log.Write(&scene, [&](std::ostream& out) {
+            out << "Pack: " << scene.Maps.size() + 1 << " assets, " << scene.Pack->GetFlatBytes() << " -> "
+                << scene.Pack->GetStoredBytes() << " bytes (" << tekki::asset::CompressionCodecName(params.PackCompression)
+                << ", ratio " << std::fixed << std::setprecision(2) << ratio << ")";
+        });
+        scene.Pack.reset();
+    }
+
+    scene.Manifest.Save(scene.ManifestPath);
+    log.Write(&scene, [&](std::ostream& out) {
+        out << "Bake cache: " << scene.Manifest.CountOutputs(BakeOutputStatus::Reused) << " outputs reused, "
+            << scene.Manifest.CountOutputs(BakeOutputStatus::Rebuilt) << " rebuilt (" << scene.ManifestPath.string() << ")";
+    });
+}
+
+BatchBakeParams MeshAssetProcessor::LoadBatch(const std::filesystem::path& path, const MeshAssetProcessParams& defaults) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open batch manifest " + path.string());
+    }
+
+    static const std::map<std::string, tekki::asset::TexCompressionQuality> qualityNames{
+        {"fast", tekki::asset::TexCompressionQuality::Fast},
+        {"normal", tekki::asset::TexCompressionQuality::Normal},
+        {"best", tekki::asset::TexCompressionQuality::Best},
+    };
+    static const std::map<std::string, tekki::asset::CompressionCodec> codecNames{
+        {"none", tekki::asset::CompressionCodec::None},
+        {"zstd", tekki::asset::CompressionCodec::Zstd},
+        {"lz4", tekki::asset::CompressionCodec::Lz4},
+    };
+    auto lookup = [](const auto& names, const std::string& name, const char* what) {
+        auto it = names.find(name);
+        if (it == names.end()) {
+            throw std::runtime_error("unknown " + std::string(what) + " \"" + name + "\"");
+        }
+        return it->second;
+    };
+
+    BatchBakeParams batch;
+    batch.Jobs = defaults.Jobs;
+    batch.MaxInflightMb = defaults.MaxInflightMb;
+
+    try {
+        auto root = nlohmann::json::parse(file);
+        const auto base = path.parent_path();
+        for (const auto& entry : root.at("scenes")) {
+            MeshAssetProcessParams params = defaults;
+            params.Path = (base / entry.at("scene").get<std::string>()).lexically_normal();
+            params.OutputName = entry.value("output", params.Path.stem().string());
+            params.Scale = entry.value("scale", params.Scale);
+            params.OptimizeVertexOrder = entry.value("optimize_vertex_order", params.OptimizeVertexOrder);
+            params.QuantizeVertices = entry.value("quantize", params.QuantizeVertices);
+            params.LodErrors = entry.value("lod_errors", params.LodErrors);
+            params.WeldVertices = entry.value("weld", params.WeldVertices);
+            params.WeldEpsilon = entry.value("weld_epsilon", params.WeldEpsilon);
+            params.InstanceMeshes = entry.value("instance_meshes", params.InstanceMeshes);
+            params.ShortIndices = entry.value("short_indices", params.ShortIndices);
+            params.AtlasMaxTextureSize = entry.value("atlas_max_size", params.AtlasMaxTextureSize);
+            params.Pack = entry.value("pack", params.Pack);
+            if (entry.contains("bc_quality")) {
+                params.TextureQuality = lookup(qualityNames, entry["bc_quality"].get<std::string>(), "bc_quality");
+            }
+            if (entry.contains("pack_compression")) {
+                params.PackCompression = lookup(codecNames, entry["pack_compression"].get<std::string>(), "pack_compression");
+            }
+            batch.Scenes.push_back(std::move(params));
+        }
+    } catch (const std::exception& e) {
+        throw std::runtime_error("Invalid batch manifest " + path.string() + ": " + e.what());
+    }
+
+    if (batch.Scenes.empty()) {
+        throw std::runtime_error("Batch manifest " + path.string() + " lists no scenes");
+    }
+    return batch;
+}
+
+uint64_t MeshAssetProcessor::BakeKey(const MeshAssetProcessParams& params, const std::vector<BakeInput>& inputs) {
+    // Everything that changes the baked bytes; Jobs and MaxInflightMb only change how.
+    kajiya_asset::IdentityHasher hasher;
+    hasher.String("bake")
+        .Value(kajiya_asset::BAKE_VERSION)
+        .String(params.OutputName)
+        .Value(params.Scale)
+        .Value(params.OptimizeVertexOrder)
+        .Value(params.QuantizeVertices)
+        .Value(params.LodErrors.size())
+        .Bytes(params.LodErrors.data(), params.LodErrors.size() * sizeof(float))
+        .Value(params.WeldVertices)
+        .Value(params.WeldEpsilon)
+        .Value(params.InstanceMeshes)
+        .Value(params.ShortIndices)
+        .Value(params.AtlasMaxTextureSize)
+        .Value(params.TextureQuality)
+        .Value(params.Pack)
+        .Value(params.PackCompression);
+    for (const auto& input : inputs) {
+        hasher.String(input.Path.generic_string()).Value(input.Hash);
+    }
+    return hasher.Finish();
+}
+
+void MeshAssetProcessor::PrintVertexCacheStats(std::ostream& out, const char* label, const std::vector<uint32_t>& indices,
+                                               size_t vertexCount) {
+    auto stats = tekki::asset::AnalyzeVertexCache(indices, vertexCount);
+    out << label << ": ACMR " << std::fixed << std::setprecision(3) << stats.Acmr()
+        << ", ATVR " << stats.Atvr() << std::defaultfloat
+        << " (" << stats.Triangles << " triangles, FIFO " << tekki::asset::VERTEX_CACHE_SIZE << ")";
 }
 
 std::string MeshAssetProcessor::FormatHex(uint64_t value, size_t width) {
@@ -99,4 +753,77 @@ std::string MeshAssetProcessor::FormatHex(uint64_t value, size_t width) {
     return ss.str();
 }
 
+void EnvironmentAssetProcessor::ProcessEnvironment(const EnvironmentAssetProcessParams& params) {
+    std::filesystem::create_directories("cache");
+    const std::filesystem::path manifestPath = "cache/" + params.OutputName + ".manifest.json";
+
+    std::optional<BakeManifest> previous;
+    if (params.Incremental) {
+        previous = BakeManifest::Load(manifestPath);
+    }
+
+    BakeManifest manifest;
+    manifest.BakeVersion = kajiya_asset::BAKE_VERSION;
+    manifest.Scene = params.Path;
+    manifest.Inputs = HashBakeInputs({params.Path}, previous ? &*previous : nullptr);
+    manifest.SceneKey = BakeKey(params, manifest.Inputs);
+    manifest.Images = {
+        {"cache/" + params.OutputName + ".image", manifest.SceneKey, BakeOutputStatus::Rebuilt},
+        {"cache/" + params.OutputName + ".irradiance.image", manifest.SceneKey, BakeOutputStatus::Rebuilt},
+    };
+
+    const bool upToDate = previous && previous->SceneKey == manifest.SceneKey &&
+                          std::all_of(manifest.Images.begin(), manifest.Images.end(),
+                                      [](const BakeOutput& output) { return std::filesystem::exists(output.Path); });
+    if (upToDate) {
+        for (auto& image : manifest.Images) {
+            image.Status = BakeOutputStatus::Reused;
+        }
+        manifest.Save(manifestPath);
+        std::cout << "Up to date: reused " << manifest.Images.size() << " outputs (" << manifestPath.string() << ")" << std::endl;
+        return;
+    }
+
+    std::cout << "Loading " << params.Path << "..." << std::endl;
+    tekki::asset::HdrImage equirect;
+    try {
+        tekki::asset::ImageSource source(params.Path);
+        equirect = tekki::asset::DecodeExr(source.GetData());
+    } catch (const std::exception& e) {
+        throw std::runtime_error("Failed to load environment " + params.Path.string() + ": " + e.what());
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    auto baked = tekki::asset::BakeEnvironment(equirect, params.Options);
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Environment: " << equirect.Width << "x" << equirect.Height << " -> " << params.Options.CubeSize
+              << " cube, " << baked.Specular.Mips.size() << " GGX levels at " << params.Options.Specular.SampleCount
+              << " samples, " << std::fixed << std::setprecision(2) << seconds << " s" << std::endl;
+
+    const Proto* images[] = {&baked.Specular, &baked.Irradiance};
+    for (size_t i = 0; i < manifest.Images.size(); ++i) {
+        WriteOutputFile(manifest.Images[i].Path, [&](std::ofstream& imageFile) {
+            tekki::asset::StreamFlattenSink sink(imageFile);
+            images[i]->FlattenInto(sink);
+        });
+    }
+
+    manifest.Save(manifestPath);
+    std::cout << "Bake cache: " << manifest.Images.size() << " outputs rebuilt (" << manifestPath.string() << ")" << std::endl;
+}
+
+uint64_t EnvironmentAssetProcessor::BakeKey(const EnvironmentAssetProcessParams& params, const std::vector<BakeInput>& inputs) {
+    kajiya_asset::IdentityHasher hasher;
+    hasher.String("environment")
+        .Value(kajiya_asset::BAKE_VERSION)
+        .String(params.OutputName)
+        .Value(params.Options.CubeSize)
+        .Value(params.Options.Specular.SampleCount)
+        .Value(params.Options.Specular.MipCount);
+    for (const auto& input : inputs) {
+        hasher.String(input.Path.generic_string()).Value(input.Hash);
+    }
+    return hasher.Finish();
+}
+
 } // namespace tekki::kajiya_asset_pipe
\ No newline at end of file
@@ -8,6 +8,7 @@
 #include "tekki/asset/image.h"
 #include "tekki/asset/TexParams.h"
 #include "tekki/asset/GpuImage.h"
+#include "tekki/asset/mip_chain.h"
 #include "tekki/backend/lib.h"
 #include "tekki/backend/vulkan/image.h"
 #include "tekki/backend/vulkan/device.h"
@@ -56,6 +57,7 @@ std::size_t UploadGpuImage::Hash::operator()(const UploadGpuImage& key) const {
 
     hash_combine(static_cast<int>(key.m_params.gamma));
     hash_combine(key.m_params.use_mips);
+    hash_combine(static_cast<int>(key.m_params.MipFilter));
 
     return seed;
 }
@@ -94,7 +96,7 @@ std::shared_ptr<tekki::backend::vulkan::Image> UploadGpuImage::CreateImageWithMi
 
     for (uint32_t level = 1; level < mip_levels; level++) {
         auto& mip_data = mipmaps[level - 1];
-        uint32_t mip_width = std::max(width >> level, 1u);
+        uint32_t mip_width = tekki::asset::MipExtent(width, level);
         initial_data.emplace_back(tekki::backend::vulkan::ImageSubResourceData{
             mip_data,
             mip_width * 4,
@@ -146,56 +148,13 @@ std::shared_ptr<tekki::backend::vulkan::Image> UploadGpuImage::CreateImageWithou
 }
 
 std::vector<std::vector<uint8_t>> UploadGpuImage::GenerateMipmaps(const tekki::asset::RawImage& src) {
-    std::vector<std::vector<uint8_t>> mipmaps;
-
     const auto& rgba8 = src.GetRgba8Image();
-    uint32_t width = rgba8.dimensions.x;
-    uint32_t height = rgba8.dimensions.y;
-
-    if (rgba8.data.size() != width * height * 4) {
+    if (rgba8.data.size() != static_cast<size_t>(rgba8.dimensions.x) * rgba8.dimensions.y * 4) {
         throw std::runtime_error("UploadGpuImage: invalid image data size");
     }
 
-    std::vector<uint8_t> current_level(rgba8.data.begin(), rgba8.data.end());
-    uint32_t current_width = width;
-    uint32_t current_height = height;
-    
-    while (current_width > 1 || current_height > 1) {
-        uint32_t next_width = std::max(current_width / 2, 1u);
-        uint32_t next_height = std::max(current_height / 2, 1u);
-        
-        std::vector<uint8_t> next_level(next_width * next_height * 4);
-        
-        for (uint32_t y = 0; y < next_height; y++) {
-            for (uint32_t x = 0; x < next_width; x++) {
-                uint32_t src_x0 = x * 2;
-                uint32_t src_y0 = y * 2;
-                uint32_t src_x1 = std::min(src_x0 + 1, current_width - 1);
-                uint32_t src_y1 = std::min(src_y0 + 1, current_height - 1);
-                
-                for (int channel = 0; channel < 4; channel++) {
-                    uint32_t idx00 = (src_y0 * current_width + src_x0) * 4 + channel;
-                    uint32_t idx01 = (src_y0 * current_width + src_x1) * 4 + channel;
-                    uint32_t idx10 = (src_y1 * current_width + src_x0) * 4 + channel;
-                    uint32_t idx11 = (src_y1 * current_width + src_x1) * 4 + channel;
-                    
-                    uint32_t sum = current_level[idx00] + current_level[idx01] + 
-                                  current_level[idx10] + current_level[idx11];
-                    uint8_t avg = static_cast<uint8_t>(sum / 4);
-                    
-                    uint32_t dst_idx = (y * next_width + x) * 4 + channel;
-                    next_level[dst_idx] = avg;
-                }
-            }
-        }
-        
-        mipmaps.push_back(std::move(next_level));
-        current_level = mipmaps.back();
-        current_width = next_width;
-        current_height = next_height;
-    }
-    
-    return mipmaps;
+    return tekki::asset::GenerateMipChain(rgba8.data, rgba8.dimensions.x, rgba8.dimensions.y,
+                                          tekki::asset::MipChainOptions{m_params.gamma, m_params.MipFilter});
 }
 
 } // namespace tekki::renderer
\ No newline at end of file
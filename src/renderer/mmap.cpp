@@ -1,9 +1,128 @@
 #include "tekki/renderer/mmap.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
 
 namespace tekki::renderer {
 
-// Static member definitions
-std::unordered_map<std::filesystem::path, std::vector<uint8_t>> AssetMmapManager::AssetMmaps;
-std::mutex AssetMmapManager::AssetMmapsMutex;
+namespace {
+
+using tekki::core::MappedFile;
+
+constexpr size_t SHARD_COUNT = 16;
+
+// Entries are weak: the registry never keeps a file mapped by itself. Expired entries are
+// replaced on the next lookup of the same path and swept when their shard grows.
+struct Shard {
+    std::shared_mutex Mutex;
+    std::unordered_map<std::string, std::weak_ptr<const MappedFile>> Files;
+    size_t SweepAt = 64;
+};
+
+struct Registry {
+    std::array<Shard, SHARD_COUNT> Shards;
+    std::atomic<size_t> MappedFiles{0};
+    std::atomic<uint64_t> MappedBytes{0};
+
+    Shard& ShardFor(const std::string& key) {
+        return Shards[std::hash<std::string>{}(key) % SHARD_COUNT];
+    }
+};
+
+Registry& GetRegistry() {
+    static Registry registry;
+    return registry;
+}
+
+std::string CanonicalKey(const std::filesystem::path& path) {
+    try {
+        return std::filesystem::canonical(path).string();
+    } catch (const std::exception& e) {
+        throw std::runtime_error("Could not mmap " + path.string() + ": " + e.what());
+    }
+}
+
+std::shared_ptr<const MappedFile> Find(Shard& shard, const std::string& key) {
+    std::shared_lock lock(shard.Mutex);
+    auto it = shard.Files.find(key);
+    return it == shard.Files.end() ? nullptr : it->second.lock();
+}
+
+} // namespace
+
+std::shared_ptr<const MappedFile> AssetMmapManager::Map(const std::filesystem::path& path) {
+    Registry& registry = GetRegistry();
+    const std::string key = CanonicalKey(path);
+    Shard& shard = registry.ShardFor(key);
+
+    if (auto file = Find(shard, key)) {
+        return file;
+    }
+
+    std::unique_lock lock(shard.Mutex);
+    auto& entry = shard.Files[key];
+    if (auto file = entry.lock()) {
+        return file;
+    }
+
+    // The outer pointer's deleter keeps the counters in step; the mapping itself goes away with
+    // the inner pointer it captures.
+    auto mapped = MappedFile::Open(key);
+    const uint64_t size = mapped->Size();
+    registry.MappedFiles.fetch_add(1, std::memory_order_relaxed);
+    registry.MappedBytes.fetch_add(size, std::memory_order_relaxed);
+    std::shared_ptr<const MappedFile> file(mapped.get(), [mapped, size, &registry](const MappedFile*) mutable {
+        registry.MappedFiles.fetch_sub(1, std::memory_order_relaxed);
+        registry.MappedBytes.fetch_sub(size, std::memory_order_relaxed);
+        mapped.reset();
+    });
+    entry = file;
+
+    if (shard.Files.size() >= shard.SweepAt) {
+        std::erase_if(shard.Files, [](const auto& item) { return item.second.expired(); });
+        shard.SweepAt = std::max<size_t>(64, shard.Files.size() * 2);
+    }
+    return file;
+}
+
+void AssetMmapManager::Prefetch(const std::filesystem::path& path) {
+    const std::string key = CanonicalKey(path);
+    if (auto file = Find(GetRegistry().ShardFor(key), key)) {
+        file->WillNeed();
+    }
+}
+
+void AssetMmapManager::Evict(const std::filesystem::path& path) {
+    const std::string key = CanonicalKey(path);
+    if (auto file = Find(GetRegistry().ShardFor(key), key)) {
+        file->DontNeed();
+    }
+}
+
+AssetMmapManager::Stats AssetMmapManager::GetStats() {
+    Registry& registry = GetRegistry();
+    Stats stats;
+    stats.MappedFiles = registry.MappedFiles.load(std::memory_order_relaxed);
+    stats.MappedBytes = registry.MappedBytes.load(std::memory_order_relaxed);
+
+    std::vector<std::shared_ptr<const MappedFile>> live;
+    for (Shard& shard : registry.Shards) {
+        std::shared_lock lock(shard.Mutex);
+        for (const auto& [key, weak] : shard.Files) {
+            if (auto file = weak.lock()) {
+                live.push_back(std::move(file));
+            }
+        }
+    }
+    for (const auto& file : live) {
+        stats.ResidentBytes += file->ResidentBytes();
+    }
+    return stats;
+}
 
 } // namespace tekki::renderer
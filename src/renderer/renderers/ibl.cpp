@@ -2,6 +2,7 @@
 #include <fstream>
 #include <stdexcept>
 #include <array>
+#include <cstring>
 #include <optional>
 #include <memory>
 #include <vector>
@@ -11,6 +12,7 @@
 #include "tekki/backend/vulkan/image.h"
 #include "tekki/render_graph/lib.h"
 #include "tekki/backend/file.h"
+#include "tekki/asset/exr.h"
 
 namespace tekki::renderer::renderers {
 
@@ -61,11 +63,14 @@ ImageRgba16f IblRenderer::LoadHdr(const std::filesystem::path& filePath) {
 }
 
 ImageRgba16f IblRenderer::LoadExr(const std::filesystem::path& filePath) {
-    (void)filePath;  // Will be used when fully implemented
-    // TODO: Implement EXR loading
-    // For now, return a placeholder implementation
-    ImageRgba16f image(1, 1);
-    image.PutPixel(0, 0, {0x3C00, 0x3C00, 0x3C00, 0x3C00}); // 1.0 in f16 for all channels
+    // Only the top level is uploaded here, so the mip chain isn't built.
+    tekki::asset::ImageSource source(filePath);
+    auto proto = tekki::asset::LoadExrGpuImage(source, false);
+
+    ImageRgba16f image;
+    image.Size = glm::uvec2(proto.Extent[0], proto.Extent[1]);
+    image.Data.resize(proto.Mips[0].size() / sizeof(uint16_t));
+    std::memcpy(image.Data.data(), proto.Mips[0].data(), proto.Mips[0].size());
     return image;
 }
 
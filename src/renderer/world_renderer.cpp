@@ -24,6 +24,7 @@
 #include "tekki/rust_shaders_shared/render_overrides.h"
 #include "tekki/asset/mesh.h"
 #include "tekki/core/result.h"
+#include "tekki/renderer/buffer_builder.h"
 
 namespace tekki::renderer {
 
@@ -167,8 +168,12 @@ BindlessImageHandle WorldRenderer::AddImage(const std::shared_ptr<tekki::backend
     return handle;
 }
 
-MeshHandle WorldRenderer::AddMesh(const std::shared_ptr<tekki::asset::PackedTriMesh>& mesh, const AddMeshOptions& opts) {
+MeshHandle WorldRenderer::AddMesh(const std::shared_ptr<tekki::asset::PackedTriangleMesh>& mesh, const AddMeshOptions& opts) {
     size_t mesh_idx = Meshes.size();
+
+    if (mesh->Verts.empty() && !mesh->QuantizedVerts.empty()) {
+        throw std::runtime_error("AddMesh needs a mesh baked without vertex quantization");
+    }
     
     // Load and process images
     std::vector<std::shared_ptr<tekki::asset::GpuImage>> unique_images;
@@ -187,7 +192,7 @@ MeshHandle WorldRenderer::AddMesh(const std::shared_ptr<tekki::asset::PackedTriM
     }
     
     // Process materials
-    std::vector<tekki::asset::MeshMaterial> materials = mesh->GetMaterials();
+    std::vector<tekki::asset::MeshMaterial> materials = mesh->Materials;
     // TODO: Update material map indices
     
     if (opts.UseLights) {
@@ -196,16 +201,34 @@ MeshHandle WorldRenderer::AddMesh(const std::shared_ptr<tekki::asset::PackedTriM
         }
     }
     
-    uint32_t vertex_data_offset = static_cast<uint32_t>(VertexBufferWritten);
+    // Materials come from the full-detail material ranges; there is no per-vertex material stream.
+    // The table stays in material order: after CompactIndices, FirstIndex points into either
+    // ShortIndices or Indices, so it can't be searched by triangle index.
+    const size_t level0_ranges = mesh->Lods.empty() ? mesh->MaterialRanges.size() : mesh->Lods[0].FirstRange;
+    std::vector<tekki::asset::MaterialRange> material_ranges(mesh->MaterialRanges.begin(),
+                                                             mesh->MaterialRanges.begin() + level0_ranges);
     
     // Build vertex buffer data
-    // TODO: Implement buffer building
+    BufferBuilder buffer_builder;
+    uint64_t vertex_core_offset = buffer_builder.Append(mesh->Verts);
+    uint64_t vertex_uv_offset = buffer_builder.Append(mesh->Uvs);
+    uint64_t vertex_aux_offset = buffer_builder.Append(mesh->Colors);
+    uint64_t vertex_tangent_offset = buffer_builder.Append(mesh->Tangents);
+    uint64_t mat_data_offset = buffer_builder.Append(materials);
+    uint64_t index_offset = buffer_builder.Append(mesh->Indices);
+    uint64_t material_range_offset = buffer_builder.Append(material_ranges);
+    // Last, as it is only 2-byte aligned.
+    uint64_t short_index_offset = buffer_builder.Append(mesh->ShortIndices);
+    // Padded so the next mesh's slice starts 4-byte aligned too.
+    uint64_t total_buffer_size = (buffer_builder.GetCurrentOffset() + 3) & ~uint64_t(3);
     
     // Upload to GPU
+    uint32_t vertex_data_offset;
     {
         std::lock_guard<std::mutex> lock(VertexBufferMutex);
-        // TODO: Upload vertex data
-        VertexBufferWritten += /* total_buffer_size */ 0;
+        vertex_data_offset = static_cast<uint32_t>(VertexBufferWritten);
+        buffer_builder.Upload(Device, VertexBuffer.get(), vertex_data_offset);
+        VertexBufferWritten += total_buffer_size;
     }
     
     // Update mesh buffer
@@ -215,46 +238,74 @@ MeshHandle WorldRenderer::AddMesh(const std::shared_ptr<tekki::asset::PackedTriM
         auto gpu_meshes = reinterpret_cast<GpuMesh*>(mapped_data);
 
         gpu_meshes[mesh_idx] = GpuMesh{
-            /* vertex_core_offset */ 0,
-            /* vertex_uv_offset */ 0,
-            /* vertex_mat_offset */ 0,
-            /* vertex_aux_offset */ 0,
-            /* vertex_tangent_offset */ 0,
-            /* mat_data_offset */ 0,
-            /* index_offset */ 0
+            /* vertex_core_offset */ vertex_data_offset + static_cast<uint32_t>(vertex_core_offset),
+            /* vertex_uv_offset */ vertex_data_offset + static_cast<uint32_t>(vertex_uv_offset),
+            /* vertex_aux_offset */ vertex_data_offset + static_cast<uint32_t>(vertex_aux_offset),
+            /* vertex_tangent_offset */ vertex_data_offset + static_cast<uint32_t>(vertex_tangent_offset),
+            /* mat_data_offset */ vertex_data_offset + static_cast<uint32_t>(mat_data_offset),
+            /* index_offset */ vertex_data_offset + static_cast<uint32_t>(index_offset),
+            /* material_range_offset */ vertex_data_offset + static_cast<uint32_t>(material_range_offset),
+            /* material_range_count */ static_cast<uint32_t>(material_ranges.size()),
+            /* short_index_offset */ vertex_data_offset + static_cast<uint32_t>(short_index_offset)
         };
     }
     
-    // Create BLAS if ray tracing is enabled
-    if (Device->RayTracingEnabled()) {
-        auto vertex_buffer_da = VertexBuffer->DeviceAddress(Device->GetRaw()) + /* vertex_core_offset */ 0;
-        auto index_buffer_da = VertexBuffer->DeviceAddress(Device->GetRaw()) + /* index_offset */ 0;
-        
-        tekki::backend::vulkan::RayTracingBottomAccelerationDesc blas_desc;
-        tekki::backend::vulkan::RayTracingGeometryDesc geometry_desc;
-        geometry_desc.GeometryType = tekki::backend::vulkan::RayTracingGeometryType::Triangle;
-        geometry_desc.VertexBuffer = vertex_buffer_da;
-        geometry_desc.IndexBuffer = index_buffer_da;
-        geometry_desc.VertexFormat = VK_FORMAT_R32G32B32_SFLOAT;
-        geometry_desc.VertexStride = sizeof(tekki::asset::PackedVertex);
+    // Create BLAS if ray tracing is enabled; a mesh without triangles has no geometry to build.
+    if (Device->RayTracingEnabled() && !mesh->Verts.empty() && !material_ranges.empty()) {
+        auto vertex_buffer_da = VertexBuffer->DeviceAddress(Device->GetRaw()) + vertex_data_offset + vertex_core_offset;
+        auto index_buffer_da = VertexBuffer->DeviceAddress(Device->GetRaw()) + vertex_data_offset + index_offset;
+        auto short_index_buffer_da = VertexBuffer->DeviceAddress(Device->GetRaw()) + vertex_data_offset + short_index_offset;
         
-        tekki::backend::vulkan::RayTracingGeometryPart part;
-        part.IndexCount = mesh->GetIndices().size();
-        part.IndexOffset = 0;
-        part.MaxVertex = *std::max_element(mesh->GetIndices().begin(), mesh->GetIndices().end());
+        // One geometry per full-detail material range, in table order, so a hit's geometry index
+        // is its MaterialRange index; 16-bit ranges read the short index buffer and have their
+        // base vertex added to every index.
+        uint32_t max_vertex = static_cast<uint32_t>(mesh->Verts.size() - 1);
         
-        geometry_desc.Parts = {part};
-        blas_desc.Geometries = {geometry_desc};
+        tekki::backend::vulkan::RayTracingBottomAccelerationDesc blas_desc;
+        for (const auto& range : material_ranges) {
+            bool short_indices = range.IndexSize == sizeof(uint16_t);
+            
+            tekki::backend::vulkan::RayTracingGeometryDesc geometry_desc;
+            geometry_desc.GeometryType = tekki::backend::vulkan::RayTracingGeometryType::Triangle;
+            geometry_desc.VertexBuffer = vertex_buffer_da;
+            geometry_desc.IndexBuffer = short_indices ? short_index_buffer_da : index_buffer_da;
+            geometry_desc.VertexFormat = VK_FORMAT_R32G32B32_SFLOAT;
+            geometry_desc.VertexStride = sizeof(tekki::asset::PackedVertex);
+            geometry_desc.IndexType = short_indices ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+            
+            tekki::backend::vulkan::RayTracingGeometryPart part;
+            part.IndexCount = range.IndexCount;
+            part.IndexOffset = range.FirstIndex;
+            part.MaxVertex = max_vertex;
+            part.FirstVertex = short_indices ? range.BaseVertex : 0;
+            
+            geometry_desc.Parts = {part};
+            blas_desc.Geometries.push_back(std::move(geometry_desc));
+        }
         
         auto blas = Device->CreateRayTracingBottomAcceleration(blas_desc);
         MeshBlas.push_back(std::make_shared<tekki::backend::vulkan::RayTracingAcceleration>(blas));
+    } else if (Device->RayTracingEnabled()) {
+        // Keeps MeshBlas indexed by mesh; instances of this mesh are left out of the TLAS.
+        MeshBlas.push_back(nullptr);
     }
     
-    // Add mesh to list
-    Meshes.push_back(UploadedTriMesh{
-        /* IndexBufferOffset */ 0,
-        /* IndexCount */ static_cast<uint32_t>(mesh->GetIndices().size())
-    });
+    // Add mesh to list; 16-bit and 32-bit ranges live in different index streams, so each
+    // range is its own draw.
+    UploadedTriMesh uploaded;
+    uploaded.Draws.reserve(material_ranges.size());
+    for (const auto& range : material_ranges) {
+        bool short_indices = range.IndexSize == sizeof(uint16_t);
+        uploaded.Draws.push_back(UploadedMeshDraw{
+            /* IndexBufferOffset */ vertex_data_offset + (short_indices ? short_index_offset : index_offset) +
+                static_cast<uint64_t>(range.FirstIndex) * range.IndexSize,
+            /* IndexCount */ range.IndexCount,
+            /* IndexType */ short_indices ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32,
+            /* VertexOffset */ short_indices ? range.BaseVertex : 0,
+            /* MaterialId */ range.MaterialId
+        });
+    }
+    Meshes.push_back(std::move(uploaded));
     
     // Process mesh lights if requested
     MeshLightSet mesh_lights;
@@ -338,6 +389,9 @@ void WorldRenderer::BuildRayTracingTopLevelAcceleration() {
     instances.reserve(Instances.size());
     
     for (const auto& inst : Instances) {
+        if (!MeshBlas[inst.Mesh.GetValue()]) {
+            continue;
+        }
         instances.push_back(tekki::backend::vulkan::RayTracingInstanceDesc{
             MeshBlas[inst.Mesh.GetValue()],
             inst.Transform,
@@ -368,6 +422,9 @@ void WorldRenderer::PrepareTopLevelAcceleration(class TemporalRenderGraph& rg) {
     instances.reserve(Instances.size());
     
     for (const auto& inst : Instances) {
+        if (!MeshBlas[inst.Mesh.GetValue()]) {
+            continue;
+        }
         instances.push_back(tekki::backend::vulkan::RayTracingInstanceDesc{
             MeshBlas[inst.Mesh.GetValue()],
             inst.Transform,
@@ -0,0 +1,181 @@
+#include <catch2/catch_test_macros.hpp>
+#include <tekki/asset/asset_pack.h>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <vector>
+
+using namespace tekki::asset;
+namespace fs = std::filesystem;
+
+namespace {
+
+GpuImage::Proto MakeImage(uint32_t size, uint8_t fill) {
+    GpuImage::Proto image;
+    image.Format = 37;
+    image.Extent = {size, size, 1};
+    for (uint32_t extent = size; extent > 0; extent /= 2) {
+        image.Mips.emplace_back(static_cast<size_t>(extent) * extent * 4, fill);
+    }
+    return image;
+}
+
+} // namespace
+
+TEST_CASE("Asset pack", "[asset][pack]") {
+    auto path = fs::temp_directory_path() / "tekki_test.pack";
+
+    PackedTriangleMesh mesh;
+    for (uint32_t i = 0; i < 4; ++i) {
+        mesh.Verts.push_back(PackedVertex{{float(i), 0.0f, 0.0f}, i});
+    }
+    mesh.Indices = {0, 1, 2, 2, 1, 3};
+    mesh.Maps = {{0x30}, {0x10}};
+
+    for (auto codec : {CompressionCodec::None, CompressionCodec::Zstd, CompressionCodec::Lz4}) {
+        fs::remove(path);
+        {
+            AssetPackWriter writer(path, codec);
+            FlatWriter mesh_writer;
+            mesh.WriteFlat(mesh_writer);
+            REQUIRE(writer.Add(PackNameIdentity("scene"), PackEntryKind::Mesh, mesh_writer));
+            REQUIRE(writer.Add(0x30, MakeImage(256, 3)));
+            REQUIRE(writer.Add(0x10, MakeImage(8, 1)));
+            REQUIRE_FALSE(writer.Add(0x10, MakeImage(8, 2)));
+            REQUIRE(!fs::exists(path));
+            writer.Finish();
+            if (codec != CompressionCodec::None) {
+                REQUIRE(writer.GetStoredBytes() < writer.GetFlatBytes());
+            }
+        }
+
+        auto pack = AssetPack::Open(path);
+        REQUIRE(pack->GetEntries().size() == 3);
+        REQUIRE(pack->GetEntries()[0].Identity == 0x10);
+        REQUIRE(pack->Find(0x20) == nullptr);
+        REQUIRE(pack->Get<GpuImage::Flat>(0x20) == nullptr);
+
+        auto flat_mesh = pack->Get<PackedTriMesh::Flat>(PackNameIdentity("scene"));
+        REQUIRE(flat_mesh);
+        REQUIRE(flat_mesh->Verts.GetLength() == 4);
+        REQUIRE(flat_mesh->Indices[5] == 3);
+        REQUIRE(flat_mesh->Maps[0].Identity == 0x30);
+
+        auto small = pack->Get<GpuImage::Flat>(0x10);
+        REQUIRE(small->Extent[0] == 8);
+        REQUIRE(small->Mips[0][0] == 1);
+
+        auto large = pack->Get<GpuImage::Flat>(0x30);
+        REQUIRE(large->Mips.GetLength() == 9);
+        REQUIRE(large->Mips[0].GetLength() == 256 * 256 * 4);
+        REQUIRE(large->Mips[8][3] == 3);
+
+        const PackEntry* entry = pack->Find(0x30);
+        REQUIRE(entry->Offset % FlatWriter::PAGE_ALIGNMENT == 0);
+        if (codec == CompressionCodec::None) {
+            // Stored entries are read in place, with large payloads on their own pages.
+            REQUIRE(entry->Codec == CompressionCodec::None);
+            REQUIRE(reinterpret_cast<uintptr_t>(large->Mips[0].GetData()) % FlatWriter::PAGE_ALIGNMENT == 0);
+            REQUIRE(pack->GetDecodeStats().DecodedBytes == 0);
+        } else {
+            REQUIRE(entry->Codec == codec);
+            REQUIRE(entry->StoredSize < entry->Size);
+
+            std::vector<uint8_t> upload(static_cast<size_t>(entry->Size));
+            pack->LoadInto(*entry, upload);
+            auto loaded = pack->Load(*entry);
+            REQUIRE(std::memcmp(upload.data(), loaded.get(), upload.size()) == 0);
+            REQUIRE_THROWS(pack->LoadInto(*entry, std::span(upload).first(upload.size() - 1)));
+
+            auto stats = pack->GetDecodeStats();
+            REQUIRE(stats.DecodedBytes > stats.StoredBytes);
+            REQUIRE(stats.GigabytesPerSecond() > 0.0);
+        }
+    }
+
+    SECTION("Abandoned writers leave nothing behind") {
+        fs::remove(path);
+        {
+            AssetPackWriter writer(path);
+            REQUIRE(writer.Add(1, MakeImage(4, 0)));
+        }
+        REQUIRE(!fs::exists(path));
+        REQUIRE(!fs::exists(path.string() + ".tmp"));
+        REQUIRE_THROWS(AssetPack::Open(path));
+    }
+
+    SECTION("Entries copy between packs without decoding") {
+        auto copy_path = fs::temp_directory_path() / "tekki_test_copy.pack";
+        fs::remove(path);
+        {
+            AssetPackWriter writer(path, CompressionCodec::Zstd);
+            REQUIRE(writer.Add(0x30, MakeImage(64, 5)));
+            writer.Finish();
+        }
+        auto source = AssetPack::Open(path);
+        const PackEntry* entry = source->Find(0x30);
+        {
+            AssetPackWriter writer(copy_path, CompressionCodec::Zstd);
+            REQUIRE(writer.AddStored(*entry, source->GetStored(*entry)));
+            REQUIRE_FALSE(writer.AddStored(*entry, source->GetStored(*entry)));
+            writer.Finish();
+        }
+        auto copy = AssetPack::Open(copy_path);
+        auto image = copy->Get<GpuImage::Flat>(0x30);
+        REQUIRE(image->Mips[2][7] == 5);
+        REQUIRE(copy->Find(0x30)->StoredSize == entry->StoredSize);
+        fs::remove(copy_path);
+    }
+
+    fs::remove(path);
+}
+
+TEST_CASE("Block compression", "[asset][pack]") {
+    // A small header, a compressible section spanning several blocks and an incompressible one.
+    std::vector<uint8_t> data(100 + 3 * COMPRESSION_BLOCK_SIZE / 2 + COMPRESSION_BLOCK_SIZE);
+    const uint64_t smooth = 104;
+    const uint64_t noise = smooth + 3 * COMPRESSION_BLOCK_SIZE / 2;
+    for (size_t i = smooth; i < noise; ++i) {
+        data[i] = static_cast<uint8_t>(i / 64);
+    }
+    std::mt19937 rng(7);
+    for (size_t i = noise; i < data.size(); ++i) {
+        data[i] = static_cast<uint8_t>(rng());
+    }
+    const std::vector<std::pair<uint64_t, uint64_t>> sections = {
+        {0, 100}, {smooth, noise - smooth}, {noise, data.size() - noise}};
+
+    for (auto codec : {CompressionCodec::None, CompressionCodec::Zstd, CompressionCodec::Lz4}) {
+        auto stream = CompressBlocks(data, codec, sections);
+        REQUIRE(BlockStreamSize(stream) == data.size());
+
+        BlockStreamHeader header;
+        std::memcpy(&header, stream.data(), sizeof(header));
+        std::vector<CompressedBlock> blocks(header.BlockCount);
+        std::memcpy(blocks.data(), stream.data() + sizeof(header), blocks.size() * sizeof(CompressedBlock));
+
+        // Large sections start blocks of their own; the header gets a block to itself.
+        REQUIRE(blocks.size() == 4);
+        REQUIRE(blocks[0].Size == smooth);
+        REQUIRE(blocks[1].Offset == smooth);
+        REQUIRE(blocks[3].Offset == noise);
+        for (const auto& block : blocks) {
+            REQUIRE(block.Size <= COMPRESSION_BLOCK_SIZE);
+        }
+        if (codec != CompressionCodec::None) {
+            REQUIRE(blocks[1].StoredSize < blocks[1].Size);
+            REQUIRE(blocks[3].StoredSize == blocks[3].Size);
+        }
+
+        std::vector<uint8_t> decoded(data.size());
+        DecompressBlocks(stream, decoded);
+        REQUIRE(decoded == data);
+
+        REQUIRE_THROWS(DecompressBlocks(stream, std::span(decoded).first(decoded.size() - 1)));
+        REQUIRE_THROWS(BlockStreamSize(std::span(stream).first(stream.size() - 1)));
+    }
+
+    auto stream = CompressBlocks(std::span<const uint8_t>(), CompressionCodec::Lz4);
+    REQUIRE(BlockStreamSize(stream) == 0);
+}
@@ -0,0 +1,123 @@
+#include <catch2/catch_test_macros.hpp>
+#include <tekki/kajiya_asset_pipe/bake_manifest.h>
+#include <tekki/kajiya_asset_pipe/lib.h>
+#include <kajiya_asset/mesh.h>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+using namespace tekki::kajiya_asset_pipe;
+namespace fs = std::filesystem;
+
+namespace {
+
+void WriteText(const fs::path& path, const std::string& text) {
+    std::ofstream file(path, std::ios::binary);
+    file << text;
+}
+
+} // namespace
+
+TEST_CASE("Bake manifest", "[asset][bake]") {
+    auto dir = fs::temp_directory_path() / "tekki_test_bake";
+    fs::remove_all(dir);
+    fs::create_directories(dir / "textures");
+
+    auto gltf = dir / "scene.gltf";
+    WriteText(gltf, R"({
+        "buffers": [{"uri": "scene.bin", "byteLength": 4}],
+        "images": [
+            {"uri": "textures/base%20color.png"},
+            {"uri": "data:image/png;base64,AAAA"},
+            {"bufferView": 0, "mimeType": "image/png"}
+        ]
+    })");
+    WriteText(dir / "scene.bin", "abcd");
+    WriteText(dir / "textures" / "base color.png", "png");
+
+    auto files = GltfInputFiles(gltf);
+    REQUIRE(files.size() == 3);
+    REQUIRE(files[0] == gltf);
+    REQUIRE(files[1] == dir / "scene.bin");
+    REQUIRE(files[2] == dir / "textures" / "base color.png");
+
+    auto inputs = HashBakeInputs(files, nullptr);
+    REQUIRE(inputs.size() == 3);
+    REQUIRE(inputs[1].Size == 4);
+    REQUIRE(inputs[1].Hash != inputs[2].Hash);
+
+    SECTION("Hashes of unchanged files are reused") {
+        BakeManifest previous;
+        previous.Inputs = inputs;
+        previous.Inputs[1].Hash = 42;
+        REQUIRE(HashBakeInputs(files, &previous)[1].Hash == 42);
+
+        // Same size, different time: hashed again.
+        previous.Inputs[1].ModifiedTime += 1;
+        REQUIRE(HashBakeInputs(files, &previous)[1].Hash == inputs[1].Hash);
+    }
+
+    SECTION("Round trip") {
+        BakeManifest manifest;
+        manifest.BakeVersion = kajiya_asset::BAKE_VERSION;
+        manifest.Scene = gltf;
+        manifest.SceneKey = 0xfedcba9876543210ull;
+        manifest.Inputs = inputs;
+        manifest.Mesh = {dir / "scene.mesh", manifest.SceneKey, BakeOutputStatus::Rebuilt};
+        manifest.Images = {{dir / "a.image", 1, BakeOutputStatus::Reused}};
+
+        auto path = dir / "scene.manifest.json";
+        manifest.Save(path);
+        auto loaded = BakeManifest::Load(path);
+        REQUIRE(loaded);
+        REQUIRE(loaded->SceneKey == manifest.SceneKey);
+        REQUIRE(loaded->Inputs.size() == 3);
+        REQUIRE(loaded->FindInput(files[2])->Hash == inputs[2].Hash);
+        REQUIRE(loaded->Images[0].Status == BakeOutputStatus::Reused);
+        REQUIRE(loaded->CountOutputs(BakeOutputStatus::Rebuilt) == 1);
+        REQUIRE_FALSE(loaded->OutputsExist());
+
+        manifest.BakeVersion += 1;
+        manifest.Save(path);
+        REQUIRE_FALSE(BakeManifest::Load(path));
+
+        WriteText(path, "{ not json");
+        REQUIRE_FALSE(BakeManifest::Load(path));
+    }
+
+    fs::remove_all(dir);
+}
+
+TEST_CASE("Batch bake manifest", "[asset][bake]") {
+    auto dir = fs::temp_directory_path() / "tekki_test_batch";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+
+    auto path = dir / "batch.json";
+    WriteText(path, R"({"scenes": [
+        {"scene": "scenes/a.gltf"},
+        {"scene": "b.glb", "output": "bee", "scale": 0.5, "pack": true, "pack_compression": "lz4", "bc_quality": "fast"}
+    ]})");
+
+    MeshAssetProcessParams defaults{};
+    defaults.Scale = 2.0f;
+    defaults.Jobs = 3;
+    auto batch = MeshAssetProcessor::LoadBatch(path, defaults);
+    REQUIRE(batch.Jobs == 3);
+    REQUIRE(batch.Scenes.size() == 2);
+    REQUIRE(batch.Scenes[0].Path == dir / "scenes" / "a.gltf");
+    REQUIRE(batch.Scenes[0].OutputName == "a");
+    REQUIRE(batch.Scenes[0].Scale == 2.0f);
+    REQUIRE_FALSE(batch.Scenes[0].Pack);
+    REQUIRE(batch.Scenes[1].OutputName == "bee");
+    REQUIRE(batch.Scenes[1].Scale == 0.5f);
+    REQUIRE(batch.Scenes[1].PackCompression == tekki::asset::CompressionCodec::Lz4);
+    REQUIRE(batch.Scenes[1].TextureQuality == tekki::asset::TexCompressionQuality::Fast);
+
+    WriteText(path, R"({"scenes": [{"scene": "a.gltf", "pack_compression": "brotli"}]})");
+    REQUIRE_THROWS(MeshAssetProcessor::LoadBatch(path, defaults));
+    WriteText(path, R"({"scenes": []})");
+    REQUIRE_THROWS(MeshAssetProcessor::LoadBatch(path, defaults));
+
+    fs::remove_all(dir);
+}
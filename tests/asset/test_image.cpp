@@ -1,6 +1,18 @@
 #include <catch2/catch_test_macros.hpp>
+#include <tekki/asset/environment.h>
+#include <tekki/asset/exr.h>
 #include <tekki/asset/image.h>
+#include <tekki/asset/mip_chain.h>
+#include <tekki/asset/texture_atlas.h>
+#include <kajiya_asset/mesh.h>
+#include <tekki/core/half.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <filesystem>
+#include <fstream>
+#include <memory>
+#include <vector>
 
 using namespace tekki::asset;
 namespace fs = std::filesystem;
@@ -28,3 +40,694 @@ TEST_CASE("Image structure", "[asset][image]") {
         REQUIRE(sizeof(float) == 4);
     }
 }
+
+namespace {
+
+// Smooth colour ramps with a hard edge and some noise, at a size that is not a multiple of 4.
+std::vector<uint8_t> MakeTestImage(uint32_t width, uint32_t height, bool translucent) {
+    std::vector<uint8_t> rgba(static_cast<size_t>(width) * height * 4);
+    uint32_t seed = 1;
+    for (uint32_t y = 0; y < height; ++y) {
+        for (uint32_t x = 0; x < width; ++x) {
+            seed = seed * 1664525u + 1013904223u;
+            int noise = static_cast<int>((seed >> 24) & 3) - 2;
+            uint8_t* p = &rgba[(static_cast<size_t>(y) * width + x) * 4];
+            p[0] = static_cast<uint8_t>(std::clamp<int>(x * 128 / width + noise, 0, 255));
+            p[1] = static_cast<uint8_t>(std::clamp<int>(64 + y * 128 / height - noise, 0, 255));
+            p[2] = x < width / 2 ? 40 : 200;
+            p[3] = translucent ? static_cast<uint8_t>((x + y) * 255 / (width + height)) : 255;
+        }
+    }
+    return rgba;
+}
+
+double Psnr(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b, int channels) {
+    double sum = 0.0;
+    size_t count = 0;
+    for (size_t i = 0; i < a.size(); i += 4) {
+        for (int c = 0; c < channels; ++c) {
+            double d = static_cast<double>(a[i + c]) - static_cast<double>(b[i + c]);
+            sum += d * d;
+            ++count;
+        }
+    }
+    double mse = sum / static_cast<double>(count);
+    return mse == 0.0 ? 100.0 : 10.0 * std::log10(255.0 * 255.0 / mse);
+}
+
+// DDS file with 16-byte-block surfaces; each byte holds its surface's index in file order.
+std::vector<uint8_t> MakeBc7Dds(uint32_t width, uint32_t height, uint32_t mips, uint32_t arraySize) {
+    std::vector<uint8_t> bytes(4 + 124 + 20);
+    auto put = [&](size_t offset, uint32_t value) { std::memcpy(&bytes[offset], &value, sizeof(value)); };
+    put(0, 0x20534444);
+    put(4, 124);
+    put(8, 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000);
+    put(12, height);
+    put(16, width);
+    put(28, mips);
+    put(76, 32);
+    put(80, 0x4);
+    std::memcpy(&bytes[84], "DX10", 4);
+    put(128, 98); // BC7_UNORM
+    put(132, 3);  // TEXTURE2D
+    put(140, arraySize);
+
+    uint8_t surface = 0;
+    for (uint32_t slice = 0; slice < arraySize; ++slice) {
+        for (uint32_t mip = 0; mip < mips; ++mip, ++surface) {
+            bytes.insert(bytes.end(), BcBlockCount(MipExtent(width, mip), MipExtent(height, mip)) * 16, surface);
+        }
+    }
+    return bytes;
+}
+
+
+// Uncompressed scanline EXR with half B, G and R channels; pixel (x, y) is (x, y, x + y) / 4.
+std::vector<uint8_t> MakeExr(int32_t width, int32_t height) {
+    std::vector<uint8_t> bytes;
+    auto put = [&](const void* data, size_t size) {
+        bytes.insert(bytes.end(), static_cast<const uint8_t*>(data), static_cast<const uint8_t*>(data) + size);
+    };
+    auto put32 = [&](int32_t value) { put(&value, 4); };
+    auto putString = [&](const char* text) { put(text, std::strlen(text) + 1); };
+    auto attribute = [&](const char* name, const char* type, int32_t size) {
+        putString(name);
+        putString(type);
+        put32(size);
+    };
+
+    put32(20000630);
+    put32(2);
+    attribute("channels", "chlist", 3 * 18 + 1);
+    for (const char* channel : {"B", "G", "R"}) {
+        putString(channel);
+        put32(1); // HALF
+        put32(0);
+        put32(1);
+        put32(1);
+    }
+    bytes.push_back(0);
+    attribute("compression", "compression", 1);
+    bytes.push_back(0);
+    for (const char* window : {"dataWindow", "displayWindow"}) {
+        attribute(window, "box2i", 16);
+        put32(0);
+        put32(0);
+        put32(width - 1);
+        put32(height - 1);
+    }
+    attribute("lineOrder", "lineOrder", 1);
+    bytes.push_back(0);
+    float aspect = 1.0f;
+    attribute("pixelAspectRatio", "float", 4);
+    put(&aspect, 4);
+    float center[2] = {0.0f, 0.0f};
+    attribute("screenWindowCenter", "v2f", 8);
+    put(center, 8);
+    attribute("screenWindowWidth", "float", 4);
+    put(&aspect, 4);
+    bytes.push_back(0);
+
+    size_t table = bytes.size();
+    bytes.resize(table + static_cast<size_t>(height) * 8);
+    for (int32_t y = 0; y < height; ++y) {
+        uint64_t offset = bytes.size();
+        std::memcpy(&bytes[table + static_cast<size_t>(y) * 8], &offset, 8);
+        put32(y);
+        put32(width * 3 * 2);
+        for (int channel = 2; channel >= 0; --channel) {
+            for (int32_t x = 0; x < width; ++x) {
+                float value = (channel == 0 ? x : channel == 1 ? y : x + y) / 4.0f;
+                uint16_t half = tekki::core::FloatToHalf(value);
+                put(&half, 2);
+            }
+        }
+    }
+    return bytes;
+}
+
+
+// Latitude-longitude image whose texels are `radiance(direction)` in every colour channel.
+template<typename F>
+HdrImage MakeEquirect(uint32_t width, uint32_t height, F&& radiance) {
+    HdrImage image{width, height, std::vector<float>(static_cast<size_t>(width) * height * 4, 1.0f)};
+    for (uint32_t y = 0; y < height; ++y) {
+        for (uint32_t x = 0; x < width; ++x) {
+            float phi = ((x + 0.5f) / width - 0.5f) * 2.0f * 3.14159265f;
+            float theta = (y + 0.5f) / height * 3.14159265f;
+            glm::vec3 dir(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+            float value = radiance(dir);
+            float* p = &image.Rgba[(static_cast<size_t>(y) * width + x) * 4];
+            p[0] = p[1] = p[2] = value;
+        }
+    }
+    return image;
+}
+
+// Mean red of `face` on `level`.
+float FaceMean(const HdrCubemap& cube, uint32_t level, uint32_t face) {
+    const float* texels = cube.Mips[level].data() + face * cube.FaceFloats(level);
+    double sum = 0.0;
+    for (size_t i = 0; i < cube.FaceFloats(level); i += 4) {
+        sum += texels[i];
+    }
+    return static_cast<float>(sum / (cube.FaceFloats(level) / 4));
+}
+
+
+// Binary PPM of a solid `width` x `height` colour, which DecodeImage reads like any other format.
+std::vector<uint8_t> MakePpm(uint32_t width, uint32_t height, std::array<uint8_t, 3> rgb) {
+    std::string header = "P6\n" + std::to_string(width) + " " + std::to_string(height) + "\n255\n";
+    std::vector<uint8_t> bytes(header.begin(), header.end());
+    for (uint32_t i = 0; i < width * height; ++i) {
+        bytes.insert(bytes.end(), rgb.begin(), rgb.end());
+    }
+    return bytes;
+}
+
+} // namespace
+
+TEST_CASE("Image sources", "[asset][image]") {
+    auto bytes = MakeTestImage(7, 3, false);
+    auto path = fs::temp_directory_path() / "tekki_test_source.bin";
+    std::ofstream(path, std::ios::binary).write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+
+    SECTION("Files are mapped and outlive their source through the backing") {
+        std::shared_ptr<const void> backing;
+        std::span<const uint8_t> data;
+        {
+            ImageSource source(path);
+            REQUIRE(source.GetType() == ImageSourceType::File);
+            data = source.GetData();
+            backing = source.GetBacking();
+        }
+        REQUIRE(std::equal(data.begin(), data.end(), bytes.begin(), bytes.end()));
+    }
+
+    SECTION("Memory sources take over the buffer") {
+        std::vector<uint8_t> buffer = bytes;
+        const uint8_t* original = buffer.data();
+        ImageSource source(std::move(buffer));
+        REQUIRE(source.GetData().data() == original);
+        REQUIRE_THROWS(source.GetPath());
+    }
+
+    SECTION("LoadImage shares one source between evaluations") {
+        auto lazy = LoadImage::FromPath(path);
+        auto first = lazy.Evaluate();
+        REQUIRE(first == lazy.Evaluate());
+        REQUIRE(first->GetData().size() == bytes.size());
+
+        auto immediate = LoadImage::FromMemory(bytes);
+        REQUIRE(immediate.GetType() == LoadImageType::Immediate);
+        REQUIRE(immediate.Evaluate()->GetData()[5] == bytes[5]);
+
+        REQUIRE_THROWS(LoadImage::FromPath(path.string() + ".missing").Evaluate());
+    }
+
+    fs::remove(path);
+}
+
+TEST_CASE("DDS container parsing", "[asset][image][dds]") {
+    auto bytes = MakeBc7Dds(20, 8, 3, 2);
+    auto owner = std::make_shared<const std::vector<uint8_t>>(bytes);
+
+    SECTION("Surfaces are views into the parsed bytes") {
+        auto dds = DdsImage::Parse(*owner, owner);
+        REQUIRE(dds->GetFormat() == VK_FORMAT_BC7_UNORM_BLOCK);
+        REQUIRE(dds->GetWidth() == 20);
+        REQUIRE(dds->GetMipCount() == 3);
+        REQUIRE(dds->GetSliceCount() == 2);
+        REQUIRE(dds->GetBacking() == owner);
+
+        REQUIRE(dds->GetSurface(0).size() == 5 * 2 * 16);
+        REQUIRE(dds->GetSurface(2).size() == 2 * 1 * 16);
+        REQUIRE(dds->GetSurface(0).data() == owner->data() + 148);
+        REQUIRE(dds->GetSurface(1, 1)[0] == 4);
+        REQUIRE(dds->GetSurface(2, 1).data() + dds->GetSurface(2, 1).size() == owner->data() + owner->size());
+        REQUIRE_THROWS(dds->GetSurface(3));
+    }
+
+    SECTION("Truncated and foreign files are rejected") {
+        std::vector<uint8_t> truncated(bytes.begin(), bytes.end() - 1);
+        REQUIRE_THROWS(DdsImage::Parse(truncated, nullptr));
+        REQUIRE_FALSE(DdsImage::IsDds(MakeTestImage(4, 4, false)));
+        REQUIRE_THROWS(DdsImage::Parse(MakeTestImage(4, 4, false), nullptr));
+    }
+
+    SECTION("CreateGpuImage passes mapped mips through without copying") {
+        auto single = MakeBc7Dds(20, 8, 3, 1);
+        auto path = fs::temp_directory_path() / "tekki_test_bc7.dds";
+        std::ofstream(path, std::ios::binary).write(reinterpret_cast<const char*>(single.data()), single.size());
+
+        auto raw = std::make_shared<RawImage>(DecodeImage(ImageSource(path)));
+        REQUIRE(raw->GetType() == RawImageType::Dds);
+        auto proto = CreateGpuImage(raw, TexParams{}).Create();
+        fs::remove(path);
+
+        REQUIRE(proto.Format == VK_FORMAT_BC7_UNORM_BLOCK);
+        REQUIRE(proto.Mips.empty());
+        REQUIRE(proto.GetMipCount() == 3);
+        REQUIRE(proto.GetMip(0).data() == raw->GetDds()->GetSurface(0).data());
+
+        std::vector<uint8_t> flat;
+        proto.FlattenInto(flat);
+        const auto* image = reinterpret_cast<const GpuImage::Flat*>(flat.data());
+        REQUIRE(image->Mips.GetLength() == 3);
+        REQUIRE(image->Mips[2].GetLength() == 32);
+        REQUIRE(image->Mips[2][0] == 2);
+    }
+
+    SECTION("Arrays are not material maps") {
+        ImageSource source(bytes);
+        auto raw = std::make_shared<RawImage>(DecodeImage(source));
+        REQUIRE(raw->GetDds()->GetBacking() == source.GetBacking());
+        REQUIRE_THROWS(CreateGpuImage(raw, TexParams{}).Create());
+    }
+}
+
+TEST_CASE("BC block compression", "[asset][image][bc]") {
+    const uint32_t width = 37, height = 21;
+
+    SECTION("BC7 round-trips opaque images, improving with quality") {
+        auto rgba = MakeTestImage(width, height, false);
+        double previous = 0.0;
+        for (auto quality : {TexCompressionQuality::Fast, TexCompressionQuality::Normal, TexCompressionQuality::Best}) {
+            auto blocks = CompressBc(rgba, width, height, BcMode::Bc7, false, quality);
+            REQUIRE(blocks.size() == BcBlockCount(width, height) * BC_BLOCK_BYTES);
+            REQUIRE(blocks == CompressBc(rgba, width, height, BcMode::Bc7, false, quality));
+
+            auto decoded = DecompressBc(blocks, width, height, BcMode::Bc7);
+            double psnr = Psnr(rgba, decoded, 3);
+            REQUIRE(psnr > 38.0);
+            REQUIRE(psnr >= previous - 0.05);
+            previous = psnr;
+        }
+    }
+
+    SECTION("BC7 keeps alpha when asked to") {
+        auto rgba = MakeTestImage(width, height, true);
+        auto blocks = CompressBc(rgba, width, height, BcMode::Bc7, true, TexCompressionQuality::Normal);
+        auto decoded = DecompressBc(blocks, width, height, BcMode::Bc7);
+        REQUIRE(Psnr(rgba, decoded, 4) > 37.0);
+    }
+
+    SECTION("Solid blocks stay within one step") {
+        std::vector<uint8_t> rgba(8 * 8 * 4);
+        for (size_t i = 0; i < rgba.size(); i += 4) {
+            rgba[i + 0] = 13;
+            rgba[i + 1] = 200;
+            rgba[i + 2] = 97;
+            rgba[i + 3] = 255;
+        }
+        auto decoded = DecompressBc(CompressBc(rgba, 8, 8, BcMode::Bc7, false, TexCompressionQuality::Fast), 8, 8, BcMode::Bc7);
+        for (size_t i = 0; i < rgba.size(); i += 4) {
+            for (int c = 0; c < 3; ++c) {
+                REQUIRE(std::abs(decoded[i + c] - rgba[i + c]) <= 1);
+            }
+        }
+    }
+
+    SECTION("BC5 stores red and green") {
+        auto rgba = MakeTestImage(width, height, false);
+        auto blocks = CompressBc(rgba, width, height, BcMode::Bc5, false, TexCompressionQuality::Normal);
+        REQUIRE(blocks.size() == BcBlockCount(width, height) * BC_BLOCK_BYTES);
+
+        auto decoded = DecompressBc(blocks, width, height, BcMode::Bc5);
+        REQUIRE(Psnr(rgba, decoded, 2) > 48.0);
+        REQUIRE(decoded[2] == 0);
+        REQUIRE(decoded[3] == 255);
+    }
+
+    SECTION("CreateGpuImage compresses according to the texture params") {
+        RawRgba8Image raw{MakeTestImage(width, height, false), {width, height}};
+        TexParams params;
+        params.Compression = TexCompressionMode::Rg;
+
+        auto proto = CreateGpuImage(std::make_shared<RawImage>(raw), params).Create();
+        REQUIRE(proto.Format == VK_FORMAT_BC5_UNORM_BLOCK);
+        REQUIRE(proto.Mips.size() == MipLevelCount(width, height));
+        for (uint32_t level = 0; level < proto.Mips.size(); ++level) {
+            REQUIRE(proto.Mips[level].size() ==
+                    BcBlockCount(MipExtent(width, level), MipExtent(height, level)) * BC_BLOCK_BYTES);
+        }
+
+        params.Compression = TexCompressionMode::Rgba;
+        params.srgb = true;
+        proto = CreateGpuImage(std::make_shared<RawImage>(raw), params).Create();
+        REQUIRE(proto.Format == VK_FORMAT_BC7_SRGB_BLOCK);
+
+        params.MaxMipCount = 2;
+        proto = CreateGpuImage(std::make_shared<RawImage>(raw), params).Create();
+        REQUIRE(proto.Mips.size() == 2);
+    }
+}
+
+TEST_CASE("Mip chain generation", "[asset][image][mips]") {
+    using namespace tekki::asset;
+
+    SECTION("Non-power-of-two extents round down to 1x1") {
+        REQUIRE(MipLevelCount(37, 21) == 6);
+        REQUIRE(MipLevelCount(1, 1) == 1);
+        REQUIRE(MipExtent(37, 1) == 18);
+        REQUIRE(MipExtent(21, 5) == 1);
+
+        auto levels = GenerateMipChain(MakeTestImage(37, 21, true), 37, 21, {});
+        REQUIRE(levels.size() == 5);
+        for (uint32_t level = 1; level <= levels.size(); ++level) {
+            REQUIRE(levels[level - 1].size() == MipByteSize(37, 21, level));
+        }
+    }
+
+    SECTION("Solid colours are preserved by both filters") {
+        std::vector<uint8_t> rgba(23 * 9 * 4);
+        for (size_t i = 0; i < rgba.size(); i += 4) {
+            rgba[i] = 17;
+            rgba[i + 1] = 128;
+            rgba[i + 2] = 250;
+            rgba[i + 3] = 99;
+        }
+        for (auto filter : {TexMipFilter::Box, TexMipFilter::Kaiser}) {
+            for (auto level : GenerateMipChain(rgba, 23, 9, {TexGamma::Srgb, filter})) {
+                for (size_t i = 0; i < level.size(); i += 4) {
+                    REQUIRE(std::equal(level.begin() + i, level.begin() + i + 4, rgba.begin()));
+                }
+            }
+        }
+    }
+
+    SECTION("sRGB texels are averaged in linear space") {
+        // Black and white stripes: averaging linear light gives 0.5, which is sRGB 188, not 128.
+        std::vector<uint8_t> rgba(4 * 4 * 4);
+        for (size_t i = 0; i < 16; ++i) {
+            uint8_t v = (i % 2) ? 255 : 0;
+            std::fill(rgba.begin() + i * 4, rgba.begin() + i * 4 + 3, v);
+            rgba[i * 4 + 3] = v;
+        }
+
+        auto srgb = GenerateMipChain(rgba, 4, 4, {TexGamma::Srgb, TexMipFilter::Box});
+        REQUIRE(srgb[0][0] == 188);
+        REQUIRE(srgb[0][3] == 128);
+
+        auto linear = GenerateMipChain(rgba, 4, 4, {TexGamma::Linear, TexMipFilter::Box});
+        REQUIRE(linear[0][0] == 128);
+    }
+
+    SECTION("Odd extents weight every source texel by coverage") {
+        std::vector<uint8_t> rgba = {30, 0, 0, 255, 60, 0, 0, 255, 90, 0, 0, 255};
+        auto levels = GenerateMipChain(rgba, 3, 1, {TexGamma::Linear, TexMipFilter::Box});
+        REQUIRE(levels.size() == 1);
+        REQUIRE(levels[0][0] == 60);
+    }
+
+    SECTION("Kaiser stays close to box on smooth content") {
+        auto rgba = MakeTestImage(64, 48, false);
+        auto box = GenerateMipChain(rgba, 64, 48, {TexGamma::Srgb, TexMipFilter::Box});
+        auto kaiser = GenerateMipChain(rgba, 64, 48, {TexGamma::Srgb, TexMipFilter::Kaiser});
+        REQUIRE(Psnr(box[0], kaiser[0], 3) > 30.0);
+    }
+
+    SECTION("Storage size mismatches are rejected") {
+        std::vector<std::vector<uint8_t>> levels(1, std::vector<uint8_t>(3));
+        REQUIRE_THROWS(GenerateMipChainInto(MakeTestImage(4, 4, false), 4, 4, levels, {}));
+    }
+
+    SECTION("CreateGpuImage bakes the chain") {
+        RawRgba8Image raw{MakeTestImage(37, 21, false), {37, 21}};
+        TexParams params;
+        auto proto = CreateGpuImage(std::make_shared<RawImage>(raw), params).Create();
+        REQUIRE(proto.Mips.size() == 6);
+        REQUIRE(proto.Mips[5].size() == 4);
+
+        params.use_mips = false;
+        proto = CreateGpuImage(std::make_shared<RawImage>(raw), params).Create();
+        REQUIRE(proto.Mips.size() == 1);
+    }
+}
+
+TEST_CASE("EXR loading", "[asset][image][exr]") {
+    auto bytes = MakeExr(13, 7);
+
+    SECTION("Files are recognised by their magic number") {
+        REQUIRE(IsExr(bytes));
+        REQUIRE_FALSE(IsExr(MakeBc7Dds(4, 4, 1, 1)));
+    }
+
+    SECTION("Channels decode by name with opaque alpha") {
+        auto image = DecodeExr(bytes);
+        REQUIRE(image.Width == 13);
+        REQUIRE(image.Height == 7);
+        for (uint32_t y = 0; y < 7; ++y) {
+            for (uint32_t x = 0; x < 13; ++x) {
+                const float* p = &image.Rgba[(static_cast<size_t>(y) * 13 + x) * 4];
+                REQUIRE(p[0] == x / 4.0f);
+                REQUIRE(p[1] == y / 4.0f);
+                REQUIRE(p[2] == (x + y) / 4.0f);
+                REQUIRE(p[3] == 1.0f);
+            }
+        }
+    }
+
+    SECTION("Corrupt files are rejected") {
+        bytes.resize(bytes.size() / 2);
+        REQUIRE_THROWS(LoadExrGpuImage(ImageSource(std::move(bytes))));
+    }
+
+    SECTION("LoadExrGpuImage builds an RGBA16F chain") {
+        auto proto = LoadExrGpuImage(ImageSource(std::move(bytes)));
+        REQUIRE(proto.Format == VK_FORMAT_R16G16B16A16_SFLOAT);
+        REQUIRE(proto.Extent == std::array<uint32_t, 3>{13, 7, 1});
+        REQUIRE(proto.Mips.size() == 4);
+        for (uint32_t mip = 0; mip < proto.Mips.size(); ++mip) {
+            REQUIRE(proto.Mips[mip].size() == MipExtent(13, mip) * MipExtent(7, mip) * 8);
+        }
+        uint16_t texel[4];
+        std::memcpy(texel, &proto.Mips[0][(2 * 13 + 5) * 8], 8);
+        REQUIRE(tekki::core::HalfToFloat(texel[0]) == 1.25f);
+        REQUIRE(tekki::core::HalfToFloat(texel[2]) == 1.75f);
+    }
+
+    SECTION("Half conversion matches the scalar helper") {
+        std::vector<float> values = {0.0f, -0.0f, 1.0f, -2.5f, 65504.0f, 65520.0f, 1.0e6f, 1.0e-5f,
+                                     5.96e-8f, 2.0e-8f, 1.0e-9f, 0.333333f, INFINITY, -INFINITY};
+        for (int i = 0; i < 1000; ++i) {
+            values.push_back(std::ldexp(static_cast<float>(i * 7919 % 1000) / 1000.0f, i % 40 - 28));
+        }
+        std::vector<uint16_t> halves(values.size());
+        ConvertFloatsToHalves(values, halves);
+        for (size_t i = 0; i < values.size(); ++i) {
+            REQUIRE(halves[i] == tekki::core::FloatToHalf(values[i]));
+        }
+    }
+
+    SECTION("Float mips keep values above one") {
+        std::vector<float> src(static_cast<size_t>(6) * 5 * 4, 40.0f);
+        std::vector<float> dst(static_cast<size_t>(3) * 2 * 4);
+        DownsampleRgba32f(src, 6, 5, dst, 3, 2, TexMipFilter::Kaiser);
+        for (float value : dst) {
+            REQUIRE(std::abs(value - 40.0f) < 1.0e-3f);
+        }
+    }
+}
+
+TEST_CASE("Environment prefiltering", "[asset][image][environment]") {
+    constexpr float PI = 3.14159265f;
+
+    SECTION("Face directions follow the Vulkan cube layout") {
+        const glm::vec3 axes[CUBE_FACE_COUNT] = {{1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1}};
+        for (uint32_t face = 0; face < CUBE_FACE_COUNT; ++face) {
+            glm::vec3 centre = CubeFaceDirection(face, 0.0f, 0.0f);
+            REQUIRE(glm::dot(centre, axes[face]) == 1.0f);
+        }
+        // +Z: u runs along +X, v down along -Y.
+        glm::vec3 corner = CubeFaceDirection(4, 1.0f, 1.0f);
+        REQUIRE(corner.x == 1.0f);
+        REQUIRE(corner.y == -1.0f);
+    }
+
+    SECTION("Constant environments stay constant") {
+        auto equirect = MakeEquirect(64, 32, [](const glm::vec3&) { return 2.0f; });
+        auto cube = CubemapFromEquirect(equirect, 16);
+        REQUIRE(cube.Mips.size() == 5);
+
+        auto specular = PrefilterGgx(cube, {64, 0});
+        REQUIRE(specular.Mips.size() == 5);
+        for (const auto& level : specular.Mips) {
+            for (size_t i = 0; i < level.size(); i += 4) {
+                REQUIRE(std::abs(level[i] - 2.0f) < 1.0e-3f);
+            }
+        }
+
+        auto sh = ProjectShIrradiance(cube);
+        for (glm::vec3 n : {glm::vec3(0, 1, 0), glm::vec3(0.6f, 0, -0.8f), glm::vec3(0, -1, 0)}) {
+            REQUIRE(std::abs(sh.Evaluate(n).x - 2.0f * PI) < 1.0e-3f);
+        }
+    }
+
+    SECTION("SH irradiance of a sky hemisphere") {
+        // Uniform radiance above the horizon gives E(n) = pi (1 + n.y) / 2, which bands 0 and 1
+        // hold exactly.
+        auto equirect = MakeEquirect(256, 128, [](const glm::vec3& dir) { return dir.y > 0.0f ? 1.0f : 0.0f; });
+        auto sh = ProjectShIrradiance(CubemapFromEquirect(equirect, 64));
+        REQUIRE(std::abs(sh.Evaluate({0, 1, 0}).x - PI) < 0.03f * PI);
+        REQUIRE(std::abs(sh.Evaluate({0, -1, 0}).x) < 0.03f * PI);
+        REQUIRE(std::abs(sh.Evaluate({1, 0, 0}).x - 0.5f * PI) < 0.03f * PI);
+    }
+
+    SECTION("Rougher levels spread light further") {
+        auto equirect = MakeEquirect(128, 64, [](const glm::vec3& dir) { return dir.x > 0.0f ? 1.0f : 0.0f; });
+        auto specular = PrefilterGgx(CubemapFromEquirect(equirect, 32), {128, 0});
+        REQUIRE(specular.Mips.size() == 6);
+
+        // Light leaks onto the face opposite the lit one, more at every level. The 1x1 level is
+        // left out: its one texel looks straight down the axis, away from the lit half.
+        REQUIRE(FaceMean(specular, 0, 1) == 0.0f);
+        for (uint32_t level = 1; level < 5; ++level) {
+            REQUIRE(FaceMean(specular, level, 1) > FaceMean(specular, level - 1, 1));
+            REQUIRE(FaceMean(specular, level, 0) < FaceMean(specular, level - 1, 0));
+        }
+        REQUIRE(FaceMean(specular, 4, 1) > 0.05f);
+    }
+
+    SECTION("BakeEnvironment stores a half cube and the SH coefficients") {
+        auto equirect = MakeEquirect(64, 32, [](const glm::vec3& dir) { return 1.0f + dir.y; });
+        EnvironmentBakeOptions options;
+        options.CubeSize = 16;
+        options.Specular = {32, 3};
+        auto baked = BakeEnvironment(equirect, options);
+
+        REQUIRE(baked.Specular.Format == VK_FORMAT_R16G16B16A16_SFLOAT);
+        REQUIRE(baked.Specular.Extent == std::array<uint32_t, 3>{16, 16, 6});
+        REQUIRE(baked.Specular.Mips.size() == 3);
+        for (uint32_t level = 0; level < 3; ++level) {
+            REQUIRE(baked.Specular.Mips[level].size() == MipExtent(16, level) * MipExtent(16, level) * 6 * 8);
+        }
+
+        REQUIRE(baked.Irradiance.Format == VK_FORMAT_R32G32B32A32_SFLOAT);
+        REQUIRE(baked.Irradiance.Extent == std::array<uint32_t, 3>{9, 1, 1});
+        float stored[4];
+        std::memcpy(stored, &baked.Irradiance.Mips[0][2 * 16], sizeof(stored));
+        REQUIRE(stored[0] == baked.Sh.Coefficients[2].x);
+        REQUIRE(stored[3] == 0.0f);
+    }
+
+    SECTION("Malformed inputs are rejected") {
+        REQUIRE_THROWS(CubemapFromEquirect(HdrImage{4, 4, {}}, 16));
+        HdrCubemap cube{8, {std::vector<float>(10)}};
+        REQUIRE_THROWS(PrefilterGgx(cube));
+    }
+}
+
+TEST_CASE("Texture atlases", "[asset][image][atlas]") {
+    SECTION("Cells are bordered, block aligned and kept on the page") {
+        std::vector<glm::u32vec2> sizes = {{4, 4}, {30, 10}, {1, 1}, {64, 64}, {30, 10}};
+        auto layout = PackAtlas(sizes, 96, 4);
+        REQUIRE(layout.Placements.size() == sizes.size());
+        for (size_t i = 0; i < sizes.size(); ++i) {
+            const auto& placement = layout.Placements[i];
+            const auto page = layout.Pages[placement.Page];
+            REQUIRE(placement.X % 4 == 0);
+            REQUIRE(placement.Y % 4 == 0);
+            REQUIRE(placement.X + sizes[i].x + 4 <= page.x);
+            REQUIRE(placement.Y + sizes[i].y + 4 <= page.y);
+            for (size_t j = 0; j < i; ++j) {
+                const auto& other = layout.Placements[j];
+                bool apart = other.Page != placement.Page || other.X >= placement.X + sizes[i].x + 8 ||
+                             placement.X >= other.X + sizes[j].x + 8 || other.Y >= placement.Y + sizes[i].y + 8 ||
+                             placement.Y >= other.Y + sizes[j].y + 8;
+                REQUIRE(apart);
+            }
+        }
+        REQUIRE(layout.Pages.size() == 2);
+        REQUIRE_THROWS(PackAtlas(std::vector<glm::u32vec2>{{90, 4}}, 96, 4));
+    }
+
+    SECTION("Borders repeat the edge texels") {
+        std::vector<uint8_t> rgba = {10, 0, 0, 255, 20, 0, 0, 255, 30, 0, 0, 255, 40, 0, 0, 255};
+        std::vector<uint8_t> page(8 * 8 * 4, 0);
+        BlitAtlasImage(rgba, {2, 2}, page, 8, 2, 2, 2);
+        auto red = [&](uint32_t x, uint32_t y) { return page[(y * 8 + x) * 4]; };
+        REQUIRE(red(0, 0) == 10);
+        REQUIRE(red(2, 2) == 10);
+        REQUIRE(red(3, 2) == 20);
+        REQUIRE(red(5, 0) == 20);
+        REQUIRE(red(0, 5) == 30);
+        REQUIRE(red(5, 5) == 40);
+        REQUIRE(red(6, 6) == 0);
+        REQUIRE_THROWS(BlitAtlasImage(rgba, {2, 2}, page, 8, 1, 2, 2));
+    }
+
+    SECTION("Map transforms land in the placement") {
+        std::array<float, 6> rotated = {0.0f, 1.0f, -1.0f, 0.0f, 0.0f, 1.0f}; // (u, v) -> (v, 1 - u)
+        auto transform = AtlasMapTransform(rotated, {16, 8}, 32, 4, {64, 32});
+        glm::vec2 lo;
+        glm::vec2 hi;
+        TransformUvBounds(transform, glm::vec2(0.0f), glm::vec2(1.0f), lo, hi);
+        REQUIRE(lo.x == 0.5f);
+        REQUIRE(lo.y == 0.125f);
+        REQUIRE(hi.x == 0.75f);
+        REQUIRE(hi.y == 0.375f);
+        REQUIRE(AtlasMipCount(4) == 3);
+        REQUIRE(AtlasMipCount(1) == 1);
+    }
+
+    SECTION("Packing moves small maps into atlases") {
+        auto mesh = std::make_shared<TriangleMesh>();
+        mesh->Positions = {{0, 0, 0}, {1, 0, 0}, {0, 1, 0}};
+        mesh->Normals = {{0, 0, 1}, {0, 0, 1}, {0, 0, 1}};
+        mesh->Uvs = {{0, 0}, {1, 0}, {0, 1}};
+        mesh->Indices = {0, 1, 2};
+        mesh->MaterialIds = {0, 0, 0};
+
+        MeshMaterial material{};
+        material.Maps = {0, 1, 2, 3};
+        for (auto& transform : material.MapTransforms) {
+            transform = {1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f};
+        }
+        material.MapTransforms[2] = {3.0f, 0.0f, 0.0f, 3.0f, 0.0f, 0.0f}; // Tiles, so it can't be atlased
+        mesh->Materials = {material};
+
+        TexParams albedo;
+        albedo.Compression = TexCompressionMode::Rgba;
+        albedo.srgb = true;
+        mesh->Maps = {
+            MeshMaterialMap::CreateImage(std::make_shared<ImageSource>(MakePpm(4, 4, {200, 10, 10})), albedo),
+            MeshMaterialMap::CreatePlaceholder({255, 255, 255, 255}),
+            MeshMaterialMap::CreateImage(std::make_shared<ImageSource>(MakePpm(4, 4, {10, 200, 10})), albedo),
+            MeshMaterialMap::CreatePlaceholder({0, 0, 0, 255}),
+        };
+
+        PackTriangleMeshOptions options;
+        auto separate = kajiya_asset::PackTriangleMesh(mesh, options);
+        REQUIRE(separate.Maps.size() == 4);
+        REQUIRE(separate.Atlases.Maps == 0);
+
+        options.AtlasMaxTextureSize = 64;
+        auto packed = kajiya_asset::PackTriangleMesh(mesh, options);
+        REQUIRE(packed.Atlases.Maps == 3);
+        REQUIRE(packed.Atlases.Pages == 2);
+        REQUIRE(packed.Maps.size() == 3);
+        REQUIRE(packed.Packed.Maps[2].Identity == separate.Packed.Maps[2].Identity);
+        REQUIRE(packed.Packed.Maps[0].Identity == packed.Maps[1]->Identity());
+        REQUIRE(packed.Packed.Maps[1].Identity == packed.Maps[2]->Identity());
+        REQUIRE(packed.Packed.Maps[3].Identity == packed.Maps[2]->Identity());
+
+        const auto& transforms = packed.Packed.Materials[0].MapTransforms;
+        REQUIRE(transforms[0] == std::array<float, 6>{4.0f / 12, 0.0f, 0.0f, 4.0f / 12, 4.0f / 12, 4.0f / 12});
+        REQUIRE(transforms[1] == std::array<float, 6>{0.0f, 0.0f, 0.0f, 0.0f, 4.5f / 24, 4.5f / 12});
+        REQUIRE(transforms[2] == material.MapTransforms[2]);
+
+        auto albedoAtlas = packed.Maps[1]->Compute(nullptr);
+        REQUIRE(albedoAtlas->Format == VK_FORMAT_BC7_SRGB_BLOCK);
+        REQUIRE(albedoAtlas->Extent == std::array<uint32_t, 3>{12, 12, 1});
+        REQUIRE(albedoAtlas->Mips.size() == 3);
+
+        auto placeholderAtlas = packed.Maps[2]->Compute(nullptr);
+        REQUIRE(placeholderAtlas->Extent == std::array<uint32_t, 3>{24, 12, 1});
+        REQUIRE(placeholderAtlas->Mips.size() == 1);
+        const auto& texels = placeholderAtlas->Mips[0];
+        REQUIRE(texels[(4 * 24 + 4) * 4] == 255);
+        REQUIRE(texels[(0 * 24 + 12) * 4] == 0);
+        REQUIRE(texels[(0 * 24 + 12) * 4 + 3] == 255);
+    }
+}
@@ -0,0 +1,82 @@
+#include <catch2/catch_test_macros.hpp>
+#include <kajiya_asset/lazy.h>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace kajiya_asset;
+
+TEST_CASE("LazyCache", "[asset][lazy]") {
+    auto cache = LazyCache::Create();
+    std::atomic<int> runs{0};
+
+    auto make_lazy = [&](uint64_t identity, int value) {
+        return Lazy<int>(identity, [&runs, value](const std::shared_ptr<LazyCache>&) {
+            runs++;
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            return std::make_shared<int>(value);
+        });
+    };
+
+    SECTION("Concurrent requests share one computation") {
+        std::vector<std::shared_ptr<int>> results(8);
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < results.size(); ++i) {
+            threads.emplace_back([&, i]() { results[i] = make_lazy(1, 42).Eval(cache); });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        REQUIRE(runs == 1);
+        for (const auto& result : results) {
+            REQUIRE(result == results[0]);
+            REQUIRE(*result == 42);
+        }
+
+        auto stats = cache->GetStats();
+        REQUIRE(stats.Misses == 1);
+        REQUIRE(stats.Hits + stats.InFlightJoins == 7);
+        REQUIRE(stats.ComputeSeconds > 0.0);
+    }
+
+    SECTION("Results are held weakly") {
+        auto first = make_lazy(2, 1).Eval(cache);
+        auto again = make_lazy(2, 1).Eval(cache);
+        REQUIRE(first == again);
+        REQUIRE(runs == 1);
+
+        std::weak_ptr<int> weak = first;
+        first.reset();
+        again.reset();
+        REQUIRE(weak.expired());
+
+        make_lazy(2, 1).Eval(cache);
+        REQUIRE(runs == 2);
+    }
+
+    SECTION("Identities and types are keyed separately") {
+        auto a = make_lazy(3, 1).Eval(cache);
+        auto b = make_lazy(4, 2).Eval(cache);
+        auto c = Lazy<float>(3, [](const std::shared_ptr<LazyCache>&) { return std::make_shared<float>(3.0f); }).Eval(cache);
+        REQUIRE(*a == 1);
+        REQUIRE(*b == 2);
+        REQUIRE(*c == 3.0f);
+    }
+
+    SECTION("Failures propagate and are not cached") {
+        bool fail = true;
+        auto flaky = Lazy<int>(5, [&fail](const std::shared_ptr<LazyCache>&) {
+            if (fail) {
+                throw std::runtime_error("boom");
+            }
+            return std::make_shared<int>(5);
+        });
+
+        REQUIRE_THROWS(flaky.Eval(cache));
+        fail = false;
+        REQUIRE(*flaky.Eval(cache) == 5);
+    }
+}
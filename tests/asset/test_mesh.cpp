@@ -1,6 +1,15 @@
 #include <catch2/catch_test_macros.hpp>
 #include <tekki/asset/mesh.h>
+#include <tekki/asset/mesh_optimize.h>
+#include <tekki/asset/mesh_quantize.h>
+#include <tekki/asset/mesh_simplify.h>
 #include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
 
 using namespace tekki::asset;
 
@@ -22,3 +31,906 @@ TEST_CASE("Mesh structure", "[asset][mesh]") {
         REQUIRE(dot == 0.0f); // Orthogonal vectors
     }
 }
+
+TEST_CASE("glTF scene loading", "[asset][mesh]") {
+    // One triangle (float3 positions, float3 normals, u16 indices) instanced by two nodes,
+    // the second of which is mirrored and therefore needs its winding flipped.
+    const char* gltf = R"({
+        "asset": {"version": "2.0"},
+        "scene": 0,
+        "scenes": [{"nodes": [0, 1]}],
+        "nodes": [
+            {"mesh": 0},
+            {"mesh": 0, "translation": [0, 0, 5], "scale": [-1, 1, 1]}
+        ],
+        "meshes": [{"primitives": [{"attributes": {"POSITION": 0, "NORMAL": 1}, "indices": 2}]}],
+        "buffers": [{"byteLength": 80, "uri": "data:application/octet-stream;base64,AAAAAAAAAAAAAAAAAACAPwAAAAAAAAAAAAAAAAAAgD8AAAAAAAAAAAAAAAAAAIA/AAAAAAAAAAAAAIA/AAAAAAAAAAAAAIA/AAABAAIAAAA="}],
+        "bufferViews": [
+            {"buffer": 0, "byteOffset": 0, "byteLength": 36},
+            {"buffer": 0, "byteOffset": 36, "byteLength": 36},
+            {"buffer": 0, "byteOffset": 72, "byteLength": 6}
+        ],
+        "accessors": [
+            {"bufferView": 0, "componentType": 5126, "count": 3, "type": "VEC3", "min": [0, 0, 0], "max": [1, 1, 0]},
+            {"bufferView": 1, "componentType": 5126, "count": 3, "type": "VEC3"},
+            {"bufferView": 2, "componentType": 5123, "count": 3, "type": "SCALAR"}
+        ]
+    })";
+
+    auto path = std::filesystem::temp_directory_path() / "tekki_test_triangle.gltf";
+    {
+        std::ofstream file(path);
+        file << gltf;
+    }
+
+    TriangleMesh mesh = LoadGltfScene(path.string(), 2.0f, glm::quat(1.0f, 0.0f, 0.0f, 0.0f)).Run();
+    std::filesystem::remove(path);
+
+    REQUIRE(mesh.Positions.size() == 6);
+    REQUIRE(mesh.Normals.size() == 6);
+    REQUIRE(mesh.Tangents.size() == 6);
+    REQUIRE(mesh.Uvs.size() == 6);
+    REQUIRE(mesh.Colors.size() == 6);
+    REQUIRE(mesh.MaterialIds.size() == 6);
+
+    SECTION("Node transforms are applied") {
+        REQUIRE(mesh.Positions[1] == std::array<float, 3>{2.0f, 0.0f, 0.0f});
+        REQUIRE(mesh.Positions[4] == std::array<float, 3>{-2.0f, 0.0f, 10.0f});
+    }
+
+    SECTION("Indices are rebased and mirrored instances are flipped") {
+        REQUIRE(mesh.Indices == std::vector<uint32_t>{0, 1, 2, 5, 4, 3});
+    }
+
+    SECTION("Primitives without a material use the default one") {
+        REQUIRE(mesh.Materials.size() == 1);
+        REQUIRE(mesh.Maps.size() == 4);
+        for (uint32_t id : mesh.MaterialIds) {
+            REQUIRE(id == 0);
+        }
+    }
+}
+
+TEST_CASE("glTF accessors without buffer views", "[asset][mesh]") {
+    // Same triangle, but its index accessor has no buffer view and so reads as zeros.
+    const char* gltf = R"({
+        "asset": {"version": "2.0"},
+        "scene": 0,
+        "scenes": [{"nodes": [0]}],
+        "nodes": [{"mesh": 0}],
+        "meshes": [{"primitives": [{"attributes": {"POSITION": 0, "NORMAL": 1}, "indices": 2}]}],
+        "buffers": [{"byteLength": 80, "uri": "data:application/octet-stream;base64,AAAAAAAAAAAAAAAAAACAPwAAAAAAAAAAAAAAAAAAgD8AAAAAAAAAAAAAAAAAAIA/AAAAAAAAAAAAAIA/AAAAAAAAAAAAAIA/AAABAAIAAAA="}],
+        "bufferViews": [
+            {"buffer": 0, "byteOffset": 0, "byteLength": 36},
+            {"buffer": 0, "byteOffset": 36, "byteLength": 36}
+        ],
+        "accessors": [
+            {"bufferView": 0, "componentType": 5126, "count": 3, "type": "VEC3", "min": [0, 0, 0], "max": [1, 1, 0]},
+            {"bufferView": 1, "componentType": 5126, "count": 3, "type": "VEC3"},
+            {"componentType": 5123, "count": 3, "type": "SCALAR"}
+        ]
+    })";
+
+    auto path = std::filesystem::temp_directory_path() / "tekki_test_zero_indices.gltf";
+    {
+        std::ofstream file(path);
+        file << gltf;
+    }
+
+    TriangleMesh mesh = LoadGltfScene(path.string(), 1.0f, glm::quat(1.0f, 0.0f, 0.0f, 0.0f)).Run();
+    std::filesystem::remove(path);
+
+    REQUIRE(mesh.Positions.size() == 3);
+    REQUIRE(mesh.Indices == std::vector<uint32_t>{0, 0, 0});
+}
+
+TEST_CASE("glTF attributes shorter than POSITION are rejected", "[asset][mesh]") {
+    // The NORMAL accessor covers only two of the three vertices.
+    const char* gltf = R"({
+        "asset": {"version": "2.0"},
+        "scene": 0,
+        "scenes": [{"nodes": [0]}],
+        "nodes": [{"mesh": 0}],
+        "meshes": [{"primitives": [{"attributes": {"POSITION": 0, "NORMAL": 1}, "indices": 2}]}],
+        "buffers": [{"byteLength": 80, "uri": "data:application/octet-stream;base64,AAAAAAAAAAAAAAAAAACAPwAAAAAAAAAAAAAAAAAAgD8AAAAAAAAAAAAAAAAAAIA/AAAAAAAAAAAAAIA/AAAAAAAAAAAAAIA/AAABAAIAAAA="}],
+        "bufferViews": [
+            {"buffer": 0, "byteOffset": 0, "byteLength": 36},
+            {"buffer": 0, "byteOffset": 56, "byteLength": 24},
+            {"buffer": 0, "byteOffset": 72, "byteLength": 6}
+        ],
+        "accessors": [
+            {"bufferView": 0, "componentType": 5126, "count": 3, "type": "VEC3", "min": [0, 0, 0], "max": [1, 1, 0]},
+            {"bufferView": 1, "componentType": 5126, "count": 2, "type": "VEC3"},
+            {"bufferView": 2, "componentType": 5123, "count": 3, "type": "SCALAR"}
+        ]
+    })";
+
+    auto path = std::filesystem::temp_directory_path() / "tekki_test_short_normals.gltf";
+    {
+        std::ofstream file(path);
+        file << gltf;
+    }
+
+    REQUIRE_THROWS_AS(LoadGltfScene(path.string(), 1.0f, glm::quat(1.0f, 0.0f, 0.0f, 0.0f)).Run(), std::runtime_error);
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Tangent generation", "[asset][mesh][tangents]") {
+    // 4x4 quad grid in the XY plane facing +Z, with UVs equal to XY.
+    std::vector<std::array<float, 3>> positions;
+    std::vector<std::array<float, 3>> normals;
+    std::vector<std::array<float, 2>> uvs;
+    std::vector<uint32_t> indices;
+
+    const uint32_t n = 5;
+    for (uint32_t y = 0; y < n; ++y) {
+        for (uint32_t x = 0; x < n; ++x) {
+            positions.push_back({float(x), float(y), 0.0f});
+            normals.push_back({0.0f, 0.0f, 1.0f});
+            uvs.push_back({float(x), float(y)});
+        }
+    }
+    for (uint32_t y = 0; y + 1 < n; ++y) {
+        for (uint32_t x = 0; x + 1 < n; ++x) {
+            uint32_t i = y * n + x;
+            indices.insert(indices.end(), {i, i + 1, i + n, i + 1, i + n + 1, i + n});
+        }
+    }
+
+    SECTION("Tangents follow +U with positive handedness") {
+        std::vector<std::array<float, 4>> tangents(positions.size());
+        TangentCalcContext{indices, positions, normals, uvs, tangents}.GenerateTangents();
+
+        for (const auto& t : tangents) {
+            REQUIRE(std::abs(t[0] - 1.0f) < 1e-5f);
+            REQUIRE(std::abs(t[1]) < 1e-5f);
+            REQUIRE(std::abs(t[2]) < 1e-5f);
+            REQUIRE(t[3] == 1.0f);
+        }
+    }
+
+    SECTION("Mirrored UVs flip handedness") {
+        for (auto& uv : uvs) {
+            uv[1] = -uv[1];
+        }
+
+        std::vector<std::array<float, 4>> tangents(positions.size());
+        TangentCalcContext{indices, positions, normals, uvs, tangents}.GenerateTangents();
+
+        for (const auto& t : tangents) {
+            REQUIRE(std::abs(t[0] - 1.0f) < 1e-5f);
+            REQUIRE(t[3] == -1.0f);
+        }
+    }
+}
+
+TEST_CASE("Instanced glTF scene loading", "[asset][mesh]") {
+    // The triangle of the test above as three meshes: mesh 1 repeats mesh 0 exactly, mesh 2 uses
+    // the same geometry with a material of its own.
+    const char* gltf = R"({
+        "asset": {"version": "2.0"},
+        "scene": 0,
+        "scenes": [{"nodes": [0, 1, 2, 3]}],
+        "nodes": [
+            {"mesh": 0},
+            {"mesh": 0, "translation": [0, 0, 5], "scale": [-1, 1, 1]},
+            {"mesh": 1, "translation": [3, 0, 0]},
+            {"mesh": 2}
+        ],
+        "materials": [{"pbrMetallicRoughness": {"baseColorFactor": [1, 0, 0, 1]}}],
+        "meshes": [
+            {"primitives": [{"attributes": {"POSITION": 0, "NORMAL": 1}, "indices": 2}]},
+            {"primitives": [{"attributes": {"POSITION": 0, "NORMAL": 1}, "indices": 2}]},
+            {"primitives": [{"attributes": {"POSITION": 0, "NORMAL": 1}, "indices": 2, "material": 0}]}
+        ],
+        "buffers": [{"byteLength": 80, "uri": "data:application/octet-stream;base64,AAAAAAAAAAAAAAAAAACAPwAAAAAAAAAAAAAAAAAAgD8AAAAAAAAAAAAAAAAAAIA/AAAAAAAAAAAAAIA/AAAAAAAAAAAAAIA/AAABAAIAAAA="}],
+        "bufferViews": [
+            {"buffer": 0, "byteOffset": 0, "byteLength": 36},
+            {"buffer": 0, "byteOffset": 36, "byteLength": 36},
+            {"buffer": 0, "byteOffset": 72, "byteLength": 6}
+        ],
+        "accessors": [
+            {"bufferView": 0, "componentType": 5126, "count": 3, "type": "VEC3", "min": [0, 0, 0], "max": [1, 1, 0]},
+            {"bufferView": 1, "componentType": 5126, "count": 3, "type": "VEC3"},
+            {"bufferView": 2, "componentType": 5123, "count": 3, "type": "SCALAR"}
+        ]
+    })";
+
+    auto path = std::filesystem::temp_directory_path() / "tekki_test_instanced.gltf";
+    {
+        std::ofstream file(path);
+        file << gltf;
+    }
+
+    InstancedTriangleScene scene = LoadGltfScene(path.string(), 2.0f, glm::quat(1.0f, 0.0f, 0.0f, 0.0f)).RunInstanced();
+    std::filesystem::remove(path);
+
+    REQUIRE(scene.Meshes.size() == 2);
+    REQUIRE(scene.DuplicateMeshes == 1);
+    REQUIRE(scene.Instances.size() == 4);
+    REQUIRE(scene.Instances[0].Mesh == 0);
+    REQUIRE(scene.Instances[1].Mesh == 0);
+    REQUIRE(scene.Instances[2].Mesh == 0);
+    REQUIRE(scene.Instances[3].Mesh == 1);
+
+    SECTION("Meshes stay in their own space and keep their winding") {
+        const auto& mesh = scene.Meshes[0];
+        REQUIRE(mesh.Positions.size() == 3);
+        REQUIRE(mesh.Positions[1] == std::array<float, 3>{1.0f, 0.0f, 0.0f});
+        REQUIRE(mesh.Indices == std::vector<uint32_t>{0, 1, 2});
+    }
+
+    SECTION("Instance transforms include the load scale") {
+        const auto& mirrored = scene.Instances[1].Transform;
+        REQUIRE(mirrored[0] == -2.0f);
+        REQUIRE(mirrored[5] == 2.0f);
+        REQUIRE(mirrored[10] == 2.0f);
+        REQUIRE(mirrored[11] == 10.0f);
+        REQUIRE(scene.Instances[2].Transform[3] == 6.0f);
+    }
+
+    SECTION("Each mesh carries only the materials it uses") {
+        for (const auto& mesh : scene.Meshes) {
+            REQUIRE(mesh.Materials.size() == 1);
+            REQUIRE(mesh.Maps.size() == 4);
+            REQUIRE(mesh.Materials[0].Maps == std::array<uint32_t, 4>{0, 1, 2, 3});
+            for (uint32_t id : mesh.MaterialIds) {
+                REQUIRE(id == 0);
+            }
+        }
+        REQUIRE(scene.Meshes[0].Materials[0].BaseColorMult[1] == 1.0f);
+        REQUIRE(scene.Meshes[1].Materials[0].BaseColorMult[1] == 0.0f);
+    }
+}
+
+TEST_CASE("Vertex cache and fetch optimization", "[asset][mesh][optimize]") {
+    // 64x64 quad grid with triangles shuffled into a cache-hostile order.
+    const uint32_t n = 65;
+    std::vector<uint32_t> indices;
+    for (uint32_t y = 0; y + 1 < n; ++y) {
+        for (uint32_t x = 0; x + 1 < n; ++x) {
+            uint32_t i = y * n + x;
+            indices.insert(indices.end(), {i, i + 1, i + n, i + 1, i + n + 1, i + n});
+        }
+    }
+    size_t triangle_count = indices.size() / 3;
+    std::vector<uint32_t> shuffled;
+    for (size_t t = 0; t < triangle_count; ++t) {
+        size_t src = (t * 7919) % triangle_count;
+        shuffled.insert(shuffled.end(), indices.begin() + src * 3, indices.begin() + src * 3 + 3);
+    }
+
+    auto before = AnalyzeVertexCache(shuffled, n * n);
+    auto optimized = OptimizeVertexCache(shuffled, n * n);
+    auto after = AnalyzeVertexCache(optimized, n * n);
+
+    REQUIRE(optimized.size() == shuffled.size());
+    REQUIRE(before.ReferencedVertices == n * n);
+    REQUIRE(after.Acmr() < before.Acmr());
+    REQUIRE(after.Acmr() < 1.0f);
+    REQUIRE(after.Atvr() >= 1.0f);
+
+    SECTION("Fetch remap keeps triangles intact") {
+        std::vector<uint32_t> ids(n * n);
+        for (uint32_t v = 0; v < n * n; ++v) {
+            ids[v] = v;
+        }
+
+        auto remapped = optimized;
+        auto remap = OptimizeVertexFetch(remapped, n * n);
+        RemapVertexStream(ids, remap);
+
+        REQUIRE(remapped[0] == 0);
+        for (size_t i = 0; i < remapped.size(); ++i) {
+            REQUIRE(ids[remapped[i]] == optimized[i]);
+        }
+    }
+}
+
+namespace {
+
+// n x n quads over unit cells, every triangle with its own three vertices, as exporters
+// often leave them.
+PackedTriangleMesh UnweldedGrid(uint32_t n) {
+    PackedTriangleMesh mesh;
+    auto corner = [&](uint32_t x, uint32_t y) {
+        mesh.Verts.push_back(PackedVertex{{float(x), float(y), 0.0f}, PackUnitDirection11_10_11(0.0f, 0.0f, 1.0f)});
+        mesh.Uvs.push_back({float(x) / float(n), float(y) / float(n)});
+        mesh.MaterialIds.push_back(0);
+        mesh.Indices.push_back(static_cast<uint32_t>(mesh.Indices.size()));
+    };
+    for (uint32_t y = 0; y < n; ++y) {
+        for (uint32_t x = 0; x < n; ++x) {
+            corner(x, y), corner(x + 1, y), corner(x, y + 1);
+            corner(x + 1, y), corner(x + 1, y + 1), corner(x, y + 1);
+        }
+    }
+    return mesh;
+}
+
+} // namespace
+
+TEST_CASE("Vertex welding", "[asset][mesh][optimize]") {
+    SECTION("Bitwise-equal vertices merge and triangles keep their corners") {
+        auto source = UnweldedGrid(4);
+        auto mesh = source;
+        auto stats = WeldVertices(mesh);
+
+        REQUIRE(stats.Vertices == 96);
+        REQUIRE(stats.UniqueVertices == 25);
+        REQUIRE(stats.DroppedTriangles == 0);
+        REQUIRE(mesh.Verts.size() == 25);
+        REQUIRE(mesh.Uvs.size() == 25);
+        REQUIRE(mesh.MaterialIds.size() == 25);
+        REQUIRE(mesh.Indices.size() == source.Indices.size());
+        for (size_t i = 0; i < mesh.Indices.size(); ++i) {
+            REQUIRE(mesh.Verts[mesh.Indices[i]].Pos == source.Verts[source.Indices[i]].Pos);
+            REQUIRE(mesh.Uvs[mesh.Indices[i]] == source.Uvs[source.Indices[i]]);
+        }
+    }
+
+    SECTION("Epsilon welds near vertices that bitwise welding keeps") {
+        auto mesh = UnweldedGrid(4);
+        for (size_t v = 0; v < mesh.Verts.size(); ++v) {
+            mesh.Verts[v].Pos[2] = (v % 3) * 1e-5f;
+        }
+
+        auto bitwise = mesh;
+        REQUIRE(WeldVertices(bitwise).UniqueVertices > 25);
+        REQUIRE(WeldVertices(mesh, 1e-4f).UniqueVertices == 25);
+    }
+
+    SECTION("Different attributes keep vertices apart") {
+        auto mesh = UnweldedGrid(1);
+        mesh.Uvs[3] = {0.5f, 0.5f};     // Second copy of corner (1, 0)
+        mesh.MaterialIds[5] = 1;        // Second copy of corner (0, 1)
+        auto stats = WeldVertices(mesh, 1e-3f);
+        REQUIRE(stats.UniqueVertices == 6);
+    }
+
+    SECTION("Triangles that collapse are dropped") {
+        auto mesh = UnweldedGrid(1);
+        mesh.Verts[1].Pos = {1e-4f, 0.0f, 0.0f}; // Nearly onto corner 0 of the first triangle
+        mesh.Uvs[1] = mesh.Uvs[0];
+        auto stats = WeldVertices(mesh, 1e-3f);
+        REQUIRE(stats.DroppedTriangles == 1);
+        REQUIRE(mesh.Indices.size() == 3);
+    }
+
+    SECTION("The packer welds on request") {
+        TriangleMesh source;
+        auto grid = UnweldedGrid(2);
+        for (const auto& vert : grid.Verts) {
+            source.Positions.push_back(vert.Pos);
+            source.Normals.push_back({0.0f, 0.0f, 1.0f});
+        }
+        source.Uvs = grid.Uvs;
+        source.Tangents.assign(grid.Verts.size(), {1.0f, 0.0f, 0.0f, 1.0f});
+        source.Colors.assign(grid.Verts.size(), {1.0f, 1.0f, 1.0f, 1.0f});
+        source.MaterialIds = grid.MaterialIds;
+        source.Indices = grid.Indices;
+
+        REQUIRE(PackTriangleMesh(source).Verts.size() == 24);
+
+        PackTriangleMeshOptions options;
+        options.WeldVertices = true;
+        options.BuildMeshlets = true;
+        auto packed = PackTriangleMesh(source, options);
+        REQUIRE(packed.Verts.size() == 9);
+        REQUIRE(packed.Tangents.size() == 9);
+        REQUIRE(packed.Meshlets.size() == 1);
+        REQUIRE(packed.Meshlets[0].VertexCount == 9);
+    }
+}
+
+TEST_CASE("Meshlet generation", "[asset][mesh][meshlets]") {
+    // Flat 40x40 quad grid in the XY plane, facing +Z.
+    const uint32_t n = 41;
+    PackedTriangleMesh mesh;
+    for (uint32_t y = 0; y < n; ++y) {
+        for (uint32_t x = 0; x < n; ++x) {
+            mesh.Verts.push_back(PackedVertex{{float(x), float(y), 0.0f}, PackUnitDirection11_10_11(0.0f, 0.0f, 1.0f)});
+        }
+    }
+    for (uint32_t y = 0; y + 1 < n; ++y) {
+        for (uint32_t x = 0; x + 1 < n; ++x) {
+            uint32_t i = y * n + x;
+            mesh.Indices.insert(mesh.Indices.end(), {i, i + 1, i + n, i + 1, i + n + 1, i + n});
+        }
+    }
+
+    BuildMeshlets(mesh);
+    REQUIRE(!mesh.Meshlets.empty());
+
+    // Every source triangle appears exactly once, in order, within the meshlet limits.
+    std::vector<uint32_t> rebuilt;
+    for (const auto& m : mesh.Meshlets) {
+        REQUIRE(m.VertexCount <= MAX_MESHLET_VERTICES);
+        REQUIRE(m.TriangleCount <= MAX_MESHLET_TRIANGLES);
+        REQUIRE(m.TriangleOffset % 4 == 0);
+
+        for (uint32_t t = 0; t < m.TriangleCount * 3; ++t) {
+            uint8_t local = mesh.MeshletTriangles[m.TriangleOffset + t];
+            REQUIRE(local < m.VertexCount);
+            rebuilt.push_back(mesh.MeshletVertices[m.VertexOffset + local]);
+        }
+
+        for (uint32_t v = 0; v < m.VertexCount; ++v) {
+            const auto& p = mesh.Verts[mesh.MeshletVertices[m.VertexOffset + v]].Pos;
+            float dx = p[0] - m.Center[0], dy = p[1] - m.Center[1], dz = p[2] - m.Center[2];
+            REQUIRE(std::sqrt(dx * dx + dy * dy + dz * dz) <= m.Radius + 1e-4f);
+        }
+
+        // A flat patch gets a tight cone along +Z.
+        REQUIRE(std::abs(m.ConeAxis[2] - 1.0f) < 1e-5f);
+        REQUIRE(m.ConeCutoff < 1e-3f);
+    }
+    REQUIRE(rebuilt == mesh.Indices);
+
+    SECTION("Output is deterministic") {
+        auto again = mesh;
+        BuildMeshlets(again);
+        REQUIRE(again.MeshletVertices == mesh.MeshletVertices);
+        REQUIRE(again.MeshletTriangles == mesh.MeshletTriangles);
+        REQUIRE(again.Meshlets.size() == mesh.Meshlets.size());
+        REQUIRE(std::memcmp(again.Meshlets.data(), mesh.Meshlets.data(), mesh.Meshlets.size() * sizeof(Meshlet)) == 0);
+    }
+}
+
+namespace {
+
+// Area of every triangle, summed; flat patches keep it through simplification.
+float TotalArea(const std::vector<uint32_t>& indices, const std::vector<std::array<float, 3>>& positions) {
+    float area = 0.0f;
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        glm::vec3 a(positions[indices[i]][0], positions[indices[i]][1], positions[indices[i]][2]);
+        glm::vec3 b(positions[indices[i + 1]][0], positions[indices[i + 1]][1], positions[indices[i + 1]][2]);
+        glm::vec3 c(positions[indices[i + 2]][0], positions[indices[i + 2]][1], positions[indices[i + 2]][2]);
+        area += glm::length(glm::cross(b - a, c - a)) * 0.5f;
+    }
+    return area;
+}
+
+// n x n vertex grid over [x0, x0 + n - 1] x [0, n - 1], appended to `positions` and `indices`.
+void AppendGrid(uint32_t n, float x0, std::vector<std::array<float, 3>>& positions, std::vector<uint32_t>& indices,
+                float (*height)(float, float) = nullptr) {
+    uint32_t base = static_cast<uint32_t>(positions.size());
+    for (uint32_t y = 0; y < n; ++y) {
+        for (uint32_t x = 0; x < n; ++x) {
+            float px = x0 + float(x);
+            positions.push_back({px, float(y), height ? height(px, float(y)) : 0.0f});
+        }
+    }
+    for (uint32_t y = 0; y + 1 < n; ++y) {
+        for (uint32_t x = 0; x + 1 < n; ++x) {
+            uint32_t i = base + y * n + x;
+            indices.insert(indices.end(), {i, i + 1, i + n, i + 1, i + n + 1, i + n});
+        }
+    }
+}
+
+} // namespace
+
+TEST_CASE("Mesh simplification", "[asset][mesh][simplify]") {
+    SECTION("Flat patches collapse to a few triangles with their outline intact") {
+        std::vector<std::array<float, 3>> positions;
+        std::vector<uint32_t> indices;
+        AppendGrid(33, 0.0f, positions, indices);
+
+        SimplifyOptions options;
+        options.TargetError = 1e-3f;
+        auto result = SimplifyMesh(indices, positions, options);
+        REQUIRE(result.Indices.size() <= 8 * 3);
+        REQUIRE(std::abs(TotalArea(result.Indices, positions) - 32.0f * 32.0f) < 1e-2f);
+        REQUIRE(result.Error < 1e-3f);
+    }
+
+    SECTION("Seams move on both sides together") {
+        // Two halves meeting at x = 16 with separate vertices there, like a UV seam.
+        std::vector<std::array<float, 3>> positions;
+        std::vector<uint32_t> left;
+        std::vector<uint32_t> right;
+        AppendGrid(17, 0.0f, positions, left);
+        AppendGrid(17, 16.0f, positions, right);
+        std::vector<uint32_t> indices = left;
+        indices.insert(indices.end(), right.begin(), right.end());
+
+        SimplifyOptions options;
+        options.TargetError = 1e-3f;
+        auto result = SimplifyMesh(indices, positions, options);
+        REQUIRE(result.Indices.size() < indices.size() / 4);
+        REQUIRE(std::abs(TotalArea(result.Indices, positions) - 32.0f * 16.0f) < 1e-2f);
+
+        // Triangles never mix the halves, and both sides keep the same seam vertices.
+        std::vector<float> seam_left;
+        std::vector<float> seam_right;
+        for (size_t i = 0; i < result.Indices.size(); ++i) {
+            uint32_t v = result.Indices[i];
+            bool is_left = v < 17 * 17;
+            REQUIRE(is_left == (result.Indices[i - i % 3] < 17 * 17));
+            if (positions[v][0] == 16.0f) {
+                (is_left ? seam_left : seam_right).push_back(positions[v][1]);
+            }
+        }
+        for (auto* seam : {&seam_left, &seam_right}) {
+            std::sort(seam->begin(), seam->end());
+            seam->erase(std::unique(seam->begin(), seam->end()), seam->end());
+        }
+        REQUIRE(seam_left == seam_right);
+    }
+
+    SECTION("Locked vertices and the error bound hold") {
+        std::vector<std::array<float, 3>> positions;
+        std::vector<uint32_t> indices;
+        AppendGrid(33, 0.0f, positions, indices, [](float x, float y) { return std::sin(x * 0.4f) * std::cos(y * 0.3f); });
+
+        std::vector<uint8_t> locked(positions.size(), 0);
+        locked[16 * 33 + 16] = 1;
+
+        SimplifyOptions options;
+        options.TargetError = 0.01f;
+        auto result = SimplifyMesh(indices, positions, options, locked);
+        REQUIRE(result.Indices.size() < indices.size());
+        REQUIRE(result.Error <= 0.01f);
+        REQUIRE(std::find(result.Indices.begin(), result.Indices.end(), 16u * 33 + 16) != result.Indices.end());
+
+        options.TargetError = 1e-6f;
+        REQUIRE(SimplifyMesh(indices, positions, options).Indices.size() == indices.size());
+    }
+
+    SECTION("LOD chains") {
+        std::vector<std::array<float, 3>> positions;
+        PackedTriangleMesh mesh;
+        AppendGrid(65, 0.0f, positions, mesh.Indices, [](float x, float y) { return std::sin(x * 0.2f) * std::cos(y * 0.15f) * 4.0f; });
+        for (const auto& p : positions) {
+            mesh.Verts.push_back(PackedVertex{p, 0});
+            mesh.MaterialIds.push_back(p[0] < 32.0f ? 0 : 1);
+        }
+
+        LodChainOptions options;
+        options.Errors = {0.001f, 0.005f, 0.02f, 0.08f};
+        BuildLodChain(mesh, options);
+        REQUIRE(mesh.Lods.size() >= 2);
+
+        uint32_t previous_count = static_cast<uint32_t>(mesh.Indices.size());
+        float previous_error = 0.0f;
+        for (const auto& lod : mesh.Lods) {
+            REQUIRE(lod.IndexCount <= previous_count * 9 / 10);
+            REQUIRE(lod.IndexCount % 3 == 0);
+            REQUIRE(lod.Error >= previous_error);
+            REQUIRE(lod.Error <= 0.08f * 64.0f);
+            REQUIRE(lod.IndexOffset + lod.IndexCount <= mesh.LodIndices.size());
+            previous_count = lod.IndexCount;
+            previous_error = lod.Error;
+        }
+
+        // Vertices on the material boundary never move, so the halves still meet without cracks.
+        std::vector<uint8_t> used_by(positions.size(), 0);
+        for (size_t i = 0; i < mesh.Indices.size(); i += 3) {
+            for (size_t c = 0; c < 3; ++c) {
+                used_by[mesh.Indices[i + c]] |= uint8_t(1u << mesh.MaterialIds[mesh.Indices[i]]);
+            }
+        }
+        for (const auto& lod : mesh.Lods) {
+            std::vector<uint8_t> kept(positions.size(), 0);
+            for (uint32_t i = 0; i < lod.IndexCount; ++i) {
+                kept[mesh.LodIndices[lod.IndexOffset + i]] = 1;
+            }
+            for (size_t v = 0; v < positions.size(); ++v) {
+                if (used_by[v] == 3) {
+                    REQUIRE(kept[v]);
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("Material ranges", "[asset][mesh][materials]") {
+    // A wavy grid in bands of four columns cycling through three materials, so each material's
+    // triangles are interleaved with the others' in the source order.
+    TriangleMesh source;
+    AppendGrid(33, 0.0f, source.Positions, source.Indices,
+               [](float x, float y) { return std::sin(x * 0.3f) * std::cos(y * 0.2f) * 3.0f; });
+    auto material_at = [](const std::array<float, 3>& p) { return static_cast<uint32_t>(p[0]) / 4 % 3; };
+    for (const auto& p : source.Positions) {
+        source.Normals.push_back({0.0f, 0.0f, 1.0f});
+        source.MaterialIds.push_back(material_at(p));
+    }
+
+    SECTION("Sorting is stable and gives one range per material") {
+        PackedTriangleMesh mesh;
+        for (const auto& p : source.Positions) {
+            mesh.Verts.push_back(PackedVertex{p, 0});
+        }
+        mesh.Indices = source.Indices;
+        mesh.MaterialIds = source.MaterialIds;
+
+        std::vector<uint32_t> expected;
+        for (uint32_t m = 0; m < 3; ++m) {
+            for (size_t i = 0; i < source.Indices.size(); i += 3) {
+                if (source.MaterialIds[source.Indices[i]] == m) {
+                    expected.insert(expected.end(), source.Indices.begin() + i, source.Indices.begin() + i + 3);
+                }
+            }
+        }
+
+        SortTrianglesByMaterial(mesh);
+        REQUIRE(mesh.Indices == expected);
+        REQUIRE(mesh.MaterialRanges.size() == 3);
+        uint32_t next = 0;
+        for (uint32_t r = 0; r < 3; ++r) {
+            REQUIRE(mesh.MaterialRanges[r].MaterialId == r);
+            REQUIRE(mesh.MaterialRanges[r].FirstIndex == next);
+            next += mesh.MaterialRanges[r].IndexCount;
+        }
+        REQUIRE(next == mesh.Indices.size());
+
+        mesh.Lods = {MeshLod{0, 3, 0.0f, 3}};
+        REQUIRE_THROWS(SortTrianglesByMaterial(mesh));
+    }
+
+    SECTION("Packing keeps every level and meshlet within its ranges") {
+        PackTriangleMeshOptions options;
+        options.OptimizeVertexOrder = true;
+        options.BuildMeshlets = true;
+        options.LodErrors = {0.005f, 0.02f, 0.08f};
+        auto mesh = PackTriangleMesh(source, options);
+
+        REQUIRE(mesh.MaterialIds.empty());
+        REQUIRE(mesh.Indices.size() == source.Indices.size());
+        REQUIRE(!mesh.Lods.empty());
+
+        // Levels own consecutive slices of the ranges, each sorted by material and covering the
+        // level's indices without gaps.
+        for (size_t level = 0; level <= mesh.Lods.size(); ++level) {
+            size_t first_range = level == 0 ? 0 : mesh.Lods[level - 1].FirstRange;
+            size_t end_range = level < mesh.Lods.size() ? mesh.Lods[level].FirstRange : mesh.MaterialRanges.size();
+            uint32_t next = level == 0 ? 0 : mesh.Lods[level - 1].IndexOffset;
+            uint32_t count = level == 0 ? static_cast<uint32_t>(mesh.Indices.size()) : mesh.Lods[level - 1].IndexCount;
+            REQUIRE(first_range < end_range);
+            for (size_t r = first_range; r < end_range; ++r) {
+                const auto& range = mesh.MaterialRanges[r];
+                REQUIRE(range.FirstIndex == next);
+                REQUIRE(range.IndexCount % 3 == 0);
+                if (r > first_range) {
+                    REQUIRE(range.MaterialId > mesh.MaterialRanges[r - 1].MaterialId);
+                }
+                next += range.IndexCount;
+            }
+            REQUIRE(next - (level == 0 ? 0 : mesh.Lods[level - 1].IndexOffset) == count);
+        }
+
+        for (size_t r = 0; r < mesh.Lods[0].FirstRange; ++r) {
+            const auto& range = mesh.MaterialRanges[r];
+            for (uint32_t i = range.FirstIndex; i < range.FirstIndex + range.IndexCount; i += 3) {
+                REQUIRE(material_at(mesh.Verts[mesh.Indices[i]].Pos) == range.MaterialId);
+            }
+        }
+
+        // Meshlets come in index order, so each one's triangles must start and end in one range.
+        uint32_t triangle = 0;
+        size_t range = 0;
+        for (const auto& m : mesh.Meshlets) {
+            while (mesh.MaterialRanges[range].FirstIndex + mesh.MaterialRanges[range].IndexCount <= triangle * 3) {
+                range++;
+            }
+            uint32_t end = mesh.MaterialRanges[range].FirstIndex + mesh.MaterialRanges[range].IndexCount;
+            REQUIRE((triangle + m.TriangleCount) * 3 <= end);
+            triangle += m.TriangleCount;
+        }
+        REQUIRE(triangle * 3 == mesh.Indices.size());
+    }
+
+    SECTION("Ranges within 65535 vertices compact to 16-bit indices") {
+        PackTriangleMeshOptions options;
+        options.LodErrors = {0.02f};
+        auto mesh = PackTriangleMesh(source, options);
+        REQUIRE(mesh.Lods.size() == 1);
+        const auto before = mesh;
+
+        auto stats = CompactIndices(mesh);
+        REQUIRE(stats.Ranges == mesh.MaterialRanges.size());
+        REQUIRE(stats.ShortRanges == stats.Ranges);
+        REQUIRE(stats.Bytes == (before.Indices.size() + before.LodIndices.size()) * sizeof(uint32_t));
+        REQUIRE(stats.CompactBytes * 2 == stats.Bytes);
+        REQUIRE(mesh.Indices.empty());
+        REQUIRE(mesh.LodIndices.empty());
+        REQUIRE(mesh.Lods[0].IndexCount == 0);
+
+        for (size_t r = 0; r < mesh.MaterialRanges.size(); ++r) {
+            const auto& range = mesh.MaterialRanges[r];
+            const auto& original = before.MaterialRanges[r];
+            const auto& source_indices = r < before.Lods[0].FirstRange ? before.Indices : before.LodIndices;
+            REQUIRE(range.IndexSize == sizeof(uint16_t));
+            REQUIRE(range.IndexCount == original.IndexCount);
+            for (uint32_t i = 0; i < range.IndexCount; ++i) {
+                REQUIRE(range.BaseVertex + mesh.ShortIndices[range.FirstIndex + i] == source_indices[original.FirstIndex + i]);
+            }
+        }
+    }
+
+    SECTION("Ranges spanning more vertices keep 32-bit indices") {
+        PackedTriangleMesh mesh;
+        mesh.Verts.resize(70000, PackedVertex{{0.0f, 0.0f, 0.0f}, 0});
+        mesh.MaterialIds.assign(mesh.Verts.size(), 0);
+        mesh.Indices = {0, 1, 69999, 69000, 69001, 69002};
+        mesh.MaterialIds[69000] = 1;
+        SortTrianglesByMaterial(mesh);
+
+        auto stats = CompactIndices(mesh);
+        REQUIRE(stats.ShortRanges == 1);
+        REQUIRE(stats.CompactBytes == 3 * sizeof(uint32_t) + 3 * sizeof(uint16_t));
+        REQUIRE(mesh.Indices == std::vector<uint32_t>{0, 1, 69999});
+        REQUIRE(mesh.MaterialRanges[0].IndexSize == sizeof(uint32_t));
+        REQUIRE(mesh.MaterialRanges[0].FirstIndex == 0);
+        REQUIRE(mesh.MaterialRanges[1].BaseVertex == 69000);
+        REQUIRE(mesh.ShortIndices == std::vector<uint16_t>{0, 1, 2});
+
+        std::vector<uint8_t> bytes;
+        mesh.FlattenInto(bytes);
+        const auto* flat = reinterpret_cast<const PackedTriMesh::Flat*>(bytes.data());
+        REQUIRE(flat->ShortIndices.GetLength() == 3);
+        REQUIRE(flat->MaterialRanges[1].IndexSize == sizeof(uint16_t));
+
+        // A second pass leaves compacted ranges alone.
+        REQUIRE(CompactIndices(mesh).CompactBytes == stats.CompactBytes);
+        REQUIRE(mesh.ShortIndices.size() == 3);
+    }
+}
+
+TEST_CASE("Vertex stream quantization", "[asset][mesh][quantize]") {
+    // Hemisphere-ish patch so normals and tangents cover many directions, including -Z.
+    const uint32_t n = 33;
+    PackedTriangleMesh mesh;
+    for (uint32_t y = 0; y < n; ++y) {
+        for (uint32_t x = 0; x < n; ++x) {
+            float theta = 3.14159265f * float(y) / float(n - 1);
+            float phi = 6.2831853f * float(x) / float(n - 1);
+            std::array<float, 3> dir = {std::sin(theta) * std::cos(phi), std::sin(theta) * std::sin(phi), std::cos(theta)};
+
+            mesh.Verts.push_back(PackedVertex{{dir[0] * 10.0f, dir[1] * 10.0f, dir[2] * 10.0f - 3.0f},
+                                              PackUnitDirection11_10_11(dir[0], dir[1], dir[2])});
+            mesh.Uvs.push_back({float(x) / float(n - 1), float(y) / float(n - 1)});
+            mesh.Tangents.push_back({-std::sin(phi), std::cos(phi), 0.0f, (x % 2) ? 1.0f : -1.0f});
+            mesh.Colors.push_back({float(x) / float(n - 1), 0.5f, 1.0f, 1.0f});
+        }
+    }
+    for (uint32_t y = 0; y + 1 < n; ++y) {
+        for (uint32_t x = 0; x + 1 < n; ++x) {
+            uint32_t i = y * n + x;
+            mesh.Indices.insert(mesh.Indices.end(), {i, i + 1, i + n, i + 1, i + n + 1, i + n});
+        }
+    }
+    mesh.Indices.push_back(0); // one large backwards jump for the varint path
+    mesh.Indices.push_back(n * n - 1);
+    mesh.Indices.push_back(7);
+
+    const auto original = mesh;
+    auto report = QuantizeVertexStreams(mesh);
+
+    REQUIRE(mesh.Verts.empty());
+    REQUIRE(mesh.Indices.empty());
+    REQUIRE(mesh.QuantizedVerts.size() == original.Verts.size());
+    REQUIRE(mesh.IndexStreamCount == original.Indices.size());
+    REQUIRE(report.QuantizedBytes * 2 < report.FullBytes);
+
+    // 20 units of extent over 16 bits, and 8-bit octahedral normals.
+    REQUIRE(report.MaxPositionError < 20.0f / 65535.0f);
+    REQUIRE(report.MaxNormalErrorDegrees < 1.0f);
+    REQUIRE(report.MaxTangentErrorDegrees < 0.05f);
+    REQUIRE(report.MaxUvError <= 1.0f / 2048.0f);
+    REQUIRE(report.MaxColorError <= 0.5f / 255.0f + 1e-6f);
+
+    DequantizeVertexStreams(mesh);
+    REQUIRE(mesh.QuantizedVerts.empty());
+    REQUIRE(mesh.Indices == original.Indices);
+    REQUIRE(mesh.Verts.size() == original.Verts.size());
+    for (size_t i = 0; i < mesh.Verts.size(); ++i) {
+        for (int c = 0; c < 3; ++c) {
+            REQUIRE(std::abs(mesh.Verts[i].Pos[c] - original.Verts[i].Pos[c]) <= report.MaxPositionError + 1e-6f);
+        }
+        REQUIRE(mesh.Tangents[i][3] == original.Tangents[i][3]);
+    }
+
+    SECTION("Malformed index streams are rejected") {
+        auto stream = EncodeIndexStream(original.Indices);
+        std::vector<uint32_t> decoded(original.Indices.size());
+        REQUIRE_THROWS(DecodeIndexStream(std::span(stream).first(stream.size() - 1), decoded));
+
+        stream.push_back(0);
+        REQUIRE_THROWS(DecodeIndexStream(stream, decoded));
+    }
+}
+
+TEST_CASE("Flattened asset layout", "[asset][mesh][flatten]") {
+    PackedTriangleMesh mesh;
+    for (uint32_t i = 0; i < 5; ++i) {
+        mesh.Verts.push_back(PackedVertex{{float(i), float(i * 2), 0.0f}, i});
+    }
+    mesh.Indices = {0, 1, 2, 2, 3, 4};
+    mesh.MaterialIds = {7, 7, 7, 7, 7};
+    SortTrianglesByMaterial(mesh);
+    mesh.IndexStreamCount = 42;
+    mesh.PositionScale = {1.0f, 2.0f, 3.0f};
+    mesh.Lods = {MeshLod{0, 3, 0.5f, 0}};
+    mesh.LodIndices = {0, 2, 4};
+    BuildMeshlets(mesh);
+
+    std::vector<uint8_t> bytes;
+    mesh.FlattenInto(bytes);
+
+    FlatWriter writer;
+    mesh.WriteFlat(writer);
+    REQUIRE(writer.Size() == bytes.size());
+
+    const auto* flat = reinterpret_cast<const PackedTriMesh::Flat*>(bytes.data());
+    REQUIRE(flat->Verts.GetLength() == 5);
+    REQUIRE(reinterpret_cast<uintptr_t>(flat->Verts.GetData()) % FlatWriter::SECTION_ALIGNMENT == 0);
+    REQUIRE(flat->Verts[3].Pos[1] == 6.0f);
+    REQUIRE(flat->Verts[4].Normal == 4);
+    REQUIRE(std::vector<uint32_t>(flat->Indices.begin(), flat->Indices.end()) == mesh.Indices);
+    REQUIRE(flat->MaterialRanges.GetLength() == 1);
+    REQUIRE(flat->MaterialRanges[0].MaterialId == 7);
+    REQUIRE(flat->MaterialRanges[0].IndexCount == 6);
+    REQUIRE(flat->Uvs.IsEmpty());
+    REQUIRE(flat->Meshlets.GetLength() == 1);
+    REQUIRE(flat->Meshlets[0].TriangleCount == 2);
+    REQUIRE(flat->MeshletTriangles.GetLength() == mesh.MeshletTriangles.size());
+    REQUIRE(flat->IndexStreamCount == 42);
+    REQUIRE(flat->PositionScale[2] == 3.0f);
+    REQUIRE(flat->Lods.GetLength() == 1);
+    REQUIRE(flat->Lods[0].Error == 0.5f);
+    REQUIRE(flat->LodIndices[2] == 4);
+
+    SECTION("Nested vectors") {
+        GpuImage::Proto image{37, {4, 2, 1}, {std::vector<uint8_t>(32, 1), std::vector<uint8_t>(8, 2), std::vector<uint8_t>(3, 3)}};
+        std::vector<uint8_t> image_bytes;
+        image.FlattenInto(image_bytes);
+
+        const auto* flat_image = reinterpret_cast<const GpuImage::Flat*>(image_bytes.data());
+        REQUIRE(flat_image->Format == 37);
+        REQUIRE(flat_image->Extent[1] == 2);
+        REQUIRE(flat_image->Mips.GetLength() == 3);
+        for (size_t mip = 0; mip < 3; ++mip) {
+            REQUIRE(flat_image->Mips[mip].GetLength() == image.Mips[mip].size());
+            REQUIRE(flat_image->Mips[mip][0] == mip + 1);
+        }
+    }
+
+    SECTION("Instanced scenes nest whole meshes") {
+        PackedScene::Proto scene;
+        scene.Meshes = {mesh, mesh};
+        scene.Meshes[1].Indices = {4, 3, 2};
+        scene.Instances.push_back(SceneInstance{1, 0, {1, 0, 0, 7, 0, 1, 0, 0, 0, 0, 1, 0}});
+
+        std::vector<uint8_t> scene_bytes;
+        scene.FlattenInto(scene_bytes);
+
+        const auto* flat_scene = reinterpret_cast<const PackedScene::Flat*>(scene_bytes.data());
+        REQUIRE(flat_scene->Meshes.GetLength() == 2);
+        for (const auto& flat_mesh : flat_scene->Meshes) {
+            REQUIRE(flat_mesh.Verts.GetLength() == 5);
+            REQUIRE(flat_mesh.Verts[3].Pos[1] == 6.0f);
+            REQUIRE(flat_mesh.PositionScale[2] == 3.0f);
+            REQUIRE(flat_mesh.LodIndices[2] == 4);
+        }
+        REQUIRE(flat_scene->Meshes[0].Indices.GetLength() == 6);
+        REQUIRE(flat_scene->Meshes[1].Indices.GetLength() == 3);
+        REQUIRE(flat_scene->Meshes[1].Indices[0] == 4);
+        REQUIRE(flat_scene->Instances.GetLength() == 1);
+        REQUIRE(flat_scene->Instances[0].Mesh == 1);
+        REQUIRE(flat_scene->Instances[0].Transform[3] == 7.0f);
+    }
+
+    SECTION("Span sink writes in place and rejects short buffers") {
+        std::vector<uint8_t> mapped(bytes.size());
+        SpanFlattenSink sink(mapped);
+        mesh.FlattenInto(sink);
+        REQUIRE(sink.Written() == bytes.size());
+        REQUIRE(mapped == bytes);
+
+        std::vector<uint8_t> short_buffer(bytes.size() - 1);
+        SpanFlattenSink short_sink(short_buffer);
+        REQUIRE_THROWS(mesh.FlattenInto(short_sink));
+    }
+}
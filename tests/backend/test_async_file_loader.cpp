@@ -0,0 +1,108 @@
+#include <catch2/catch_test_macros.hpp>
+#include <tekki/backend/async_file_loader.h>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace tekki::backend;
+namespace fs = std::filesystem;
+
+namespace {
+
+std::vector<uint8_t> WriteTestFile(const fs::path& path, size_t size, uint8_t seed) {
+    std::vector<uint8_t> bytes(size);
+    for (size_t i = 0; i < size; ++i) {
+        bytes[i] = static_cast<uint8_t>(i * 31 + seed);
+    }
+    std::ofstream out(path, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    return bytes;
+}
+
+} // namespace
+
+TEST_CASE("AsyncFileLoader", "[backend][file]") {
+    const fs::path dir = fs::temp_directory_path() / "tekki_async_loader";
+    fs::create_directories(dir);
+
+    // Spans several read chunks, so multi-part reads are exercised too.
+    const auto large = WriteTestFile(dir / "large.bin", 20 * 1024 * 1024 + 123, 1);
+    const auto small = WriteTestFile(dir / "small.bin", 4096, 2);
+    const auto empty = WriteTestFile(dir / "empty.bin", 0, 3);
+
+    for (bool use_io_uring : {true, false}) {
+        AsyncFileLoader loader(AsyncFileLoader::Options{4, 2, use_io_uring});
+        if (!use_io_uring) {
+            REQUIRE_FALSE(loader.UsesIoUring());
+        }
+
+        SECTION(use_io_uring ? "Reads (io_uring when available)" : "Reads (thread fallback)") {
+            std::vector<std::shared_ptr<FileRead>> reads;
+            for (int i = 0; i < 8; ++i) {
+                reads.push_back(loader.Read(dir / "small.bin", i % 2 ? FileReadPriority::Urgent : FileReadPriority::Normal));
+            }
+            auto large_read = loader.Read(dir / "large.bin");
+            auto empty_read = loader.Read(dir / "empty.bin");
+            auto missing = loader.Read(dir / "missing.bin");
+
+            for (auto& read : reads) {
+                auto bytes = read->Get();
+                REQUIRE(std::vector<uint8_t>(bytes.begin(), bytes.end()) == small);
+            }
+            REQUIRE(large_read->Take() == large);
+            REQUIRE(empty_read->Get().empty());
+            REQUIRE_THROWS(missing->Get());
+            REQUIRE(missing->GetState() == FileRead::State::Failed);
+
+            auto stats = loader.GetStats();
+            REQUIRE(stats.Reads == 10);
+            REQUIRE(stats.BytesRead == 8 * small.size() + large.size());
+        }
+
+        SECTION(use_io_uring ? "Prefetch (io_uring when available)" : "Prefetch (thread fallback)") {
+            loader.Prefetch(dir / "large.bin");
+            loader.Prefetch(dir / "large.bin");
+            loader.Prefetch(dir / "small.bin");
+
+            auto read = loader.Read(dir / "large.bin", FileReadPriority::Urgent);
+            REQUIRE(read->Take() == large);
+            REQUIRE(loader.GetStats().PrefetchHits == 1);
+
+            // A claimed prefetch is gone; the next read goes to disk again.
+            auto again = loader.Read(dir / "large.bin");
+            REQUIRE(again != read);
+            REQUIRE(again->Get().size() == large.size());
+
+            loader.DropPrefetches();
+            auto after_drop = loader.Read(dir / "small.bin");
+            auto bytes = after_drop->Get();
+            REQUIRE(std::vector<uint8_t>(bytes.begin(), bytes.end()) == small);
+            REQUIRE(loader.GetStats().PrefetchHits == 1);
+        }
+
+        SECTION(use_io_uring ? "Cancellation (io_uring when available)" : "Cancellation (thread fallback)") {
+            std::vector<std::shared_ptr<FileRead>> reads;
+            for (int i = 0; i < 16; ++i) {
+                reads.push_back(loader.Read(dir / "large.bin", FileReadPriority::Prefetch));
+            }
+            for (auto& read : reads) {
+                read->Cancel();
+                REQUIRE(read->IsFinished());
+                if (read->GetState() == FileRead::State::Cancelled) {
+                    REQUIRE_THROWS(read->Get());
+                } else {
+                    REQUIRE(read->Get().size() == large.size());
+                }
+            }
+
+            // Cancelling a finished read keeps its data.
+            auto done = loader.Read(dir / "small.bin");
+            done->Wait();
+            done->Cancel();
+            REQUIRE(done->Get().size() == small.size());
+        }
+    }
+
+    fs::remove_all(dir);
+}
@@ -0,0 +1,169 @@
+#include <catch2/catch_test_macros.hpp>
+#include <tekki/core/parallel.h>
+#include <tekki/core/thread_pool.h>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace tekki::core;
+
+TEST_CASE("ThreadPool runs submitted tasks", "[core][thread_pool]") {
+    ThreadPool pool(4);
+    REQUIRE(pool.ThreadCount() == 4);
+
+    std::vector<std::future<int>> results;
+    for (int i = 0; i < 100; ++i) {
+        results.push_back(pool.Submit([i]() { return i * i; }));
+    }
+    for (int i = 0; i < 100; ++i) {
+        REQUIRE(results[i].get() == i * i);
+    }
+
+    auto failing = pool.Submit([]() { throw std::runtime_error("task failed"); });
+    REQUIRE_THROWS_AS(failing.get(), std::runtime_error);
+}
+
+TEST_CASE("ThreadPool keeps reservations within the budget", "[core][thread_pool]") {
+    ThreadPool pool(4, 100);
+    std::atomic<uint64_t> running_bytes{0};
+    std::atomic<uint64_t> max_running_bytes{0};
+
+    std::vector<std::future<void>> tasks;
+    for (int i = 0; i < 20; ++i) {
+        uint64_t bytes = 30 + (i % 3) * 10;
+        tasks.push_back(pool.Submit([&, bytes]() {
+            uint64_t now = running_bytes.fetch_add(bytes) + bytes;
+            uint64_t prev = max_running_bytes.load();
+            while (now > prev && !max_running_bytes.compare_exchange_weak(prev, now)) {
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            running_bytes.fetch_sub(bytes);
+        }, bytes));
+    }
+
+    // Larger than the whole budget: still runs, on its own.
+    tasks.push_back(pool.Submit([]() {}, 500));
+
+    for (auto& task : tasks) {
+        task.get();
+    }
+    REQUIRE(max_running_bytes.load() <= 100);
+    REQUIRE(pool.PeakInflightBytes() >= 500);
+    REQUIRE(pool.InflightBytes() == 0);
+}
+
+TEST_CASE("ParallelFor inside a pool task uses the pool", "[core][thread_pool]") {
+    ThreadPool pool(3);
+    std::atomic<size_t> sum{0};
+    std::atomic<bool> on_pool{true};
+
+    std::vector<std::future<void>> tasks;
+    for (int t = 0; t < 8; ++t) {
+        tasks.push_back(pool.Submit([&]() {
+            if (ThreadPool::Current() != &pool) {
+                on_pool = false;
+            }
+            ParallelFor(1000, [&](size_t i) {
+                ParallelFor(4, [&](size_t) {});
+                sum += i;
+            });
+        }));
+    }
+    for (auto& task : tasks) {
+        task.get();
+    }
+    REQUIRE(on_pool);
+    REQUIRE(sum == 8 * (999 * 1000 / 2));
+    REQUIRE(ThreadPool::Current() == nullptr);
+
+    auto failing = pool.Submit([]() {
+        ParallelFor(100, [](size_t i) {
+            if (i == 42) {
+                throw std::runtime_error("item failed");
+            }
+        });
+    });
+    REQUIRE_THROWS_AS(failing.get(), std::runtime_error);
+}
+
+TEST_CASE("ParallelFor on a pool returns only after every item has finished", "[core][thread_pool]") {
+    ThreadPool pool(4);
+    std::atomic<size_t> errors{0};
+
+    std::vector<std::future<void>> tasks;
+    for (int t = 0; t < 64; ++t) {
+        tasks.push_back(pool.Submit([&]() {
+            for (int round = 0; round < 50; ++round) {
+                // Lives on this task's stack, like most loop state; items must be done with it
+                // before ParallelFor returns, even when one of them throws.
+                std::atomic<int> inflight{0};
+                std::atomic<int> done{0};
+                try {
+                    ParallelFor(3, [&](size_t i) {
+                        inflight.fetch_add(1);
+                        std::this_thread::yield();
+                        inflight.fetch_sub(1);
+                        done.fetch_add(1);
+                        if (round % 2 == 1 && i == 0) {
+                            throw std::runtime_error("item failed");
+                        }
+                    });
+                } catch (const std::runtime_error&) {
+                }
+                if (inflight.load() != 0 || (round % 2 == 0 && done.load() != 3)) {
+                    errors.fetch_add(1);
+                }
+            }
+        }));
+    }
+    for (auto& task : tasks) {
+        task.get();
+    }
+    REQUIRE(errors == 0);
+}
+
+TEST_CASE("ParallelForOnPool limits items in flight but not their fan-out", "[core][thread_pool]") {
+    ThreadPool pool(4);
+
+    SECTION("A single item fans out over the whole pool") {
+        std::mutex mutex;
+        std::set<std::thread::id> threads;
+        ParallelForOnPool(pool, 1, [&](size_t) {
+            ParallelFor(64, [&](size_t) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                std::lock_guard<std::mutex> lock(mutex);
+                threads.insert(std::this_thread::get_id());
+            });
+        }, 1);
+        REQUIRE(threads.size() > 1);
+    }
+
+    SECTION("Items in flight stay within the limit") {
+        std::atomic<int> inflight{0};
+        std::atomic<int> peak{0};
+        std::atomic<int> done{0};
+        ParallelForOnPool(pool, 16, [&](size_t) {
+            int now = inflight.fetch_add(1) + 1;
+            for (int seen = peak.load(); now > seen && !peak.compare_exchange_weak(seen, now);) {
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            inflight.fetch_sub(1);
+            done.fetch_add(1);
+        }, 2);
+        REQUIRE(done == 16);
+        REQUIRE(peak <= 2);
+    }
+
+    SECTION("The first exception is rethrown") {
+        REQUIRE_THROWS_AS(ParallelForOnPool(pool, 8, [](size_t i) {
+            if (i == 3) {
+                throw std::runtime_error("item failed");
+            }
+        }), std::runtime_error);
+    }
+}
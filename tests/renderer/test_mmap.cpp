@@ -0,0 +1,69 @@
+#include <catch2/catch_test_macros.hpp>
+#include <tekki/renderer/mmap.h>
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+using namespace tekki::renderer;
+namespace fs = std::filesystem;
+
+namespace {
+
+struct Header {
+    uint32_t Magic;
+    uint32_t Count;
+};
+
+} // namespace
+
+TEST_CASE("AssetMmapManager", "[renderer][mmap]") {
+    auto path = fs::temp_directory_path() / "tekki_test_mmap.bin";
+    std::vector<uint32_t> words(4096, 7);
+    words[0] = 0x1234;
+    words[1] = 42;
+    std::ofstream(path, std::ios::binary).write(reinterpret_cast<const char*>(words.data()), words.size() * 4);
+    const uint64_t file_size = words.size() * 4;
+
+    SECTION("Handles share one mapping that goes away with the last of them") {
+        const auto before = AssetMmapManager::GetStats();
+        {
+            auto header = AssetMmapManager::MmappedAsset<Header>(path);
+            REQUIRE(header->Magic == 0x1234);
+            REQUIRE(header->Count == 42);
+
+            auto again = AssetMmapManager::MmappedAsset<Header>(fs::path(path).replace_filename("./tekki_test_mmap.bin"));
+            REQUIRE(again.get() == header.get());
+
+            auto stats = AssetMmapManager::GetStats();
+            REQUIRE(stats.MappedFiles == before.MappedFiles + 1);
+            REQUIRE(stats.MappedBytes == before.MappedBytes + file_size);
+
+            AssetMmapManager::Prefetch(path);
+            AssetMmapManager::Evict(path);
+            REQUIRE(header->Count == 42);
+        }
+        auto after = AssetMmapManager::GetStats();
+        REQUIRE(after.MappedFiles == before.MappedFiles);
+        REQUIRE(after.MappedBytes == before.MappedBytes);
+    }
+
+    SECTION("Resident bytes follow the pages that were touched") {
+        auto file = AssetMmapManager::Map(path);
+        uint64_t sum = 0;
+        for (uint8_t byte : file->Bytes()) {
+            sum += byte;
+        }
+        REQUIRE(sum == 4094 * 7 + 0x34 + 0x12 + 42);
+        REQUIRE(file->ResidentBytes() == file_size);
+        REQUIRE(AssetMmapManager::GetStats().ResidentBytes >= file_size);
+    }
+
+    SECTION("Missing and short files are rejected") {
+        REQUIRE_THROWS(AssetMmapManager::Map(path.string() + ".missing"));
+        REQUIRE_THROWS(AssetMmapManager::MmappedAsset<std::array<uint8_t, 1 << 20>>(path));
+    }
+
+    fs::remove(path);
+}
@@ -2,36 +2,153 @@
 #include <CLI/CLI.hpp>
 #include <filesystem>
 #include <iostream>
+#include <map>
 #include <string>
+#include <vector>
 
 using namespace tekki::kajiya_asset_pipe;
 
 /**
  * Bake tool - Kanelbullar
  *
- * Processes mesh assets from GLTF format into optimized .mesh and .image cache files
+ * Processes mesh assets from GLTF format into optimized .mesh (or instanced .scene) and .image cache files,
+ * or a single .pack.
+ * Unchanged outputs of earlier bakes are reused; cache/<name>.manifest.json records what was rebuilt.
+ * With --batch, every scene of a JSON manifest is baked in one process, sharing image work.
+ * With --environment, an EXR environment is prefiltered into specular and irradiance images.
  */
 int main(int argc, char** argv) {
     CLI::App app{"bake - Kanelbullar"};
 
     std::filesystem::path scenePath;
+    std::filesystem::path batchPath;
+    std::filesystem::path environmentPath;
+    tekki::asset::EnvironmentBakeOptions environmentOptions;
+    size_t sceneJobs = 0;
     float scale = 1.0f;
     std::string outputName;
+    bool optimizeVertexOrder = false;
+    bool quantizeVertices = false;
+    std::vector<float> lodErrors;
+    bool noWeld = false;
+    float weldEpsilon = 0.0f;
+    bool instanceMeshes = false;
+    bool noShortIndices = false;
+    uint32_t atlasMaxSize = 0;
+    size_t jobs = 0;
+    uint64_t maxInflightMb = 2048;
+    auto textureQuality = tekki::asset::TexCompressionQuality::Normal;
+    bool pack = false;
+    auto packCompression = tekki::asset::CompressionCodec::None;
+    bool force = false;
 
     // Add command line options
-    app.add_option("--scene", scenePath, "Path to the scene file (GLTF)")
-        ->required()
+    auto* sceneOption = app.add_option("--scene", scenePath, "Path to the scene file (GLTF)")
         ->check(CLI::ExistingFile);
 
     app.add_option("--scale", scale, "Scale factor for the mesh")
         ->default_val(1.0f);
 
-    app.add_option("-o", outputName, "Output name for the baked mesh")
-        ->required();
+    auto* outputOption = app.add_option("-o", outputName, "Output name for the baked mesh");
+
+    auto* batchOption = app.add_option("--batch", batchPath,
+                   "JSON manifest of scenes to bake together; the other options are defaults for its entries")
+        ->check(CLI::ExistingFile)
+        ->excludes(sceneOption)
+        ->excludes(outputOption);
+
+    app.add_option("--environment", environmentPath,
+                   "Equirectangular EXR to bake into a GGX-prefiltered cube and SH irradiance instead of a scene")
+        ->check(CLI::ExistingFile)
+        ->excludes(sceneOption)
+        ->excludes(batchOption);
+
+    app.add_option("--env-size", environmentOptions.CubeSize, "Face size of the baked environment cube")
+        ->default_val(256);
+
+    app.add_option("--env-samples", environmentOptions.Specular.SampleCount, "GGX samples per prefiltered cube texel")
+        ->default_val(256);
+
+    app.add_option("--scene-jobs", sceneJobs, "Batch scenes loaded and packed at once (0 = a quarter of hardware threads)")
+        ->default_val(0);
+
+    app.add_flag("--optimize-vertex-order", optimizeVertexOrder,
+                 "Reorder triangles and vertices for GPU vertex cache and fetch locality");
+
+    app.add_flag("--quantize", quantizeVertices,
+                 "Store compact quantised vertex streams and a varint-coded index stream");
+
+    app.add_option("--lod-errors", lodErrors,
+                   "Build simplified LODs, one per error bound relative to the mesh size (e.g. 0.001,0.005,0.02)")
+        ->delimiter(',');
+
+    app.add_flag("--no-weld", noWeld, "Keep duplicate vertices instead of welding them");
+
+    app.add_option("--weld-epsilon", weldEpsilon,
+                   "Weld vertices whose attributes all differ by at most this much (0 = bitwise-equal only)")
+        ->default_val(0.0f);
+
+    app.add_flag("--instance-meshes", instanceMeshes,
+                 "Bake each unique glTF mesh once with its instance transforms, into a .scene");
+
+    app.add_flag("--no-short-indices", noShortIndices,
+                 "Keep 32-bit indices for material ranges that would fit 16-bit ones from a base vertex");
+
+    app.add_option("--atlas-max-size", atlasMaxSize,
+                   "Pack material maps at most this many texels a side into shared atlases (0 = off)")
+        ->default_val(0);
+
+    app.add_option("--jobs", jobs, "Scene packing and image bake threads (0 = all hardware threads)")
+        ->default_val(0);
+
+    app.add_option("--max-inflight-mb", maxInflightMb, "Memory budget for images baked at once, in MiB (0 = unlimited)")
+        ->default_val(2048);
+
+    const std::map<std::string, tekki::asset::TexCompressionQuality> qualityNames{
+        {"fast", tekki::asset::TexCompressionQuality::Fast},
+        {"normal", tekki::asset::TexCompressionQuality::Normal},
+        {"best", tekki::asset::TexCompressionQuality::Best},
+    };
+    app.add_option("--bc-quality", textureQuality, "Texture block compression effort: fast, normal or best")
+        ->transform(CLI::CheckedTransformer(qualityNames, CLI::ignore_case))
+        ->default_str("normal");
+
+    app.add_flag("--pack", pack, "Write one .pack archive holding the mesh and its images");
+
+    const std::map<std::string, tekki::asset::CompressionCodec> codecNames{
+        {"none", tekki::asset::CompressionCodec::None},
+        {"zstd", tekki::asset::CompressionCodec::Zstd},
+        {"lz4", tekki::asset::CompressionCodec::Lz4},
+    };
+    app.add_option("--pack-compression", packCompression,
+                   "Block compression of pack entries: none, lz4 (fast decode) or zstd (smaller)")
+        ->transform(CLI::CheckedTransformer(codecNames, CLI::ignore_case))
+        ->default_str("none");
+
+    app.add_flag("--force", force, "Rebake everything instead of reusing unchanged outputs of earlier bakes");
 
     // Parse command line arguments
     CLI11_PARSE(app, argc, argv);
 
+    if (!environmentPath.empty()) {
+        if (outputName.empty()) {
+            std::cerr << "Error: --environment requires -o" << std::endl;
+            return 1;
+        }
+        try {
+            EnvironmentAssetProcessor::ProcessEnvironment({environmentPath, outputName, environmentOptions, !force});
+            return 0;
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+    if (batchPath.empty() && (scenePath.empty() || outputName.empty())) {
+        std::cerr << "Error: either --batch, --environment, or --scene and -o are required" << std::endl;
+        return 1;
+    }
+
     try {
         // Initialize logging (equivalent to env_logger::init())
         // spdlog is initialized automatically in the backend
@@ -40,10 +157,30 @@ int main(int argc, char** argv) {
         MeshAssetProcessParams params{
             scenePath,
             outputName,
-            scale
+            scale,
+            optimizeVertexOrder,
+            quantizeVertices,
+            lodErrors,
+            !noWeld,
+            weldEpsilon,
+            instanceMeshes,
+            !noShortIndices,
+            atlasMaxSize,
+            jobs,
+            maxInflightMb,
+            textureQuality,
+            pack,
+            packCompression,
+            !force
         };
 
-        MeshAssetProcessor::ProcessMeshAsset(params);
+        if (!batchPath.empty()) {
+            auto batch = MeshAssetProcessor::LoadBatch(batchPath, params);
+            batch.SceneJobs = sceneJobs;
+            MeshAssetProcessor::ProcessBatch(batch);
+        } else {
+            MeshAssetProcessor::ProcessMeshAsset(params);
+        }
 
         return 0;
 
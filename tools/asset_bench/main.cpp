@@ -0,0 +1,308 @@
+#include <tekki/asset/asset_pack.h>
+#include <tekki/asset/bc_compress.h>
+#include <tekki/asset/mesh.h>
+#include <tekki/asset/mesh_quantize.h>
+#include <tekki/asset/mip_chain.h>
+#include <tekki/core/parallel.h>
+#include <CLI/CLI.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace tekki::asset;
+
+namespace {
+
+// Wavy grid with roughly `triangle_count` triangles, so tangents vary per vertex.
+TriangleMesh MakeGridMesh(size_t triangle_count) {
+    uint32_t quads_per_side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(triangle_count) / 2.0)));
+    uint32_t verts_per_side = quads_per_side + 1;
+    size_t vertex_count = static_cast<size_t>(verts_per_side) * verts_per_side;
+
+    TriangleMesh mesh;
+    mesh.Positions.resize(vertex_count);
+    mesh.Normals.resize(vertex_count);
+    mesh.Uvs.resize(vertex_count);
+    mesh.Tangents.resize(vertex_count);
+    mesh.Indices.resize(static_cast<size_t>(quads_per_side) * quads_per_side * 6);
+
+    tekki::core::ParallelFor(verts_per_side, [&](size_t y) {
+        for (uint32_t x = 0; x < verts_per_side; ++x) {
+            size_t i = y * verts_per_side + x;
+            float u = static_cast<float>(x) / quads_per_side;
+            float v = static_cast<float>(y) / quads_per_side;
+            float h = 0.05f * std::sin(u * 40.0f) * std::cos(v * 40.0f);
+            float dhdu = 2.0f * std::cos(u * 40.0f) * std::cos(v * 40.0f);
+            float dhdv = -2.0f * std::sin(u * 40.0f) * std::sin(v * 40.0f);
+            float inv_len = 1.0f / std::sqrt(dhdu * dhdu + dhdv * dhdv + 1.0f);
+
+            mesh.Positions[i] = {u, v, h};
+            mesh.Normals[i] = {-dhdu * inv_len, -dhdv * inv_len, inv_len};
+            mesh.Uvs[i] = {u, v};
+        }
+    });
+
+    tekki::core::ParallelFor(quads_per_side, [&](size_t y) {
+        for (uint32_t x = 0; x < quads_per_side; ++x) {
+            uint32_t i = static_cast<uint32_t>(y * verts_per_side + x);
+            size_t base = (y * quads_per_side + x) * 6;
+            uint32_t quad[6] = {i, i + 1, i + verts_per_side, i + 1, i + verts_per_side + 1, i + verts_per_side};
+            std::copy(std::begin(quad), std::end(quad), mesh.Indices.begin() + base);
+        }
+    });
+
+    return mesh;
+}
+
+template<typename F>
+double BestSeconds(int iterations, F&& fn) {
+    double best = 0.0;
+    for (int i = 0; i < iterations; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        best = i == 0 ? seconds : std::min(best, seconds);
+    }
+    return best;
+}
+
+void BenchTangents(size_t triangle_count, int iterations) {
+    std::cout << "Building a " << triangle_count << "-triangle grid..." << std::endl;
+    TriangleMesh mesh = MakeGridMesh(triangle_count);
+    size_t actual_triangles = mesh.Indices.size() / 3;
+
+    double seconds = BestSeconds(iterations, [&]() {
+        TangentCalcContext{mesh.Indices, mesh.Positions, mesh.Normals, mesh.Uvs, mesh.Tangents}.GenerateTangents();
+    });
+
+    std::cout << "tangents: " << actual_triangles << " triangles, " << mesh.Positions.size() << " vertices, "
+              << tekki::core::HardwareConcurrency() << " threads" << std::endl;
+    std::cout << "tangents: best of " << iterations << ": " << seconds * 1000.0 << " ms, "
+              << static_cast<double>(actual_triangles) / seconds / 1.0e6 << " Mtri/s" << std::endl;
+}
+
+void BenchDequantize(size_t triangle_count, int iterations) {
+    std::cout << "Building a " << triangle_count << "-triangle grid..." << std::endl;
+    TriangleMesh grid = MakeGridMesh(triangle_count);
+    TangentCalcContext{grid.Indices, grid.Positions, grid.Normals, grid.Uvs, grid.Tangents}.GenerateTangents();
+
+    PackedTriangleMesh mesh = PackTriangleMesh(grid, PackTriangleMeshOptions{.OptimizeVertexOrder = true});
+    auto report = QuantizeVertexStreams(mesh);
+    size_t vertex_count = mesh.QuantizedVerts.size();
+
+    std::vector<std::array<float, 3>> positions(vertex_count);
+    std::vector<std::array<float, 2>> uvs(vertex_count);
+    std::vector<uint32_t> indices(mesh.IndexStreamCount);
+
+    double vertex_seconds = BestSeconds(iterations, [&]() {
+        DecodePositions(mesh.QuantizedVerts, mesh.PositionMin, mesh.PositionScale, positions);
+        DecodeHalfUvs(mesh.HalfUvs, uvs);
+    });
+    double index_seconds = BestSeconds(iterations, [&]() {
+        DecodeIndexStream(mesh.IndexStream, indices);
+    });
+
+    std::cout << "dequantize: " << vertex_count << " vertices, " << indices.size() << " indices, "
+              << report.FullBytes << " -> " << report.QuantizedBytes << " bytes" << std::endl;
+    std::cout << "dequantize: positions + uvs: " << vertex_seconds * 1000.0 << " ms, "
+              << static_cast<double>(vertex_count) / vertex_seconds / 1.0e6 << " Mvert/s" << std::endl;
+    std::cout << "dequantize: indices: " << index_seconds * 1000.0 << " ms, "
+              << static_cast<double>(indices.size()) / index_seconds / 1.0e6 << " Mindex/s" << std::endl;
+}
+
+// Albedo-like colour ramps with detail, and a tangent-space normal map of the same bumps.
+std::vector<uint8_t> MakeTestImage(uint32_t size, bool normal_map) {
+    std::vector<uint8_t> rgba(static_cast<size_t>(size) * size * 4);
+    tekki::core::ParallelFor(size, [&](size_t y) {
+        for (uint32_t x = 0; x < size; ++x) {
+            float u = static_cast<float>(x) / size;
+            float v = static_cast<float>(y) / size;
+            float dhdu = std::cos(u * 60.0f) * std::cos(v * 45.0f);
+            float dhdv = -std::sin(u * 60.0f) * std::sin(v * 45.0f);
+            uint8_t* p = &rgba[(y * size + x) * 4];
+
+            if (normal_map) {
+                float inv_len = 1.0f / std::sqrt(dhdu * dhdu + dhdv * dhdv + 1.0f);
+                p[0] = static_cast<uint8_t>(std::lround((-dhdu * inv_len * 0.5f + 0.5f) * 255.0f));
+                p[1] = static_cast<uint8_t>(std::lround((-dhdv * inv_len * 0.5f + 0.5f) * 255.0f));
+                p[2] = static_cast<uint8_t>(std::lround((inv_len * 0.5f + 0.5f) * 255.0f));
+            } else {
+                p[0] = static_cast<uint8_t>(std::lround(255.0f * u * (0.75f + 0.25f * dhdu)));
+                p[1] = static_cast<uint8_t>(std::lround(255.0f * v * (0.75f + 0.25f * dhdv)));
+                p[2] = static_cast<uint8_t>(std::lround(127.0f + 100.0f * dhdu * dhdv));
+            }
+            p[3] = 255;
+        }
+    });
+    return rgba;
+}
+
+double Psnr(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b, int channels) {
+    double sum = 0.0;
+    for (size_t i = 0; i < a.size(); i += 4) {
+        for (int c = 0; c < channels; ++c) {
+            double d = static_cast<double>(a[i + c]) - static_cast<double>(b[i + c]);
+            sum += d * d;
+        }
+    }
+    double mse = sum / static_cast<double>(a.size() / 4 * channels);
+    return mse == 0.0 ? 100.0 : 10.0 * std::log10(255.0 * 255.0 / mse);
+}
+
+void BenchBlockCompression(uint32_t size, int iterations) {
+    const std::pair<TexCompressionQuality, const char*> qualities[] = {
+        {TexCompressionQuality::Fast, "fast"},
+        {TexCompressionQuality::Normal, "normal"},
+        {TexCompressionQuality::Best, "best"},
+    };
+    const double megapixels = static_cast<double>(size) * size / 1.0e6;
+
+    std::cout << "bc: " << size << "x" << size << " images, " << tekki::core::HardwareConcurrency() << " threads" << std::endl;
+    for (BcMode mode : {BcMode::Bc7, BcMode::Bc5}) {
+        const char* name = mode == BcMode::Bc7 ? "bc7" : "bc5";
+        auto rgba = MakeTestImage(size, mode == BcMode::Bc5);
+
+        for (const auto& [quality, quality_name] : qualities) {
+            std::vector<uint8_t> blocks;
+            double seconds = BestSeconds(iterations, [&]() {
+                blocks = CompressBc(rgba, size, size, mode, false, quality);
+            });
+            double psnr = Psnr(rgba, DecompressBc(blocks, size, size, mode), mode == BcMode::Bc7 ? 3 : 2);
+
+            std::cout << "bc: " << name << " " << quality_name << ": " << seconds * 1000.0 << " ms, "
+                      << megapixels / seconds << " MP/s, " << psnr << " dB" << std::endl;
+        }
+    }
+}
+
+void BenchMipChain(uint32_t size, int iterations) {
+    auto rgba = MakeTestImage(size, false);
+    const double megapixels = static_cast<double>(size) * size / 1.0e6;
+
+    std::cout << "mips: " << size << "x" << size << " image, " << tekki::core::HardwareConcurrency() << " threads" << std::endl;
+    for (auto [filter, name] : {std::pair{TexMipFilter::Box, "box"}, std::pair{TexMipFilter::Kaiser, "kaiser"}}) {
+        double seconds = BestSeconds(iterations, [&]() {
+            GenerateMipChain(rgba, size, size, MipChainOptions{TexGamma::Srgb, filter});
+        });
+        std::cout << "mips: " << name << ": " << seconds * 1000.0 << " ms, " << megapixels / seconds
+                  << " source MP/s" << std::endl;
+    }
+}
+
+// Packs an RGBA8 mip chain and a BC7 image with each codec, then decodes every entry.
+void BenchPackDecode(uint32_t size, int iterations) {
+    auto rgba = MakeTestImage(size, false);
+    GpuImage::Proto rgba_image;
+    rgba_image.Format = 37; // VK_FORMAT_R8G8B8A8_UNORM
+    rgba_image.Extent = {size, size, 1};
+    rgba_image.Mips = GenerateMipChain(rgba, size, size, MipChainOptions{TexGamma::Srgb, TexMipFilter::Box});
+    rgba_image.Mips.insert(rgba_image.Mips.begin(), rgba);
+
+    GpuImage::Proto bc_image;
+    bc_image.Format = 146; // VK_FORMAT_BC7_SRGB_BLOCK
+    bc_image.Extent = {size, size, 1};
+    bc_image.Mips.push_back(CompressBc(rgba, size, size, BcMode::Bc7, false, TexCompressionQuality::Fast));
+
+    const auto path = std::filesystem::temp_directory_path() / "tekki_bench.pack";
+    std::cout << "pack: " << size << "x" << size << " images, " << tekki::core::HardwareConcurrency() << " threads" << std::endl;
+    for (auto codec : {CompressionCodec::Lz4, CompressionCodec::Zstd}) {
+        uint64_t flat_bytes = 0;
+        uint64_t stored_bytes = 0;
+        double encode_seconds = BestSeconds(1, [&]() {
+            AssetPackWriter writer(path, codec);
+            writer.Add(1, rgba_image);
+            writer.Add(2, bc_image);
+            writer.Finish();
+            flat_bytes = writer.GetFlatBytes();
+            stored_bytes = writer.GetStoredBytes();
+        });
+
+        auto pack = AssetPack::Open(path);
+        std::vector<std::vector<uint8_t>> uploads;
+        for (const auto& entry : pack->GetEntries()) {
+            uploads.emplace_back(static_cast<size_t>(entry.Size));
+        }
+        double decode_seconds = BestSeconds(iterations, [&]() {
+            for (size_t i = 0; i < uploads.size(); ++i) {
+                pack->LoadInto(pack->GetEntries()[i], uploads[i]);
+            }
+        });
+
+        std::cout << "pack: " << CompressionCodecName(codec) << ": ratio "
+                  << static_cast<double>(flat_bytes) / static_cast<double>(stored_bytes) << ", encode "
+                  << encode_seconds * 1000.0 << " ms, decode " << decode_seconds * 1000.0 << " ms, "
+                  << static_cast<double>(flat_bytes) / decode_seconds / 1.0e9 << " GB/s" << std::endl;
+    }
+    std::filesystem::remove(path);
+}
+
+} // namespace
+
+/**
+ * Asset pipeline benchmarks
+ *
+ * Measures the throughput of the CPU-heavy asset baking stages on synthetic inputs
+ */
+int main(int argc, char** argv) {
+    CLI::App app{"tekki asset pipeline benchmarks"};
+    app.require_subcommand(1);
+
+    int iterations = 3;
+    app.add_option("--iterations", iterations, "Runs per benchmark; the best one is reported")
+        ->default_val(3)
+        ->check(CLI::PositiveNumber);
+
+    size_t triangleCount = 10'000'000;
+    auto* tangents = app.add_subcommand("tangents", "MikkTSpace tangent generation");
+    tangents->add_option("--triangles", triangleCount, "Triangle count of the synthetic mesh")
+        ->default_val(10'000'000);
+
+    auto* dequantize = app.add_subcommand("dequantize", "Quantised vertex and index stream decoding");
+    dequantize->add_option("--triangles", triangleCount, "Triangle count of the synthetic mesh")
+        ->default_val(10'000'000);
+
+    uint32_t imageSize = 2048;
+    auto* bc = app.add_subcommand("bc", "BC7 and BC5 block compression");
+    bc->add_option("--size", imageSize, "Width and height of the synthetic image")
+        ->default_val(2048)
+        ->check(CLI::PositiveNumber);
+
+    auto* mips = app.add_subcommand("mips", "sRGB mip chain generation");
+    mips->add_option("--size", imageSize, "Width and height of the synthetic image")
+        ->default_val(2048)
+        ->check(CLI::PositiveNumber);
+
+    auto* pack = app.add_subcommand("pack", "Asset pack block compression and parallel decode");
+    pack->add_option("--size", imageSize, "Width and height of the synthetic images")
+        ->default_val(2048)
+        ->check(CLI::PositiveNumber);
+
+    CLI11_PARSE(app, argc, argv);
+
+    try {
+        if (*tangents) {
+            BenchTangents(triangleCount, iterations);
+        }
+        if (*dequantize) {
+            BenchDequantize(triangleCount, iterations);
+        }
+        if (*bc) {
+            BenchBlockCompression(imageSize, iterations);
+        }
+        if (*mips) {
+            BenchMipChain(imageSize, iterations);
+        }
+        if (*pack) {
+            BenchPackDecode(imageSize, iterations);
+        }
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}